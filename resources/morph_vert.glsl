@@ -5,17 +5,17 @@ in vec3 ciNormal;
 in vec3 ciTangent;
 in vec2 ciTexCoord0;
 
-// These attributes need to be manually added/updated if more morph targets are added
-in vec3 vPositionDiff0;
-in vec3 vPositionDiff1;
-in vec3 vPositionDiff2;
+// First and number of this vertex's offsets in uMorphDeltas.
+in vec2 vMorphRange;
 
 uniform mat4 ciModelViewProjection;
 uniform mat4 ciModelView;
 uniform mat3 ciNormalMatrix;
 uniform float ciElapsedSeconds;
 
-uniform float uWeights[10];
+// Offset in xyz, index of its target (in uMorphWeights) in w.
+uniform samplerBuffer uMorphDeltas;
+uniform samplerBuffer uMorphWeights;
 
 out vec4	vVertex;
 out vec3	vNormal;
@@ -26,9 +26,12 @@ out vec2	vTexCoord0;
 void main()
 {	
 	vec4 pos	= ciPosition;
-	pos.xyz		+= uWeights[0] * vPositionDiff0;
-	pos.xyz		+= uWeights[1] * vPositionDiff1;
-	pos.xyz		+= uWeights[2] * vPositionDiff2;
+	int first	= int( vMorphRange.x );
+	int count	= int( vMorphRange.y );
+	for( int i = 0; i < count; ++i ) {
+		vec4 delta	= texelFetch( uMorphDeltas, first + i );
+		pos.xyz		+= texelFetch( uMorphWeights, int( delta.w ) ).r * delta.xyz;
+	}
 
 	vec4 tang	= vec4(ciTangent, 1.0);
 	vec4 norm	= vec4(ciNormal, 1.0);
@@ -0,0 +1,62 @@
+#version 330
+
+// Decodes the PackedVertices layout: every attribute but the position is packed in integers.
+in vec4 ciPosition;
+in int ciNormal;
+in int ciTangent;
+in int ciTexCoord0;
+
+uniform mat4 ciModelViewProjection;
+uniform mat4 ciModelView;
+uniform mat3 ciNormalMatrix;
+
+// outputs passed to the fragment shader
+out vec4	vVertex;
+out vec3	vNormal;
+out vec3	vTangent;
+out vec3	vBiTangent;
+out vec2	vTexCoord0;
+
+vec3 decodeOctahedral( vec2 e ) {
+	vec3 v = vec3( e, 1.0 - abs( e.x ) - abs( e.y ) );
+	float t = max( -v.z, 0.0 );
+	v.x += ( v.x >= 0.0 ) ? -t : t;
+	v.y += ( v.y >= 0.0 ) ? -t : t;
+	return normalize( v );
+}
+
+vec3 decodeNormal( int v ) {
+	// 2 x snorm16, sign-extended by the arithmetic shifts
+	vec2 e = vec2( ( v << 16 ) >> 16, v >> 16 ) / 32767.0;
+	return decodeOctahedral( clamp( e, -1.0, 1.0 ) );
+}
+
+vec3 decodeTangent( int v ) {
+	// 2 x unorm15, the bitangent sign lives in bit 31
+	vec2 e = vec2( v & 0x7FFF, ( v >> 15 ) & 0x7FFF ) / 32767.0 * 2.0 - 1.0;
+	return decodeOctahedral( e );
+}
+
+float decodeHalf( int h ) {
+	int e = ( h >> 10 ) & 0x1F;
+	float m = float( h & 0x3FF );
+	float v = ( e == 0 ) ? m * exp2( -24.0 ) : ( 1.0 + m / 1024.0 ) * exp2( float( e - 15 ) );
+	return ( ( h & 0x8000 ) != 0 ) ? -v : v;
+}
+
+void main()
+{
+	vec3 normal		= decodeNormal( ciNormal );
+	vec3 tangent	= decodeTangent( ciTangent );
+	float handedness = ( ciTangent < 0 ) ? -1.0 : 1.0;
+	vec2 texCoord	= vec2( decodeHalf( ciTexCoord0 ), decodeHalf( ciTexCoord0 >> 16 ) );
+	
+	vVertex		= ciModelView * ciPosition;
+	vNormal		= normalize(ciNormalMatrix * normal);
+	vTangent	= normalize(ciNormalMatrix * tangent);
+	vBiTangent	= handedness * normalize(cross(vNormal, vTangent));
+	//modulo to support symmetric texture lookups
+	vTexCoord0 = mod(texCoord, vec2(1.0));
+	
+	gl_Position = ciModelViewProjection * ciPosition;
+}
@@ -41,8 +41,8 @@ vec4 skinInverseTranspose( in vec4 pos ) {
 void main()
 {	
 	vec4 pos	= skinBone( ciPosition );
-	vec4 tang	= skinBone( vec4(ciTangent, 1.0) );
-	vec4 norm	= skinInverseTranspose( vec4(ciNormal, 1.0) );
+	vec4 tang	= skinBone( vec4(ciTangent, 0.0) );
+	vec4 norm	= skinInverseTranspose( vec4(ciNormal, 0.0) );
 	
 	pos.w = 1.0;
 	norm.w = 0.0;
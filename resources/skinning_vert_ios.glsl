@@ -38,7 +38,7 @@ vec4 skinInverseTranspose( in vec4 pos ) {
 void main()
 {	
 	vec4 pos	= skinBone( ciPosition );
-	vec4 norm	= skinInverseTranspose( vec4(ciNormal, 1.0) );
+	vec4 norm	= skinInverseTranspose( vec4(ciNormal, 0.0) );
 	
 	pos.w = 1.0;
 	norm.w = 0.0;
@@ -0,0 +1,75 @@
+#include "Benchmark.h"
+
+#include "Cinder-Assimp/include/AssimpLoader.h"
+
+#include "cinder/Rand.h"
+
+using namespace ci;
+using namespace model;
+
+namespace {
+	
+	const unsigned int NUM_VERTICES = 2000000;
+	
+	//! A triangulated mesh with every attribute the loader extracts, at random values.
+	void fillMesh( aiMesh* aimesh )
+	{
+		Rand rand( 1 );
+		auto randomVectors = [&] () -> aiVector3D* {
+			aiVector3D* vectors = new aiVector3D[NUM_VERTICES];
+			for( unsigned int v = 0; v < NUM_VERTICES; ++v ) {
+				vectors[v] = aiVector3D( rand.nextFloat(), rand.nextFloat(), rand.nextFloat() );
+			}
+			return vectors;
+		};
+		aimesh->mPrimitiveTypes = aiPrimitiveType_TRIANGLE;
+		aimesh->mNumVertices = NUM_VERTICES;
+		aimesh->mVertices = randomVectors();
+		aimesh->mNormals = randomVectors();
+		aimesh->mTangents = randomVectors();
+		aimesh->mBitangents = randomVectors();
+		aimesh->mTextureCoords[0] = randomVectors();
+		aimesh->mNumUVComponents[0] = 2;
+		
+		aimesh->mNumFaces = NUM_VERTICES - 2;
+		aimesh->mFaces = new aiFace[aimesh->mNumFaces];
+		for( unsigned int f = 0; f < aimesh->mNumFaces; ++f ) {
+			aiFace& face = aimesh->mFaces[f];
+			face.mNumIndices = 3;
+			face.mIndices = new unsigned int[3] { f, f + 1, f + 2 };
+		}
+	}
+	
+	//! The extraction before the bulk path: one push_back per vertex.
+	std::vector<vec3> pushBackVectors( const aiVector3D* vectors, unsigned int count )
+	{
+		std::vector<vec3> result;
+		for( unsigned int v = 0; v < count; ++v ) {
+			result.push_back( ai::get( vectors[v] ) );
+		}
+		return result;
+	}
+	
+} // anonymous namespace
+
+namespace bench {
+
+void attributes( const Context& context, Report* report )
+{
+	report->begin( "Attribute extraction (user-001), " + std::to_string( NUM_VERTICES ) + " vertices" );
+	aiMesh aimesh;
+	fillMesh( &aimesh );
+	
+	auto addRate = [&] ( const std::string& label, double seconds ) {
+		report->add( label, NUM_VERTICES / seconds * 1e-6, "M vertices/s" );
+	};
+	addRate( "positions", bestTime( [&] { ai::getPositions( &aimesh ); } ) );
+	addRate( "normals", bestTime( [&] { ai::getNormals( &aimesh ); } ) );
+	addRate( "tangents", bestTime( [&] { ai::getTangents( &aimesh ); } ) );
+	addRate( "bitangents", bestTime( [&] { ai::getBitangents( &aimesh ); } ) );
+	addRate( "texture coordinates", bestTime( [&] { ai::getTexCoords( &aimesh ); } ) );
+	addRate( "indices", bestTime( [&] { ai::getIndices( &aimesh ); } ) );
+	addRate( "positions, per-vertex push_back (before)", bestTime( [&] { pushBackVectors( aimesh.mVertices, aimesh.mNumVertices ); } ) );
+}
+
+} //end namespace bench
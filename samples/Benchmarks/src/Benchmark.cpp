@@ -0,0 +1,80 @@
+#include "Benchmark.h"
+
+#include "cinder/CinderMath.h"
+#include "cinder/Log.h"
+#include "cinder/Rand.h"
+
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+namespace bench {
+
+void Report::begin( const std::string& title )
+{
+	mLines.push_back( title );
+	CI_LOG_I( title );
+}
+
+void Report::add( const std::string& label, double value, const std::string& unit, int precision )
+{
+	std::ostringstream line;
+	line << "  " << label << ": " << std::fixed << std::setprecision( precision ) << value << " " << unit;
+	mLines.push_back( line.str() );
+	CI_LOG_I( line.str() );
+}
+
+void Report::note( const std::string& text )
+{
+	mLines.push_back( "  " + text );
+	CI_LOG_I( text );
+}
+
+void createSphere( size_t rings, std::vector<glm::vec3>* positions, std::vector<uint32_t>* indices )
+{
+	const size_t segments = 2 * rings;
+	for( size_t r = 0; r <= rings; ++r ) {
+		const float theta = float( M_PI ) * r / rings;
+		for( size_t s = 0; s <= segments; ++s ) {
+			const float phi = 2.0f * float( M_PI ) * s / segments;
+			positions->push_back( glm::vec3( std::sin( theta ) * std::cos( phi ), std::cos( theta ), std::sin( theta ) * std::sin( phi ) ) );
+		}
+	}
+	for( size_t r = 0; r < rings; ++r ) {
+		for( size_t s = 0; s < segments; ++s ) {
+			const uint32_t a = uint32_t( r * ( segments + 1 ) + s ), b = a + uint32_t( segments + 1 );
+			indices->insert( indices->end(), { a, b, a + 1, a + 1, b, b + 1 } );
+		}
+	}
+}
+
+model::SkeletonRef createRig( size_t numNodes, size_t numTracks, size_t numKeyframes )
+{
+	using namespace model;
+	
+	ci::Rand rand( 1 );
+	std::vector<NodeRef> nodes;
+	nodes.reserve( numNodes );
+	for( size_t i = 0; i < numNodes; ++i ) {
+		NodeRef parent = ( i > 0 ) ? nodes[( i - 1 ) / 2] : nullptr;
+		NodeRef node = Node::create( rand.randVec3(), glm::angleAxis( rand.nextFloat( 3.14f ), rand.randVec3() ), glm::vec3( 1 ),
+									"node" + std::to_string( i ), parent, parent ? parent->getLevel() + 1 : 0 );
+		if( parent ) {
+			parent->addChild( node );
+		}
+		node->setBoneIndex( i );
+		node->setOffsetMatrix( glm::translate( -rand.randVec3() ) );
+		for( size_t t = 0; t < numTracks; ++t ) {
+			node->addAnimTrack( int( t ), float( numKeyframes - 1 ), 30.0f );
+			for( size_t k = 0; k < numKeyframes; ++k ) {
+				node->addPositionKeyframe( int( t ), float( k ), rand.randVec3() );
+				node->addRotationKeyframe( int( t ), float( k ), glm::angleAxis( rand.nextFloat( 3.14f ), rand.randVec3() ) );
+				node->addScalingKeyframe( int( t ), float( k ), glm::vec3( 1 ) );
+			}
+		}
+		nodes.push_back( node );
+	}
+	return Skeleton::create( nodes.front() );
+}
+
+} //end namespace bench
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "Cinder-Assimp/include/AssimpLoader.h"
+#include "Cinder-Assimp/include/Skeleton.h"
+
+#include "cinder/DataSource.h"
+#include "cinder/Timer.h"
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <vector>
+
+/* The benchmarks of the block, run by BenchmarksApp. Each one times the current code paths (and, where the
+   previous implementation can be reproduced locally, the previous one) on synthetic data or on the model
+   dropped on the app, and reports its numbers to a Report.
+ */
+
+namespace bench {
+	
+	//! What the benchmarks run on.
+	struct Context {
+		//! Model dropped on the app (or passed as its first argument), null if none. Benchmarks which need one skip themselves otherwise.
+		ci::DataSourceRef	mModel;
+	};
+	
+	//! Lines reported by the benchmarks, printed to the console and drawn by the app.
+	class Report {
+	public:
+		//! Starts the section of a benchmark.
+		void	begin( const std::string& title );
+		//! Adds "label: value unit", the value printed with \a precision decimals.
+		void	add( const std::string& label, double value, const std::string& unit, int precision = 2 );
+		void	note( const std::string& text );
+		
+		const std::vector<std::string>&	getLines() const { return mLines; }
+	private:
+		std::vector<std::string>	mLines;
+	};
+	
+	//! Best wall-clock time, in seconds, of \a numRuns calls of \a fn. The best run is the least disturbed by the rest of the system.
+	template<typename Fn>
+	double bestTime( Fn fn, int numRuns = 5 )
+	{
+		double best = std::numeric_limits<double>::max();
+		for( int r = 0; r < numRuns; ++r ) {
+			ci::Timer timer( true );
+			fn();
+			best = std::min( best, timer.getSeconds() );
+		}
+		return best;
+	}
+	
+	//! A sphere of radius 1 with 4 * \a rings * \a rings triangles, indexed ring by ring like a scan.
+	void	createSphere( size_t rings, std::vector<glm::vec3>* positions, std::vector<uint32_t>* indices );
+	
+	//! Seconds to load \a model with \a settings, each run with an empty SurfacePool so that textures are decoded again.
+	double	loadTime( const ci::DataSourceRef& model, model::AssimpLoader::Settings settings, int numRuns = 3 );
+	
+	/*!
+	 * A synthetic rig of \a numNodes nodes, every one a bone (with an offset) and animated in \a numTracks tracks
+	 * (ids 0 to numTracks - 1) of \a numKeyframes random keyframes, one per tick. Node \a i is the child of node ( i - 1 ) / 2.
+	 */
+	model::SkeletonRef	createRig( size_t numNodes, size_t numTracks, size_t numKeyframes );
+	
+	//! Vertices per second of each ai::get*() attribute extraction.
+	void	attributes( const Context& context, Report* report );
+	//! Load time of the model at 1, 2, 4 and 8 threads.
+	void	loadThreads( const Context& context, Report* report );
+	//! Cost of posing a 200-bone rig, against the previous node tree.
+	void	pose( const Context& context, Report* report );
+	//! Memory per curve and sampling throughput of the keyframe arrays, against the previous std::map.
+	void	curves( const Context& context, Report* report );
+	//! Vertices per second of SkinningEngine on the model's skinned sections, against the previous per-influence skinning.
+	void	skinning( const Context& context, Report* report );
+	//! Compression ratio and largest error of each of the model's clips, and of key reduction and quantization alone.
+	void	compression( const Context& context, Report* report );
+	//! Packing time and size of PackedVertices on the model's sections, with 8 and 16-bit bone weights.
+	void	packing( const Context& context, Report* report );
+	//! Meshlet build time, and cost per view and share of meshlets kept by MeshletCuller, on a synthetic scan and on the model.
+	void	meshlets( const Context& context, Report* report );
+	//! Triangles, error and simplification time of each level of detail, on a synthetic prop and on the model.
+	void	lods( const Context& context, Report* report );
+	//! Build time, memory, frustum culling and ray picking of Bvh, on a synthetic scene and on the model, against scanning every section and triangle.
+	void	bvh( const Context& context, Report* report );
+	//! Draws and state changes per frame of a scene of the model's sections, queued against flushed per draw, counted headlessly.
+	void	renderQueue( const Context& context, Report* report );
+	//! Bytes allocated by each instance of a 60-bone skeleton and of the model's SkeletalMesh, and the time to create one.
+	void	instances( const Context& context, Report* report );
+	//! Cost of resolving the bone and channel names of an import, NameTable against string maps, and the model's load time.
+	void	names( const Context& context, Report* report );
+	//! Cost per blended pose of BlendGraph::evaluate() at 1, 4 and 8 layers, against Skeleton::blendAnimate().
+	void	blend( const Context& context, Report* report );
+	
+} //end namespace bench
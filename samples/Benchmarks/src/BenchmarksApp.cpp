@@ -0,0 +1,111 @@
+/* Runs the benchmarks of the block (see Benchmark.h) and draws their report, also printed to the console.
+   Drop a model on the window, or pass its path as the first argument, to run the benchmarks which need one;
+   the MultipleAnimationsDemo's corgi is used by default.
+ */
+
+#include "Benchmark.h"
+
+#include "cinder/app/App.h"
+#include "cinder/app/RendererGl.h"
+#include "cinder/gl/gl.h"
+
+using namespace ci;
+using namespace ci::app;
+using namespace std;
+
+class BenchmarksApp : public App {
+public:
+	void setup() override;
+	void fileDrop( FileDropEvent event ) override;
+	void keyDown( KeyEvent event ) override;
+	
+	void update() override;
+	void draw() override;
+private:
+	void run();
+	
+	bench::Context	mContext;
+	bench::Report	mReport;
+	bool			mPending;
+};
+
+void BenchmarksApp::setup()
+{
+	// Built from the block's sources, the demo's assets are a sibling of this sample.
+	addAssetDirectory( fs::path( __FILE__ ).parent_path().parent_path().parent_path() / "MultipleAnimationsDemo" / "assets" );
+	
+	const auto& args = getCommandLineArgs();
+	if( args.size() > 1 && fs::exists( args[1] ) ) {
+		mContext.mModel = loadFile( args[1] );
+	}
+	else if( ! getAssetPath( "cu_puppy_corgi.fbx" ).empty() ) {
+		mContext.mModel = loadAsset( "cu_puppy_corgi.fbx" );
+	}
+	mPending = true;
+}
+
+void BenchmarksApp::fileDrop( FileDropEvent event )
+{
+	mContext.mModel = loadFile( event.getFile( 0 ) );
+	mPending = true;
+}
+
+void BenchmarksApp::keyDown( KeyEvent event )
+{
+	if( event.getCode() == KeyEvent::KEY_r ) {
+		mPending = true;
+	} else if( event.getCode() == KeyEvent::KEY_ESCAPE ) {
+		quit();
+	}
+}
+
+void BenchmarksApp::run()
+{
+	mReport = bench::Report();
+	if( mContext.mModel && mContext.mModel->isFilePath() ) {
+		mReport.note( "Model: " + mContext.mModel->getFilePath().string() );
+	}
+	bench::attributes( mContext, &mReport );
+	bench::loadThreads( mContext, &mReport );
+	bench::pose( mContext, &mReport );
+	bench::curves( mContext, &mReport );
+	bench::skinning( mContext, &mReport );
+	bench::compression( mContext, &mReport );
+	bench::packing( mContext, &mReport );
+	bench::meshlets( mContext, &mReport );
+	bench::lods( mContext, &mReport );
+	bench::bvh( mContext, &mReport );
+	bench::renderQueue( mContext, &mReport );
+	bench::instances( mContext, &mReport );
+	bench::names( mContext, &mReport );
+	bench::blend( mContext, &mReport );
+}
+
+void BenchmarksApp::update()
+{
+	// One frame late, so that the window says what's going on while the benchmarks run.
+	if( mPending && getElapsedFrames() > 1 ) {
+		mPending = false;
+		run();
+	}
+}
+
+void BenchmarksApp::draw()
+{
+	gl::clear( Color( 0.1f, 0.1f, 0.12f ) );
+	gl::setMatricesWindow( getWindowSize() );
+	vec2 position( 10, 10 );
+	if( mPending ) {
+		gl::drawString( "Running benchmarks...", position );
+		return;
+	}
+	for( const auto& line : mReport.getLines() ) {
+		gl::drawString( line, position );
+		position.y += 14;
+	}
+	gl::drawString( "R: run again. Drop a model to run on it.", vec2( 10, getWindowHeight() - 20 ) );
+}
+
+CINDER_APP( BenchmarksApp, RendererGl, [] ( App::Settings* settings ) {
+	settings->setWindowSize( 900, 800 );
+} )
@@ -0,0 +1,80 @@
+#include "Benchmark.h"
+
+#include "Cinder-Assimp/include/BlendGraph.h"
+
+#include <unordered_map>
+
+using namespace ci;
+using namespace model;
+
+namespace {
+
+	const size_t NUM_BONES = 200;
+	const size_t NUM_TRACKS = 8;
+	const size_t NUM_KEYFRAMES = 120;
+	const int NUM_POSES = 1000;
+
+	//! Seconds per pose of \a blend, called at NUM_POSES times sweeping the tracks. Only the local pose is blended: no update().
+	template<typename Fn>
+	double timePerPose( Fn blend )
+	{
+		// Seconds: createRig() plays a keyframe per tick, 30 ticks per second.
+		const float step = float( NUM_KEYFRAMES - 1 ) / 30.0f / NUM_POSES;
+		return bench::bestTime( [&] {
+			for( int p = 0; p < NUM_POSES; ++p ) {
+				blend( p * step );
+			}
+		} ) / NUM_POSES;
+	}
+
+	size_t getNumChannels( const BlendGraph& graph )
+	{
+		size_t numChannels = 0;
+		for( size_t l = 0; l < graph.getNumLayers(); ++l ) {
+			numChannels += graph.getNumChannels( l );
+		}
+		return numChannels;
+	}
+
+} // anonymous namespace
+
+namespace bench {
+
+void blend( const Context& context, Report* report )
+{
+	report->begin( "Blending a " + std::to_string( NUM_BONES ) + "-bone rig (user-023)" );
+	SkeletonRef skeleton = createRig( NUM_BONES, NUM_TRACKS, NUM_KEYFRAMES );
+
+	for( size_t numLayers : { 1, 4, 8 } ) {
+		const std::string label = std::to_string( numLayers ) + " layer(s)";
+		const float weight = 1.0f / numLayers;
+		std::unordered_map<int, float> weights;
+		BlendGraphRef graph = BlendGraph::create( skeleton );
+		for( size_t l = 0; l < numLayers; ++l ) {
+			weights[int( l )] = weight;
+			graph->addLayer( int( l ), weight );
+		}
+		const double blendAnimate = timePerPose( [&] ( float time ) { skeleton->blendAnimate( time, weights ); } );
+		const double evaluate = timePerPose( [&] ( float time ) { graph->evaluate( time ); } );
+		report->add( label + ", channels", double( getNumChannels( *graph ) ), "", 0 );
+		report->add( label + ", Skeleton::blendAnimate()", blendAnimate * 1e6, "us per pose" );
+		report->add( label + ", BlendGraph::evaluate()", evaluate * 1e6, "us per pose" );
+		report->add( label + ", speed-up", blendAnimate / evaluate, "x" );
+	}
+
+	// A full body layer under layers masked to the subtree of node 1, about half the rig: the cost follows the channels.
+	for( size_t numLayers : { 4, 8 } ) {
+		const std::string label = std::to_string( numLayers ) + " layer(s), masked";
+		BlendGraphRef graph = BlendGraph::create( skeleton );
+		const BlendGraph::Mask mask = graph->createMask( "node1" );
+		graph->addLayer( 0 );
+		for( size_t l = 1; l < numLayers; ++l ) {
+			graph->addLayer( int( l ), 1.0f / numLayers, BlendGraph::OVERRIDE, mask );
+		}
+		const double evaluate = timePerPose( [&] ( float time ) { graph->evaluate( time ); } );
+		report->add( label + ", channels", double( getNumChannels( *graph ) ), "", 0 );
+		report->add( label + ", BlendGraph::evaluate()", evaluate * 1e6, "us per pose" );
+	}
+}
+
+} //end namespace bench
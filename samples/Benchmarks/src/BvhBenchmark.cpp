@@ -0,0 +1,212 @@
+#include "Benchmark.h"
+
+#include "Cinder-Assimp/include/AssimpLoader.h"
+#include "Cinder-Assimp/include/Bvh.h"
+
+#include "cinder/Camera.h"
+#include "cinder/CinderMath.h"
+#include "cinder/Rand.h"
+
+#include <cmath>
+#include <fstream>
+
+using namespace ci;
+using namespace model;
+
+namespace {
+
+	const size_t NUM_RAYS = 1000;
+	const int NUM_VIEWS = 16;
+	const int GRID_SIZE = 4;
+
+	/*!
+	 * Writes, once, an OBJ of GRID_SIZE^3 spheres of 4 * \a rings * \a rings triangles each, so that the loader gives a
+	 * Source of many sections to index: SectionSource can only be built by a loader.
+	 */
+	fs::path writeScene( size_t rings )
+	{
+		const fs::path path = fs::temp_directory_path() / ( "cinder_assimp_bvh_" + std::to_string( rings ) + ".obj" );
+		if( fs::exists( path ) ) {
+			return path;
+		}
+		std::vector<vec3> positions;
+		std::vector<uint32_t> indices;
+		bench::createSphere( rings, &positions, &indices );
+		std::ofstream obj( path.string() );
+		size_t firstVertex = 1;
+		for( int x = 0; x < GRID_SIZE; ++x ) {
+			for( int y = 0; y < GRID_SIZE; ++y ) {
+				for( int z = 0; z < GRID_SIZE; ++z ) {
+					obj << "o sphere_" << x << "_" << y << "_" << z << "\n";
+					const vec3 center = vec3( x, y, z ) * 3.0f;
+					for( const vec3& p : positions ) {
+						obj << "v " << center.x + p.x << " " << center.y + p.y << " " << center.z + p.z << "\n";
+					}
+					for( size_t i = 0; i < indices.size(); i += 3 ) {
+						obj << "f " << firstVertex + indices[i] << " " << firstVertex + indices[i + 1] << " " << firstVertex + indices[i + 2] << "\n";
+					}
+					firstVertex += positions.size();
+				}
+			}
+		}
+		return path;
+	}
+
+	//! Ray picking before the BVH: every triangle of every section, Moller-Trumbore.
+	bool raycastLinear( const Source& source, const Ray& ray, float* nearest )
+	{
+		bool found = false;
+		*nearest = std::numeric_limits<float>::max();
+		for( const auto& section : source.getSectionSources() ) {
+			const mat4 inverse = glm::inverse( section->getDefaultTransformation() );
+			const vec3 origin = vec3( inverse * vec4( ray.getOrigin(), 1.0f ) );
+			const vec3 direction = vec3( inverse * vec4( ray.getDirection(), 0.0f ) );
+			const vec3* positions = section->getPositions().data();
+			const auto& indices = section->getIndices();
+			for( size_t i = 0; i + 2 < indices.size(); i += 3 ) {
+				const vec3& a = positions[indices[i]];
+				const vec3 e1 = positions[indices[i + 1]] - a, e2 = positions[indices[i + 2]] - a;
+				const vec3 p = glm::cross( direction, e2 );
+				const float det = glm::dot( e1, p );
+				if( std::abs( det ) < 1e-12f ) {
+					continue;
+				}
+				const float invDet = 1.0f / det;
+				const vec3 s = origin - a;
+				const float u = glm::dot( s, p ) * invDet;
+				if( u < 0.0f || u > 1.0f ) {
+					continue;
+				}
+				const vec3 q = glm::cross( s, e1 );
+				const float v = glm::dot( direction, q ) * invDet;
+				if( v < 0.0f || u + v > 1.0f ) {
+					continue;
+				}
+				const float t = glm::dot( e2, q ) * invDet;
+				if( t >= 0.0f && t < *nearest ) {
+					*nearest = t;
+					found = true;
+				}
+			}
+		}
+		return found;
+	}
+
+	//! Rays from outside \a bounds towards random points inside, the same ones every run.
+	std::vector<Ray> createRays( const AxisAlignedBox& bounds )
+	{
+		Rand rand( 17 );
+		const float radius = glm::length( bounds.getSize() );
+		std::vector<Ray> rays;
+		for( size_t r = 0; r < NUM_RAYS; ++r ) {
+			const vec3 origin = bounds.getCenter() + rand.nextVec3() * radius;
+			const vec3 target = bounds.getMin() + vec3( rand.nextFloat(), rand.nextFloat(), rand.nextFloat() ) * bounds.getSize();
+			rays.push_back( Ray( origin, glm::normalize( target - origin ) ) );
+		}
+		return rays;
+	}
+
+	//! Build time, memory, culling and picking of a Bvh over \a source, against a scan of every section and triangle.
+	void addBvh( const std::string& label, const Source& source, size_t numRays, bench::Report* report )
+	{
+		BvhRef bvh;
+		const double buildSeconds = bench::bestTime( [&] { bvh = Bvh::create( source ); }, 3 );
+		report->add( label + " sections", double( bvh->getSectionTrees().size() ), "", 0 );
+		report->add( label + " triangles", double( bvh->getNumTriangles() ), "", 0 );
+		report->add( label + ", build", buildSeconds * 1e3, "ms" );
+		report->add( label + ", memory", bvh->getMemorySize() / ( 1024.0 * 1024.0 ), "MB" );
+		if( bvh->getNumTriangles() == 0 ) {
+			return;
+		}
+		const AxisAlignedBox& bounds = bvh->getBounds();
+
+		// Culling, against testing the bounds of every section.
+		std::vector<Frustumf> frustums;
+		for( int v = 0; v < NUM_VIEWS; ++v ) {
+			const float angle = 2.0f * float( M_PI ) * v / NUM_VIEWS;
+			CameraPersp camera( 900, 800, 40.0f, 0.01f, 10.0f * glm::length( bounds.getSize() ) );
+			camera.lookAt( bounds.getCenter() + vec3( std::cos( angle ), 0.2f, std::sin( angle ) ) * glm::length( bounds.getSize() ) * 0.25f, bounds.getCenter() );
+			frustums.push_back( Frustumf( camera ) );
+		}
+		std::vector<AxisAlignedBox> sectionBounds;
+		for( const auto& section : source.getSectionSources() ) {
+			sectionBounds.push_back( section->getBounds().transformed( section->getDefaultTransformation() ) );
+		}
+		std::vector<size_t> visible;
+		size_t numVisible = 0;
+		const double cullSeconds = bench::bestTime( [&] {
+			numVisible = 0;
+			for( const auto& frustum : frustums ) {
+				visible.clear();
+				bvh->cull( frustum, &visible );
+				numVisible += visible.size();
+			}
+		} );
+		const double scanCullSeconds = bench::bestTime( [&] {
+			for( const auto& frustum : frustums ) {
+				visible.clear();
+				for( size_t s = 0; s < sectionBounds.size(); ++s ) {
+					if( frustum.intersects( sectionBounds[s] ) ) {
+						visible.push_back( s );
+					}
+				}
+			}
+		} );
+		report->add( label + ", cull per view", cullSeconds / NUM_VIEWS * 1e6, "us" );
+		report->add( label + ", cull per view, every section", scanCullSeconds / NUM_VIEWS * 1e6, "us" );
+		report->add( label + ", sections kept", 100.0 * numVisible / ( NUM_VIEWS * sectionBounds.size() ), "%", 1 );
+
+		// Picking, against testing every triangle; both must find the same distances.
+		const std::vector<Ray> rays = createRays( bounds );
+		std::vector<float> distances( rays.size(), -1.0f );
+		size_t numHits = 0;
+		const double rayBvhSeconds = bench::bestTime( [&] {
+			numHits = 0;
+			for( size_t r = 0; r < rays.size(); ++r ) {
+				Bvh::Hit hit;
+				if( bvh->raycast( rays[r], &hit ) ) {
+					distances[r] = hit.mDistance;
+					++numHits;
+				}
+			}
+		} );
+		report->add( label + ", ray pick", rayBvhSeconds / rays.size() * 1e6, "us" );
+		report->add( label + ", rays hitting", 100.0 * numHits / rays.size(), "%", 1 );
+
+		numRays = std::min( numRays, rays.size() );
+		size_t numMismatches = 0;
+		const double rayScanSeconds = bench::bestTime( [&] {
+			numMismatches = 0;
+			for( size_t r = 0; r < numRays; ++r ) {
+				float distance;
+				const bool found = raycastLinear( source, rays[r], &distance );
+				if( found != ( distances[r] >= 0.0f ) || ( found && std::abs( distance - distances[r] ) > 1e-3f * distance ) ) {
+					++numMismatches;
+				}
+			}
+		}, 1 );
+		report->add( label + ", ray pick, every triangle", rayScanSeconds / numRays * 1e6, "us" );
+		report->add( label + ", picks differing from the scan", double( numMismatches ), "", 0 );
+	}
+
+} // anonymous namespace
+
+namespace bench {
+
+void bvh( const Context& context, Report* report )
+{
+	report->begin( "BVH culling and picking (user-017)" );
+
+	// 64 spheres of 15376 triangles: 1M triangles. The triangle scan being that slow, it only runs for a few rays.
+	AssimpLoader scene( loadFile( writeScene( 62 ) ) );
+	addBvh( "scene", scene, 20, report );
+
+	if( ! context.mModel ) {
+		report->note( "Model skipped: no model." );
+		return;
+	}
+	AssimpLoader loader( context.mModel );
+	addBvh( "model", loader, NUM_RAYS, report );
+}
+
+} //end namespace bench
@@ -0,0 +1,62 @@
+#include "Benchmark.h"
+
+#include "Cinder-Assimp/include/AssimpLoader.h"
+
+using namespace ci;
+using namespace model;
+
+namespace {
+	
+	//! Keyframe bytes and largest errors over every clip of \a loader.
+	AnimCompressionStats totalStats( const AssimpLoader& loader )
+	{
+		AnimCompressionStats total;
+		for( const auto& info : loader.getAnimInfos() ) {
+			total.merge( info.getCompressionStats() );
+		}
+		return total;
+	}
+	
+	void addStats( const std::string& label, const AnimCompressionStats& stats, bench::Report* report )
+	{
+		report->add( label + ", ratio", stats.getRatio(), "x" );
+		report->add( label + ", max translation error", stats.mMaxTranslationError, "", 5 );
+		report->add( label + ", max rotation error", stats.mMaxRotationError, "rad", 5 );
+		report->add( label + ", max scale error", stats.mMaxScaleError, "", 5 );
+	}
+	
+} // anonymous namespace
+
+namespace bench {
+
+void compression( const Context& context, Report* report )
+{
+	report->begin( "Animation compression (user-012)" );
+	if( ! context.mModel ) {
+		report->note( "Skipped: no model." );
+		return;
+	}
+	
+	const AnimCompression compression;
+	AssimpLoader loader( context.mModel, AssimpLoader::Settings().compressAnimations( compression ) );
+	if( loader.getAnimInfos().empty() ) {
+		report->note( "Skipped: the model has no animation." );
+		return;
+	}
+	const AnimCompressionStats total = totalStats( loader );
+	report->add( "raw keyframes", total.mRawBytes / 1024.0, "KB" );
+	report->add( "compressed keyframes", total.mCompressedBytes / 1024.0, "KB" );
+	for( const auto& info : loader.getAnimInfos() ) {
+		addStats( "'" + info.getName() + "'", info.getCompressionStats(), report );
+	}
+	
+	// What each stage contributes.
+	AssimpLoader reduced( context.mModel, AssimpLoader::Settings().compressAnimations( AnimCompression( compression ).quantize( false ) ) );
+	addStats( "all clips, key reduction only", totalStats( reduced ), report );
+	AssimpLoader quantized( context.mModel, AssimpLoader::Settings().compressAnimations(
+		AnimCompression( compression ).translationTolerance( 0 ).rotationTolerance( 0 ).scaleTolerance( 0 ) ) );
+	addStats( "all clips, quantization only", totalStats( quantized ), report );
+	addStats( "all clips, both", total, report );
+}
+
+} //end namespace bench
@@ -0,0 +1,138 @@
+#include "Benchmark.h"
+
+#include <cmath>
+#include <iterator>
+#include <map>
+
+using namespace ci;
+using namespace model;
+
+namespace {
+	
+	const size_t NUM_BONES = 200;
+	const size_t NUM_KEYFRAMES = 300;
+	const float TICKS_PER_SECOND = 30.0f;
+	const int NUM_POSES = 1000;
+	
+	//! Counts the bytes a container allocates, to measure the std::map keyframes took before the arrays.
+	template<typename T>
+	struct CountingAllocator {
+		typedef T value_type;
+		
+		explicit CountingAllocator( size_t* bytes ) : mBytes( bytes ) { }
+		template<typename U>
+		CountingAllocator( const CountingAllocator<U>& rhs ) : mBytes( rhs.mBytes ) { }
+		
+		T*		allocate( size_t n ) { *mBytes += n * sizeof( T ); return std::allocator<T>().allocate( n ); }
+		void	deallocate( T* p, size_t n ) { *mBytes -= n * sizeof( T ); std::allocator<T>().deallocate( p, n ); }
+		
+		template<typename U>
+		bool	operator==( const CountingAllocator<U>& rhs ) const { return mBytes == rhs.mBytes; }
+		template<typename U>
+		bool	operator!=( const CountingAllocator<U>& rhs ) const { return mBytes != rhs.mBytes; }
+		
+		size_t*	mBytes;
+	};
+	
+	//! A curve as stored before the arrays: keyframes in a std::map, sampled with an upper_bound.
+	template<typename T>
+	class MapCurve {
+	public:
+		MapCurve( const AnimCurve<T>& curve, size_t* bytes )
+		: mKeyframes( std::less<float>(), CountingAllocator<std::pair<const float, T>>( bytes ) )
+		{
+			for( size_t k = 0; k < NUM_KEYFRAMES; ++k ) {
+				mKeyframes.emplace( float( k ), curve.getValue( k / TICKS_PER_SECOND ) );
+			}
+		}
+		
+		T getValue( float time ) const
+		{
+			const float duration = mKeyframes.rbegin()->first;
+			const float n = time * TICKS_PER_SECOND;
+			const float cyclicTime = n - duration * std::floor( n / duration );
+			auto next = mKeyframes.upper_bound( cyclicTime );
+			if( next == mKeyframes.end() ) {
+				return mKeyframes.rbegin()->second;
+			}
+			auto prev = std::prev( next );
+			return lerp( prev->second, next->second, ( cyclicTime - prev->first ) / ( next->first - prev->first ) );
+		}
+	private:
+		static vec3	lerp( const vec3& start, const vec3& end, float time ) { return glm::mix( start, end, time ); }
+		static quat	lerp( const quat& start, const quat& end, float time ) { return glm::slerp( start, end, time ); }
+		
+		std::map<float, T, std::less<float>, CountingAllocator<std::pair<const float, T>>>	mKeyframes;
+	};
+	
+	struct MapTrack {
+		MapTrack( const AnimTrack& track, size_t* bytes )
+		: mTranslation( *track.mTranslationCurve, bytes ), mRotation( *track.mRotationCurve, bytes ), mScaling( *track.mScalingCurve, bytes )
+		{ }
+		
+		MapCurve<vec3>	mTranslation;
+		MapCurve<quat>	mRotation;
+		MapCurve<vec3>	mScaling;
+	};
+	
+} // anonymous namespace
+
+namespace bench {
+
+void curves( const Context& context, Report* report )
+{
+	report->begin( "Curve sampling, " + std::to_string( NUM_BONES ) + " tracks of " + std::to_string( NUM_KEYFRAMES ) + " keyframes (user-010)" );
+	SkeletonRef skeleton = createRig( NUM_BONES, 1, NUM_KEYFRAMES );
+	std::vector<AnimTrack*> tracks;
+	size_t arrayBytes = 0, mapBytes = 0;
+	std::vector<std::unique_ptr<MapTrack>> mapTracks;
+	for( const NodeRef& node : skeleton->getNodes() ) {
+		AnimTrack* track = node->getAnimTracks().at( 0 ).get();
+		tracks.push_back( track );
+		arrayBytes += track->getMemorySize() + 2 * sizeof( AnimCurve<vec3> ) + sizeof( AnimCurve<quat> );
+		mapTracks.emplace_back( new MapTrack( *track, &mapBytes ) );
+		mapBytes += 2 * sizeof( MapCurve<vec3> ) + sizeof( MapCurve<quat> );
+	}
+	const size_t numCurves = 3 * tracks.size();
+	report->add( "memory per curve, arrays", double( arrayBytes ) / numCurves, "bytes", 0 );
+	report->add( "memory per curve, std::map (before)", double( mapBytes ) / numCurves, "bytes", 0 );
+	
+	// Playback: every pose a little later than the previous one.
+	const float step = ( NUM_KEYFRAMES - 1 ) / TICKS_PER_SECOND / NUM_POSES;
+	vec3 translation, scale;
+	quat rotation;
+	auto addRate = [&] ( const std::string& label, double seconds ) {
+		report->add( label, numCurves * NUM_POSES / seconds * 1e-6, "M curve samples/s" );
+	};
+	addRate( "batched, cursors and SIMD interpolation (Skeleton::animate)", bestTime( [&] {
+		for( int p = 0; p < NUM_POSES; ++p ) {
+			skeleton->animate( p * step );
+		}
+	} ) );
+	std::vector<AnimTrack::Cursor> cursors( tracks.size() );
+	addRate( "per track, cursors", bestTime( [&] {
+		for( int p = 0; p < NUM_POSES; ++p ) {
+			for( size_t t = 0; t < tracks.size(); ++t ) {
+				tracks[t]->getValues( p * step, &translation, &rotation, &scale, &cursors[t] );
+			}
+		}
+	} ) );
+	addRate( "per track, binary search", bestTime( [&] {
+		for( int p = 0; p < NUM_POSES; ++p ) {
+			for( AnimTrack* track : tracks ) {
+				track->getValues( p * step, &translation, &rotation, &scale );
+			}
+		}
+	} ) );
+	addRate( "per track, std::map (before)", bestTime( [&] {
+		for( int p = 0; p < NUM_POSES; ++p ) {
+			for( const auto& track : mapTracks ) {
+				translation = track->mTranslation.getValue( p * step );
+				rotation = track->mRotation.getValue( p * step );
+				scale = track->mScaling.getValue( p * step );
+			}
+		}
+	} ) );
+}
+
+} //end namespace bench
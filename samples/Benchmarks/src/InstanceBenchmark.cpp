@@ -0,0 +1,62 @@
+#include "Benchmark.h"
+
+#include "Cinder-Assimp/include/AssimpLoader.h"
+#include "Cinder-Assimp/include/SkeletalMesh.h"
+
+using namespace ci;
+using namespace model;
+
+namespace {
+
+	const size_t NUM_BONES = 60;
+	const size_t NUM_INSTANCES = 100;
+
+} // anonymous namespace
+
+namespace bench {
+
+void instances( const Context& context, Report* report )
+{
+	report->begin( "Memory per instance (user-021)" );
+	// Explicit accounting (getMemorySize()) of what an instance owns; what instances share is not counted.
+
+	SkeletonRef rig = createRig( NUM_BONES, 1, 30 );
+	std::vector<SkeletonRef> skeletons;
+	for( size_t i = 0; i < NUM_INSTANCES; ++i ) {
+		skeletons.push_back( rig->createInstance() );
+		skeletons.back()->animate( 0.5f );
+		skeletons.back()->getPose()->update();
+	}
+	const size_t skeletonBytes = skeletons.front()->getMemorySize();
+	report->add( std::to_string( NUM_BONES ) + "-bone skeleton instance", double( skeletonBytes ), "bytes", 0 );
+	report->add( std::to_string( NUM_BONES ) + "-bone skeleton instance, pose", double( skeletons.front()->getPose()->getMemorySize() ), "bytes", 0 );
+	report->add( std::to_string( NUM_BONES ) + "-bone skeleton instance, per node", double( skeletonBytes ) / NUM_BONES, "bytes", 0 );
+	const double createSeconds = bestTime( [&] {
+		skeletons.clear();
+		for( size_t i = 0; i < NUM_INSTANCES; ++i ) {
+			skeletons.push_back( rig->createInstance() );
+		}
+	} );
+	report->add( std::to_string( NUM_BONES ) + "-bone skeleton, createInstance()", createSeconds / NUM_INSTANCES * 1e6, "us" );
+	skeletons.clear();
+
+	if( ! context.mModel ) {
+		report->note( "Model skipped: no model." );
+		return;
+	}
+	AssimpLoader loader( context.mModel );
+	SkeletalMeshRef mesh = SkeletalMesh::create( loader );
+	if( mesh->getSkeleton()->getNumBones() == 0 ) {
+		report->note( "Model skipped: the model is not skinned." );
+		return;
+	}
+	SkeletalMeshRef instance = mesh->createInstance();
+	instance->setPose( 0.5f, 0 );
+	report->add( "model nodes", double( mesh->getSkeleton()->getNodes().size() ), "", 0 );
+	report->add( "model palette matrices", double( mesh->getNumPaletteMatrices() ), "", 0 );
+	report->add( "model mesh instance", double( instance->getMemorySize() ), "bytes", 0 );
+	report->add( "model mesh instance, skeleton", double( instance->getSkeleton()->getMemorySize() ), "bytes", 0 );
+	report->add( "model mesh instance, palettes", double( mesh->getNumPaletteMatrices() * sizeof( mat4 ) ), "bytes", 0 );
+}
+
+} //end namespace bench
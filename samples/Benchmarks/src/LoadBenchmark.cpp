@@ -0,0 +1,38 @@
+#include "Benchmark.h"
+
+#include "Cinder-Assimp/include/AssimpLoader.h"
+#include "Cinder-Assimp/include/SurfacePool.h"
+
+using namespace ci;
+using namespace model;
+
+namespace bench {
+
+double loadTime( const DataSourceRef& model, AssimpLoader::Settings settings, int numRuns )
+{
+	return bestTime( [&] {
+		settings.surfaces( std::make_shared<SurfacePool>() );
+		AssimpLoader loader( model, settings );
+	}, numRuns );
+}
+
+void loadThreads( const Context& context, Report* report )
+{
+	report->begin( "Load time per number of threads (user-003)" );
+	if( ! context.mModel ) {
+		report->note( "Skipped: no model." );
+		return;
+	}
+	// Untimed, so that the first timed load doesn't pay for reading the file from disk.
+	AssimpLoader loader( context.mModel );
+	report->add( "sections", double( loader.getSectionSources().size() ), "", 0 );
+	
+	const double reference = loadTime( context.mModel, AssimpLoader::Settings().numThreads( 1 ) );
+	for( size_t numThreads : { 1, 2, 4, 8 } ) {
+		const double seconds = ( numThreads == 1 ) ? reference : loadTime( context.mModel, AssimpLoader::Settings().numThreads( numThreads ) );
+		report->add( std::to_string( numThreads ) + " thread(s)", seconds * 1e3, "ms" );
+		report->add( std::to_string( numThreads ) + " thread(s), speed-up", reference / seconds, "x" );
+	}
+}
+
+} //end namespace bench
@@ -0,0 +1,106 @@
+#include "Benchmark.h"
+
+#include "Cinder-Assimp/include/AssimpLoader.h"
+#include "Cinder-Assimp/include/Lod.h"
+
+#include "cinder/CinderMath.h"
+
+using namespace ci;
+using namespace model;
+
+namespace {
+
+	const size_t NUM_LEVELS = 4;
+
+	//! One level, possibly over several sections.
+	struct Level {
+		Level() : mNumTriangles( 0 ), mError( 0.0f ), mSeconds( 0.0 ) { }
+		
+		size_t	mNumTriangles;
+		float	mError;
+		double	mSeconds;
+	};
+	
+	void addLevels( const std::string& label, size_t numTriangles, const std::vector<Level>& levels, bench::Report* report )
+	{
+		report->add( label + ", level 0 triangles", double( numTriangles ), "", 0 );
+		for( size_t i = 0; i < levels.size(); ++i ) {
+			const std::string level = label + ", level " + std::to_string( i + 1 );
+			report->add( level + " triangles", double( levels[i].mNumTriangles ), "", 0 );
+			report->add( level + " error", levels[i].mError, "", 5 );
+			report->add( level + " simplification", levels[i].mSeconds * 1e3, "ms" );
+		}
+	}
+	
+	//! The levels of every section of \a loader: triangles summed, largest error, time summed.
+	std::vector<Level> sumLevels( const AssimpLoader& loader, size_t* numTriangles )
+	{
+		std::vector<Level> levels;
+		*numTriangles = 0;
+		for( const auto& section : loader.getSectionSources() ) {
+			*numTriangles += section->getIndices().size() / 3;
+			levels.resize( std::max( levels.size(), section->getLods().size() ) );
+		}
+		for( const auto& section : loader.getSectionSources() ) {
+			const auto& lods = section->getLods();
+			for( size_t i = 0; i < levels.size(); ++i ) {
+				if( lods.empty() ) {
+					levels[i].mNumTriangles += section->getIndices().size() / 3;
+					continue;
+				}
+				// Sections which stopped early are drawn with their coarsest level.
+				const Lod& lod = lods[std::min( i, lods.size() - 1 )];
+				levels[i].mNumTriangles += lod.getNumTriangles();
+				levels[i].mError = std::max( levels[i].mError, lod.mError );
+				levels[i].mSeconds += ( i < lods.size() ) ? lod.mSeconds : 0.0;
+			}
+		}
+		return levels;
+	}
+	
+} // anonymous namespace
+
+namespace bench {
+
+void lods( const Context& context, Report* report )
+{
+	report->begin( "Level of detail generation (user-016)" );
+
+	// A 500K-triangle prop, without skinning.
+	std::vector<vec3> positions;
+	std::vector<uint32_t> indices;
+	createSphere( 350, &positions, &indices );
+	std::vector<Lod> lods;
+	const double seconds = bestTime( [&] {
+		lods = Lod::build( positions.data(), positions.size(), indices, {}, {}, NUM_LEVELS );
+	}, 3 );
+	report->add( "sphere, build", seconds * 1e3, "ms" );
+	std::vector<Level> levels( lods.size() );
+	for( size_t i = 0; i < lods.size(); ++i ) {
+		levels[i].mNumTriangles = lods[i].getNumTriangles();
+		levels[i].mError = lods[i].mError;
+		levels[i].mSeconds = lods[i].mSeconds;
+	}
+	addLevels( "sphere", indices.size() / 3, levels, report );
+	// Level picked for a 1-pixel error on a 1080p screen, at 60 degrees of field of view.
+	for( float distance : { 2.0f, 10.0f, 50.0f, 250.0f } ) {
+		const size_t level = Lod::select( lods, Lod::getPixelsPerUnit( distance, toRadians( 60.0f ), 1080.0f ) );
+		report->add( "sphere, level at distance " + std::to_string( int( distance ) ), double( level ), "", 0 );
+	}
+
+	if( ! context.mModel ) {
+		report->note( "Model skipped: no model." );
+		return;
+	}
+	const double loadSeconds = bestTime( [&] { AssimpLoader loader( context.mModel ); }, 3 );
+	const double lodLoadSeconds = bestTime( [&] { AssimpLoader loader( context.mModel, AssimpLoader::Settings().lods( NUM_LEVELS ) ); }, 3 );
+	report->add( "model, load", loadSeconds * 1e3, "ms" );
+	report->add( "model, load with levels of detail", lodLoadSeconds * 1e3, "ms" );
+
+	AssimpLoader loader( context.mModel, AssimpLoader::Settings().lods( NUM_LEVELS ) );
+	size_t numTriangles = 0;
+	const std::vector<Level> modelLevels = sumLevels( loader, &numTriangles );
+	addLevels( "model", numTriangles, modelLevels, report );
+}
+
+} //end namespace bench
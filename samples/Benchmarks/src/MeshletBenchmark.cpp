@@ -0,0 +1,130 @@
+#include "Benchmark.h"
+
+#include "Cinder-Assimp/include/AssimpLoader.h"
+#include "Cinder-Assimp/include/Meshlet.h"
+
+#include "cinder/Camera.h"
+#include "cinder/CinderMath.h"
+
+#include <cmath>
+
+using namespace ci;
+using namespace model;
+
+namespace {
+
+	const int NUM_VIEWS = 16;
+
+	/*!
+	 * Cameras orbiting a sphere of \a radius around \a center, at \a distance radii: NUM_VIEWS of them, all looking at the center
+	 * from far away, or each looking at a point of the surface from close by.
+	 */
+	std::vector<CameraPersp> createViews( const vec3& center, float radius, float distance, bool closeUp )
+	{
+		std::vector<CameraPersp> views;
+		for( int v = 0; v < NUM_VIEWS; ++v ) {
+			const float angle = 2.0f * float( M_PI ) * v / NUM_VIEWS;
+			const vec3 direction( std::cos( angle ), 0.3f, std::sin( angle ) );
+			CameraPersp camera( 900, 800, 60.0f, radius * 0.01f, radius * ( distance + 2.0f ) );
+			const vec3 eye = center + glm::normalize( direction ) * radius * distance;
+			camera.lookAt( eye, closeUp ? center + glm::normalize( direction + vec3( 0, 0.5f, 0 ) ) * radius : center );
+			views.push_back( camera );
+		}
+		return views;
+	}
+
+	//! Culls \a meshlets, each section drawn with its one of \a modelMatrices, for every one of \a views: the time per view and the meshlets and indices kept.
+	void addCulling( const std::string& label, const std::vector<std::vector<Meshlet>>& meshlets, const std::vector<mat4>& modelMatrices,
+					 const std::vector<CameraPersp>& views, bench::Report* report )
+	{
+		MeshletCuller::Stats stats;
+		size_t numIndices = 0, numVisibleIndices = 0;
+		std::vector<MeshletRange> ranges;
+		const double seconds = bench::bestTime( [&] {
+			stats = MeshletCuller::Stats();
+			numIndices = numVisibleIndices = 0;
+			for( const auto& camera : views ) {
+				for( size_t s = 0; s < meshlets.size(); ++s ) {
+					MeshletCuller culler( camera, modelMatrices[s] );
+					ranges.clear();
+					culler.cull( meshlets[s], &ranges );
+					stats.merge( culler.getStats() );
+					for( const auto& meshlet : meshlets[s] ) {
+						numIndices += meshlet.mNumIndices;
+					}
+					for( const auto& range : ranges ) {
+						numVisibleIndices += range.mNumIndices;
+					}
+				}
+			}
+		} );
+		report->add( label + ", cull per view", seconds / views.size() * 1e6, "us" );
+		report->add( label + ", meshlets kept", 100.0 * stats.mNumVisible / std::max<size_t>( stats.mNumMeshlets, 1 ), "%", 1 );
+		report->add( label + ", triangles kept", 100.0 * numVisibleIndices / std::max<size_t>( numIndices, 1 ), "%", 1 );
+	}
+
+} // anonymous namespace
+
+namespace bench {
+
+void meshlets( const Context& context, Report* report )
+{
+	report->begin( "Meshlet building and culling (user-015)" );
+
+	// A 2M-triangle scan.
+	std::vector<vec3> positions;
+	std::vector<uint32_t> indices;
+	createSphere( 700, &positions, &indices );
+	std::vector<std::vector<Meshlet>> sphere( 1 );
+	const double buildSeconds = bestTime( [&] {
+		sphere[0] = Meshlet::build( positions.data(), positions.size(), indices );
+	}, 3 );
+	report->add( "scan triangles", double( indices.size() / 3 ), "", 0 );
+	report->add( "scan meshlets", double( sphere[0].size() ), "", 0 );
+	report->add( "scan, build", buildSeconds * 1e3, "ms" );
+	report->add( "scan, build", indices.size() / 3 / buildSeconds * 1e-6, "M triangles/s" );
+	const std::vector<mat4> identity( 1, mat4() );
+	addCulling( "scan, whole view", sphere, identity, createViews( vec3( 0 ), 1.0f, 3.0f, false ), report );
+	addCulling( "scan, close-up", sphere, identity, createViews( vec3( 0 ), 1.0f, 1.3f, true ), report );
+
+	if( ! context.mModel ) {
+		report->note( "Model skipped: no model." );
+		return;
+	}
+	const double loadSeconds = bestTime( [&] { AssimpLoader loader( context.mModel ); }, 3 );
+	const double meshletLoadSeconds = bestTime( [&] { AssimpLoader loader( context.mModel, AssimpLoader::Settings().meshlets() ); }, 3 );
+	report->add( "model, load", loadSeconds * 1e3, "ms" );
+	report->add( "model, load with meshlets", meshletLoadSeconds * 1e3, "ms" );
+
+	AssimpLoader loader( context.mModel, AssimpLoader::Settings().meshlets() );
+	std::vector<std::vector<Meshlet>> meshlets;
+	std::vector<mat4> modelMatrices;
+	AxisAlignedBox bounds;
+	for( const auto& section : loader.getSectionSources() ) {
+		if( section->getMeshlets().empty() ) {
+			continue;
+		}
+		meshlets.push_back( section->getMeshlets() );
+		modelMatrices.push_back( section->getDefaultTransformation() );
+		const AxisAlignedBox sectionBounds = section->getBounds().transformed( section->getDefaultTransformation() );
+		if( meshlets.size() == 1 ) {
+			bounds = sectionBounds;
+		} else {
+			bounds.include( sectionBounds );
+		}
+	}
+	if( meshlets.empty() ) {
+		report->note( "Model skipped: no triangles." );
+		return;
+	}
+	size_t numMeshlets = 0;
+	for( const auto& sectionMeshlets : meshlets ) {
+		numMeshlets += sectionMeshlets.size();
+	}
+	report->add( "model meshlets", double( numMeshlets ), "", 0 );
+	const float radius = glm::length( bounds.getExtents() );
+	addCulling( "model, whole view", meshlets, modelMatrices, createViews( bounds.getCenter(), radius, 3.0f, false ), report );
+	addCulling( "model, close-up", meshlets, modelMatrices, createViews( bounds.getCenter(), radius, 1.3f, true ), report );
+}
+
+} //end namespace bench
@@ -0,0 +1,209 @@
+#include "Benchmark.h"
+
+#include "Cinder-Assimp/include/AssimpLoader.h"
+
+#include "cinder/Rand.h"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace ci;
+using namespace model;
+
+namespace {
+
+	const unsigned int NUM_NODES = 300;
+	const unsigned int NUM_MESHES = 60;
+	const unsigned int NUM_MESH_BONES = 80;
+	const unsigned int NUM_ANIMATIONS = 20;
+	const int NUM_RUNS = 20;
+
+	/*!
+	 * A scene with just the names the loader resolves: NUM_NODES nodes (node \a i being the child of node ( i - 1 ) / 2),
+	 * NUM_MESHES meshes of NUM_MESH_BONES bones and NUM_ANIMATIONS animations with a channel per node. No geometry nor keys.
+	 */
+	std::unique_ptr<aiScene> createScene()
+	{
+		Rand rand( 22 );
+		std::unique_ptr<aiScene> scene( new aiScene );
+		std::vector<aiNode*> nodes;
+		std::vector<std::vector<aiNode*>> children( NUM_NODES );
+		for( unsigned int i = 0; i < NUM_NODES; ++i ) {
+			nodes.push_back( new aiNode( "mixamorig:Bone_" + std::to_string( i ) ) );
+			if( i > 0 ) {
+				nodes[i]->mParent = nodes[( i - 1 ) / 2];
+				children[( i - 1 ) / 2].push_back( nodes[i] );
+			}
+		}
+		for( unsigned int i = 0; i < NUM_NODES; ++i ) {
+			nodes[i]->mNumChildren = unsigned( children[i].size() );
+			if( ! children[i].empty() ) {
+				nodes[i]->mChildren = new aiNode*[children[i].size()];
+				std::copy( children[i].begin(), children[i].end(), nodes[i]->mChildren );
+			}
+		}
+		scene->mRootNode = nodes.front();
+
+		scene->mNumMeshes = NUM_MESHES;
+		scene->mMeshes = new aiMesh*[NUM_MESHES];
+		for( unsigned int m = 0; m < NUM_MESHES; ++m ) {
+			aiMesh* mesh = new aiMesh;
+			mesh->mName.Set( "mesh_" + std::to_string( m ) );
+			mesh->mNumBones = NUM_MESH_BONES;
+			mesh->mBones = new aiBone*[NUM_MESH_BONES];
+			for( unsigned int b = 0; b < NUM_MESH_BONES; ++b ) {
+				mesh->mBones[b] = new aiBone;
+				mesh->mBones[b]->mName = nodes[rand.nextUint( NUM_NODES )]->mName;
+			}
+			scene->mMeshes[m] = mesh;
+		}
+
+		scene->mNumAnimations = NUM_ANIMATIONS;
+		scene->mAnimations = new aiAnimation*[NUM_ANIMATIONS];
+		for( unsigned int a = 0; a < NUM_ANIMATIONS; ++a ) {
+			aiAnimation* animation = new aiAnimation;
+			animation->mNumChannels = NUM_NODES;
+			animation->mChannels = new aiNodeAnim*[NUM_NODES];
+			for( unsigned int c = 0; c < NUM_NODES; ++c ) {
+				animation->mChannels[c] = new aiNodeAnim;
+				animation->mChannels[c]->mNodeName = nodes[c]->mName;
+			}
+			scene->mAnimations[a] = animation;
+		}
+		return scene;
+	}
+
+	//! Name resolution as the loader did it before the NameTable: a std::string per name, probing string-keyed containers.
+	size_t resolveStrings( const aiScene* scene )
+	{
+		size_t numResolved = 0;
+		auto toString = [] ( const aiString& name ) { return std::string( name.data, name.length ); };
+
+		// getBoneNames()
+		std::unordered_set<std::string> boneNames;
+		for( unsigned int m = 0; m < scene->mNumMeshes; ++m ) {
+			for( unsigned int b = 0; b < scene->mMeshes[m]->mNumBones; ++b ) {
+				boneNames.insert( toString( scene->mMeshes[m]->mBones[b]->mName ) );
+			}
+		}
+		// generateNodeHierarchy()
+		std::unordered_map<std::string, const aiNode*> bones;
+		std::vector<const aiNode*> stack( 1, scene->mRootNode );
+		while( ! stack.empty() ) {
+			const aiNode* node = stack.back();
+			stack.pop_back();
+			const std::string name = toString( node->mName );
+			if( boneNames.count( name ) > 0 && bones.count( name ) == 0 ) {
+				bones.emplace( name, node );
+			}
+			stack.insert( stack.end(), node->mChildren, node->mChildren + node->mNumChildren );
+		}
+		// setBoneOffsets() then getBoneWeights()
+		for( int pass = 0; pass < 2; ++pass ) {
+			for( unsigned int m = 0; m < scene->mNumMeshes; ++m ) {
+				for( unsigned int b = 0; b < scene->mMeshes[m]->mNumBones; ++b ) {
+					numResolved += bones.at( toString( scene->mMeshes[m]->mBones[b]->mName ) ) != nullptr;
+				}
+			}
+		}
+		// generateAnimationCurves()
+		for( unsigned int a = 0; a < scene->mNumAnimations; ++a ) {
+			for( unsigned int c = 0; c < scene->mAnimations[a]->mNumChannels; ++c ) {
+				const std::string name = toString( scene->mAnimations[a]->mChannels[c]->mNodeName );
+				numResolved += bones.count( name ) ? bones.at( name ) != nullptr : 0;
+			}
+		}
+		return numResolved;
+	}
+
+	//! The same resolution through ai::NameTable, as the loader does it now.
+	size_t resolveTable( const aiScene* scene )
+	{
+		size_t numResolved = 0;
+		const ai::NameTable names( scene );
+		const std::vector<bool> isBone = ai::findBones( scene, names );
+		std::vector<const aiNode*> bones( names.size(), nullptr );
+		std::vector<const aiNode*> stack( 1, scene->mRootNode );
+		while( ! stack.empty() ) {
+			const aiNode* node = stack.back();
+			stack.pop_back();
+			const int32_t id = names.find( node->mName );
+			if( id >= 0 && isBone[id] && ! bones[id] ) {
+				bones[id] = node;
+			}
+			stack.insert( stack.end(), node->mChildren, node->mChildren + node->mNumChildren );
+		}
+		for( int pass = 0; pass < 2; ++pass ) {
+			for( unsigned int m = 0; m < scene->mNumMeshes; ++m ) {
+				for( unsigned int b = 0; b < scene->mMeshes[m]->mNumBones; ++b ) {
+					const int32_t id = names.find( scene->mMeshes[m]->mBones[b]->mName );
+					numResolved += id >= 0 && bones[id] != nullptr;
+				}
+			}
+		}
+		for( unsigned int a = 0; a < scene->mNumAnimations; ++a ) {
+			for( unsigned int c = 0; c < scene->mAnimations[a]->mNumChannels; ++c ) {
+				const int32_t id = names.find( scene->mAnimations[a]->mChannels[c]->mNodeName );
+				numResolved += id >= 0 && bones[id] != nullptr;
+			}
+		}
+		return numResolved;
+	}
+
+	//! Time per import of each resolution of \a scene's names; both must resolve the same names.
+	void addResolution( const std::string& label, const aiScene* scene, double* stringSeconds, double* tableSeconds, bench::Report* report )
+	{
+		size_t numStrings = 0, numTable = 0;
+		*stringSeconds = bench::bestTime( [&] {
+			for( int r = 0; r < NUM_RUNS; ++r ) {
+				numStrings = resolveStrings( scene );
+			}
+		} ) / NUM_RUNS;
+		*tableSeconds = bench::bestTime( [&] {
+			for( int r = 0; r < NUM_RUNS; ++r ) {
+				numTable = resolveTable( scene );
+			}
+		} ) / NUM_RUNS;
+		report->add( label + ", names resolved", double( numTable ), "", 0 );
+		report->add( label + ", string maps (before)", *stringSeconds * 1e3, "ms", 3 );
+		report->add( label + ", NameTable", *tableSeconds * 1e3, "ms", 3 );
+		report->add( label + ", speed-up", *stringSeconds / *tableSeconds, "x" );
+		if( numStrings != numTable ) {
+			report->note( label + ": the two resolutions disagree (" + std::to_string( numStrings ) + " names against " + std::to_string( numTable ) + ")." );
+		}
+	}
+
+} // anonymous namespace
+
+namespace bench {
+
+void names( const Context& context, Report* report )
+{
+	report->begin( "Name resolution and load time (user-022)" );
+
+	double stringSeconds, tableSeconds;
+	std::unique_ptr<aiScene> scene = createScene();
+	addResolution( "synthetic rig", scene.get(), &stringSeconds, &tableSeconds, report );
+
+	if( ! context.mModel || ! context.mModel->isFilePath() ) {
+		report->note( "Model skipped: no model file." );
+		return;
+	}
+	// The scene as the loader imports it.
+	Assimp::Importer importer;
+	const aiScene* modelScene = importer.ReadFile( context.mModel->getFilePath().string(), ai::FLAGS );
+	if( ! modelScene ) {
+		report->note( "Model skipped: " + std::string( importer.GetErrorString() ) );
+		return;
+	}
+	addResolution( "model", modelScene, &stringSeconds, &tableSeconds, report );
+
+	// The string resolution is gone from the loader: its load time before is the current one with the difference added back.
+	const double loadSeconds = loadTime( context.mModel, AssimpLoader::Settings() );
+	report->add( "model, load", loadSeconds * 1e3, "ms" );
+	report->add( "model, load before (estimated)", ( loadSeconds - tableSeconds + stringSeconds ) * 1e3, "ms" );
+}
+
+} //end namespace bench
@@ -0,0 +1,58 @@
+#include "Benchmark.h"
+
+#include "Cinder-Assimp/include/AssimpLoader.h"
+#include "Cinder-Assimp/include/PackedVertices.h"
+
+using namespace ci;
+using namespace model;
+
+namespace {
+
+	//! Packing time and size of every section of \a sections with \a format.
+	void addPacking( const std::string& label, const std::vector<SectionSourceRef>& sections, size_t numVertices,
+					 const PackedVertices::Format& format, bench::Report* report )
+	{
+		std::vector<PackedVerticesRef> packed( sections.size() );
+		const double seconds = bench::bestTime( [&] {
+			for( size_t s = 0; s < sections.size(); ++s ) {
+				packed[s] = PackedVertices::create( *sections[s], format );
+			}
+		} );
+		size_t packedBytes = 0, unpackedBytes = 0, numIndices16 = 0, numIndices = 0;
+		for( const auto& vertices : packed ) {
+			packedBytes += vertices->getPackedBytes();
+			unpackedBytes += vertices->getUnpackedBytes();
+			numIndices += vertices->getNumIndices();
+			numIndices16 += vertices->has16BitIndices() ? vertices->getNumIndices() : 0;
+		}
+		report->add( label + ", packing", seconds * 1e3, "ms" );
+		report->add( label + ", packing", numVertices / seconds * 1e-6, "M vertices/s" );
+		report->add( label + ", unpacked", unpackedBytes / ( 1024.0 * 1024.0 ), "MB" );
+		report->add( label + ", packed", packedBytes / ( 1024.0 * 1024.0 ), "MB" );
+		report->add( label + ", size ratio", double( unpackedBytes ) / std::max<size_t>( packedBytes, 1 ), "x" );
+		report->add( label + ", 16-bit indices", 100.0 * numIndices16 / std::max<size_t>( numIndices, 1 ), "%", 1 );
+	}
+
+} // anonymous namespace
+
+namespace bench {
+
+void packing( const Context& context, Report* report )
+{
+	report->begin( "Packed vertices (user-014)" );
+	if( ! context.mModel ) {
+		report->note( "Skipped: no model." );
+		return;
+	}
+	AssimpLoader loader( context.mModel );
+	std::vector<SectionSourceRef> sections = loader.getSectionSources();
+	size_t numVertices = 0;
+	for( const auto& section : sections ) {
+		numVertices += section->getNumVertices();
+	}
+	report->add( "model vertices", double( numVertices ), "", 0 );
+	addPacking( "model", sections, numVertices, PackedVertices::Format(), report );
+	addPacking( "model, 16-bit weights", sections, numVertices, PackedVertices::Format().weights16( true ), report );
+}
+
+} //end namespace bench
@@ -0,0 +1,119 @@
+#include "Benchmark.h"
+
+#include <functional>
+
+using namespace ci;
+using namespace model;
+
+namespace {
+	
+	const size_t NUM_BONES = 200;
+	const size_t NUM_KEYFRAMES = 120;
+	const int NUM_POSES = 1000;
+	
+	/*!
+	 * The node tree posed before the flat pose: a shared_ptr hierarchy walked with a std::function, each node
+	 * sampling its track, requesting the update of its subtree and recomputing its transformation from its
+	 * parent's, locked through a weak_ptr.
+	 */
+	class TreeNode {
+	public:
+		typedef std::shared_ptr<TreeNode> Ref;
+		
+		explicit TreeNode( AnimTrack* track ) : mTrack( track ), mNeedsUpdate( true ) { }
+		
+		static void traverse( const Ref& node, const std::function<void( const Ref& )>& visit )
+		{
+			visit( node );
+			for( const Ref& child : node->mChildren ) {
+				traverse( child, visit );
+			}
+		}
+		
+		void animate( float time )
+		{
+			mTrack->getValues( time, &mPosition, &mRotation, &mScale );
+			requestSubtreeUpdate();
+			update();
+		}
+		
+		void requestSubtreeUpdate()
+		{
+			mNeedsUpdate = true;
+			for( const Ref& child : mChildren ) {
+				child->requestSubtreeUpdate();
+			}
+		}
+		
+		void update()
+		{
+			if( ! mNeedsUpdate ) {
+				return;
+			}
+			Ref parent = mParent.lock();
+			if( parent ) {
+				parent->update();
+				mAbsoluteRotation = parent->mAbsoluteRotation * mRotation;
+				mAbsoluteScale = parent->mAbsoluteScale * mScale;
+				mAbsolutePosition = parent->mAbsoluteRotation * ( parent->mAbsoluteScale * mPosition ) + parent->mAbsolutePosition;
+			} else {
+				mAbsoluteRotation = mRotation;
+				mAbsoluteScale = mScale;
+				mAbsolutePosition = mPosition;
+			}
+			mNeedsUpdate = false;
+		}
+		
+		std::weak_ptr<TreeNode>	mParent;
+		std::vector<Ref>		mChildren;
+		AnimTrack*				mTrack;
+		vec3					mPosition, mScale, mAbsolutePosition, mAbsoluteScale;
+		quat					mRotation, mAbsoluteRotation;
+		bool					mNeedsUpdate;
+	};
+	
+	//! The tree of \a skeleton's nodes, sharing their tracks.
+	TreeNode::Ref createTree( const Skeleton& skeleton )
+	{
+		const auto& nodes = skeleton.getNodes();
+		const auto& parents = skeleton.getPose()->getParents();
+		std::vector<TreeNode::Ref> tree;
+		for( size_t i = 0; i < nodes.size(); ++i ) {
+			tree.push_back( std::make_shared<TreeNode>( nodes[i]->getAnimTracks().at( 0 ).get() ) );
+			if( parents[i] >= 0 ) {
+				tree[i]->mParent = tree[parents[i]];
+				tree[parents[i]]->mChildren.push_back( tree[i] );
+			}
+		}
+		return tree.front();
+	}
+	
+} // anonymous namespace
+
+namespace bench {
+
+void pose( const Context& context, Report* report )
+{
+	report->begin( "Posing a " + std::to_string( NUM_BONES ) + "-bone rig (user-008)" );
+	SkeletonRef skeleton = createRig( NUM_BONES, 1, NUM_KEYFRAMES );
+	TreeNode::Ref tree = createTree( *skeleton );
+	
+	const float step = float( NUM_KEYFRAMES - 1 ) / NUM_POSES;
+	const double flat = bestTime( [&] {
+		for( int p = 0; p < NUM_POSES; ++p ) {
+			skeleton->animate( p * step );
+			skeleton->getPose()->update();
+		}
+	} ) / NUM_POSES;
+	const double nodeTree = bestTime( [&] {
+		for( int p = 0; p < NUM_POSES; ++p ) {
+			const float time = p * step;
+			TreeNode::traverse( tree, [time] ( const TreeNode::Ref& node ) { node->animate( time ); } );
+		}
+	} ) / NUM_POSES;
+	report->add( "flat pose", flat * 1e6, "us per pose" );
+	report->add( "node tree (before)", nodeTree * 1e6, "us per pose" );
+	report->add( "speed-up", nodeTree / flat, "x" );
+}
+
+} //end namespace bench
@@ -0,0 +1,102 @@
+#include "Benchmark.h"
+
+#include "Cinder-Assimp/include/AssimpLoader.h"
+#include "Cinder-Assimp/include/RenderQueue.h"
+
+#include "cinder/Rand.h"
+#include "cinder/gl/gl.h"
+
+#include <algorithm>
+#include <random>
+
+using namespace ci;
+using namespace model;
+
+namespace {
+
+	const size_t NUM_OBJECTS = 200;
+	const int NUM_FRAMES = 20;
+
+	//! One object of the scene: a section drawn with one of the shaders, somewhere.
+	struct Object {
+		ABatchSectionRef	mSection;
+		mat4				mModelMatrix;
+	};
+
+	//! Submits \a objects for one frame, queued then flushed once, or flushed after each object as drawing right away does.
+	void submit( const std::vector<Object>& objects, bool queued, RenderQueue* queue, CommandRecorder* recorder )
+	{
+		for( const auto& object : objects ) {
+			gl::ScopedModelMatrix scopedModelMatrix;
+			gl::setModelMatrix( object.mModelMatrix );
+			queue->push( *object.mSection, object.mSection->getBatch() );
+			if( ! queued ) {
+				queue->flush( recorder );
+			}
+		}
+		queue->flush( recorder );
+	}
+
+	//! Commands per frame and submission time of \a objects, against a counting recorder.
+	void addSubmission( const std::string& label, const std::vector<Object>& objects, bool queued, bench::Report* report )
+	{
+		RenderQueue queue;
+		CommandRecorderRef recorder = CommandRecorder::create();
+		submit( objects, queued, &queue, recorder.get() );
+		const CommandRecorder::Stats stats = recorder->getStats();
+		const double seconds = bench::bestTime( [&] {
+			for( int f = 0; f < NUM_FRAMES; ++f ) {
+				submit( objects, queued, &queue, recorder.get() );
+			}
+		} ) / NUM_FRAMES;
+		report->add( label + ", draws", double( stats.mNumDraws ), "per frame", 0 );
+		report->add( label + ", state changes", double( stats.getNumChanges() ), "per frame", 0 );
+		report->add( label + ", shader binds", double( stats.mNumShaderBinds ), "per frame", 0 );
+		report->add( label + ", texture binds", double( stats.mNumTextureBinds ), "per frame", 0 );
+		report->add( label + ", uniforms", double( stats.mNumUniforms ), "per frame", 0 );
+		report->add( label + ", model matrices", double( stats.mNumMatrixChanges ), "per frame", 0 );
+		report->add( label + ", submission", seconds * 1e6, "us per frame" );
+	}
+
+} // anonymous namespace
+
+namespace bench {
+
+void renderQueue( const Context& context, Report* report )
+{
+	report->begin( "Render queue state changes (user-018)" );
+	if( ! context.mModel ) {
+		report->note( "Skipped: no model." );
+		return;
+	}
+	AssimpLoader loader( context.mModel );
+	if( loader.getSectionSources().empty() ) {
+		report->note( "Skipped: no sections." );
+		return;
+	}
+	// Two stock shaders, so that sorting has shaders to group; no assets needed.
+	const gl::GlslProgRef shaders[2] = { gl::getStockShader( gl::ShaderDef().lambert() ), gl::getStockShader( gl::ShaderDef().color() ) };
+	std::vector<ABatchSectionRef> sections;
+	for( const auto& source : loader.getSectionSources() ) {
+		for( const auto& shader : shaders ) {
+			sections.push_back( std::make_shared<ABatchSection>( source, shader ) );
+		}
+	}
+
+	// The model's sections scattered in a random order, as a scene's draws come.
+	Rand rand( 18 );
+	std::vector<Object> objects;
+	for( size_t o = 0; o < NUM_OBJECTS; ++o ) {
+		for( size_t s = 0; s < loader.getSectionSources().size(); ++s ) {
+			objects.push_back( Object{ sections[2 * s + rand.nextUint( 2 )], glm::translate( rand.randVec3() * 10.0f ) } );
+		}
+	}
+	std::shuffle( objects.begin(), objects.end(), std::mt19937( 18 ) );
+	report->add( "objects", double( NUM_OBJECTS ), "", 0 );
+	report->add( "sections per object", double( loader.getSectionSources().size() ), "", 0 );
+
+	addSubmission( "each draw flushed", objects, false, report );
+	addSubmission( "queued", objects, true, report );
+}
+
+} //end namespace bench
@@ -0,0 +1,98 @@
+#include "Benchmark.h"
+
+#include "Cinder-Assimp/include/AssimpLoader.h"
+#include "Cinder-Assimp/include/Parallel.h"
+#include "Cinder-Assimp/include/SkinningEngine.h"
+
+using namespace ci;
+using namespace model;
+
+namespace {
+	
+	const int NUM_FRAMES = 20;
+	
+	//! Skinning as SkeletalTriMesh::Section::update() did before the engine: a skinning matrix built per influence, serially.
+	void skinPerInfluence( const SectionSource& source, vec3* positions, vec3* normals )
+	{
+		const auto& weights = source.getWeights();
+		const bool hasNormals = source.getNormals().size() == weights.size();
+		for( size_t v = 0; v < weights.size(); ++v ) {
+			vec3 weightedPosition, weightedNormal;
+			for( size_t i = 0; i < weights[v].getNumActiveWeights(); ++i ) {
+				const Node* bone = weights[v].getBone( int( i ) );
+				const mat4 skinningMatrix = bone->getAbsoluteTransformation() * *bone->getOffset();
+				const float weight = weights[v].getWeight( int( i ) );
+				weightedPosition += weight * vec3( skinningMatrix * vec4( source.getPositions().at( v ), 1 ) );
+				if( hasNormals ) {
+					weightedNormal += weight * vec3( skinningMatrix * vec4( source.getNormals().at( v ), 1 ) );
+				}
+			}
+			positions[v] = weightedPosition;
+			if( hasNormals ) {
+				normals[v] = weightedNormal;
+			}
+		}
+	}
+	
+} // anonymous namespace
+
+namespace bench {
+
+void skinning( const Context& context, Report* report )
+{
+	report->begin( "CPU skinning (user-011)" );
+	if( ! context.mModel ) {
+		report->note( "Skipped: no model." );
+		return;
+	}
+	AssimpLoader loader( context.mModel );
+	std::vector<SectionSourceRef> sections;
+	size_t numVertices = 0;
+	for( const auto& section : loader.getSectionSources() ) {
+		if( ! section->getWeights().empty() ) {
+			sections.push_back( section );
+			numVertices += section->getNumVertices();
+		}
+	}
+	if( sections.empty() ) {
+		report->note( "Skipped: the model is not skinned." );
+		return;
+	}
+	report->add( "skinned vertices", double( numVertices ), "", 0 );
+	
+	SkeletonRef skeleton = Skeleton::create( loader.getSkeletonRoot(), loader.getSkeletonBones() );
+	skeleton->getPose()->update();
+	std::vector<mat4> palette;
+	skeleton->computeSkinningMatrices( &palette );
+	std::vector<vec3> positions( numVertices ), normals( numVertices );
+	
+	auto addRate = [&] ( const std::string& label, double seconds ) {
+		report->add( label, numVertices * NUM_FRAMES / seconds * 1e-6, "M vertices/s" );
+	};
+	for( size_t numThreads : { size_t( 1 ), getDefaultNumThreads() } ) {
+		std::vector<SkinningEngineRef> engines;
+		for( const auto& section : sections ) {
+			engines.push_back( SkinningEngine::create( *section, numThreads ) );
+		}
+		addRate( "SkinningEngine, " + std::to_string( numThreads ) + " thread(s)", bestTime( [&] {
+			for( int f = 0; f < NUM_FRAMES; ++f ) {
+				size_t first = 0;
+				for( const auto& engine : engines ) {
+					engine->skin( palette, &positions[first], &normals[first] );
+					first += engine->getNumVertices();
+				}
+			}
+		} ) );
+	}
+	addRate( "matrix per influence, serial (before)", bestTime( [&] {
+		for( int f = 0; f < NUM_FRAMES; ++f ) {
+			size_t first = 0;
+			for( const auto& section : sections ) {
+				skinPerInfluence( *section, &positions[first], &normals[first] );
+				first += section->getNumVertices();
+			}
+		}
+	} ) );
+}
+
+} //end namespace bench
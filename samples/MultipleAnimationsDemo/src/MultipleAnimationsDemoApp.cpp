@@ -19,6 +19,8 @@ using namespace std;
 
 
 #include "Cinder-Assimp/include/SkeletalMesh.h"
+#include "Cinder-Assimp/include/Skeleton.h"
+#include "Cinder-Assimp/include/Crowd.h"
 #include "Cinder-Assimp/include/Renderer.h"
 
 using namespace model;
@@ -41,7 +43,10 @@ private:
 	void playAnim();
 	void loopAnim();
 	void stopAnim();
+	void loadModel( const DataSourceRef& modelSource );
+	void updateCrowd();
 	
+	AssimpLoaderRef					mLoader;
 	SkeletalMeshRef					mActor;
 	float							mScaleFactor;
 	
@@ -54,6 +59,12 @@ private:
 	params::InterfaceGl				mParams;
 	bool mDrawSkeleton, mDrawLabels, mDrawMesh, mDrawRelative, mEnableWireframe;
 	int mAnimId;
+	
+	//! Benchmark: copies of the actor, each with its own skeleton, posed every frame (but not drawn).
+	CrowdRef						mCrowd;
+	std::vector<SkeletalMeshRef>	mCrowdMeshes;
+	int								mCrowdSize;
+	float							mCrowdActorsPerMs;
 };
 
 void MultipleAnimationsDemo::playAnim()
@@ -96,8 +107,14 @@ void MultipleAnimationsDemo::setup()
 	mParams.addButton( "Play Anim", std::bind( &MultipleAnimationsDemo::playAnim, this) );
 	mParams.addButton( "Loop Anim", std::bind( &MultipleAnimationsDemo::loopAnim, this) );
 	mParams.addButton( "Stop Anim", std::bind( &MultipleAnimationsDemo::stopAnim, this) );
+	mParams.addSeparator();
+	mCrowdSize = 0;
+	mParams.addParam( "Crowd Size", &mCrowdSize ).min( 0 ).max( 2000 ).step( 50 );
+	mCrowdActorsPerMs = 0.0f;
+	mParams.addParam( "Actors/ms", &mCrowdActorsPerMs, "", true );
+	mCrowd = Crowd::create();
 	
-	mActor = SkeletalMesh::create( AssimpLoader( loadAsset( "astroboy_walk.dae" ) ) );
+	loadModel( loadAsset( "astroboy_walk.dae" ) );
 	
 	
 	// Blend both animations with a factor of one since they affect independent bones (lower vs upper body).
@@ -106,8 +123,38 @@ void MultipleAnimationsDemo::setup()
 
 void MultipleAnimationsDemo::fileDrop( FileDropEvent event )
 {
-	auto modelFile = loadFile( event.getFile( 0 ) );
-	mActor = SkeletalMesh::create( AssimpLoader( modelFile ) );
+	loadModel( loadFile( event.getFile( 0 ) ) );
+}
+
+void MultipleAnimationsDemo::loadModel( const DataSourceRef& modelSource )
+{
+	mLoader = std::make_shared<AssimpLoader>( modelSource );
+	mActor = SkeletalMesh::create( *mLoader );
+	mCrowdMeshes.clear();
+}
+
+void MultipleAnimationsDemo::updateCrowd()
+{
+	while( mCrowdMeshes.size() > size_t( mCrowdSize ) ) {
+		mCrowdMeshes.pop_back();
+	}
+	while( mCrowdMeshes.size() < size_t( mCrowdSize ) ) {
+		mCrowdMeshes.push_back( mActor->createInstance() );
+	}
+	if( mCrowdMeshes.empty() ) {
+		mCrowdActorsPerMs = 0.0f;
+		return;
+	}
+	
+	// Spread the actors along the animation so that they don't all share the same pose.
+	std::vector<Crowd::Instance> instances;
+	instances.reserve( mCrowdMeshes.size() );
+	const float time = float( getElapsedSeconds() );
+	for( size_t i = 0; i < mCrowdMeshes.size(); ++i ) {
+		instances.emplace_back( mCrowdMeshes[i], time + 0.05f * float( i ), mAnimId );
+	}
+	mCrowd->update( instances );
+	mCrowdActorsPerMs = float( mCrowd->getStats().getInstancesPerMs() );
 }
 
 void MultipleAnimationsDemo::keyDown( KeyEvent event )
@@ -156,6 +203,7 @@ void MultipleAnimationsDemo::update()
 	mFps = getAverageFps();
 	model::Renderer::getLight()->position.x = mRotationRadius * math<float>::sin( float( app::getElapsedSeconds() ) );
 	model::Renderer::getLight()->position.z = mRotationRadius * math<float>::cos( float( app::getElapsedSeconds() ) );
+	updateCrowd();
 }
 
 void MultipleAnimationsDemo::draw()
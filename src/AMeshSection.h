@@ -1,12 +1,17 @@
 #pragma once
 
 #include "ModelIo.h"
+#include "PackedVertices.h"
 #include "cinder/gl/Texture.h"
 
 #include "cinder/gl/VboMesh.h"
+#include "cinder/gl/Vbo.h"
 #include "cinder/gl/Batch.h"
 #include "cinder/gl/GlslProg.h"
+#include "cinder/Camera.h"
 
+#include <algorithm>
+#include <limits>
 #include <vector>
 #include <string>
 
@@ -31,10 +36,30 @@ protected:
 		auto textureSurfaces = source->getMaterialSource().mSurfaces;
 		if( textureSurfaces.count( model::MaterialSource::TextureType::DIFFUSE ) ) {
 			
-			mTexture = ci::gl::Texture2d::create( *textureSurfaces.at( model::MaterialSource::TextureType::DIFFUSE ),
-												  ci::gl::Texture2d::Format().loadTopDown() );
+			mTexture = findTexture( textureSurfaces.at( model::MaterialSource::TextureType::DIFFUSE ) );
 		}
 	}
+	//! Sections sharing a surface (see SurfacePool) share its texture, which saves memory and texture binds.
+	static ci::gl::Texture2dRef findTexture( const std::shared_ptr<ci::Surface>& surface )
+	{
+		static std::vector<std::pair<std::weak_ptr<ci::Surface>, std::weak_ptr<ci::gl::Texture2d>>> sTextures;
+		ci::gl::Texture2dRef texture;
+		for( auto it = sTextures.begin(); it != sTextures.end(); ) {
+			if( it->first.expired() || it->second.expired() ) {
+				it = sTextures.erase( it );
+				continue;
+			}
+			if( it->first.lock() == surface ) {
+				texture = it->second.lock();
+			}
+			++it;
+		}
+		if( ! texture ) {
+			texture = ci::gl::Texture2d::create( *surface, ci::gl::Texture2d::Format().loadTopDown() );
+			sTextures.emplace_back( surface, texture );
+		}
+		return texture;
+	}
 	virtual ~AMeshSection() { };
 	
 	std::string					mName;
@@ -51,13 +76,95 @@ public:
 	ABatchSection( const SectionSourceRef& source, ci::gl::GlslProgRef shader, ci::gl::Batch::AttributeMapping mapping = ci::gl::Batch::AttributeMapping() )
 	: AMeshSection( source )
 	, mBatch( ci::gl::Batch::create( ci::gl::VboMesh::create( *source ), shader, mapping ) )
+	, mPacked( false )
+	, mLodRadius( 0.0f )
 	{
+		createLodBatches( *source, mapping );
+	}
+	//! With \a packVertices, uploads the section in the PackedVertices layout of \a packedFormat, which \a shader has to decode.
+	ABatchSection( const SectionSourceRef& source, ci::gl::GlslProgRef shader, bool packVertices, const PackedVertices::Format& packedFormat = PackedVertices::Format() )
+	: AMeshSection( source )
+	, mBatch( ci::gl::Batch::create( packVertices ? PackedVertices::create( *source, packedFormat )->createVboMesh() : ci::gl::VboMesh::create( *source ), shader ) )
+	, mPacked( packVertices )
+	, mLodRadius( 0.0f )
+	{
+		createLodBatches( *source, ci::gl::Batch::AttributeMapping() );
+	}
+	//! Draws \a vboMesh, uploaded by the caller from \a source (i.e. with attributes of its own).
+	ABatchSection( const SectionSourceRef& source, const ci::gl::VboMeshRef& vboMesh, ci::gl::GlslProgRef shader, ci::gl::Batch::AttributeMapping mapping = ci::gl::Batch::AttributeMapping() )
+	: AMeshSection( source )
+	, mBatch( ci::gl::Batch::create( vboMesh, shader, mapping ) )
+	, mPacked( false )
+	, mLodRadius( 0.0f )
+	{
+		createLodBatches( *source, mapping );
 	}
 	virtual ~ABatchSection() { };
 	
 	ci::gl::BatchRef	getBatch() const { return mBatch; }
+	bool				isPacked() const { return mPacked; }
+	
+	//! Levels of detail, including the full section as level 0.
+	size_t				getNumLods() const { return mLods.size() + 1; }
+	ci::gl::BatchRef	getLodBatch( size_t lod ) const { return ( lod == 0 ) ? mBatch : mLodBatches.at( lod - 1 ); }
+	//! Coarsest level whose error projects to at most \a maxPixelError pixels for \a camera, drawn with \a modelMatrix in the current viewport.
+	size_t				selectLod( const ci::Camera& camera, const glm::mat4& modelMatrix, float maxPixelError = 1.0f ) const
+	{
+		if( mLods.empty() ) {
+			return 0;
+		}
+		float scale = std::max( glm::length( glm::vec3( modelMatrix[0] ) ), std::max( glm::length( glm::vec3( modelMatrix[1] ) ), glm::length( glm::vec3( modelMatrix[2] ) ) ) );
+		glm::vec3 center = glm::vec3( modelMatrix * glm::vec4( mLodCenter, 1.0f ) );
+		float distance = glm::length( center - camera.getEyePoint() ) - mLodRadius * scale;
+		float pixelsPerUnit = Lod::getPixelsPerUnit( std::max( distance, camera.getNearClip() ), glm::radians( camera.getFov() ), float( ci::gl::getViewport().second.y ) );
+		return Lod::select( mLods, pixelsPerUnit * scale, maxPixelError );
+	}
 protected:
+	//! Every level shares the vertex buffers of mBatch, with its own index buffer.
+	void createLodBatches( const SectionSource& source, const ci::gl::Batch::AttributeMapping& mapping )
+	{
+		if( source.getLods().empty() ) {
+			return;
+		}
+		
+		glm::vec3 lower( std::numeric_limits<float>::max() ), upper( -std::numeric_limits<float>::max() );
+		for( const auto& position : source.getPositions() ) {
+			lower = glm::min( lower, position );
+			upper = glm::max( upper, position );
+		}
+		mLodCenter = ( lower + upper ) * 0.5f;
+		mLodRadius = glm::length( upper - lower ) * 0.5f;
+		
+		auto vboMesh = mBatch->getVboMesh();
+		// 16-bit indices whenever they fit, as PackedVertices does for level 0.
+		const bool indices16 = vboMesh->getNumVertices() <= std::numeric_limits<uint16_t>::max();
+		for( const auto& lod : source.getLods() ) {
+			ci::gl::VboRef indexVbo;
+			if( indices16 ) {
+				const std::vector<uint16_t> indices( lod.mIndices.begin(), lod.mIndices.end() );
+				indexVbo = ci::gl::Vbo::create( GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof( uint16_t ), indices.data(), GL_STATIC_DRAW );
+			}
+			else {
+				indexVbo = ci::gl::Vbo::create( GL_ELEMENT_ARRAY_BUFFER, lod.mIndices.size() * sizeof( uint32_t ), lod.mIndices.data(), GL_STATIC_DRAW );
+			}
+			auto lodMesh = ci::gl::VboMesh::create( vboMesh->getNumVertices(), GL_TRIANGLES, vboMesh->getVertexArrayLayoutVbos(),
+												   uint32_t( lod.mIndices.size() ), indices16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, indexVbo );
+			mLodBatches.push_back( ci::gl::Batch::create( lodMesh, mBatch->getGlslProg(), mapping ) );
+			// The indices now live on the GPU: keep the error metrics only.
+			Lod metrics;
+			metrics.mError = lod.mError;
+			metrics.mSeconds = lod.mSeconds;
+			mLods.push_back( metrics );
+		}
+	}
+	
 	ci::gl::BatchRef	mBatch;
+	bool				mPacked;
+	
+	std::vector<ci::gl::BatchRef>	mLodBatches;
+	std::vector<Lod>				mLods;
+	glm::vec3						mLodCenter;
+	float							mLodRadius;
 };
 
 } //end namespace model
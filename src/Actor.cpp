@@ -10,6 +10,7 @@
 
 #include "Actor.h"
 #include "Skeleton.h"
+#include "BlendGraph.h"
 
 using namespace model;
 	
@@ -21,48 +22,64 @@ Actor::Actor( const Source& source, SkeletonRef skeleton )
 		mSkeleton = Skeleton::create( source.getSkeletonRoot(), source.getSkeletonBones() );
 	}
 	
+	auto animInfoMap = std::make_shared<std::unordered_map<int, AnimInfo>>();
 	size_t animId = 0;
 	for( auto& animInfo : source.getAnimInfos() ) {
-		mAnimInfoMap[animId] = AnimInfo( animInfo.getDuration(), animInfo.getTicksPerSecond(), animInfo.getName() );
+		(*animInfoMap)[animId] = AnimInfo( animInfo.getDuration(), animInfo.getTicksPerSecond(), animInfo.getName() );
 		++animId;
 	}
+	mAnimInfoMap = animInfoMap;
+	mSampledClips = std::make_shared<std::vector<SampledClipRef>>( source.getSampledClips() );
+}
+
+Actor::Actor( const Actor& prototype, SkeletonRef skeleton )
+: mSkeleton( skeleton ? skeleton : prototype.mSkeleton->createInstance() )
+, mAnimInfoMap( prototype.mAnimInfoMap )
+, mSampledClips( prototype.mSampledClips )
+{
 }
 
 float Actor::getAnimDuration( int trackId ) const
 {
-	return mAnimInfoMap.at( trackId ).getDuration();
+	return mAnimInfoMap->at( trackId ).getDuration();
 }
 
 const std::string& Actor::getAnimName( int trackId ) const
 {
-	return mAnimInfoMap.at( trackId ).getName();
+	return mAnimInfoMap->at( trackId ).getName();
 }
 
 float Actor::getAnimTicksPerSecond( int trackId ) const
 {
-	return mAnimInfoMap.at( trackId ).getTicksPerSecond();
+	return mAnimInfoMap->at( trackId ).getTicksPerSecond();
 }
 
 void Actor::resetPose()
 {
-	mSkeleton->traverseNodes( [] ( const NodeRef& n ) {
-		n->resetToInitial();
-	} );
+	mSkeleton->resetToInitial();
 	update();
 }
 void Actor::setPose( float time, int trackId )
 {
-	mSkeleton->traverseNodes( [&time, &trackId] ( const NodeRef& n ) {
-		n->animate( time, trackId );
-	} );
+	const auto& sampledClips = *mSampledClips;
+	if( trackId >= 0 && size_t( trackId ) < sampledClips.size() && sampledClips[trackId] ) {
+		mSkeleton->animate( sampledClips[trackId], time );
+	} else {
+		mSkeleton->animate( time, trackId );
+	}
 	update();
 }
 
 void Actor::setBlendedPose( float time, const std::unordered_map<int, float>& trackWeights )
 {
-	mSkeleton->traverseNodes( [&time, &trackWeights] ( const NodeRef& n ) {
-		n->blendAnimate( time, trackWeights );
-	} );
+	mSkeleton->blendAnimate( time, trackWeights );
+	update();
+}
+
+void Actor::setBlendedPose( float time, BlendGraph& graph )
+{
+	CI_ASSERT( graph.getSkeleton() == mSkeleton );
+	graph.evaluate( time );
 	update();
 }
 	
@@ -79,7 +96,7 @@ void Actor::blendUpdateImpl( const std::unordered_map<int, float>& trackWeights
 void  Actor::playAnim( ci::Timeline& timeline, int trackId )
 {
 	mAnimTime = 0.0f;
-	float d = mAnimInfoMap.at( trackId ).getDuration();
+	float d = mAnimInfoMap->at( trackId ).getDuration();
 	timeline.apply(&mAnimTime, d, d ).updateFn( std::bind(&Actor::updateImpl, this, trackId ) );
 }
 
@@ -87,7 +104,7 @@ void  Actor::playAnim( ci::Timeline& timeline, const std::unordered_map<int, flo
 {
 	mAnimTime = 0.0f;
 	float d = 0.0f;
-	for( const auto& kv : mAnimInfoMap ) {
+	for( const auto& kv : *mAnimInfoMap ) {
 		float duration = kv.second.getDuration();
 		if( duration > d )
 			d = duration;
@@ -98,7 +115,7 @@ void  Actor::playAnim( ci::Timeline& timeline, const std::unordered_map<int, flo
 void  Actor::loopAnim( ci::Timeline& timeline, int trackId )
 {
 	mAnimTime = 0.0f;
-	float d = mAnimInfoMap.at( trackId ).getDuration();
+	float d = mAnimInfoMap->at( trackId ).getDuration();
 	timeline.apply(&mAnimTime, d, d ).updateFn( std::bind(&Actor::updateImpl, this, trackId ) ).loop();
 }
 
@@ -106,7 +123,7 @@ void  Actor::loopAnim( ci::Timeline& timeline, const std::unordered_map<int, flo
 {
 	mAnimTime = 0.0f;
 	float d = 1.0f;
-	for( const auto& kv : mAnimInfoMap ) {
+	for( const auto& kv : *mAnimInfoMap ) {
 		if( kv.second.getDuration() > d )
 			d = kv.second.getDuration();
 	}
@@ -8,6 +8,8 @@
 
 namespace model {
 
+class BlendGraph;
+
 class Actor {
 public:
 	Actor( const Source& source, SkeletonRef skeleton );
@@ -18,8 +20,10 @@ public:
 	void				resetPose();
 	void				setPose( float time, int trackId = 0 );
 	void				setBlendedPose( float time, const std::unordered_map<int, float>& trackWeights );
+	//! Poses the skeleton with \a graph, which must have been created over it (see BlendGraph::create()).
+	void				setBlendedPose( float time, BlendGraph& graph );
 		
-	bool				hasAnimations() const { return ! mAnimInfoMap.empty(); }
+	bool				hasAnimations() const { return ! mAnimInfoMap->empty(); }
 	float				getAnimDuration( int trackId = 0 ) const;
 	const std::string&	getAnimName( int trackId = 0 ) const;
 	float				getAnimTicksPerSecond( int trackId = 0 ) const;
@@ -34,13 +38,19 @@ public:
 	void			stop();
 	
 protected:
+	//! An instance of \a prototype: clips are shared, and \a skeleton (i.e. an instance of the prototype's skeleton) is posed independently.
+	Actor( const Actor& prototype, SkeletonRef skeleton );
+	
 	void			updateImpl( int trackId );
 	void			blendUpdateImpl( const std::unordered_map<int, float>& trackWeights );
 	
 	SkeletonRef							mSkeleton;
 	
 	ci::Anim<float>						mAnimTime;
-	std::unordered_map<int, AnimInfo>	mAnimInfoMap;
+	//! Shared by the instances of the actor, as the clips are not modified once loaded.
+	std::shared_ptr<const std::unordered_map<int, AnimInfo>>	mAnimInfoMap;
+	//! Pre-sampled clips by track id, played instead of the curves when present.
+	std::shared_ptr<const std::vector<SampledClipRef>>			mSampledClips;
 };
 
 } //end namespace model
@@ -0,0 +1,158 @@
+#include "AnimBatch.h"
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+	#define MODEL_ANIM_USE_SSE2
+	#include <emmintrin.h>
+#endif
+
+using namespace model;
+
+namespace {
+	
+	const size_t CAPACITY = AnimBatch::CAPACITY;
+	
+	//! Coefficients of Eberly's slerp polynomial, tuned for single precision.
+	const float MU = 1.90110745351730037f;
+	const float SLERP_U[8] = { 1.0f / ( 1 * 3 ), 1.0f / ( 2 * 5 ), 1.0f / ( 3 * 7 ), 1.0f / ( 4 * 9 ), 1.0f / ( 5 * 11 ), 1.0f / ( 6 * 13 ), 1.0f / ( 7 * 15 ), MU / ( 8 * 17 ) };
+	const float SLERP_V[8] = { 1.0f / 3, 2.0f / 5, 3.0f / 7, 4.0f / 9, 5.0f / 11, 6.0f / 13, 7.0f / 15, MU * 8 / 17 };
+	
+	//! start[c][k] = mix( start[c][k], end[c][k], factors[k] ) for the first \a count lanes of \a N components.
+	template<int N>
+	void lerp( size_t count, float (*start)[CAPACITY], const float (*end)[CAPACITY], const float* factors )
+	{
+		size_t k = 0;
+#if defined( MODEL_ANIM_USE_SSE2 )
+		for( ; k + 4 <= count; k += 4 ) {
+			const __m128 t = _mm_loadu_ps( factors + k );
+			for( int c = 0; c < N; ++c ) {
+				const __m128 a = _mm_loadu_ps( start[c] + k );
+				const __m128 b = _mm_loadu_ps( end[c] + k );
+				_mm_storeu_ps( start[c] + k, _mm_add_ps( a, _mm_mul_ps( _mm_sub_ps( b, a ), t ) ) );
+			}
+		}
+#endif
+		for( ; k < count; ++k ) {
+			for( int c = 0; c < N; ++c ) {
+				start[c][k] += ( end[c][k] - start[c][k] ) * factors[k];
+			}
+		}
+	}
+	
+	//! start[k] = slerp( start[k], end[k], factors[k] ) for the first \a count quaternions, along the shortest arc.
+	void slerp( size_t count, float (*start)[CAPACITY], const float (*end)[CAPACITY], const float* factors )
+	{
+		size_t k = 0;
+#if defined( MODEL_ANIM_USE_SSE2 )
+		const __m128 one = _mm_set1_ps( 1.0f );
+		const __m128 signBit = _mm_set1_ps( -0.0f );
+		for( ; k + 4 <= count; k += 4 ) {
+			__m128 a[4], b[4];
+			for( int c = 0; c < 4; ++c ) {
+				a[c] = _mm_loadu_ps( start[c] + k );
+				b[c] = _mm_loadu_ps( end[c] + k );
+			}
+			__m128 x = _mm_add_ps( _mm_add_ps( _mm_mul_ps( a[0], b[0] ), _mm_mul_ps( a[1], b[1] ) ), _mm_add_ps( _mm_mul_ps( a[2], b[2] ), _mm_mul_ps( a[3], b[3] ) ) );
+			// The sign of the dot product, moved onto the end coefficient, takes the shortest arc.
+			const __m128 sign = _mm_and_ps( x, signBit );
+			x = _mm_xor_ps( x, sign );
+			
+			const __m128 xm1 = _mm_sub_ps( x, one );
+			const __m128 t = _mm_loadu_ps( factors + k );
+			const __m128 d = _mm_sub_ps( one, t );
+			const __m128 t2 = _mm_mul_ps( t, t );
+			const __m128 d2 = _mm_mul_ps( d, d );
+			__m128 cT = one, cD = one;
+			for( int i = 7; i >= 0; --i ) {
+				const __m128 u = _mm_set1_ps( SLERP_U[i] );
+				const __m128 v = _mm_set1_ps( SLERP_V[i] );
+				cT = _mm_add_ps( one, _mm_mul_ps( _mm_mul_ps( _mm_sub_ps( _mm_mul_ps( u, t2 ), v ), xm1 ), cT ) );
+				cD = _mm_add_ps( one, _mm_mul_ps( _mm_mul_ps( _mm_sub_ps( _mm_mul_ps( u, d2 ), v ), xm1 ), cD ) );
+			}
+			cT = _mm_xor_ps( _mm_mul_ps( cT, t ), sign );
+			cD = _mm_mul_ps( cD, d );
+			for( int c = 0; c < 4; ++c ) {
+				_mm_storeu_ps( start[c] + k, _mm_add_ps( _mm_mul_ps( cD, a[c] ), _mm_mul_ps( cT, b[c] ) ) );
+			}
+		}
+#endif
+		for( ; k < count; ++k ) {
+			float x = start[0][k] * end[0][k] + start[1][k] * end[1][k] + start[2][k] * end[2][k] + start[3][k] * end[3][k];
+			const float sign = ( x < 0.0f ) ? -1.0f : 1.0f;
+			x *= sign;
+			
+			const float xm1 = x - 1.0f;
+			const float t = factors[k];
+			const float d = 1.0f - t;
+			float cT = 1.0f, cD = 1.0f;
+			for( int i = 7; i >= 0; --i ) {
+				cT = 1.0f + ( SLERP_U[i] * t * t - SLERP_V[i] ) * xm1 * cT;
+				cD = 1.0f + ( SLERP_U[i] * d * d - SLERP_V[i] ) * xm1 * cD;
+			}
+			cT *= sign * t;
+			cD *= d;
+			for( int c = 0; c < 4; ++c ) {
+				start[c][k] = cD * start[c][k] + cT * end[c][k];
+			}
+		}
+	}
+	
+	void setLane( const glm::vec3& value, float (*lanes)[CAPACITY], size_t k )
+	{
+		lanes[0][k] = value.x;
+		lanes[1][k] = value.y;
+		lanes[2][k] = value.z;
+	}
+	
+	void setLane( const glm::quat& value, float (*lanes)[CAPACITY], size_t k )
+	{
+		lanes[0][k] = value.x;
+		lanes[1][k] = value.y;
+		lanes[2][k] = value.z;
+		lanes[3][k] = value.w;
+	}
+	
+	//! Queues the keys of \a curve around \a time into lane \a k.
+	template<typename T>
+	void gather( const AnimCurve<T>& curve, float time, AnimCursor* cursor, float (*start)[CAPACITY], float (*end)[CAPACITY], float* factors, size_t k )
+	{
+		T startValue, endValue;
+		curve.getKeys( time, cursor, &startValue, &endValue, &factors[k] );
+		setLane( startValue, start, k );
+		setLane( endValue, end, k );
+	}
+	
+} // anonymous namespace
+
+AnimBatch::AnimBatch( glm::vec3* positions, glm::quat* rotations, glm::vec3* scales )
+: mPositions( positions )
+, mScales( scales )
+, mRotations( rotations )
+, mSize( 0 )
+{
+}
+
+void AnimBatch::add( const AnimTrack& track, float time, AnimTrack::Cursor* cursor, size_t slot )
+{
+	gather( *track.mTranslationCurve, time, &cursor->mTranslation, mTranslationStart, mTranslationEnd, mTranslationFactor, mSize );
+	gather( *track.mRotationCurve, time, &cursor->mRotation, mRotationStart, mRotationEnd, mRotationFactor, mSize );
+	gather( *track.mScalingCurve, time, &cursor->mScaling, mScaleStart, mScaleEnd, mScaleFactor, mSize );
+	mSlots[mSize++] = uint32_t( slot );
+	if( mSize == CAPACITY ) {
+		flush();
+	}
+}
+
+void AnimBatch::flush()
+{
+	lerp<3>( mSize, mTranslationStart, mTranslationEnd, mTranslationFactor );
+	slerp( mSize, mRotationStart, mRotationEnd, mRotationFactor );
+	lerp<3>( mSize, mScaleStart, mScaleEnd, mScaleFactor );
+	
+	for( size_t k = 0; k < mSize; ++k ) {
+		const uint32_t slot = mSlots[k];
+		mPositions[slot] = glm::vec3( mTranslationStart[0][k], mTranslationStart[1][k], mTranslationStart[2][k] );
+		mRotations[slot] = glm::quat( mRotationStart[3][k], mRotationStart[0][k], mRotationStart[1][k], mRotationStart[2][k] );
+		mScales[slot] = glm::vec3( mScaleStart[0][k], mScaleStart[1][k], mScaleStart[2][k] );
+	}
+	mSize = 0;
+}
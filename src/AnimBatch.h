@@ -0,0 +1,42 @@
+#pragma once
+
+#include "AnimTrack.h"
+
+#include <cstdint>
+
+namespace model {
+
+/*!
+ * Interpolates the curves of many tracks at once.
+ * add() only looks up the keys around the sampled time of each curve, into per-component arrays (one lane per
+ * track); the lerps and slerps then run over those arrays, four tracks per SIMD instruction where available,
+ * and the results are written to the slot given for each track. Slerp uses a polynomial approximation free of
+ * trigonometric calls (D. Eberly, "A Fast and Accurate Algorithm for Computing SLERP"): within 1e-6 of glm::slerp()
+ * for keys less than 120 degrees apart, as animation keys are, and 3e-5 at worst.
+ * Holds no heap memory: meant to live on the stack of the function posing a skeleton.
+ */
+class AnimBatch {
+public:
+	//! Tracks interpolated per pass; add() runs a pass whenever that many are pending.
+	static const size_t CAPACITY = 64;
+	
+	//! Results of track \a slot (see add()) go to \a positions[slot], \a rotations[slot] and \a scales[slot].
+	AnimBatch( glm::vec3* positions, glm::quat* rotations, glm::vec3* scales );
+	
+	//! Queues the values of \a track at \a time, using and updating \a cursor as AnimTrack::getValues().
+	void	add( const AnimTrack& track, float time, AnimTrack::Cursor* cursor, size_t slot );
+	//! Interpolates the pending tracks. Call once every track was added.
+	void	flush();
+private:
+	glm::vec3	*mPositions, *mScales;
+	glm::quat	*mRotations;
+	
+	//! Per component, the keys around the sampled time of each pending track, and the factor between them.
+	float		mTranslationStart[3][CAPACITY], mTranslationEnd[3][CAPACITY], mTranslationFactor[CAPACITY];
+	float		mRotationStart[4][CAPACITY], mRotationEnd[4][CAPACITY], mRotationFactor[CAPACITY];
+	float		mScaleStart[3][CAPACITY], mScaleEnd[3][CAPACITY], mScaleFactor[CAPACITY];
+	uint32_t	mSlots[CAPACITY];
+	size_t		mSize;
+};
+
+} //end namespace model
@@ -3,15 +3,109 @@
 
 #include "cinder/CinderAssert.h"
 
+#include <algorithm>
+#include <cmath>
+
 using namespace ci;
 using namespace model;
 
+namespace {
+	//! Curves never drop more than this many consecutive keys, which bounds the cost of reduction.
+	const size_t MAX_REDUCED_SPAN = 256;
+	//! Apart from the largest one, the components of a unit quaternion lie within +-1/sqrt(2).
+	const float QUAT_RANGE = 0.70710678f;
+	
+	float keyError( const vec3& a, const vec3& b ) { return glm::length( a - b ); }
+	float keyError( const dvec3& a, const dvec3& b ) { return float( glm::length( a - b ) ); }
+	float keyError( const quat& a, const quat& b ) { return 2.0f * std::acos( std::min( 1.0f, std::abs( glm::dot( a, b ) ) ) ); }
+	float keyError( const dquat& a, const dquat& b ) { return 2.0f * float( std::acos( std::min( 1.0, std::abs( glm::dot( a, b ) ) ) ) ); }
+	
+	void includeInRange( const vec3& v, vec3* minimum, vec3* maximum ) { *minimum = glm::min( *minimum, v ); *maximum = glm::max( *maximum, v ); }
+	void includeInRange( const dvec3& v, vec3* minimum, vec3* maximum ) { includeInRange( vec3( v ), minimum, maximum ); }
+	void includeInRange( const quat&, vec3*, vec3* ) { }
+	void includeInRange( const dquat&, vec3*, vec3* ) { }
+	
+	//! Each component is mapped to 16 bits over the range of the curve.
+	void packValue( const vec3& v, const float* rangeMin, const float* rangeExtent, uint16_t* out )
+	{
+		for( int c = 0; c < 3; ++c ) {
+			float n = rangeExtent[c] > 0.0f ? ( v[c] - rangeMin[c] ) / rangeExtent[c] : 0.0f;
+			out[c] = uint16_t( glm::clamp( n, 0.0f, 1.0f ) * 65535.0f + 0.5f );
+		}
+	}
+	
+	void unpackValue( const uint16_t* in, const float* rangeMin, const float* rangeExtent, vec3* v )
+	{
+		for( int c = 0; c < 3; ++c ) {
+			(*v)[c] = rangeMin[c] + float( in[c] ) * ( 1.0f / 65535.0f ) * rangeExtent[c];
+		}
+	}
+	
+	//! Smallest three: the largest component is dropped (and made positive), the others get 15 bits each, and its index the top bits of the first two.
+	void packValue( const quat& q, const float*, const float*, uint16_t* out )
+	{
+		quat n = glm::normalize( q );
+		const float c[4] = { n.x, n.y, n.z, n.w };
+		int largest = 0;
+		for( int i = 1; i < 4; ++i ) {
+			if( std::abs( c[i] ) > std::abs( c[largest] ) ) {
+				largest = i;
+			}
+		}
+		const float sign = c[largest] < 0.0f ? -1.0f : 1.0f;
+		
+		uint16_t packed[3];
+		for( int i = 0, k = 0; i < 4; ++i ) {
+			if( i != largest ) {
+				float u = ( sign * c[i] / QUAT_RANGE + 1.0f ) * 0.5f;
+				packed[k++] = uint16_t( glm::clamp( u, 0.0f, 1.0f ) * 32767.0f + 0.5f );
+			}
+		}
+		out[0] = uint16_t( packed[0] | ( ( largest >> 1 ) << 15 ) );
+		out[1] = uint16_t( packed[1] | ( ( largest & 1 ) << 15 ) );
+		out[2] = packed[2];
+	}
+	
+	void unpackValue( const uint16_t* in, const float*, const float*, quat* q )
+	{
+		const int largest = ( ( in[0] >> 15 ) << 1 ) | ( in[1] >> 15 );
+		float c[4];
+		float sum = 0.0f;
+		for( int i = 0, k = 0; i < 4; ++i ) {
+			if( i != largest ) {
+				c[i] = ( float( in[k++] & 0x7FFF ) * ( 2.0f / 32767.0f ) - 1.0f ) * QUAT_RANGE;
+				sum += c[i] * c[i];
+			}
+		}
+		c[largest] = std::sqrt( std::max( 0.0f, 1.0f - sum ) );
+		*q = quat( c[3], c[0], c[1], c[2] );
+	}
+	
+	// Double precision curves go through single precision quantization.
+	void packValue( const dvec3& v, const float* rangeMin, const float* rangeExtent, uint16_t* out ) { packValue( vec3( v ), rangeMin, rangeExtent, out ); }
+	void packValue( const dquat& q, const float* rangeMin, const float* rangeExtent, uint16_t* out ) { packValue( quat( q ), rangeMin, rangeExtent, out ); }
+	void unpackValue( const uint16_t* in, const float* rangeMin, const float* rangeExtent, dvec3* v )
+	{
+		vec3 value;
+		unpackValue( in, rangeMin, rangeExtent, &value );
+		*v = dvec3( value );
+	}
+	void unpackValue( const uint16_t* in, const float* rangeMin, const float* rangeExtent, dquat* q )
+	{
+		quat value;
+		unpackValue( in, rangeMin, rangeExtent, &value );
+		*q = dquat( value );
+	}
+} // anonymous namespace
+
 template< typename T >
 AnimCurve<T>::AnimCurve( const std::shared_ptr<AnimTrack>& parentTrack )
 : mParentTrack( parentTrack.get() )
 , mStartTime( std::numeric_limits<float>::max() )
 , mEndTime( -std::numeric_limits<float>::max() )
 , mAverageFrameDuration( 0.0f )
+, mRangeMin()
+, mRangeExtent()
 {
 	mVirtualDuration = mParentTrack->getAnimDuration();
 }
@@ -20,7 +114,20 @@ template< typename T >
 void AnimCurve<T>::updateAverageFrameDuration( float time )
 {
 	//cumulative average
-	mAverageFrameDuration = ( time - mAverageFrameDuration ) / float( mKeyframes.size() ) ;
+	mAverageFrameDuration = ( time - mAverageFrameDuration ) / float( mTimes.size() ) ;
+}
+
+template< typename T >
+void AnimCurve<T>::setKeyframe( float time, const T& value )
+{
+	auto it = std::lower_bound( mTimes.begin(), mTimes.end(), time );
+	size_t index = it - mTimes.begin();
+	if( it != mTimes.end() && *it == time ) {
+		mValues[index] = value;
+	} else {
+		mTimes.insert( it, time );
+		mValues.insert( mValues.begin() + index, value );
+	}
 }
 
 template< typename T >
@@ -29,8 +136,9 @@ void AnimCurve<T>::addKeyframe( float time, T value )
 	float duration = mParentTrack->getAnimDuration();
 	
 	CI_ASSERT( time <= duration && duration == mVirtualDuration );
+	CI_ASSERT_MSG( ! isQuantized(), "Keyframes can't be added to a compressed curve." );
 	
-	mKeyframes[time] = value;
+	setKeyframe( time, value );
 	
 	if( time < mStartTime ) {
 		mStartTime = time;
@@ -42,41 +150,203 @@ void AnimCurve<T>::addKeyframe( float time, T value )
 	updateAverageFrameDuration( time );
 	
 	// Use an extra 'virtual keyframe' when the last frame is not equal to the first
-	if( time == duration && value != mKeyframes.begin()->second
-	   && mKeyframes.begin()->first == 0.0f ) {
-		mKeyframes[time + mAverageFrameDuration] = mKeyframes.begin()->second;
+	if( time == duration && value != mValues.front()
+	   && mTimes.front() == 0.0f ) {
+		setKeyframe( time + mAverageFrameDuration, mValues.front() );
 		mVirtualDuration = time + mAverageFrameDuration;
 	}
 }
 
 template< typename T >
-T AnimCurve<T>::getValue(float time) const
+T AnimCurve<T>::getValue( float time ) const
 {
-	CI_ASSERT( !mKeyframes.empty() );
-	if( mKeyframes.size() == 1 ) {
-		return mKeyframes.begin()->second;
+	AnimCursor cursor;
+	return getValue( time, &cursor );
+}
+
+template< typename T >
+T AnimCurve<T>::getValue( float time, AnimCursor* cursor ) const
+{
+	CI_ASSERT( !mTimes.empty() );
+	if( mTimes.size() == 1 ) {
+		return getKeyValue( 0 );
 	}
 	
 	float cyclicTime = getCyclicTime( time );
+	cursor->mIndex = uint32_t( findKeyframe( cyclicTime, cursor->mIndex ) );
+	return sample( cyclicTime, cursor->mIndex );
+}
+
+template< typename T >
+size_t AnimCurve<T>::findKeyframe( float cyclicTime, size_t hint ) const
+{
+	const size_t numKeyframes = mTimes.size();
+	if( cyclicTime < mTimes.front() ) {
+		return numKeyframes - 1;
+	}
+	// Playback moves forward: the hinted keyframe or the next one are the likely candidates.
+	for( size_t i = hint; i < numKeyframes && i <= hint + 1; ++i ) {
+		if( mTimes[i] <= cyclicTime && ( i + 1 == numKeyframes || cyclicTime < mTimes[i + 1] ) ) {
+			return i;
+		}
+	}
+	return size_t( std::upper_bound( mTimes.begin(), mTimes.end(), cyclicTime ) - mTimes.begin() ) - 1;
+}
+
+template< typename T >
+void AnimCurve<T>::getKeys( float time, AnimCursor* cursor, T* start, T* end, float* factor ) const
+{
+	CI_ASSERT( !mTimes.empty() );
+	if( mTimes.size() == 1 ) {
+		*start = *end = getKeyValue( 0 );
+		*factor = 0.0f;
+		return;
+	}
 	
-	auto itnext =  mKeyframes.upper_bound( cyclicTime );
-	auto itprev = ( itnext == mKeyframes.begin() ) ? mKeyframes.end() : itnext;
-	itprev--;
-	
+	float cyclicTime = getCyclicTime( time );
+	cursor->mIndex = uint32_t( findKeyframe( cyclicTime, cursor->mIndex ) );
+	size_t next;
+	*factor = locate( cyclicTime, cursor->mIndex, &next );
+	*start = getKeyValue( cursor->mIndex );
+	*end = ( next == cursor->mIndex ) ? *start : getKeyValue( next );
+}
+
+template< typename T >
+float AnimCurve<T>::locate( float cyclicTime, size_t prev, size_t* next ) const
+{
+	*next = prev;
 	// no interpolation needed, we are right on the 'prev' keyframe
-	if( cyclicTime == 0.0f || itprev->first == cyclicTime ) {
-		return itprev->second;
+	if( cyclicTime == 0.0f || mTimes[prev] == cyclicTime ) {
+		return 0.0f;
 	}
 	
 	float normalizedTime;
-	if( itnext == mKeyframes.begin() ) {
-		normalizedTime = cyclicTime / itnext->first;
+	if( cyclicTime < mTimes.front() ) {
+		// wrapping around, from the last keyframe to the first one
+		*next = 0;
+		normalizedTime = cyclicTime / mTimes.front();
+	} else if( prev + 1 == mTimes.size() ) {
+		// past the last keyframe (and no virtual one): hold it
+		return 0.0f;
 	} else {
-		normalizedTime = (cyclicTime - itprev->first) / (itnext->first - itprev->first);
+		*next = prev + 1;
+		normalizedTime = ( cyclicTime - mTimes[prev] ) / ( mTimes[*next] - mTimes[prev] );
 	}
 	
 	CI_ASSERT( 0.0f < normalizedTime && 1.0f >= normalizedTime);
-	return curveLerp( itprev->second, itnext->second, normalizedTime );
+	return normalizedTime;
+}
+
+template< typename T >
+T AnimCurve<T>::sample( float cyclicTime, size_t prev ) const
+{
+	size_t next;
+	const float normalizedTime = locate( cyclicTime, prev, &next );
+	if( next == prev ) {
+		return getKeyValue( prev );
+	}
+	return curveLerp( getKeyValue( prev ), getKeyValue( next ), normalizedTime );
+}
+
+template< typename T >
+T AnimCurve<T>::getKeyValue( size_t index ) const
+{
+	if( mPacked.empty() ) {
+		return mValues[index];
+	}
+	T value;
+	unpackValue( &mPacked[3 * index], mRangeMin, mRangeExtent, &value );
+	return value;
+}
+
+template< typename T >
+float AnimCurve<T>::compress( float tolerance, bool quantize )
+{
+	CI_ASSERT( ! isQuantized() );
+	const std::vector<float> rawTimes = mTimes;
+	const std::vector<T> rawValues = mValues;
+	
+	if( tolerance > 0.0f ) {
+		reduce( tolerance );
+	}
+	mTimes.shrink_to_fit();
+	if( ! quantize || mTimes.empty() ) {
+		return measureError( rawTimes, rawValues );
+	}
+	
+	// 16 bits over a wide range can step by more than the tolerance: keep full precision values when they don't fit.
+	std::vector<T> reducedValues = mValues;
+	pack();
+	const float maxError = measureError( rawTimes, rawValues );
+	if( maxError <= tolerance ) {
+		return maxError;
+	}
+	mValues.swap( reducedValues );
+	std::vector<uint16_t>().swap( mPacked );
+	return measureError( rawTimes, rawValues );
+}
+
+template< typename T >
+float AnimCurve<T>::measureError( const std::vector<float>& times, const std::vector<T>& values ) const
+{
+	float maxError = 0.0f;
+	for( size_t k = 0; k < times.size() && mTimes.size() > 1; ++k ) {
+		T value = sample( times[k], findKeyframe( times[k], 0 ) );
+		maxError = std::max( maxError, keyError( value, values[k] ) );
+	}
+	return maxError;
+}
+
+template< typename T >
+void AnimCurve<T>::reduce( float tolerance )
+{
+	const size_t numKeyframes = mTimes.size();
+	if( numKeyframes <= 2 ) {
+		return;
+	}
+	
+	// Grow each segment from its anchor for as long as interpolating across it reproduces every key it skips.
+	std::vector<size_t> kept( 1, 0 );
+	size_t anchor = 0;
+	for( size_t end = 2; end < numKeyframes; ++end ) {
+		bool fits = end - anchor <= MAX_REDUCED_SPAN;
+		for( size_t k = anchor + 1; fits && k < end; ++k ) {
+			float u = ( mTimes[k] - mTimes[anchor] ) / ( mTimes[end] - mTimes[anchor] );
+			fits = keyError( curveLerp( mValues[anchor], mValues[end], u ), mValues[k] ) <= tolerance;
+		}
+		if( ! fits ) {
+			anchor = end - 1;
+			kept.push_back( anchor );
+		}
+	}
+	kept.push_back( numKeyframes - 1 );
+	
+	for( size_t i = 0; i < kept.size(); ++i ) {
+		mTimes[i] = mTimes[kept[i]];
+		mValues[i] = mValues[kept[i]];
+	}
+	mTimes.resize( kept.size() );
+	mValues.resize( kept.size() );
+}
+
+template< typename T >
+void AnimCurve<T>::pack()
+{
+	vec3 minimum( std::numeric_limits<float>::max() );
+	vec3 maximum( -std::numeric_limits<float>::max() );
+	for( const auto& value : mValues ) {
+		includeInRange( value, &minimum, &maximum );
+	}
+	for( int c = 0; c < 3; ++c ) {
+		mRangeMin[c] = ( minimum[c] <= maximum[c] ) ? minimum[c] : 0.0f;
+		mRangeExtent[c] = ( minimum[c] <= maximum[c] ) ? maximum[c] - minimum[c] : 0.0f;
+	}
+	
+	mPacked.resize( 3 * mValues.size() );
+	for( size_t k = 0; k < mValues.size(); ++k ) {
+		packValue( mValues[k], mRangeMin, mRangeExtent, &mPacked[3 * k] );
+	}
+	std::vector<T>().swap( mValues );
 }
 
 template< typename T >
@@ -4,30 +4,84 @@
 #include "cinder/Matrix.h"
 #include "cinder/Quaternion.h"
 
+#include <cstdint>
 #include <limits>
-#include <map>
+#include <vector>
 
 namespace model {
 	
 class AnimTrack;
+class ModelCache;
+
+/*!
+ * Remembers where the previous sample of a curve fell, so that sampling it again at the same or a
+ * slightly later time (i.e. during playback) does not search the keyframes. Keep one per curve and
+ * per animated instance; a cursor is only a hint and any time can be sampled with it.
+ */
+struct AnimCursor {
+	AnimCursor() : mIndex( 0 ) { }
+	//! 32 bits: every instance keeps three per animated node.
+	uint32_t mIndex;
+};
 
 template< typename T >
 class AnimCurve {
 public:
-	AnimCurve() { }
+	friend class ModelCache;
+
+	AnimCurve() : mRangeMin(), mRangeExtent() { }
 	AnimCurve( const std::shared_ptr<AnimTrack>& parentTrack );
 	void	addKeyframe(float time, T value);
 	T		getValue(float time) const;
-	bool	empty() { return mKeyframes.empty(); }
+	//! Same as getValue( time ), starting the keyframe search from \a cursor which is then updated.
+	T		getValue( float time, AnimCursor* cursor ) const;
+	/*!
+	 * The two keyframe values around \a time and the factor in [0, 1] interpolating them, i.e. what getValue() blends:
+	 * for interpolating many curves at once (see AnimBatch). Both values are the same key where no interpolation is needed.
+	 */
+	void	getKeys( float time, AnimCursor* cursor, T* start, T* end, float* factor ) const;
+	bool	empty() const { return mTimes.empty(); }
+	size_t	getNumKeyframes() const { return mTimes.size(); }
+	//! Bytes used by the keyframes.
+	size_t	getMemorySize() const { return mTimes.size() * sizeof( float ) + mValues.size() * sizeof( T ) + mPacked.size() * sizeof( uint16_t ); }
+	bool	isQuantized() const { return ! mPacked.empty(); }
+	
+	/*!
+	 * Drops the keys which interpolating their kept neighbours reproduces within \a tolerance, then
+	 * optionally quantizes the values to 16 bits per component (smallest-three for rotations). Curves whose
+	 * quantized error would exceed \a tolerance (i.e. translations over a wide range) keep full precision
+	 * values instead. Sampling stays random access: only the two keys around the sampled time are decoded. Tolerances are
+	 * distances for vectors, angles in radians for rotations. Keyframes can't be added afterwards.
+	 * Returns the largest error over the original keys.
+	 */
+	float	compress( float tolerance, bool quantize );
 	
 private:
+	//! Index of the last keyframe at or before \a cyclicTime, the last keyframe if there is none (we wrap around).
+	size_t				findKeyframe( float cyclicTime, size_t hint ) const;
+	T					sample( float cyclicTime, size_t prev ) const;
+	//! Keyframe following \a prev at \a cyclicTime into \a next and the factor between them, \a prev itself and 0 if there's nothing to interpolate.
+	float				locate( float cyclicTime, size_t prev, size_t* next ) const;
+	//! Inserts or replaces the keyframe at \a time, keeping the arrays sorted.
+	void				setKeyframe( float time, const T& value );
+	//! Value of keyframe \a index, decoded if quantized.
+	T					getKeyValue( size_t index ) const;
+	void				reduce( float tolerance );
+	void				pack();
+	//! Largest error of playback at \a times against \a values, the original keys.
+	float				measureError( const std::vector<float>& times, const std::vector<T>& values ) const;
 	static inline T		curveLerp( const T& start, const T& end, float time );
 	static inline bool	isFinite( const glm::vec3& vec );
 	inline float		getCyclicTime( float time ) const;
 	void				updateAverageFrameDuration( float time );
 	
 	AnimTrack*			mParentTrack;
-	std::map<float, T>	mKeyframes;
+	//! Keyframes sorted by time, as two parallel arrays: searches only touch the times.
+	std::vector<float>	mTimes;
+	std::vector<T>		mValues;
+	//! Quantized values (3 per keyframe) replacing mValues once compressed, and the range of vector components.
+	std::vector<uint16_t>	mPacked;
+	float				mRangeMin[3], mRangeExtent[3];
 	float mStartTime, mEndTime;
 	float mVirtualDuration, mAverageFrameDuration;
 };
@@ -12,8 +12,46 @@
 
 #include "cinder/CinderMath.h"
 
+#include <algorithm>
+
 namespace model {
 
+//! Load-time animation compression, see AnimCurve::compress().
+struct AnimCompression {
+	AnimCompression()
+	: mTranslationTolerance( 0.001f ), mRotationTolerance( 0.0005f ), mScaleTolerance( 0.0001f ), mQuantize( true )
+	{ }
+	
+	AnimCompression& translationTolerance( float tolerance ) { mTranslationTolerance = tolerance; return *this; }
+	//! In radians.
+	AnimCompression& rotationTolerance( float tolerance ) { mRotationTolerance = tolerance; return *this; }
+	AnimCompression& scaleTolerance( float tolerance ) { mScaleTolerance = tolerance; return *this; }
+	AnimCompression& quantize( bool quantize ) { mQuantize = quantize; return *this; }
+	
+	float	mTranslationTolerance, mRotationTolerance, mScaleTolerance;
+	bool	mQuantize;
+};
+
+//! Outcome of compressing the tracks of an animation clip.
+struct AnimCompressionStats {
+	AnimCompressionStats()
+	: mRawBytes( 0 ), mCompressedBytes( 0 ), mMaxTranslationError( 0 ), mMaxRotationError( 0 ), mMaxScaleError( 0 )
+	{ }
+	
+	float	getRatio() const { return mCompressedBytes > 0 ? float( mRawBytes ) / float( mCompressedBytes ) : 1.0f; }
+	void	merge( const AnimCompressionStats& rhs )
+	{
+		mRawBytes += rhs.mRawBytes;
+		mCompressedBytes += rhs.mCompressedBytes;
+		mMaxTranslationError = std::max( mMaxTranslationError, rhs.mMaxTranslationError );
+		mMaxRotationError = std::max( mMaxRotationError, rhs.mMaxRotationError );
+		mMaxScaleError = std::max( mMaxScaleError, rhs.mMaxScaleError );
+	}
+	
+	size_t	mRawBytes, mCompressedBytes;
+	float	mMaxTranslationError, mMaxRotationError, mMaxScaleError;
+};
+
 class AnimTrack {
 public:
 	static std::shared_ptr<AnimTrack> create(float duration, float ticksPerSecond ) {
@@ -24,9 +62,9 @@ public:
 		return track;
 	}
 	
-	float	getAnimDuration() { return mDuration; }
+	float	getAnimDuration() const { return mDuration; }
 	void	setAnimDuration( float duration ) { mDuration = duration; }
-	float	getAnimTicksPerSecond() { return mTicksPerSecond; }
+	float	getAnimTicksPerSecond() const { return mTicksPerSecond; }
 	void	setAnimTicksPerSecond( float ticksPerSecond ) { mTicksPerSecond = ticksPerSecond; }
 	
 	glm::vec3 getTranslation( float time ) const
@@ -44,13 +82,44 @@ public:
 		return mScalingCurve->getValue( time );
 	}
 	
-	void getValues( float time, glm::vec3* translate, glm::quat* rotation,  glm::vec3* scale )
+	void getValues( float time, glm::vec3* translate, glm::quat* rotation,  glm::vec3* scale ) const
 	{
 		*translate = mTranslationCurve->getValue( time );
 		*rotation = mRotationCurve->getValue( time );
 		*scale = mScalingCurve->getValue( time );
 	}
 	
+	//! Playback position in each curve of the track, see AnimCursor.
+	struct Cursor {
+		AnimCursor mTranslation, mRotation, mScaling;
+	};
+	
+	void getValues( float time, glm::vec3* translate, glm::quat* rotation,  glm::vec3* scale, Cursor* cursor ) const
+	{
+		*translate = mTranslationCurve->getValue( time, &cursor->mTranslation );
+		*rotation = mRotationCurve->getValue( time, &cursor->mRotation );
+		*scale = mScalingCurve->getValue( time, &cursor->mScaling );
+	}
+	
+	//! Bytes used by the keyframes of the three curves.
+	size_t getMemorySize() const
+	{
+		return mTranslationCurve->getMemorySize() + mRotationCurve->getMemorySize() + mScalingCurve->getMemorySize();
+	}
+	
+	//! Compresses the three curves, accumulating sizes and errors into \a stats.
+	void compress( const AnimCompression& compression, AnimCompressionStats* stats )
+	{
+		stats->mRawBytes += getMemorySize();
+		float translationError = mTranslationCurve->compress( compression.mTranslationTolerance, compression.mQuantize );
+		float rotationError = mRotationCurve->compress( compression.mRotationTolerance, compression.mQuantize );
+		float scaleError = mScalingCurve->compress( compression.mScaleTolerance, compression.mQuantize );
+		stats->mCompressedBytes += getMemorySize();
+		stats->mMaxTranslationError = std::max( stats->mMaxTranslationError, translationError );
+		stats->mMaxRotationError = std::max( stats->mMaxRotationError, rotationError );
+		stats->mMaxScaleError = std::max( stats->mMaxScaleError, scaleError );
+	}
+	
 	glm::mat4 getTransformation( float time ) const
 	{
 		glm::mat4 t = glm::scale( mScalingCurve->getValue( time ) );
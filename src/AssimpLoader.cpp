@@ -2,8 +2,13 @@
 #include "Skeleton.h"
 
 #include "SurfacePool.h"
+#include "DataSourceIOSystem.h"
+#include "ModelCache.h"
+#include "Parallel.h"
+#include "SampledClip.h"
 
 #include "assimp/postprocess.h"
+#include "assimp/ProgressHandler.hpp"
 #include "../assimp/code/ProcessHelper.h"
 #include "cinder/ImageIo.h"
 #include "cinder/app/App.h"
@@ -12,9 +17,15 @@
 #include <boost/algorithm/string.hpp>
 #include <assert.h> 
 #include <algorithm>
+#include <cstring>
 
 #include "glm/gtc/type_ptr.hpp"
 
+#if ! defined( ASSIMP_DOUBLE_PRECISION ) && ( defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 ) )
+	#define MODEL_AI_USE_SSE2
+	#include <emmintrin.h>
+#endif
+
 using namespace glm;
 
 namespace model {
@@ -50,6 +61,13 @@ namespace ai {
 		aiProcess_GenUVCoords |
 		aiProcess_SortByPType;
 	
+	unsigned int getMorphTargetFlags( unsigned int flags )
+	{
+		// Steps that reorder or join vertices are kept: a target's vertices have to line up with the model's.
+		return flags & ~( aiProcess_CalcTangentSpace | aiProcess_GenNormals | aiProcess_GenSmoothNormals | aiProcess_GenUVCoords
+						  | aiProcess_FlipUVs | aiProcess_FixInfacingNormals | aiProcess_RemoveRedundantMaterials | aiProcess_TransformUVCoords );
+	}
+	
 	vec3 get( const aiVector3D &v ) {
 		return vec3( v.x, v.y, v.z );
 	}
@@ -70,72 +88,110 @@ namespace ai {
 		return std::string( s.data );
 	}
 	
-	std::vector<vec3> getPositions( const aiMesh* aimesh ) {
-		if ( !aimesh->HasPositions() ) {
-			return std::vector<vec3>();
+	namespace {
+		//! Converts an aiVector3D array to glm::vec3 with a single allocation.
+		void copyVectors( const aiVector3D* src, size_t count, std::vector<vec3>* dst )
+		{
+#if ! defined( ASSIMP_DOUBLE_PRECISION )
+			// Same memory layout when ai_real is float: this boils down to a memcpy.
+			static_assert( sizeof( aiVector3D ) == sizeof( vec3 ), "aiVector3D and glm::vec3 layouts differ." );
+			const vec3* begin = reinterpret_cast<const vec3*>( src );
+			dst->assign( begin, begin + count );
+#else
+			dst->resize( count );
+			vec3* out = dst->data();
+			for( size_t i = 0; i < count; ++i ) {
+				out[i] = vec3( float( src[i].x ), float( src[i].y ), float( src[i].z ) );
+			}
+#endif
+		}
+		
+		//! Drops the third component of an aiVector3D array (assimp texture coordinates are always 3D).
+		void copyTexCoords( const aiVector3D* src, size_t count, std::vector<vec2>* dst )
+		{
+			dst->resize( count );
+			float* out = reinterpret_cast<float*>( dst->data() );
+			size_t i = 0;
+#if defined( MODEL_AI_USE_SSE2 )
+			// Four vertices per iteration: 3 unaligned loads of xyz|xyz.. and 2 stores of xy|xy..
+			const float* in = reinterpret_cast<const float*>( src );
+			for( ; i + 4 <= count; i += 4 ) {
+				__m128 a = _mm_loadu_ps( in + 3 * i );		// x0 y0 z0 x1
+				__m128 b = _mm_loadu_ps( in + 3 * i + 4 );	// y1 z1 x2 y2
+				__m128 c = _mm_loadu_ps( in + 3 * i + 8 );	// z2 x3 y3 z3
+				__m128 t = _mm_shuffle_ps( a, b, _MM_SHUFFLE( 0, 0, 3, 3 ) ); // x1 x1 y1 y1
+				_mm_storeu_ps( out + 2 * i, _mm_shuffle_ps( a, t, _MM_SHUFFLE( 2, 0, 1, 0 ) ) );
+				_mm_storeu_ps( out + 2 * i + 4, _mm_shuffle_ps( b, c, _MM_SHUFFLE( 2, 1, 3, 2 ) ) );
+			}
+#endif
+			for( ; i < count; ++i ) {
+				out[2 * i]		= float( src[i].x );
+				out[2 * i + 1]	= float( src[i].y );
+			}
 		}
 		
+		//! Refers to an orphaned aiScene's vectors in place when possible, copies them otherwise.
+		void aliasVectors( const aiVector3D* src, size_t count, const std::shared_ptr<const aiScene>& scene, AttribArray<vec3>* dst )
+		{
+			if( ! src ) {
+				return;
+			}
+#if ! defined( ASSIMP_DOUBLE_PRECISION )
+			dst->alias( reinterpret_cast<const vec3*>( src ), count, scene );
+#else
+			std::vector<vec3> values;
+			copyVectors( src, count, &values );
+			*dst = std::move( values );
+#endif
+		}
+	} // anonymous namespace
+	
+	std::vector<vec3> getPositions( const aiMesh* aimesh ) {
 		std::vector<vec3> positions;
-		for( unsigned int i=0; i < aimesh->mNumVertices; ++i ) {
-			positions.push_back( ai::get( aimesh->mVertices[i] ) );
+		if ( aimesh->HasPositions() ) {
+			copyVectors( aimesh->mVertices, aimesh->mNumVertices, &positions );
 		}
 		return positions;
 	}
 	
 	std::vector<vec3> getNormals( const aiMesh* aimesh ) {
-		if ( !aimesh->HasNormals() ) {
-			return std::vector<vec3>();
-		}
-		
 		std::vector<vec3> normals;
-		for( unsigned int i=0; i < aimesh->mNumVertices; ++i ) {
-			normals.push_back( ai::get( aimesh->mNormals[i] ) );
+		if ( aimesh->HasNormals() ) {
+			copyVectors( aimesh->mNormals, aimesh->mNumVertices, &normals );
 		}
 		return normals;
 	}
 	
 	std::vector<vec3> getTangents( const aiMesh* aimesh ) {
-		if ( !aimesh->HasTangentsAndBitangents() ) {
-			return std::vector<vec3>();
-		}
-		
 		std::vector<vec3> tangents;
-		for( unsigned int i=0; i < aimesh->mNumVertices; ++i ) {
-			tangents.push_back( ai::get( aimesh->mTangents[i] ) );
+		if ( aimesh->HasTangentsAndBitangents() ) {
+			copyVectors( aimesh->mTangents, aimesh->mNumVertices, &tangents );
 		}
 		return tangents;
 	}
 	
-	std::vector<vec3> getBiTangents( const aiMesh* aimesh ) {
-		if ( !aimesh->HasTangentsAndBitangents() ) {
-			return std::vector<vec3>();
-		}
-		
+	std::vector<vec3> getBitangents( const aiMesh* aimesh ) {
 		std::vector<vec3> bitangents;
-		for( unsigned int i=0; i < aimesh->mNumVertices; ++i ) {
-			bitangents.push_back( ai::get( aimesh->mBitangents[i] ) );
+		if ( aimesh->HasTangentsAndBitangents() ) {
+			copyVectors( aimesh->mBitangents, aimesh->mNumVertices, &bitangents );
 		}
 		return bitangents;
 	}
 	
 	std::vector<vec2> getTexCoords( const aiMesh* aimesh, unsigned int unit ) {
-		if ( !aimesh->HasTextureCoords(unit) ) {
-			return std::vector<vec2>();
-		}
-		
 		std::vector<vec2> texCoords;
-		for( unsigned int i=0; i < aimesh->mNumVertices; ++i ) {
-			texCoords.push_back( vec2(aimesh->mTextureCoords[unit][i].x,
-										   aimesh->mTextureCoords[unit][i].y) );
+		if ( aimesh->HasTextureCoords( unit ) ) {
+			copyTexCoords( aimesh->mTextureCoords[unit], aimesh->mNumVertices, &texCoords );
 		}
-		assert( texCoords.size() > 0 );
 		return texCoords;
 	}
 	
 	std::vector<std::uint32_t> getIndices( const aiMesh* aimesh ) {
 		std::vector<std::uint32_t> indices;
+		// Sized for triangles, which aiProcess_Triangulate leaves only; quads (6 indices) grow the buffer past it.
+		indices.reserve( aimesh->mNumFaces * 3 );
 		for( unsigned int i=0; i < aimesh->mNumFaces; ++i ) {
-			aiFace aiface = aimesh->mFaces[i];
+			const aiFace& aiface = aimesh->mFaces[i];
 			unsigned numIndices = aiface.mNumIndices;
 			if( numIndices == 2 ) {
 				indices.emplace_back( aiface.mIndices[0] );
@@ -163,7 +219,7 @@ namespace ai {
 		return indices;
 	}
 	
-	void loadSurface( ci::fs::path texturePath, const aiMaterial *mtl, model::MaterialSource::TextureType type, const std::shared_ptr<SurfacePool>& surfacePool, model::MaterialSource* matSource )
+	void loadSurface( ci::fs::path texturePath, const ci::DataSourceRef& textureSource, const aiMaterial *mtl, model::MaterialSource::TextureType type, const std::shared_ptr<SurfacePool>& surfacePool, model::MaterialSource* matSource )
 	{
 		int horizontalMapMode;
 		if ( AI_SUCCESS == mtl->Get( AI_MATKEY_MAPPINGMODE_U_DIFFUSE( 0 ), horizontalMapMode ) ) {
@@ -192,11 +248,12 @@ namespace ai {
 //		std::string ext = texturePath.extension().string();
 //		boost::algorithm::to_lower( ext );
 		
-		matSource->mSurfaces[type] = surfacePool->loadSurface( texturePath );
+		matSource->mSurfaces[type] = surfacePool->loadSurface( texturePath, textureSource );
+		matSource->mTexturePaths[type] = texturePath;
 	}
 	
 	
-	model::MaterialSource getMaterial( const aiScene* aiscene, const aiMesh *aimesh, ci::fs::path modelPath, const std::shared_ptr<SurfacePool>& surfacePool, ci::fs::path rootPath )
+	model::MaterialSource getMaterial( const aiScene* aiscene, const aiMesh *aimesh, ci::fs::path modelPath, const std::shared_ptr<SurfacePool>& surfacePool, ci::fs::path rootPath, const DataSourceResolver& resolver )
 	{
 		model::MaterialSource matSource;
 		// Handle material info
@@ -241,6 +298,9 @@ namespace ai {
 //		}
 		
 		
+		if( ! surfacePool ) {
+			return matSource;
+		}
 		for( auto& textureType : model::MaterialSource::sTextureTypes ) {
 			aiString textureFileName;
 			// FIXME: We're only loading the first texture of each type (index 0)
@@ -253,8 +313,14 @@ namespace ai {
 				}
 				CI_LOG_I(" [" << texturePath.string() << "] of texture type: " << Assimp::TextureTypeToString((aiTextureType)textureType));
 				
-				if( ci::fs::exists( texturePath ) ) {
-					loadSurface( texturePath, mtl, textureType, surfacePool, &matSource );
+				if( resolver ) {
+					ci::DataSourceRef textureSource = resolver( texturePath );
+					if( textureSource ) {
+						loadSurface( texturePath, textureSource, mtl, textureType, surfacePool, &matSource );
+					}
+				}
+				else if( ci::fs::exists( texturePath ) ) {
+					loadSurface( texturePath, nullptr, mtl, textureType, surfacePool, &matSource );
 				}
 			}
 		}
@@ -262,18 +328,80 @@ namespace ai {
 		return matSource;
 	}
 	
-	std::vector<model::Weights> getBoneWeights( const aiMesh* aimesh, const std::unordered_map<std::string, std::shared_ptr<Node>>& bones )
+	size_t NameTable::KeyHash::operator()( const Key& key ) const
+	{
+		// FNV-1a.
+		size_t hash = size_t( 2166136261u );
+		for( size_t i = 0; i < key.mLength; ++i ) {
+			hash = ( hash ^ size_t( static_cast<unsigned char>( key.mData[i] ) ) ) * size_t( 16777619u );
+		}
+		return hash;
+	}
+	
+	bool NameTable::KeyEqual::operator()( const Key& lhs, const Key& rhs ) const
+	{
+		return lhs.mLength == rhs.mLength && std::memcmp( lhs.mData, rhs.mData, lhs.mLength ) == 0;
+	}
+	
+	NameTable::NameTable( const aiScene* aiscene )
+	: mMeshNodes( aiscene->mNumMeshes, nullptr )
+	{
+		if( aiscene->mRootNode ) {
+			addNode( aiscene->mRootNode );
+		}
+	}
+	
+	void NameTable::addNode( const aiNode* ainode )
+	{
+		// Later nodes of the same name keep the id of the first, as the bones did when keyed by name.
+		if( mIds.emplace( Key{ ainode->mName.data, ainode->mName.length }, int32_t( mNodes.size() ) ).second ) {
+			mNodes.push_back( ainode );
+		}
+		for( unsigned int i = 0; i < ainode->mNumMeshes; ++i ) {
+			const aiNode*& meshNode = mMeshNodes[ainode->mMeshes[i]];
+			if( ! meshNode ) {
+				meshNode = ainode;
+			}
+		}
+		for( unsigned int c = 0; c < ainode->mNumChildren; ++c ) {
+			addNode( ainode->mChildren[c] );
+		}
+	}
+	
+	int32_t NameTable::find( const aiString& name ) const
+	{
+		auto id = mIds.find( Key{ name.data, name.length } );
+		return ( id != mIds.end() ) ? id->second : -1;
+	}
+	
+	std::vector<bool> findBones( const aiScene* aiscene, const NameTable& names )
+	{
+		std::vector<bool> isBone( names.size(), false );
+		for( unsigned int m = 0; m < aiscene->mNumMeshes; ++m ) {
+			const aiMesh* aimesh = aiscene->mMeshes[m];
+			for( unsigned int b = 0; b < aimesh->mNumBones; ++b ) {
+				const int32_t id = names.find( aimesh->mBones[b]->mName );
+				if( id >= 0 ) {
+					isBone[id] = true;
+				} else {
+					CI_LOG_W( "Bone " << ai::get( aimesh->mBones[b]->mName ) << " of mesh " << ai::get( aimesh->mName ) << " names no node." );
+				}
+			}
+		}
+		return isBone;
+	}
+	
+	std::vector<model::Weights> getBoneWeights( const aiMesh* aimesh, const NameTable& names, const std::vector<std::shared_ptr<Node>>& bones )
 	{
 		// Create a list of empty bone weights mirroring the # of vertices
 		std::vector<model::Weights> weights( aimesh->mNumVertices, model::Weights() );
 
 		for( unsigned b=0; b < aimesh->mNumBones; ++b ){
-			model::NodeRef bone = bones.at( ai::get( aimesh->mBones[b]->mName ) );
-			
-			// Set the bone offset matrix if it hasn't been already
-			if( bone->getOffset() == nullptr ) {
-				bone->setOffsetMatrix( ai::get( aimesh->mBones[b]->mOffsetMatrix ) ) ;
+			const int32_t id = names.find( aimesh->mBones[b]->mName );
+			if( id < 0 || ! bones[id] ) {
+				continue;
 			}
+			const model::NodeRef& bone = bones[id];
 			
 			// Add the bone weight information to the correct vertex index
 			aiBone* aibone = aimesh->mBones[b];
@@ -286,6 +414,20 @@ namespace ai {
 		return weights;
 	}
 	
+	void setBoneOffsets( const aiScene* aiscene, const NameTable& names, const std::vector<std::shared_ptr<Node>>& bones )
+	{
+		for( unsigned int m = 0; m < aiscene->mNumMeshes; ++m ) {
+			const aiMesh* aimesh = aiscene->mMeshes[m];
+			for( unsigned b = 0; b < aimesh->mNumBones; ++b ) {
+				const int32_t id = names.find( aimesh->mBones[b]->mName );
+				// Set the bone offset matrix if it hasn't been already
+				if( id >= 0 && bones[id] && bones[id]->getOffset() == nullptr ) {
+					bones[id]->setOffsetMatrix( ai::get( aimesh->mBones[b]->mOffsetMatrix ) );
+				}
+			}
+		}
+	}
+	
 	const aiNode* findMeshNode( const std::string& meshName, const aiScene* aiscene, const aiNode* ainode )
 	{
 		for( unsigned i=0; i<ainode->mNumMeshes; ++i ) {
@@ -303,16 +445,17 @@ namespace ai {
 		return nullptr;
 	}
 	
-	model::NodeRef generateNodeHierarchy( std::unordered_map<std::string, std::shared_ptr<Node>>* bones,
+	//! Builds the node hierarchy, gathering in \a bones the bone of each name id flagged in \a isBone, and the same by name in \a boneMap.
+	model::NodeRef generateNodeHierarchy( std::vector<std::shared_ptr<Node>>* bones,
+										 std::unordered_map<std::string, std::shared_ptr<Node>>* boneMap,
 										 const aiNode* ainode,
-										 const std::unordered_set<std::string>& boneNames,
+										 const NameTable& names,
+										 const std::vector<bool>& isBone,
 										 const std::shared_ptr<model::Node>& parent = nullptr,
-										 mat4 derivedTransformation = mat4{},
 										 int level = 0 )
 	{
 		assert( ainode );
 		
-		derivedTransformation *= ai::get( ainode->mTransformation );
 		std::string name = ai::get( ainode->mName );
 		
 		// store transform
@@ -321,35 +464,34 @@ namespace ai {
 		ainode->mTransformation.Decompose( scaling, rotation, position );
 		model::NodeRef node = model::Node::create( ai::get(position), ai::get(rotation), ai::get(scaling), name, parent, level );
 		
-		if( boneNames.count(name) > 0 && bones->count( name ) == 0 ) {
-			node->setBoneIndex( bones->size() );
-			bones->emplace( name, node );
+		const int32_t id = names.find( ainode->mName );
+		if( id >= 0 && isBone[id] && ! (*bones)[id] ) {
+			node->setBoneIndex( boneMap->size() );
+			(*bones)[id] = node;
+			boneMap->emplace( name, node );
 		}
 		
 		for( unsigned int c=0; c < ainode->mNumChildren; ++c) {
-			model::NodeRef child = generateNodeHierarchy( bones, ainode->mChildren[c], boneNames, node, derivedTransformation, level + 1);
+			model::NodeRef child = generateNodeHierarchy( bones, boneMap, ainode->mChildren[c], names, isBone, node, level + 1);
 			node->addChild( child );
 		}
 		return node;
 	}
 	
 	
-	void generateAnimationCurves( const std::unordered_map<std::string, std::shared_ptr<Node>>& bones, const aiScene* aiscene )
+	void generateAnimationCurves( const NameTable& names, const std::vector<std::shared_ptr<Node>>& bones, const aiScene* aiscene )
 	{
 		for( unsigned int a=0; a < aiscene->mNumAnimations; ++a) {
 			aiAnimation* anim = aiscene->mAnimations[a];
+			float tsecs = ( anim->mTicksPerSecond != 0 ) ? (float) anim->mTicksPerSecond : 25.0f;
+			CI_LOG_I(" Duration: " << anim->mDuration << " seconds:" << tsecs);
 			
 			for( unsigned int c=0; c < anim->mNumChannels; ++c ) {
 				aiNodeAnim* nodeAnim = anim->mChannels[c];
-				model::NodeRef bone;
-				auto name = ai::get( nodeAnim->mNodeName );
-				if( bones.count( name ) ) {
-					bone = bones.at( name );
-				}
+				const int32_t id = names.find( nodeAnim->mNodeName );
+				model::Node* bone = ( id >= 0 ) ? bones[id].get() : nullptr;
 				if( bone ) {
-					float tsecs = ( anim->mTicksPerSecond != 0 ) ? (float) anim->mTicksPerSecond : 25.0f;
 					bone->addAnimTrack( a, float( anim->mDuration ), tsecs );
-					CI_LOG_I(" Duration: " << anim->mDuration << " seconds:" << tsecs);
 					for( unsigned int k=0; k < nodeAnim->mNumPositionKeys; ++k) {
 						const aiVectorKey& key = nodeAnim->mPositionKeys[k];
 						bone->addPositionKeyframe( a, (float) key.mTime, ai::get( key.mValue ) );
@@ -381,58 +523,327 @@ namespace ai {
 		return mAnimInfos;
 	}
 	
-	std::unordered_set<std::string>  getBoneNames( const aiScene* aiscene )
-	{
-		std::unordered_set<std::string> boneNames;
-#if 0
-		for( unsigned int m=0; m < aiscene->mNumMeshes; ++m ) {
-			aiMesh * mesh = aiscene->mMeshes[m];
-			for( unsigned int b=0; b < mesh->mNumBones; ++b) {
-				std::string name = ai::get( mesh->mBones[b]->mName );
-				boneNames.insert( name );
+} //end namespace ai
+
+namespace {
+	//! Share of the overall progress taken by assimp's own parsing and post-processing.
+	const float IMPORT_PROGRESS = 0.5f;
+	
+	//! Forwards assimp's progress to an asynchronous load, and asks assimp to stop once it was cancelled.
+	class ProgressForwarder : public Assimp::ProgressHandler {
+	public:
+		ProgressForwarder( const std::function<void( float )>& report, const std::function<bool()>& cancelled )
+		: mReport( report ), mCancelled( cancelled ) { }
+		
+		bool Update( float percentage ) override
+		{
+			if( percentage >= 0.0f ) {
+				mReport( percentage * IMPORT_PROGRESS );
 			}
+			return ! mCancelled();
 		}
-#else
-        auto processNode = [](aiNode* node) {
+	private:
+		std::function<void( float )>	mReport;
+		std::function<bool()>			mCancelled;
+	};
+} // anonymous namespace
 
-        };
-#endif
-		return boneNames;
-	}
-	
-} //end namespace ai
+void AssimpLoader::AsyncLoad::setProgress( float progress )
+{
+	// Sections complete out of order: only ever move forward.
+	float current = mProgress;
+	while( progress > current && ! mProgress.compare_exchange_weak( current, progress ) ) { }
+}
 
 AssimpLoader::AssimpLoader(const ci::DataSourceRef& dataSource, const Settings& settings)
     : mRootAssetFolderPath(settings.mRootAssetFolderPath)
     , mSurfacePool(settings.mSurfacePool)
     , mHasAnimations(false)
     , mHasSkeleton(false)
+    , mNumThreads(settings.mNumThreads)
+    , mMeshletMaxVertices(settings.mMeshletMaxVertices)
+    , mMeshletMaxTriangles(settings.mMeshletMaxTriangles)
+    , mLodLevels(settings.mLodLevels)
+    , mLodTriangleRatio(settings.mLodTriangleRatio)
+    , mLodSkinTolerance(settings.mLodSkinTolerance)
+    , mLoadTextures(settings.mLoadTextures)
+    , mRemovedComponents(settings.getRemovedComponents())
+    , mAsyncLoad(nullptr)
+    , mResolver(serializeResolver(settings.mResolver))
 {
+	load( dataSource, settings );
+}
+
+AssimpLoader::AssimpLoader( const ci::DataSourceRef& dataSource, const Settings& settings, AsyncLoad* asyncLoad )
+    : mRootAssetFolderPath(settings.mRootAssetFolderPath)
+    , mSurfacePool(settings.mSurfacePool)
+    , mHasAnimations(false)
+    , mHasSkeleton(false)
+    , mNumThreads(settings.mNumThreads)
+    , mMeshletMaxVertices(settings.mMeshletMaxVertices)
+    , mMeshletMaxTriangles(settings.mMeshletMaxTriangles)
+    , mLodLevels(settings.mLodLevels)
+    , mLodTriangleRatio(settings.mLodTriangleRatio)
+    , mLodSkinTolerance(settings.mLodSkinTolerance)
+    , mLoadTextures(settings.mLoadTextures)
+    , mRemovedComponents(settings.getRemovedComponents())
+    , mAsyncLoad(asyncLoad)
+    , mResolver(serializeResolver(settings.mResolver))
+{
+	load( dataSource, settings );
+	// The handle may outlive the loader: don't keep a pointer to it around.
+	mAsyncLoad = nullptr;
+}
+
+AssimpLoader::AsyncLoadRef AssimpLoader::loadAsync( const ci::DataSourceRef& dataSource, const Settings& settings )
+{
+	AsyncLoadRef asyncLoad( new AsyncLoad );
+	// The handle's destructor waits on the future, so the raw pointer outlives the task.
+	AsyncLoad* handle = asyncLoad.get();
+	asyncLoad->mFuture = std::async( std::launch::async, [dataSource, settings, handle] {
+		return AssimpLoaderRef( new AssimpLoader( dataSource, settings, handle ) );
+	} ).share();
+	return asyncLoad;
+}
+
+void AssimpLoader::load( const ci::DataSourceRef& dataSource, const Settings& settings )
+{
+	if( !mSurfacePool ) {
+		mSurfacePool = SurfacePoolRef( new SurfacePool );
+	}
+	
+	const unsigned int flags = settings.getImportFlags();
+	uint64_t cacheKey = 0;
+	bool writeCache = false;
+	if( !settings.mCachePath.empty() ) {
+		std::vector<ci::fs::path> files;
+		if( dataSource->isFilePath() ) {
+			files.push_back( dataSource->getFilePath() );
+		}
+		for( const auto& target : settings.mMorphTargets ) {
+			if( target->isFilePath() ) {
+				files.push_back( target->getFilePath() );
+			}
+		}
+		
+		if( files.size() == 1 + settings.mMorphTargets.size() ) {
+			std::string options = std::to_string( flags ) + ";" + settings.mRootAssetFolderPath.string();
+			if( mRemovedComponents ) {
+				options += ";" + std::to_string( mRemovedComponents );
+			}
+			if( settings.mCompressAnims ) {
+				const AnimCompression& compression = settings.mAnimCompression;
+				options += ";" + std::to_string( compression.mTranslationTolerance ) + ";" + std::to_string( compression.mRotationTolerance )
+						 + ";" + std::to_string( compression.mScaleTolerance ) + ";" + std::to_string( compression.mQuantize );
+			}
+			if( settings.mSampleRate > 0.0f ) {
+				options += ";" + std::to_string( settings.mSampleRate );
+			}
+			if( settings.mMeshletMaxVertices ) {
+				options += ";" + std::to_string( settings.mMeshletMaxVertices ) + "x" + std::to_string( settings.mMeshletMaxTriangles );
+			}
+			if( settings.mLodLevels ) {
+				options += ";" + std::to_string( settings.mLodLevels ) + ";" + std::to_string( settings.mLodTriangleRatio ) + ";" + std::to_string( settings.mLodSkinTolerance );
+			}
+			if( ! settings.mMorphTargets.empty() ) {
+				options += ";" + std::to_string( settings.mMorphTolerance );
+			}
+			cacheKey = ModelCache::computeKey( files, options );
+			if( ModelCache::read( settings.mCachePath, cacheKey, this, mSurfacePool, mResolver ) ) {
+				mModelPath = files.front();
+				mHasSkeleton = ( mRootNode != nullptr );
+				mHasAnimations = mHasSkeleton && !mAnimInfos.empty();
+				reportProgress( 1.0f );
+				return;
+			}
+			writeCache = true;
+		}
+		else {
+			CI_LOG_W( "Only models loaded from files can be cached." );
+		}
+	}
+	
 	// Assimp importer instance which cannot be destroyed until the scene loading is complete.
 	std::unique_ptr<Assimp::Importer> importer( new Assimp::Importer() );
-	importer->SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_POINT | aiPrimitiveType_LINE);
-//	importer->SetIOHandler( new CustomIOSystem() );
+	configureImporter( importer.get() );
+	if( mAsyncLoad ) {
+		// Owned (and deleted) by the importer.
+		importer->SetProgressHandler( new ProgressForwarder( [this] ( float progress ) { reportProgress( progress ); },
+															 [this] { return mAsyncLoad->isCancelled(); } ) );
+	}
+	
+	const aiScene* aiscene = loadAiScene( dataSource, importer.get(), flags, &mModelPath );
+	checkCancelled();
+	
+	std::shared_ptr<const aiScene> orphanedScene;
+	if( settings.mZeroCopy ) {
+		// Take the scene away from the importer: sections will serve their vertices straight from it.
+		orphanedScene.reset( importer->GetOrphanedScene() );
+	}
+	loadScene( aiscene, orphanedScene );
+	// Sampled from the imported curves, so that compression errors don't add up.
+	if( settings.mSampleRate > 0.0f ) {
+		sampleAnimations( settings.mSampleRate );
+	}
+	if( settings.mCompressAnims ) {
+		compressAnimations( settings.mAnimCompression );
+	}
+	if( ! settings.mMorphTargets.empty() ) {
+		checkCancelled();
+		loadMorphTargets( settings.mMorphTargets, flags, settings.mMorphTolerance );
+	}
+	
+	if( writeCache ) {
+		try {
+			ModelCache::write( settings.mCachePath, cacheKey, *this );
+		}
+		catch( const std::exception& exc ) {
+			CI_LOG_W( "Cannot write model cache " << settings.mCachePath << ": " << exc.what() );
+		}
+	}
+	reportProgress( 1.0f );
+}
+
+void AssimpLoader::compressAnimations( const AnimCompression& compression )
+{
+	std::vector<NodeRef> bones;
+	for( const auto& kv : mBones ) {
+		bones.push_back( kv.second );
+	}
+	
+	// Per bone stats, merged afterwards so that bones compress concurrently.
+	std::vector<std::vector<AnimCompressionStats>> boneStats( bones.size(), std::vector<AnimCompressionStats>( mAnimInfos.size() ) );
+	parallelFor( bones.size(), mNumThreads, [&] ( size_t b ) {
+		for( const auto& kv : bones[b]->getAnimTracks() ) {
+			if( kv.first >= 0 && size_t( kv.first ) < mAnimInfos.size() ) {
+				kv.second->compress( compression, &boneStats[b][kv.first] );
+			}
+		}
+	} );
 	
-	loadScene( loadAiScene( dataSource, importer.get(), settings.mFlags ) );
-	for( auto& target : settings.mMorphTargets ) {
-		loadMorphTarget( loadAiScene( target, importer.get(), settings.mFlags ) );
+	for( size_t a = 0; a < mAnimInfos.size(); ++a ) {
+		AnimCompressionStats stats;
+		for( const auto& perBone : boneStats ) {
+			stats.merge( perBone[a] );
+		}
+		mAnimInfos[a].setCompressionStats( stats );
+		CI_LOG_I( "Animation '" << mAnimInfos[a].getName() << "' compressed " << stats.getRatio() << ":1 (" << stats.mRawBytes << " to " << stats.mCompressedBytes
+				 << " bytes), max errors: translation " << stats.mMaxTranslationError << ", rotation " << stats.mMaxRotationError << " rad, scale " << stats.mMaxScaleError );
+	}
+}
+
+void AssimpLoader::sampleAnimations( float framesPerSecond )
+{
+	// Parent-first channels, like the pose the clips are played into.
+	std::vector<NodeRef> nodes;
+	if( mRootNode ) {
+		Skeleton::traverseNodes( mRootNode, [&nodes] ( const NodeRef& node ) { nodes.push_back( node ); } );
+	}
+	
+	mSampledClips.resize( mAnimInfos.size() );
+	parallelFor( mAnimInfos.size(), mNumThreads, [&] ( size_t a ) {
+		const AnimInfo& info = mAnimInfos[a];
+		float ticksPerSecond = ( info.getTicksPerSecond() != 0.0f ) ? info.getTicksPerSecond() : 25.0f;
+		mSampledClips[a] = SampledClip::create( nodes, int( a ), info.getDuration() / ticksPerSecond, framesPerSecond );
+	} );
+	
+	for( size_t a = 0; a < mSampledClips.size(); ++a ) {
+		CI_LOG_I( "Animation '" << mAnimInfos[a].getName() << "' sampled to " << mSampledClips[a]->getNumFrames() << " frames of "
+				 << mSampledClips[a]->getNumChannels() << " channels (" << mSampledClips[a]->getMemorySize() << " bytes)" );
+	}
+}
+
+unsigned int AssimpLoader::Settings::getImportFlags() const
+{
+	unsigned int flags = mFlags;
+	if( ! mLoadTextures ) {
+		flags &= ~( aiProcess_GenUVCoords | aiProcess_TransformUVCoords | aiProcess_FlipUVs );
+	}
+	if( ! mLoadNormals ) {
+		flags &= ~( aiProcess_GenNormals | aiProcess_GenSmoothNormals | aiProcess_FixInfacingNormals );
 	}
+	// Tangents are computed from the normals and texture coordinates.
+	if( ! mLoadTextures || ! mLoadNormals || ! mLoadTangents ) {
+		flags &= ~aiProcess_CalcTangentSpace;
+	}
+	if( ! mLoadSkinning ) {
+		flags &= ~( aiProcess_LimitBoneWeights | aiProcess_Debone );
+	}
+	if( getRemovedComponents() ) {
+		flags |= aiProcess_RemoveComponent;
+	}
+	return flags;
 }
 
+int AssimpLoader::Settings::getRemovedComponents() const
+{
+	int components = 0;
+	if( ! mLoadAnims ) {
+		components |= aiComponent_ANIMATIONS;
+	}
+	if( ! mLoadTextures ) {
+		components |= aiComponent_TEXTURES | aiComponent_TEXCOORDS;
+	}
+	if( ! mLoadNormals ) {
+		components |= aiComponent_NORMALS;
+	}
+	if( ! mLoadTextures || ! mLoadNormals || ! mLoadTangents ) {
+		components |= aiComponent_TANGENTS_AND_BITANGENTS;
+	}
+	if( ! mLoadSkinning ) {
+		components |= aiComponent_BONEWEIGHTS;
+	}
+	return components ? ( components | aiComponent_LIGHTS | aiComponent_CAMERAS ) : 0;
+}
 
-const aiScene * AssimpLoader::loadAiScene( const ci::DataSourceRef& dataSource, Assimp::Importer* importer, unsigned int flags )
+void AssimpLoader::configureImporter( Assimp::Importer* importer ) const
+{
+	importer->SetPropertyInteger( AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_POINT | aiPrimitiveType_LINE );
+	if( mRemovedComponents ) {
+		importer->SetPropertyInteger( AI_CONFIG_PP_RVC_FLAGS, mRemovedComponents );
+	}
+}
+
+void AssimpLoader::checkCancelled() const
+{
+	if( mAsyncLoad && mAsyncLoad->isCancelled() ) {
+		throw LoadCancelledException();
+	}
+}
+
+void AssimpLoader::reportProgress( float progress ) const
+{
+	if( mAsyncLoad ) {
+		mAsyncLoad->setProgress( progress );
+	}
+}
+
+
+const aiScene * AssimpLoader::loadAiScene( const ci::DataSourceRef& dataSource, Assimp::Importer* importer, unsigned int flags, ci::fs::path* modelPath ) const
 {
 	const aiScene* aiscene = nullptr;
-	if( dataSource->isFilePath() ) {
-		mModelPath = dataSource->getFilePath();
+	ci::fs::path& path = *modelPath;
+	if( dataSource->isFilePath() && ! mResolver ) {
+		path = dataSource->getFilePath();
 
-		if( !importer->IsExtensionSupported( mModelPath.extension().string() ) )
+		if( !importer->IsExtensionSupported( path.extension().string() ) )
 			throw LoadErrorException( "Extension not supported." );
 
-		aiscene = importer->ReadFile( mModelPath.string(), flags );
+		// Back to assimp's default file system IO (a previous model may have used data sources).
+		importer->SetIOHandler( nullptr );
+		aiscene = importer->ReadFile( path.string(), flags );
 	}
 	else {
-		throw LoadErrorException( "Only loadAsset() is supported at the moment." );
+		// Assimp picks its importer from the extension: the data source has to provide a name.
+		path = dataSource->isFilePath() ? dataSource->getFilePath() : dataSource->getFilePathHint();
+		if( path.empty() )
+			throw LoadErrorException( "Data source has no file path hint." );
+		if( !importer->IsExtensionSupported( path.extension().string() ) )
+			throw LoadErrorException( "Extension not supported." );
+
+		// Owned (and deleted) by the importer.
+		importer->SetIOHandler( new DataSourceIOSystem( dataSource, path, mResolver ) );
+		aiscene = importer->ReadFile( path.generic_string(), flags );
 	}
 	if( !aiscene )
 		throw LoadErrorException( importer->GetErrorString() );
@@ -440,63 +851,64 @@ const aiScene * AssimpLoader::loadAiScene( const ci::DataSourceRef& dataSource,
 	return aiscene;
 }
 
-void AssimpLoader::loadScene( const aiScene* aiscene )
+void AssimpLoader::loadScene( const aiScene* aiscene, const std::shared_ptr<const aiScene>& orphanedScene )
 {
 	if( !aiscene->HasMeshes() )
 		CI_LOG_E("Scene has no meshes.");
 	
-	if( !mSurfacePool ) {
-		mSurfacePool = SurfacePoolRef( new SurfacePool );
-	}
-	
-	const auto& boneNames = ai::getBoneNames( aiscene );
+	// Names are resolved to ids once; bones, channels and meshes are then looked up by id.
+	const ai::NameTable names( aiscene );
+	const std::vector<bool> isBone = ai::findBones( aiscene, names );
+	std::vector<NodeRef> bones( names.size() );
 	
 	const aiNode* root = aiscene->mRootNode;
 	
-	if( !boneNames.empty() ) {
-		mRootNode = ai::generateNodeHierarchy( &mBones, root, boneNames );
+	if( std::find( isBone.begin(), isBone.end(), true ) != isBone.end() ) {
+		mRootNode = ai::generateNodeHierarchy( &bones, &mBones, root, names, isBone );
         mHasSkeleton = true;
 		if( aiscene->HasAnimations() ) {
-			ai::generateAnimationCurves( mBones, aiscene );
+			ai::generateAnimationCurves( names, bones, aiscene );
             mHasAnimations = true;
 		}
 	}
 	
-	for( unsigned int m=0; m < aiscene->mNumMeshes; ++m ) {
-		aiMesh * mesh = aiscene->mMeshes[m];
-		std::string name = ai::get( mesh->mName );
-		
-		SectionSourceRef section = std::make_shared<SectionSource>();
-		section->mName			= ai::get( mesh->mName );
-		section->mIndices		= ai::getIndices( mesh );
-		section->mPositions		= ai::getPositions( mesh );
-		section->mNormals		= ai::getNormals( mesh );
-		section->mTangents		= ai::getTangents( mesh );
-		section->mBitangents	= ai::getBiTangents( mesh );
-		section->mTexCoords		= ai::getTexCoords( mesh );
-		section->mMaterialSource = ai::getMaterial( aiscene, mesh, mModelPath, mSurfacePool, mRootAssetFolderPath );
-		if( mesh->HasBones() ) {
-			section->mWeights = ai::getBoneWeights( mesh, mBones );
-			for( const auto& boneWeight : section->mWeights ) {
-				vec4 vWeights = vec4{};
-				vec4 vIndices = vec4{};
-				for( unsigned int b =0; b < boneWeight.getNumActiveWeights(); ++b ) {
-					const Node* bone = boneWeight.getBone(b);
-					vWeights[b] = boneWeight.getWeight(b);
-					//FIXME: Maybe use ints on the desktop?
-					vIndices[b] = static_cast<float>( bone->getBoneIndex() );
+	// Bone offsets are shared between meshes: set them once, before sections are built concurrently.
+	ai::setBoneOffsets( aiscene, names, bones );
+	
+	// Each thread fills its own slots, which keeps the section order identical to the assimp mesh order.
+	std::vector<SectionSourceRef> sections( aiscene->mNumMeshes );
+	std::atomic<size_t> numLoaded( 0 );
+	parallelFor( aiscene->mNumMeshes, mNumThreads, [&] ( size_t m ) {
+		checkCancelled();
+		sections[m] = loadSection( aiscene, (unsigned int)m, names, bones, orphanedScene );
+		reportProgress( IMPORT_PROGRESS + ( 1.0f - IMPORT_PROGRESS ) * float( ++numLoaded ) / float( aiscene->mNumMeshes ) );
+	} );
+	mSectionSources.insert( mSectionSources.end(), sections.begin(), sections.end() );
+	
+	if( mLodLevels ) {
+		// Per level totals over the sections; sections out of levels keep counting their coarsest one.
+		size_t numTriangles = 0;
+		for( const auto& section : sections ) {
+			numTriangles += section->mIndices.size() / 3;
+		}
+		CI_LOG_I( "LOD 0: " << numTriangles << " triangles" );
+		for( size_t level = 0; level < mLodLevels; ++level ) {
+			numTriangles = 0;
+			double seconds = 0.0;
+			float error = 0.0f;
+			for( const auto& section : sections ) {
+				const auto& lods = section->mLods;
+				if( lods.empty() ) {
+					numTriangles += section->mIndices.size() / 3;
+					continue;
 				}
-				section->mBoneIndices.push_back( vIndices );
-				section->mBoneWeights.push_back( vWeights );
-			}
-		} else {
-			const aiNode* ainode = ai::findMeshNode( name, aiscene, aiscene->mRootNode );
-			if( ainode ) {
-				section->mDefaultTransformation = ai::get( ainode->mTransformation);
+				const Lod& lod = lods[std::min( level, lods.size() - 1 )];
+				numTriangles += lod.getNumTriangles();
+				error = std::max( error, lod.mError );
+				seconds += ( level < lods.size() ) ? lod.mSeconds : 0.0;
 			}
+			CI_LOG_I( "LOD " << level + 1 << ": " << numTriangles << " triangles, error " << error << ", simplified in " << seconds * 1000.0 << " ms" );
 		}
-		
-		mSectionSources.push_back( section );
 	}
 	
 	if( aiscene->HasAnimations() ) {
@@ -504,31 +916,116 @@ void AssimpLoader::loadScene( const aiScene* aiscene )
 	}
 }
 
-void AssimpLoader::loadMorphTarget( const aiScene* aiscene )
+SectionSourceRef AssimpLoader::loadSection( const aiScene* aiscene, unsigned int meshIndex, const ai::NameTable& names, const std::vector<NodeRef>& bones, const std::shared_ptr<const aiScene>& orphanedScene ) const
 {
-	assert( aiscene->HasMeshes() );
-	assert( mSurfacePool );
-
-	for( unsigned int m = 0; m < aiscene->mNumMeshes; ++m ) {
-		aiMesh * mesh = aiscene->mMeshes[m];
-		auto positions = ai::getPositions( mesh );
-
-		auto& section = mSectionSources.at( m );
-		assert( section->mPositions.size() == positions.size() );
-
-		size_t i = 0;
-		float diffSum = 0.0f;
-		for( auto& p : positions ) {
-			auto diff = p - section->mPositions.at( i++ );
-			diffSum += length2( diff );
-			p = diff;
+	const aiMesh* mesh = aiscene->mMeshes[meshIndex];
+	
+	SectionSourceRef section = std::make_shared<SectionSource>();
+	section->mName			= ai::get( mesh->mName );
+	section->mIndices		= ai::getIndices( mesh );
+	if( orphanedScene ) {
+		ai::aliasVectors( mesh->mVertices, mesh->mNumVertices, orphanedScene, &section->mPositions );
+		ai::aliasVectors( mesh->mNormals, mesh->mNumVertices, orphanedScene, &section->mNormals );
+		ai::aliasVectors( mesh->mTangents, mesh->mNumVertices, orphanedScene, &section->mTangents );
+		ai::aliasVectors( mesh->mBitangents, mesh->mNumVertices, orphanedScene, &section->mBitangents );
+	} else {
+		section->mPositions		= ai::getPositions( mesh );
+		section->mNormals		= ai::getNormals( mesh );
+		section->mTangents		= ai::getTangents( mesh );
+		section->mBitangents	= ai::getBitangents( mesh );
+	}
+	section->mTexCoords		= ai::getTexCoords( mesh );
+	section->mMaterialSource = ai::getMaterial( aiscene, mesh, mModelPath, mLoadTextures ? mSurfacePool : nullptr, mRootAssetFolderPath, mResolver );
+	if( mesh->HasBones() ) {
+		section->mWeights = ai::getBoneWeights( mesh, names, bones );
+		section->mBoneIndices.reserve( section->mWeights.size() );
+		section->mBoneWeights.reserve( section->mWeights.size() );
+		for( const auto& boneWeight : section->mWeights ) {
+			vec4 vWeights = vec4{};
+			vec4 vIndices = vec4{};
+			for( unsigned int b =0; b < boneWeight.getNumActiveWeights(); ++b ) {
+				const Node* bone = boneWeight.getBone(b);
+				vWeights[b] = boneWeight.getWeight(b);
+				//FIXME: Maybe use ints on the desktop?
+				vIndices[b] = static_cast<float>( bone->getBoneIndex() );
+			}
+			section->mBoneIndices.push_back( vIndices );
+			section->mBoneWeights.push_back( vWeights );
 		}
-
-		if( diffSum > ci::EPSILON ) {
-			section->mMorphOffsets.emplace_back( positions );
+	} else {
+		const aiNode* ainode = names.getMeshNode( meshIndex );
+		if( ainode ) {
+			section->mDefaultTransformation = ai::get( ainode->mTransformation);
 		}
 	}
+	section->updateBounds();
+	if( mMeshletMaxVertices ) {
+		section->mMeshlets = Meshlet::build( section->mPositions.data(), section->mPositions.size(), section->mIndices, mMeshletMaxVertices, mMeshletMaxTriangles );
+	}
+	if( mLodLevels ) {
+		section->mLods = Lod::build( section->mPositions.data(), section->mPositions.size(), section->mIndices, section->mBoneIndices, section->mBoneWeights,
+									 mLodLevels, mLodTriangleRatio, mLodSkinTolerance );
+	}
+	
+	return section;
+}
 
+void AssimpLoader::loadMorphTargets( const std::vector<ci::DataSourceRef>& targets, unsigned int flags, float tolerance )
+{
+	// Positions only, unless joining vertices without the generated attributes doesn't give the model's vertices back.
+	const unsigned int targetFlags = ai::getMorphTargetFlags( flags );
+	auto matchesSections = [this] ( const aiScene* aiscene ) -> bool {
+		if( aiscene->mNumMeshes != mSectionSources.size() )
+			return false;
+		for( unsigned int m = 0; m < aiscene->mNumMeshes; ++m ) {
+			if( aiscene->mMeshes[m]->mNumVertices != mSectionSources[m]->mPositions.size() )
+				return false;
+		}
+		return true;
+	};
+	
+	// One importer per target: they are neither thread-safe nor reusable while their scene is in use.
+	std::vector<std::vector<MorphTarget>> sparseTargets( targets.size() );
+	parallelFor( targets.size(), mNumThreads, [&] ( size_t t ) {
+		checkCancelled();
+		Assimp::Importer importer;
+		configureImporter( &importer );
+		ci::fs::path targetPath;
+		const aiScene* aiscene = loadAiScene( targets[t], &importer, targetFlags, &targetPath );
+		if( targetFlags != flags && ( flags & aiProcess_JoinIdenticalVertices ) && ! matchesSections( aiscene ) ) {
+			CI_LOG_V( "Morph target " << targetPath.string() << " joined differently without the generated attributes: importing it with the model's flags." );
+			aiscene = loadAiScene( targets[t], &importer, flags, &targetPath );
+		}
+		if( aiscene->mNumMeshes != mSectionSources.size() )
+			throw LoadErrorException( "Morph target " + targetPath.string() + " doesn't have the meshes of the model." );
+		
+		for( unsigned int m = 0; m < aiscene->mNumMeshes; ++m ) {
+			const aiMesh* mesh = aiscene->mMeshes[m];
+			const auto& section = mSectionSources[m];
+			if( mesh->mNumVertices != section->mPositions.size() )
+				throw LoadErrorException( "Morph target " + targetPath.string() + " doesn't have the vertices of the model." );
+#if ! defined( ASSIMP_DOUBLE_PRECISION )
+			const vec3* positions = reinterpret_cast<const vec3*>( mesh->mVertices );
+#else
+			const std::vector<vec3> converted = ai::getPositions( mesh );
+			const vec3* positions = converted.data();
+#endif
+			sparseTargets[t].push_back( MorphTarget::create( section->mPositions.data(), positions, mesh->mNumVertices, tolerance ) );
+		}
+	} );
+	
+	// Appended in the order of the settings, whichever target finished first.
+	size_t numOffsets = 0, numTargetVertices = 0;
+	for( size_t m = 0; m < mSectionSources.size(); ++m ) {
+		auto& sectionTargets = mSectionSources[m]->mMorphTargets;
+		sectionTargets.reserve( sectionTargets.size() + targets.size() );
+		for( auto& target : sparseTargets ) {
+			numOffsets += target[m].getNumVertices();
+			numTargetVertices += mSectionSources[m]->mPositions.size();
+			sectionTargets.push_back( std::move( target[m] ) );
+		}
+	}
+	CI_LOG_I( "Loaded " << targets.size() << " morph targets: " << numOffsets << " displaced vertices out of " << numTargetVertices << "." );
 }
 
 } //end namespace model
@@ -6,9 +6,15 @@
 #include "assimp/Importer.hpp"
 
 #include "ModelIo.h"
+#include "DataSourceIOSystem.h"
 
 #include "cinder/Noncopyable.h"
 
+#include <atomic>
+#include <future>
+#include <unordered_map>
+#include <vector>
+
 namespace model {
 	
 	class SurfacePool;
@@ -17,17 +23,19 @@ namespace model {
 		//! Assimp loader settings/flags.
 		extern const unsigned int FLAGS;
 		extern const unsigned int MORPHTARGETS_FLAGS;
+		//! \a flags without the steps that only generate or fix attributes other than positions, which morph targets don't use. Steps that reorder or join vertices are kept.
+		unsigned int					getMorphTargetFlags( unsigned int flags );
 		
 		//! Convert aiVector3D to glm::vec3.
-		inline glm::vec3				get( const aiVector3D &v );
+		glm::vec3				get( const aiVector3D &v );
 		//! Convert aiQuaternion to ci::quat.
-		inline ci::quat				get( const aiQuaternion &q );
+		ci::quat				get( const aiQuaternion &q );
 		//! Convert aiMatrix4x4 to glm::mat4.
-		inline glm::mat4			get( const aiMatrix4x4 &m );
+		glm::mat4			get( const aiMatrix4x4 &m );
 		//! Convert aiColor4D to ci::ColorAf.
-		inline ci::ColorAf				get( const aiColor4D &c );
+		ci::ColorAf				get( const aiColor4D &c );
 		//! Convert aiString to std::string.
-		inline std::string				get( const aiString &s );
+		std::string				get( const aiString &s );
 		//! Extract vertex positions from an assimp mesh section.
 		std::vector<glm::vec3>			getPositions( const aiMesh* aimesh );
 		//! Extract vertex normals from an assimp mesh section.
@@ -40,10 +48,49 @@ namespace model {
 		std::vector<glm::vec2>			getTexCoords( const aiMesh* aimesh, unsigned int unit = 0 );
 		//! Extract vertex indices from an assimp mesh section.
 		std::vector<uint32_t>			getIndices( const aiMesh* aimesh );
-		//! Extract material information (including textures) for a mesh section.
-		model::MaterialSource			getMaterial( const aiScene* aiscene, const aiMesh *aimesh, ci::fs::path modelPath, const std::shared_ptr<SurfacePool>& surfacePool, ci::fs::path rootPath = ""  );
+		//! Extract material information (including textures, unless \a surfacePool is null) for a mesh section.
+		model::MaterialSource			getMaterial( const aiScene* aiscene, const aiMesh *aimesh, ci::fs::path modelPath, const std::shared_ptr<SurfacePool>& surfacePool, ci::fs::path rootPath = "", const DataSourceResolver& resolver = DataSourceResolver() );
+		
+		/*!
+		 * The node names of a scene, interned once per import into dense ids: the parent-first order of the first node of each name.
+		 * Names are hashed straight from the aiString(s), without building std::string(s), so that bones, channels and meshes
+		 * resolve to ids once and everything past that is indexed by id. Refers to the scene's strings: don't outlive it.
+		 */
+		class NameTable {
+		public:
+			explicit NameTable( const aiScene* aiscene );
+			
+			//! Id of the first node named \a name, -1 if there is none.
+			int32_t			find( const aiString& name ) const;
+			size_t			size() const { return mNodes.size(); }
+			const aiNode*	getNode( int32_t id ) const { return mNodes[id]; }
+			//! First node (in parent-first order) referring to mesh \a meshIndex, null if none does.
+			const aiNode*	getMeshNode( unsigned int meshIndex ) const { return mMeshNodes[meshIndex]; }
+		private:
+			struct Key {
+				const char*	mData;
+				size_t		mLength;
+			};
+			struct KeyHash {
+				size_t operator()( const Key& key ) const;
+			};
+			struct KeyEqual {
+				bool operator()( const Key& lhs, const Key& rhs ) const;
+			};
+			
+			void	addNode( const aiNode* ainode );
+			
+			std::unordered_map<Key, int32_t, KeyHash, KeyEqual>	mIds;
+			std::vector<const aiNode*>							mNodes;
+			std::vector<const aiNode*>							mMeshNodes;
+		};
+		
+		//! Flags, by name id, the nodes which are bones of the scene meshes.
+		std::vector<bool>				findBones( const aiScene* aiscene, const NameTable& names );
+		//! Set the offset matrix of every bone referenced by the scene meshes; \a bones holds the bone of each name id, if any.
+		void							setBoneOffsets( const aiScene* aiscene, const NameTable& names, const std::vector<std::shared_ptr<Node>>& bones );
 		//! Extract skeletal bone weights for each vertex of an assimp mesh section.
-		std::vector<model::Weights>		getBoneWeights( const aiMesh* aimesh, const model::Skeleton* skeleton );
+		std::vector<model::Weights>		getBoneWeights( const aiMesh* aimesh, const NameTable& names, const std::vector<std::shared_ptr<Node>>& bones );
 		//! Extract a mesh section's default transformation (use when there is no bones)
 		glm::mat4					getDefaultTransformation( const std::string& name, const aiScene* aiscene, model::Skeleton* skeleton );
 		
@@ -56,30 +103,120 @@ namespace model {
 															 const aiNode* ainode );
 	}
 	
+	typedef std::shared_ptr<class AssimpLoader> AssimpLoaderRef;
+	
 	class AssimpLoader : public model::Source, public ci::Noncopyable {
 	public:
 		struct Settings {
-			//TODO: toggle loading lights, cameras, meshes, animations, textures & flags
-			Settings() : mLoadAnims(true), mFlags(ai::FLAGS) { }
+			Settings() : mLoadAnims(true), mLoadTextures(true), mLoadNormals(true), mLoadTangents(true), mLoadSkinning(true), mZeroCopy(false), mCompressAnims(false), mSampleRate(0.0f), mMeshletMaxVertices(0), mMeshletMaxTriangles(0), mLodLevels(0), mLodTriangleRatio(0.5f), mLodSkinTolerance(0.2f), mMorphTolerance(0.0f), mNumThreads(0), mFlags(ai::FLAGS) { }
 			
 			Settings& assimpFlags( unsigned int flags ) { mFlags = flags; return *this; }
 			
-			Settings& morphTargets( const std::vector<ci::DataSourceRef>& targets ) { mMorphTargets = targets; mFlags = ai::MORPHTARGETS_FLAGS; return *this; }
+			/*!
+			 * Loads \a targets, in parallel, as morph targets of the model: files with the same meshes and vertices, at other positions.
+			 * Only the vertices moving farther than \a tolerance are kept (see MorphTarget). There is no limit on the number of targets.
+			 */
+			Settings& morphTargets( const std::vector<ci::DataSourceRef>& targets, float tolerance = 0.0f ) { mMorphTargets = targets; mMorphTolerance = tolerance; mFlags = ai::MORPHTARGETS_FLAGS; return *this; }
 			Settings& rootFolder( const ci::fs::path& rootAssetFolderPath ) { mRootAssetFolderPath = rootAssetFolderPath; return *this; }
+			/*!
+			 * The toggles below skip what a pipeline doesn't use (such as everything but positions and indices for collision), and drop the
+			 * matching post-process steps from the flags. Assimp removes the skipped data right after import (see aiProcess_RemoveComponent),
+			 * so later steps don't process it either. Lights and cameras, which the loader ignores, are removed along with it.
+			 */
 			Settings& loadAnims( bool loadAnims ) { mLoadAnims = loadAnims; return *this; }
+			//! Off, materials keep their colors only: no texture is decoded, and neither texture coordinates nor the tangents computed from them are loaded.
+			Settings& loadTextures( bool loadTextures ) { mLoadTextures = loadTextures; return *this; }
+			//! Off, normals are neither imported nor generated, and neither are tangents.
+			Settings& loadNormals( bool loadNormals ) { mLoadNormals = loadNormals; return *this; }
+			//! Tangents and bitangents, imported or computed (aiProcess_CalcTangentSpace). Shaders without normal maps don't use them.
+			Settings& loadTangents( bool loadTangents ) { mLoadTangents = loadTangents; return *this; }
+			//! Off, bone weights are dropped: skinned meshes load as static ones in bind pose, without a skeleton nor animations.
+			Settings& loadSkinning( bool loadSkinning ) { mLoadSkinning = loadSkinning; return *this; }
 			Settings& surfaces( const std::shared_ptr<SurfacePool>& surfacePool ) { mSurfacePool = surfacePool; return *this; }
+			/*!
+			 * Sections keep the imported aiScene alive and read their vertex attributes from it instead of copying them.
+			 * The whole scene, animations and materials included, stays in memory for as long as any section (or a copy of its attributes) does.
+			 */
+			Settings& zeroCopy( bool zeroCopy ) { mZeroCopy = zeroCopy; return *this; }
+			//! Number of threads building mesh sections (and decoding their textures). 0 uses every hardware thread.
+			Settings& numThreads( size_t numThreads ) { mNumThreads = numThreads; return *this; }
+			/*!
+			 * Reads the model and the files it references (.mtl, textures...) from data sources returned by \a resolver instead of the file system.
+			 * Calls to \a resolver are serialized (see serializeResolver()): it needn't be thread-safe, but shouldn't block for long.
+			 */
+			Settings& resolver( const DataSourceResolver& resolver ) { mResolver = resolver; return *this; }
+			/*!
+			 * Loads the model from a ModelCache file at \a cachePath, skipping assimp entirely, when it matches the
+			 * model, its morph targets and the import flags. Otherwise imports as usual and (re)writes the cache.
+			 * Only used for models and morph targets loaded from files.
+			 */
+			Settings& cache( const ci::fs::path& cachePath ) { mCachePath = cachePath; return *this; }
+			//! Drops redundant keyframes and quantizes the rest. Per clip results are logged and kept in the AnimInfo(s).
+			Settings& compressAnimations( const AnimCompression& compression = AnimCompression() ) { mCompressAnims = true; mAnimCompression = compression; return *this; }
+			//! Also resamples every animation at \a framesPerSecond into a SampledClip, which actors then play instead of the curves. 0 disables it.
+			Settings& sampleAnimations( float framesPerSecond ) { mSampleRate = framesPerSecond; return *this; }
+			//! Splits every section into meshlets of at most \a maxVertices vertices and \a maxTriangles triangles, for Renderer's meshlet culling.
+			Settings& meshlets( size_t maxVertices = Meshlet::MAX_VERTICES, size_t maxTriangles = Meshlet::MAX_TRIANGLES ) { mMeshletMaxVertices = maxVertices; mMeshletMaxTriangles = maxTriangles; return *this; }
+			//! Builds \a numLevels simplified index buffers per section (see Lod::build()). Triangle counts and times are logged.
+			Settings& lods( size_t numLevels, float triangleRatio = 0.5f, float skinTolerance = 0.2f ) { mLodLevels = numLevels; mLodTriangleRatio = triangleRatio; mLodSkinTolerance = skinTolerance; return *this; }
 		private:
-			bool mLoadAnims;
+			//! mFlags without the steps producing data the toggles leave out.
+			unsigned int	getImportFlags() const;
+			//! aiComponent flags of the data the toggles leave out, 0 if none.
+			int				getRemovedComponents() const;
+			
+			bool mLoadAnims, mLoadTextures, mLoadNormals, mLoadTangents, mLoadSkinning;
+			bool mZeroCopy;
+			bool mCompressAnims;
+			AnimCompression mAnimCompression;
+			float mSampleRate;
+			size_t mMeshletMaxVertices, mMeshletMaxTriangles;
+			size_t mLodLevels;
+			float mLodTriangleRatio, mLodSkinTolerance;
+			float mMorphTolerance;
+			size_t mNumThreads;
 			unsigned int mFlags;
 			
 			std::shared_ptr<SurfacePool> mSurfacePool;
 			std::vector<ci::DataSourceRef> mMorphTargets;
 			ci::fs::path mRootAssetFolderPath;
+			DataSourceResolver mResolver;
+			ci::fs::path mCachePath;
+			
+			friend class AssimpLoader;
+		};
+		
+		typedef std::shared_ptr<class AsyncLoad> AsyncLoadRef;
+		
+		//! Handle on a model being imported on a worker thread.
+		class AsyncLoad : public ci::Noncopyable {
+		public:
+			//! Cancels the load and waits for the worker thread to wind down.
+			~AsyncLoad() { cancel(); }
+			
+			//! Progress in [0, 1]: file parsing and assimp post-processing, then sections and texture decoding.
+			float			getProgress() const { return mProgress; }
+			//! Requests cancellation; the worker stops at its next checkpoint and get() throws LoadCancelledException.
+			void			cancel() { mCancelled = true; }
+			bool			isCancelled() const { return mCancelled; }
+			bool			isReady() const { return mFuture.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready; }
+			//! Blocks until the load is over and returns the loader. Rethrows any load error.
+			AssimpLoaderRef	get() const { return mFuture.get(); }
+		private:
+			AsyncLoad() : mProgress( 0.0f ), mCancelled( false ) { }
+			void			setProgress( float progress );
+			
+			std::atomic<float>					mProgress;
+			std::atomic<bool>					mCancelled;
+			std::shared_future<AssimpLoaderRef>	mFuture;
 			
 			friend class AssimpLoader;
 		};
 		
 		explicit AssimpLoader( const ci::DataSourceRef& modelSource, const Settings& settings = Settings()  );
+		
+		//! Imports the model on a worker thread. Textures are decoded there too, leaving only GL uploads to the caller.
+		static AsyncLoadRef	loadAsync( const ci::DataSourceRef& modelSource, const Settings& settings = Settings() );
 				
 		const std::shared_ptr<SurfacePool>&			getSurfacePool() { return mSurfacePool; }
 
@@ -89,11 +226,41 @@ namespace model {
         ci::fs::path getModelPath() const { return mModelPath; }
 
 	protected:
-		const aiScene*		loadAiScene( const ci::DataSourceRef& dataSource, Assimp::Importer* importer, unsigned int flags );
-		void				loadScene( const aiScene* aiScene );
-		void				loadMorphTarget( const aiScene* aiscene );
+		AssimpLoader( const ci::DataSourceRef& modelSource, const Settings& settings, AsyncLoad* asyncLoad );
+		
+		void				load( const ci::DataSourceRef& modelSource, const Settings& settings );
+		//! Throws LoadCancelledException if the asynchronous load driving this loader was cancelled.
+		void				checkCancelled() const;
+		void				reportProgress( float progress ) const;
+		
+		//! Sets the properties of the post-process steps shared by the model and its morph targets.
+		void				configureImporter( Assimp::Importer* importer ) const;
+		//! Imports \a dataSource with \a importer, storing its path into \a modelPath. Called concurrently for morph targets, hence const.
+		const aiScene*		loadAiScene( const ci::DataSourceRef& dataSource, Assimp::Importer* importer, unsigned int flags, ci::fs::path* modelPath ) const;
+		void				loadScene( const aiScene* aiScene, const std::shared_ptr<const aiScene>& orphanedScene = nullptr );
+		//! Builds section \a meshIndex, \a bones holding the bone of each name id; called concurrently for different meshes, hence const.
+		SectionSourceRef	loadSection( const aiScene* aiscene, unsigned int meshIndex, const ai::NameTable& names, const std::vector<std::shared_ptr<Node>>& bones, const std::shared_ptr<const aiScene>& orphanedScene ) const;
+		//! Imports \a targets concurrently, each with its own importer, and appends them to the sections in order. \a flags are the model's:
+		//! targets are imported with ai::getMorphTargetFlags(), or again with \a flags when vertices joined without the generated attributes don't match the model's.
+		void				loadMorphTargets( const std::vector<ci::DataSourceRef>& targets, unsigned int flags, float tolerance );
+		void				compressAnimations( const AnimCompression& compression );
+		void				sampleAnimations( float framesPerSecond );
 
 		bool mHasAnimations, mHasSkeleton;
+		size_t mNumThreads;
+		//! Meshlet limits of loadSection(), 0 to skip building meshlets.
+		size_t mMeshletMaxVertices, mMeshletMaxTriangles;
+		//! Lod levels of loadSection(), 0 to skip simplification.
+		size_t mLodLevels;
+		float mLodTriangleRatio, mLodSkinTolerance;
+		//! Whether loadSection() decodes textures.
+		bool mLoadTextures;
+		//! aiComponent flags removed by configureImporter()'s importers (see Settings::getRemovedComponents()).
+		int mRemovedComponents;
+		//! Set when loading through loadAsync(), null otherwise.
+		AsyncLoad*						mAsyncLoad;
+		//! Set when the model and its files come from data sources rather than the file system.
+		DataSourceResolver				mResolver;
 		//! File path to the model.
 		ci::fs::path					mModelPath;
 		//! Root asset folder (textures in a model may not reside in the same directory as the model).
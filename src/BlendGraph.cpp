@@ -0,0 +1,148 @@
+#include "BlendGraph.h"
+
+#include "cinder/CinderAssert.h"
+
+using namespace model;
+
+namespace {
+
+	//! Adds \a weight times \a q to \a sum, flipping \a q into the hemisphere of the sum so that both don't cancel out.
+	inline void accumulateRotation( glm::quat* sum, const glm::quat& q, float weight )
+	{
+		*sum += ( glm::dot( *sum, q ) < 0.0f ? -weight : weight ) * q;
+	}
+
+} // anonymous namespace
+
+BlendGraphRef BlendGraph::create( const SkeletonRef& skeleton )
+{
+	return BlendGraphRef( new BlendGraph( skeleton ) );
+}
+
+BlendGraph::BlendGraph( const SkeletonRef& skeleton )
+: mSkeleton( skeleton )
+{
+	const size_t numNodes = skeleton->getNodes().size();
+	mIsSlotUsed.assign( numNodes, false );
+	mPositions.resize( numNodes );
+	mScales.resize( numNodes );
+	mRotations.resize( numNodes );
+	mWeights.resize( numNodes );
+}
+
+size_t BlendGraph::addLayer( int trackId, float weight, BlendMode mode, const Mask& mask )
+{
+	CI_ASSERT( mask.empty() || mask.size() == mIsSlotUsed.size() );
+
+	Layer layer{ trackId, weight, mode, std::vector<Channel>() };
+	const auto& channels = mSkeleton->mDefinition->mChannels;
+	auto channel = channels.find( trackId );
+	if( channel != channels.end() ) {
+		const std::vector<AnimTrack*>& tracks = channel->second;
+		for( size_t i = 0; i < tracks.size(); ++i ) {
+			const float maskWeight = mask.empty() ? 1.0f : mask[i];
+			if( ! tracks[i] || maskWeight <= 0.0f ) {
+				continue;
+			}
+			layer.mChannels.push_back( Channel{ uint32_t( i ), maskWeight, tracks[i], AnimTrack::Cursor() } );
+			if( ! mIsSlotUsed[i] ) {
+				mIsSlotUsed[i] = true;
+				mSlots.push_back( uint32_t( i ) );
+			}
+		}
+	}
+	mLayers.push_back( std::move( layer ) );
+	return mLayers.size() - 1;
+}
+
+void BlendGraph::setWeight( size_t layer, float weight )
+{
+	mLayers[layer].mWeight = weight;
+}
+
+BlendGraph::Mask BlendGraph::createMask( const std::string& rootName, float weight ) const
+{
+	Mask mask( mIsSlotUsed.size(), 0.0f );
+	const int32_t root = mSkeleton->getNodeIndex( rootName );
+	if( root < 0 ) {
+		return mask;
+	}
+	// Parent-first order: the subtree ends at the first node whose parent precedes the root.
+	const auto& parents = mSkeleton->mDefinition->mParents;
+	mask[root] = weight;
+	for( size_t i = size_t( root ) + 1; i < parents.size() && parents[i] >= root; ++i ) {
+		mask[i] = weight;
+	}
+	return mask;
+}
+
+void BlendGraph::evaluate( float time )
+{
+	const Skeleton::Definition& def = *mSkeleton->mDefinition;
+	Pose& pose = *mSkeleton->getPose();
+	glm::vec3* positions = pose.getLocalPositions();
+	glm::quat* rotations = pose.getLocalRotations();
+	glm::vec3* scales = pose.getLocalScales();
+
+	for( uint32_t slot : mSlots ) {
+		mPositions[slot] = glm::vec3( 0 );
+		mRotations[slot] = glm::quat( 0, 0, 0, 0 );
+		mScales[slot] = glm::vec3( 0 );
+		mWeights[slot] = 0.0f;
+	}
+
+	glm::vec3 translation, scale;
+	glm::quat rotation;
+	for( Layer& layer : mLayers ) {
+		if( layer.mMode != OVERRIDE || layer.mWeight <= 0.0f ) {
+			continue;
+		}
+		for( Channel& channel : layer.mChannels ) {
+			const float w = layer.mWeight * channel.mMask;
+			channel.mTrack->getValues( time, &translation, &rotation, &scale, &channel.mCursor );
+			mPositions[channel.mSlot] += w * translation;
+			accumulateRotation( &mRotations[channel.mSlot], rotation, w );
+			mScales[channel.mSlot] += w * scale;
+			mWeights[channel.mSlot] += w;
+		}
+	}
+
+	for( uint32_t slot : mSlots ) {
+		// What the layers leave below one goes to the initial transformation.
+		float weight = mWeights[slot];
+		if( weight < 1.0f ) {
+			const float rest = 1.0f - weight;
+			mPositions[slot] += rest * def.mInitialPositions[slot];
+			accumulateRotation( &mRotations[slot], def.mInitialRotations[slot], rest );
+			mScales[slot] += rest * def.mInitialScales[slot];
+			weight = 1.0f;
+		}
+		positions[slot] = mPositions[slot] / weight;
+		rotations[slot] = glm::normalize( mRotations[slot] );
+		scales[slot] = mScales[slot] / weight;
+		pose.setAnimated( slot, mWeights[slot] > 0.0f );
+	}
+
+	for( Layer& layer : mLayers ) {
+		if( layer.mMode != ADDITIVE || layer.mWeight <= 0.0f ) {
+			continue;
+		}
+		for( Channel& channel : layer.mChannels ) {
+			const float w = layer.mWeight * channel.mMask;
+			const uint32_t slot = channel.mSlot;
+			channel.mTrack->getValues( time, &translation, &rotation, &scale, &channel.mCursor );
+			positions[slot] += w * ( translation - def.mInitialPositions[slot] );
+			// The rotation from the initial one, scaled by nlerp from the identity.
+			glm::quat delta = glm::inverse( def.mInitialRotations[slot] ) * rotation;
+			if( delta.w < 0.0f ) {
+				delta = -delta;
+			}
+			rotations[slot] = glm::normalize( rotations[slot] * glm::normalize( ( 1.0f - w ) * glm::quat() + w * delta ) );
+			scales[slot] *= glm::mix( glm::vec3( 1 ), scale / def.mInitialScales[slot], w );
+			pose.setAnimated( slot, true );
+		}
+	}
+
+	pose.setTime( time );
+	pose.invalidate();
+}
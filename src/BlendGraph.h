@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Skeleton.h"
+
+#include <string>
+#include <vector>
+
+namespace model {
+
+typedef std::shared_ptr<class BlendGraph> BlendGraphRef;
+
+/*!
+ * Layers of animation tracks blended into the pose of a skeleton.
+ * OVERRIDE layers are averaged by weight node by node, the initial transformation taking whatever their weights
+ * leave below one; ADDITIVE layers then add the offset of their track from the initial transformation on top.
+ * Rotations are summed in the hemisphere of the running sum and normalized (nlerp), which doesn't depend on the
+ * order of the layers. Each layer only visits the nodes its track animates and its mask lets through, so that
+ * evaluating the graph scales with the active channels rather than with the nodes times the layers.
+ */
+class BlendGraph {
+public:
+	enum BlendMode { OVERRIDE, ADDITIVE };
+	//! Weight of every node, in pose slot order (see Skeleton::getNodes()).
+	typedef std::vector<float> Mask;
+
+	//! A graph posing \a skeleton. It holds playback cursors: create one per skeleton instance (see Skeleton::createInstance()).
+	static BlendGraphRef create( const SkeletonRef& skeleton );
+
+	/*!
+	 * Adds a layer playing track \a trackId, with the per node weights of \a mask if not empty, and returns its index.
+	 * Nodes without the track, or masked out by a zero, cost nothing to the layer.
+	 */
+	size_t	addLayer( int trackId, float weight = 1.0f, BlendMode mode = OVERRIDE, const Mask& mask = Mask() );
+	//! Layers of zero weight are skipped, i.e. to fade one in and out.
+	void	setWeight( size_t layer, float weight );
+	float	getWeight( size_t layer ) const { return mLayers[layer].mWeight; }
+	size_t	getNumLayers() const { return mLayers.size(); }
+	//! Nodes sampled by \a layer.
+	size_t	getNumChannels( size_t layer ) const { return mLayers[layer].mChannels.size(); }
+
+	//! Mask weighting the subtree of node \a rootName (i.e. the upper body from the spine) by \a weight, every other node by 0.
+	Mask	createMask( const std::string& rootName, float weight = 1.0f ) const;
+
+	//! Samples the layers at \a time (in seconds, as Skeleton::animate(): tracks convert it with their ticks per second) and blends them into the skeleton's pose.
+	void	evaluate( float time );
+
+	const SkeletonRef&	getSkeleton() const { return mSkeleton; }
+protected:
+	BlendGraph( const SkeletonRef& skeleton );
+
+	struct Channel {
+		uint32_t			mSlot;
+		float				mMask;
+		const AnimTrack*	mTrack;
+		AnimTrack::Cursor	mCursor;
+	};
+
+	struct Layer {
+		int						mTrackId;
+		float					mWeight;
+		BlendMode				mMode;
+		std::vector<Channel>	mChannels;
+	};
+
+	SkeletonRef				mSkeleton;
+	std::vector<Layer>		mLayers;
+	//! Slots animated by any layer, the only ones evaluate() touches.
+	std::vector<uint32_t>	mSlots;
+	std::vector<bool>		mIsSlotUsed;
+	//! Weighted sums of the override layers, per slot.
+	std::vector<glm::vec3>	mPositions, mScales;
+	std::vector<glm::quat>	mRotations;
+	std::vector<float>		mWeights;
+};
+
+} //end namespace model
@@ -0,0 +1,397 @@
+#include "Bvh.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace model;
+using namespace ci;
+
+namespace {
+	
+	const uint32_t	MAX_LEAF_SIZE = 4;
+	//! Leaves up to this size are kept whole when splitting them doesn't pay off.
+	const uint32_t	MAX_SAH_LEAF_SIZE = 16;
+	const int		NUM_BINS = 16;
+	//! Beyond this depth nodes are split in halves, which bounds the depth (and the traversal stack) at any size.
+	const int		MAX_SAH_DEPTH = 96;
+	const int		MAX_STACK_SIZE = 128;
+	
+	float halfArea( const vec3& lower, const vec3& upper )
+	{
+		vec3 d = glm::max( upper - lower, vec3( 0.0f ) );
+		return d.x * d.y + d.y * d.z + d.z * d.x;
+	}
+	
+	//! A primitive being sorted into the tree; moved around rather than referred to, so that every pass reads memory in order.
+	struct PrimitiveRef {
+		vec3		mLower;
+		uint32_t	mIndex;
+		vec3		mUpper;
+		
+		vec3		getCentroid() const { return ( mLower + mUpper ) * 0.5f; }
+	};
+	
+	class TreeBuilder {
+	public:
+		//! Consumes \a primitives; \a order receives their indices in leaf order.
+		TreeBuilder( std::vector<PrimitiveRef>* primitives, std::vector<Bvh::Node>* nodes, std::vector<uint32_t>* order )
+		: mPrimitives( *primitives ), mNodes( *nodes )
+		{
+			const uint32_t count = uint32_t( mPrimitives.size() );
+			mNodes.clear();
+			if( count ) {
+				mNodes.reserve( 2 * ( count / MAX_LEAF_SIZE + 1 ) );
+				build( 0, count, 0 );
+			}
+			order->resize( count );
+			for( uint32_t i = 0; i < count; ++i ) {
+				(*order)[i] = mPrimitives[i].mIndex;
+			}
+		}
+	private:
+		struct Bin {
+			Bin() : mLower( std::numeric_limits<float>::max() ), mUpper( -std::numeric_limits<float>::max() ), mCount( 0 ) { }
+			vec3		mLower, mUpper;
+			uint32_t	mCount;
+		};
+		
+		void build( uint32_t begin, uint32_t end, int depth )
+		{
+			const uint32_t nodeIndex = uint32_t( mNodes.size() );
+			mNodes.push_back( Bvh::Node() );
+			
+			vec3 lower( std::numeric_limits<float>::max() ), upper( -std::numeric_limits<float>::max() );
+			vec3 centroidLower = lower, centroidUpper = upper;
+			for( uint32_t i = begin; i < end; ++i ) {
+				const PrimitiveRef& primitive = mPrimitives[i];
+				lower = glm::min( lower, primitive.mLower );
+				upper = glm::max( upper, primitive.mUpper );
+				const vec3 centroid = primitive.getCentroid();
+				centroidLower = glm::min( centroidLower, centroid );
+				centroidUpper = glm::max( centroidUpper, centroid );
+			}
+			mNodes[nodeIndex].mMin = lower;
+			mNodes[nodeIndex].mMax = upper;
+			
+			const uint32_t count = end - begin;
+			if( count <= MAX_LEAF_SIZE ) {
+				makeLeaf( nodeIndex, begin, count );
+				return;
+			}
+			
+			uint32_t middle = begin + count / 2;
+			if( depth < MAX_SAH_DEPTH ) {
+				int bestAxis = -1, bestSplit = 0;
+				float bestCost = std::numeric_limits<float>::max();
+				// One pass bins the primitives along the three axes.
+				Bin bins[3][NUM_BINS];
+				vec3 scales;
+				for( int axis = 0; axis < 3; ++axis ) {
+					const float extent = centroidUpper[axis] - centroidLower[axis];
+					scales[axis] = ( extent > 0.0f ) ? float( NUM_BINS ) / extent : 0.0f;
+				}
+				for( uint32_t i = begin; i < end; ++i ) {
+					const PrimitiveRef& primitive = mPrimitives[i];
+					const vec3 centroid = primitive.getCentroid();
+					for( int axis = 0; axis < 3; ++axis ) {
+						Bin& bin = bins[axis][std::min( NUM_BINS - 1, int( ( centroid[axis] - centroidLower[axis] ) * scales[axis] ) )];
+						bin.mLower = glm::min( bin.mLower, primitive.mLower );
+						bin.mUpper = glm::max( bin.mUpper, primitive.mUpper );
+						++bin.mCount;
+					}
+				}
+				
+				for( int axis = 0; axis < 3; ++axis ) {
+					if( scales[axis] <= 0.0f ) {
+						continue;
+					}
+					// Right-to-left sweep for the right sides, then left-to-right for the costs.
+					float rightAreas[NUM_BINS];
+					uint32_t rightCounts[NUM_BINS];
+					Bin right;
+					for( int b = NUM_BINS - 1; b > 0; --b ) {
+						right.mLower = glm::min( right.mLower, bins[axis][b].mLower );
+						right.mUpper = glm::max( right.mUpper, bins[axis][b].mUpper );
+						right.mCount += bins[axis][b].mCount;
+						rightAreas[b] = halfArea( right.mLower, right.mUpper );
+						rightCounts[b] = right.mCount;
+					}
+					Bin left;
+					for( int b = 0; b < NUM_BINS - 1; ++b ) {
+						left.mLower = glm::min( left.mLower, bins[axis][b].mLower );
+						left.mUpper = glm::max( left.mUpper, bins[axis][b].mUpper );
+						left.mCount += bins[axis][b].mCount;
+						if( left.mCount == 0 || rightCounts[b + 1] == 0 ) {
+							continue;
+						}
+						float cost = halfArea( left.mLower, left.mUpper ) * float( left.mCount ) + rightAreas[b + 1] * float( rightCounts[b + 1] );
+						if( cost < bestCost ) {
+							bestCost = cost;
+							bestAxis = axis;
+							bestSplit = b;
+						}
+					}
+				}
+				
+				if( bestAxis < 0 ) {
+					// Every centroid at the same place: nothing to split on but the order.
+					if( count <= MAX_SAH_LEAF_SIZE ) {
+						makeLeaf( nodeIndex, begin, count );
+						return;
+					}
+				}
+				else {
+					// Traversing a node costs about a triangle test.
+					const float leafCost = halfArea( lower, upper ) * float( count );
+					if( count <= MAX_SAH_LEAF_SIZE && bestCost + halfArea( lower, upper ) >= leafCost ) {
+						makeLeaf( nodeIndex, begin, count );
+						return;
+					}
+					const float scale = scales[bestAxis];
+					const float lowerBound = centroidLower[bestAxis];
+					auto split = std::partition( mPrimitives.begin() + begin, mPrimitives.begin() + end, [&] ( const PrimitiveRef& primitive ) {
+						return std::min( NUM_BINS - 1, int( ( primitive.getCentroid()[bestAxis] - lowerBound ) * scale ) ) <= bestSplit;
+					} );
+					middle = uint32_t( split - mPrimitives.begin() );
+					if( middle == begin || middle == end ) {
+						middle = begin + count / 2;
+					}
+				}
+			}
+			
+			build( begin, middle, depth + 1 );
+			mNodes[nodeIndex].mOffset = uint32_t( mNodes.size() );
+			mNodes[nodeIndex].mCount = 0;
+			build( middle, end, depth + 1 );
+		}
+		
+		void makeLeaf( uint32_t nodeIndex, uint32_t begin, uint32_t count )
+		{
+			mNodes[nodeIndex].mOffset = begin;
+			mNodes[nodeIndex].mCount = count;
+		}
+		
+		std::vector<PrimitiveRef>&	mPrimitives;
+		std::vector<Bvh::Node>&		mNodes;
+	};
+	
+	//! Inverse direction, with huge finite values instead of infinities so that slab tests never compute 0 * inf.
+	vec3 safeInverse( const vec3& direction )
+	{
+		vec3 inverse;
+		for( int i = 0; i < 3; ++i ) {
+			inverse[i] = ( std::abs( direction[i] ) > 1e-30f ) ? 1.0f / direction[i] : std::copysign( 1e30f, direction[i] );
+		}
+		return inverse;
+	}
+	
+	bool intersectBox( const Bvh::Node& node, const vec3& origin, const vec3& inverseDirection, float maxDistance, float* distance )
+	{
+		vec3 t0 = ( node.mMin - origin ) * inverseDirection;
+		vec3 t1 = ( node.mMax - origin ) * inverseDirection;
+		vec3 entries = glm::min( t0, t1 ), exits = glm::max( t0, t1 );
+		float enter = std::max( std::max( entries.x, entries.y ), std::max( entries.z, 0.0f ) );
+		float exit = std::min( std::min( exits.x, exits.y ), std::min( exits.z, maxDistance ) );
+		*distance = enter;
+		return enter <= exit;
+	}
+	
+	//! Double-sided Möller-Trumbore.
+	bool intersectTriangle( const vec3& origin, const vec3& direction, const vec3& p0, const vec3& p1, const vec3& p2,
+						    float maxDistance, float* distance, vec2* barycentric )
+	{
+		const vec3 e1 = p1 - p0, e2 = p2 - p0;
+		const vec3 p = glm::cross( direction, e2 );
+		const float det = glm::dot( e1, p );
+		if( det == 0.0f ) {
+			return false;
+		}
+		const float inverseDet = 1.0f / det;
+		const vec3 s = origin - p0;
+		const float u = glm::dot( s, p ) * inverseDet;
+		if( u < 0.0f || u > 1.0f ) {
+			return false;
+		}
+		const vec3 q = glm::cross( s, e1 );
+		const float v = glm::dot( direction, q ) * inverseDet;
+		if( v < 0.0f || u + v > 1.0f ) {
+			return false;
+		}
+		const float t = glm::dot( e2, q ) * inverseDet;
+		if( t < 0.0f || t >= maxDistance ) {
+			return false;
+		}
+		*distance = t;
+		*barycentric = vec2( u, v );
+		return true;
+	}
+	
+	//! Visits the leaves hit by a ray nearest first; \a visitLeaf( first, count ) may shorten \a maxDistance, which prunes the rest.
+	template<typename VisitLeaf>
+	void traverse( const std::vector<Bvh::Node>& nodes, const vec3& origin, const vec3& inverseDirection, const float& maxDistance, VisitLeaf visitLeaf )
+	{
+		uint32_t stack[MAX_STACK_SIZE];
+		float stackDistances[MAX_STACK_SIZE];
+		int size = 0;
+		float distance;
+		if( nodes.empty() || ! intersectBox( nodes[0], origin, inverseDirection, maxDistance, &distance ) ) {
+			return;
+		}
+		stack[size] = 0;
+		stackDistances[size++] = distance;
+		while( size > 0 ) {
+			--size;
+			if( stackDistances[size] > maxDistance ) {
+				continue;
+			}
+			const uint32_t index = stack[size];
+			const Bvh::Node& node = nodes[index];
+			if( node.mCount ) {
+				visitLeaf( node.mOffset, node.mCount );
+				continue;
+			}
+			const uint32_t left = index + 1, right = node.mOffset;
+			float leftDistance, rightDistance;
+			const bool hitLeft = intersectBox( nodes[left], origin, inverseDirection, maxDistance, &leftDistance );
+			const bool hitRight = intersectBox( nodes[right], origin, inverseDirection, maxDistance, &rightDistance );
+			if( hitLeft && hitRight ) {
+				// Nearest on top.
+				const bool leftFirst = leftDistance <= rightDistance;
+				stack[size] = leftFirst ? right : left;
+				stackDistances[size++] = leftFirst ? rightDistance : leftDistance;
+				stack[size] = leftFirst ? left : right;
+				stackDistances[size++] = leftFirst ? leftDistance : rightDistance;
+			}
+			else if( hitLeft || hitRight ) {
+				stack[size] = hitLeft ? left : right;
+				stackDistances[size++] = hitLeft ? leftDistance : rightDistance;
+			}
+		}
+	}
+	
+} // anonymous namespace
+
+BvhRef Bvh::create( const Source& source, size_t numThreads )
+{
+	BvhRef bvh( new Bvh );
+	const auto sections = source.getSectionSources();
+	
+	bvh->mSectionTrees.resize( sections.size() );
+	parallelFor( sections.size(), numThreads, [&] ( size_t s ) {
+		SectionTree& tree = bvh->mSectionTrees[s];
+		tree.mSection = sections[s];
+		tree.mTransform = sections[s]->getDefaultTransformation();
+		tree.mInverseTransform = glm::inverse( tree.mTransform );
+		
+		const auto& indices = sections[s]->getIndices();
+		const vec3* positions = sections[s]->getPositions().data();
+		std::vector<PrimitiveRef> triangles( indices.size() / 3 );
+		for( size_t t = 0; t < triangles.size(); ++t ) {
+			const vec3& a = positions[indices[3 * t]];
+			const vec3& b = positions[indices[3 * t + 1]];
+			const vec3& c = positions[indices[3 * t + 2]];
+			triangles[t].mLower = glm::min( a, glm::min( b, c ) );
+			triangles[t].mUpper = glm::max( a, glm::max( b, c ) );
+			triangles[t].mIndex = uint32_t( t );
+		}
+		TreeBuilder( &triangles, &tree.mNodes, &tree.mTriangles );
+	} );
+	
+	// Empty sections are left out of the top tree.
+	std::vector<PrimitiveRef> boxes;
+	for( size_t s = 0; s < bvh->mSectionTrees.size(); ++s ) {
+		const SectionTree& tree = bvh->mSectionTrees[s];
+		if( tree.mNodes.empty() ) {
+			continue;
+		}
+		AxisAlignedBox box = AxisAlignedBox( tree.mNodes[0].mMin, tree.mNodes[0].mMax ).transformed( tree.mTransform );
+		boxes.push_back( PrimitiveRef{ box.getMin(), uint32_t( s ), box.getMax() } );
+	}
+	TreeBuilder( &boxes, &bvh->mNodes, &bvh->mSections );
+	if( ! bvh->mNodes.empty() && bvh->mNodes[0].mMin.x <= bvh->mNodes[0].mMax.x ) {
+		bvh->mBounds = AxisAlignedBox( bvh->mNodes[0].mMin, bvh->mNodes[0].mMax );
+	}
+	return bvh;
+}
+
+size_t Bvh::getNumTriangles() const
+{
+	size_t numTriangles = 0;
+	for( const auto& tree : mSectionTrees ) {
+		numTriangles += tree.mTriangles.size();
+	}
+	return numTriangles;
+}
+
+size_t Bvh::getMemorySize() const
+{
+	size_t size = mNodes.size() * sizeof( Node ) + mSections.size() * sizeof( uint32_t );
+	for( const auto& tree : mSectionTrees ) {
+		size += tree.mNodes.size() * sizeof( Node ) + tree.mTriangles.size() * sizeof( uint32_t );
+	}
+	return size;
+}
+
+void Bvh::cull( const Frustumf& frustum, std::vector<size_t>* sections ) const
+{
+	if( mNodes.empty() ) {
+		return;
+	}
+	uint32_t stack[MAX_STACK_SIZE];
+	int size = 0;
+	stack[size++] = 0;
+	while( size > 0 ) {
+		const uint32_t index = stack[--size];
+		const Node& node = mNodes[index];
+		if( ! frustum.intersects( AxisAlignedBox( node.mMin, node.mMax ) ) ) {
+			continue;
+		}
+		if( node.mCount ) {
+			for( uint32_t i = node.mOffset; i < node.mOffset + node.mCount; ++i ) {
+				sections->push_back( mSections[i] );
+			}
+			continue;
+		}
+		stack[size++] = node.mOffset;
+		stack[size++] = index + 1;
+	}
+}
+
+bool Bvh::raycast( const Ray& ray, Hit* hit ) const
+{
+	const vec3 origin = ray.getOrigin(), direction = ray.getDirection();
+	float nearest = std::numeric_limits<float>::max();
+	bool found = false;
+	
+	traverse( mNodes, origin, safeInverse( direction ), nearest, [&] ( uint32_t first, uint32_t count ) {
+		for( uint32_t i = first; i < first + count; ++i ) {
+			const uint32_t s = mSections[i];
+			const SectionTree& tree = mSectionTrees[s];
+			// An affine transformation keeps the ray parameter: distances compare across sections.
+			const vec3 localOrigin = vec3( tree.mInverseTransform * vec4( origin, 1.0f ) );
+			const vec3 localDirection = vec3( tree.mInverseTransform * vec4( direction, 0.0f ) );
+			const vec3* positions = tree.mSection->getPositions().data();
+			const uint32_t* indices = tree.mSection->getIndices().data();
+			
+			traverse( tree.mNodes, localOrigin, safeInverse( localDirection ), nearest, [&] ( uint32_t firstTriangle, uint32_t numTriangles ) {
+				for( uint32_t t = firstTriangle; t < firstTriangle + numTriangles; ++t ) {
+					const uint32_t triangle = tree.mTriangles[t];
+					float distance;
+					vec2 barycentric;
+					if( intersectTriangle( localOrigin, localDirection, positions[indices[3 * triangle]], positions[indices[3 * triangle + 1]],
+										   positions[indices[3 * triangle + 2]], nearest, &distance, &barycentric ) ) {
+						nearest = distance;
+						found = true;
+						hit->mSection = s;
+						hit->mTriangle = triangle;
+						hit->mDistance = distance;
+						hit->mBarycentric = barycentric;
+					}
+				}
+			} );
+		}
+	} );
+	return found;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "ModelIo.h"
+
+#include "cinder/AxisAlignedBox.h"
+#include "cinder/Frustum.h"
+#include "cinder/Ray.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace model {
+
+typedef std::shared_ptr<class Bvh> BvhRef;
+
+/*!
+ * Two-level bounding volume hierarchy of a model: a tree over its sections (placed by their default
+ * transformation), each with a tree over its triangles. Both are flattened depth-first and built with
+ * the binned surface area heuristic. Skinned sections are indexed in bind pose.
+ */
+class Bvh {
+public:
+	struct Hit {
+		Hit() : mSection( 0 ), mTriangle( 0 ), mDistance( 0.0f ) { }
+		
+		//! Index in Source::getSectionSources().
+		size_t		mSection;
+		//! Triangle of the section: indices 3 * mTriangle to 3 * mTriangle + 2.
+		uint32_t	mTriangle;
+		//! Ray parameter of the hit: ray.calcPosition( mDistance ).
+		float		mDistance;
+		//! Barycentric coordinates of the hit on the second and third vertices of the triangle.
+		glm::vec2	mBarycentric;
+	};
+	
+	//! Sections are built concurrently, on \a numThreads threads (0 uses every hardware thread).
+	static BvhRef create( const Source& source, size_t numThreads = 0 );
+	
+	const ci::AxisAlignedBox&	getBounds() const { return mBounds; }
+	size_t						getNumTriangles() const;
+	size_t						getMemorySize() const;
+	
+	//! Appends the sections intersecting \a frustum, given in the space of the model.
+	void	cull( const ci::Frustumf& frustum, std::vector<size_t>* sections ) const;
+	//! Nearest triangle hit by \a ray (in the space of the model), if any.
+	bool	raycast( const ci::Ray& ray, Hit* hit ) const;
+	
+	//! Flattened node: interior nodes are followed by their first child and point at their second one.
+	struct Node {
+		glm::vec3	mMin;
+		//! Second child of an interior node, first primitive of a leaf.
+		uint32_t	mOffset;
+		glm::vec3	mMax;
+		//! Number of primitives of a leaf, 0 for interior nodes.
+		uint32_t	mCount;
+	};
+	
+	//! A tree over the triangles of one section, in the section's space.
+	struct SectionTree {
+		SectionSourceRef		mSection;
+		glm::mat4				mTransform, mInverseTransform;
+		std::vector<Node>		mNodes;
+		//! Triangles in leaf order.
+		std::vector<uint32_t>	mTriangles;
+	};
+	
+	const std::vector<SectionTree>&	getSectionTrees() const { return mSectionTrees; }
+protected:
+	Bvh() { }
+	
+	std::vector<SectionTree>	mSectionTrees;
+	std::vector<Node>			mNodes;
+	//! Sections in leaf order.
+	std::vector<uint32_t>		mSections;
+	ci::AxisAlignedBox			mBounds;
+};
+
+} //end namespace model
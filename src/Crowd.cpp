@@ -0,0 +1,68 @@
+#include "Crowd.h"
+#include "Skeleton.h"
+#include "Parallel.h"
+
+#include "cinder/CinderAssert.h"
+
+#include <chrono>
+#include <cstring>
+
+using namespace model;
+
+Crowd::Crowd( size_t numThreads )
+: mNumThreads( numThreads )
+{
+}
+
+void Crowd::update( const std::vector<Instance>& instances )
+{
+	auto start = std::chrono::steady_clock::now();
+	
+	// Instances posing the same nodes have to be evaluated one after the other.
+	size_t numGroups = 0;
+	std::unordered_map<const Pose*, size_t> groupIndices;
+	for( size_t i = 0; i < instances.size(); ++i ) {
+		const Pose* pose = instances[i].mMesh->getSkeleton()->getPose().get();
+		auto group = groupIndices.emplace( pose, numGroups );
+		if( group.second ) {
+			if( mGroups.size() <= numGroups ) {
+				mGroups.resize( numGroups + 1 );
+			}
+			mGroups[numGroups++].clear();
+		}
+		mGroups[group.first->second].push_back( i );
+	}
+	
+	// The palettes of a mesh have a fixed size, known before posing.
+	mPaletteOffsets.resize( instances.size() + 1 );
+	mPaletteOffsets[0] = 0;
+	for( size_t i = 0; i < instances.size(); ++i ) {
+		mPaletteOffsets[i + 1] = mPaletteOffsets[i] + 2 * instances[i].mMesh->getNumPaletteMatrices();
+	}
+	mPalettes.resize( mPaletteOffsets.back() );
+	parallelFor( numGroups, mNumThreads, [&] ( size_t g ) {
+		for( size_t i : mGroups[g] ) {
+			const Instance& instance = instances[i];
+			// Both update the palettes through SkeletalMesh::update().
+			if( instance.mTrackWeights.empty() ) {
+				instance.mMesh->setPose( instance.mTime, instance.mTrackId );
+			} else {
+				instance.mMesh->setBlendedPose( instance.mTime, instance.mTrackWeights );
+			}
+			
+			const SkeletalMesh& mesh = *instance.mMesh;
+			glm::mat4* palette = mPalettes.data() + mPaletteOffsets[i];
+			const size_t numMatrices = ( mPaletteOffsets[i + 1] - mPaletteOffsets[i] ) / 2;
+			for( const auto& section : mesh.getSections() ) {
+				const size_t paletteSize = section->getBonePalette().size();
+				std::memcpy( palette, mesh.getPaletteMatrices( *section ), paletteSize * sizeof( glm::mat4 ) );
+				std::memcpy( palette + numMatrices, mesh.getPaletteInvTransposeMatrices( *section ), paletteSize * sizeof( glm::mat4 ) );
+				palette += paletteSize;
+			}
+			CI_ASSERT( palette == mPalettes.data() + mPaletteOffsets[i] + numMatrices );
+		}
+	} );
+	
+	mStats.mNumInstances = instances.size();
+	mStats.mSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "SkeletalMesh.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace model {
+
+typedef std::shared_ptr<class Crowd> CrowdRef;
+
+/*!
+ * Batch update of many SkeletalMesh instances. Poses and palettes are evaluated on worker
+ * threads and the resulting palettes gathered in one contiguous buffer, ready for a single uniform
+ * or texture buffer upload. Instances sharing a skeleton pose are evaluated on the same thread,
+ * in order; give each mesh its own instance of the skeleton (see SkeletalMesh::createInstance()) to pose them independently.
+ */
+class Crowd {
+public:
+	//! A mesh to pose at \a time, either with a single track or a blend of tracks.
+	struct Instance {
+		Instance( const SkeletalMeshRef& mesh, float time, int trackId = 0 )
+		: mMesh( mesh ), mTime( time ), mTrackId( trackId ) { }
+		Instance( const SkeletalMeshRef& mesh, float time, const std::unordered_map<int, float>& trackWeights )
+		: mMesh( mesh ), mTime( time ), mTrackId( 0 ), mTrackWeights( trackWeights ) { }
+		
+		SkeletalMeshRef					mMesh;
+		float							mTime;
+		int								mTrackId;
+		//! Blended when not empty, in which case mTrackId is ignored.
+		std::unordered_map<int, float>	mTrackWeights;
+	};
+	
+	struct Stats {
+		Stats() : mNumInstances( 0 ), mSeconds( 0.0 ) { }
+		
+		size_t	mNumInstances;
+		double	mSeconds;
+		//! Throughput of the last update.
+		double	getInstancesPerMs() const { return mSeconds > 0.0 ? double( mNumInstances ) / ( mSeconds * 1000.0 ) : 0.0; }
+	};
+	
+	//! \a numThreads caps the threads used per update, 0 using every hardware thread.
+	static CrowdRef create( size_t numThreads = 0 ) { return CrowdRef( new Crowd( numThreads ) ); }
+	
+	//! Poses every instance, updates its mesh's palettes and copies them into the palette buffer.
+	void							update( const std::vector<Instance>& instances );
+	
+	/*!
+	 * Palettes of the last update. The one of instance \a i starts at getPaletteOffsets()[i]: the palettes of the sections of its mesh,
+	 * one after the other (see SkeletalMesh::getPaletteMatrices()), then as many normal matrices (see SkeletalMesh::getPaletteInvTransposeMatrices()).
+	 */
+	const std::vector<glm::mat4>&	getPalettes() const { return mPalettes; }
+	//! One more than instances, the last being the size of getPalettes().
+	const std::vector<size_t>&		getPaletteOffsets() const { return mPaletteOffsets; }
+	const Stats&					getStats() const { return mStats; }
+protected:
+	explicit Crowd( size_t numThreads );
+	
+	size_t							mNumThreads;
+	std::vector<glm::mat4>			mPalettes;
+	std::vector<size_t>				mPaletteOffsets;
+	//! Instance indices grouped by pose, reused from one update to the next.
+	std::vector<std::vector<size_t>>	mGroups;
+	Stats							mStats;
+};
+
+} //end namespace model
@@ -0,0 +1,106 @@
+#include "DataSourceIOSystem.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+using namespace model;
+
+DataSourceResolver model::serializeResolver( const DataSourceResolver& resolver )
+{
+	if( ! resolver ) {
+		return DataSourceResolver();
+	}
+	auto mutex = std::make_shared<std::mutex>();
+	return [resolver, mutex] ( const ci::fs::path& path ) -> ci::DataSourceRef {
+		std::lock_guard<std::mutex> lock( *mutex );
+		return resolver( path );
+	};
+}
+
+BufferIOStream::BufferIOStream( const ci::BufferRef& buffer )
+: mBuffer( buffer )
+, mPosition( 0 )
+{
+}
+
+size_t BufferIOStream::Read( void* pvBuffer, size_t pSize, size_t pCount )
+{
+	if( pSize == 0 ) {
+		return 0;
+	}
+	size_t count = std::min( pCount, ( mBuffer->getSize() - mPosition ) / pSize );
+	std::memcpy( pvBuffer, static_cast<const uint8_t*>( mBuffer->getData() ) + mPosition, count * pSize );
+	mPosition += count * pSize;
+	return count;
+}
+
+aiReturn BufferIOStream::Seek( size_t pOffset, aiOrigin pOrigin )
+{
+	size_t position;
+	switch( pOrigin ) {
+		case aiOrigin_SET: position = pOffset; break;
+		case aiOrigin_CUR: position = mPosition + pOffset; break;
+		case aiOrigin_END: position = mBuffer->getSize() - pOffset; break;
+		default: return aiReturn_FAILURE;
+	}
+	if( position > mBuffer->getSize() ) {
+		return aiReturn_FAILURE;
+	}
+	mPosition = position;
+	return aiReturn_SUCCESS;
+}
+
+DataSourceIOSystem::DataSourceIOSystem( const ci::DataSourceRef& model, const ci::fs::path& modelPath, const DataSourceResolver& resolver )
+: mModel( model )
+, mModelPath( normalize( modelPath.generic_string().c_str() ) )
+, mResolver( resolver )
+{
+}
+
+std::string DataSourceIOSystem::normalize( const char* file )
+{
+	std::string path( file );
+	std::replace( path.begin(), path.end(), '\\', '/' );
+	while( path.compare( 0, 2, "./" ) == 0 ) {
+		path.erase( 0, 2 );
+	}
+	return path;
+}
+
+ci::DataSourceRef DataSourceIOSystem::resolve( const char* file ) const
+{
+	std::string path = normalize( file );
+	if( path == mModelPath ) {
+		return mModel;
+	}
+	if( ! mResolver ) {
+		return nullptr;
+	}
+	
+	std::lock_guard<std::mutex> lock( mMutex );
+	auto it = mResolved.find( path );
+	if( it == mResolved.end() ) {
+		it = mResolved.emplace( path, mResolver( path ) ).first;
+	}
+	return it->second;
+}
+
+bool DataSourceIOSystem::Exists( const char* pFile ) const
+{
+	return resolve( pFile ) != nullptr;
+}
+
+Assimp::IOStream* DataSourceIOSystem::Open( const char* pFile, const char* pMode )
+{
+	// Models are only ever read.
+	if( std::strchr( pMode, 'w' ) || std::strchr( pMode, 'a' ) ) {
+		return nullptr;
+	}
+	
+	ci::DataSourceRef source = resolve( pFile );
+	if( ! source ) {
+		return nullptr;
+	}
+	return new BufferIOStream( source->getBuffer() );
+}
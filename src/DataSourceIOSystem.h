@@ -0,0 +1,74 @@
+#pragma once
+
+#include "assimp/IOStream.hpp"
+#include "assimp/IOSystem.hpp"
+
+#include "cinder/DataSource.h"
+#include "cinder/Filesystem.h"
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace model {
+
+	/*!
+	 * Resolves a file referenced by a model (.mtl files, textures...) given the path the model
+	 * would open it with on disk, i.e. prefixed with the model's own directory if it has one.
+	 * Returns nullptr if there is no such file.
+	 */
+	typedef std::function<ci::DataSourceRef( const ci::fs::path& )> DataSourceResolver;
+	
+	/*!
+	 * \a resolver behind a mutex shared by every copy of the result, so that a resolver which isn't thread-safe can be
+	 * called by the import and by parallel section loads alike. Returns an empty resolver if \a resolver is.
+	 */
+	DataSourceResolver	serializeResolver( const DataSourceResolver& resolver );
+	
+	//! Read-only assimp stream over the memory of a ci::Buffer.
+	class BufferIOStream : public Assimp::IOStream {
+	public:
+		explicit BufferIOStream( const ci::BufferRef& buffer );
+		
+		size_t		Read( void* pvBuffer, size_t pSize, size_t pCount ) override;
+		size_t		Write( const void* pvBuffer, size_t pSize, size_t pCount ) override { return 0; }
+		aiReturn	Seek( size_t pOffset, aiOrigin pOrigin ) override;
+		size_t		Tell() const override { return mPosition; }
+		size_t		FileSize() const override { return mBuffer->getSize(); }
+		void		Flush() override { }
+	private:
+		ci::BufferRef	mBuffer;
+		size_t			mPosition;
+	};
+	
+	/*!
+	 * Assimp IO system serving files from Cinder data sources instead of the file system, for models
+	 * shipped in archives, resources or received over IPC. The model itself is read from its own data
+	 * source; every other file assimp asks for goes through the resolver. Data is read in place,
+	 * nothing gets written to temporary files.
+	 */
+	class DataSourceIOSystem : public Assimp::IOSystem {
+	public:
+		//! \a modelPath is the name assimp is given to read the model (its extension selects the importer).
+		DataSourceIOSystem( const ci::DataSourceRef& model, const ci::fs::path& modelPath, const DataSourceResolver& resolver );
+		
+		bool				Exists( const char* pFile ) const override;
+		char				getOsSeparator() const override { return '/'; }
+		Assimp::IOStream*	Open( const char* pFile, const char* pMode = "rb" ) override;
+		void				Close( Assimp::IOStream* pFile ) override { delete pFile; }
+	private:
+		//! Strips "./" prefixes and backslashes so that assimp's paths match the resolver's.
+		static std::string	normalize( const char* file );
+		ci::DataSourceRef	resolve( const char* file ) const;
+		
+		ci::DataSourceRef	mModel;
+		std::string			mModelPath;
+		DataSourceResolver	mResolver;
+		
+		//! Assimp checks for a file before opening it: avoid resolving it twice.
+		mutable std::mutex									mMutex;
+		mutable std::map<std::string, ci::DataSourceRef>	mResolved;
+	};
+	
+} //end namespace model
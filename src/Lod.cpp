@@ -0,0 +1,316 @@
+#include "Lod.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <unordered_map>
+
+using namespace model;
+
+namespace {
+	
+	//! Symmetric 4x4 matrix summing squared distances to planes.
+	struct Quadric {
+		Quadric() { std::fill( a, a + 10, 0.0 ); }
+		
+		void addPlane( const glm::vec3& n, float d )
+		{
+			a[0] += n.x * n.x;	a[1] += n.x * n.y;	a[2] += n.x * n.z;	a[3] += n.x * d;
+			a[4] += n.y * n.y;	a[5] += n.y * n.z;	a[6] += n.y * d;
+			a[7] += n.z * n.z;	a[8] += n.z * d;
+			a[9] += double( d ) * d;
+		}
+		
+		void add( const Quadric& q )
+		{
+			for( int i = 0; i < 10; ++i ) {
+				a[i] += q.a[i];
+			}
+		}
+		
+		double evaluate( const glm::vec3& p ) const
+		{
+			const double x = p.x, y = p.y, z = p.z;
+			double e = a[0] * x * x + 2.0 * a[1] * x * y + 2.0 * a[2] * x * z + 2.0 * a[3] * x
+					 + a[4] * y * y + 2.0 * a[5] * y * z + 2.0 * a[6] * y
+					 + a[7] * z * z + 2.0 * a[8] * z
+					 + a[9];
+			return std::max( e, 0.0 );
+		}
+		
+		double a[10];
+	};
+	
+	struct Collapse {
+		uint32_t	mFrom, mTo;
+		double		mCost;
+		
+		bool operator<( const Collapse& rhs ) const { return mCost < rhs.mCost; }
+	};
+	
+	struct PositionHash {
+		size_t operator()( const glm::vec3& p ) const
+		{
+			uint32_t bits[3];
+			std::memcpy( bits, &p, sizeof( bits ) );
+			return ( bits[0] * 73856093u ) ^ ( bits[1] * 19349663u ) ^ ( bits[2] * 83492791u );
+		}
+	};
+	
+	uint64_t edgeKey( uint32_t a, uint32_t b )
+	{
+		return ( a < b ) ? ( uint64_t( a ) << 32 | b ) : ( uint64_t( b ) << 32 | a );
+	}
+	
+	float skinDistance( const glm::vec4& indicesA, const glm::vec4& weightsA, const glm::vec4& indicesB, const glm::vec4& weightsB )
+	{
+		float distance = 0.0f;
+		for( int i = 0; i < 4; ++i ) {
+			float matched = 0.0f;
+			for( int j = 0; j < 4; ++j ) {
+				if( indicesB[j] == indicesA[i] && weightsB[j] > 0.0f ) {
+					matched = weightsB[j];
+					break;
+				}
+			}
+			distance += std::abs( weightsA[i] - matched );
+		}
+		for( int j = 0; j < 4; ++j ) {
+			bool found = false;
+			for( int i = 0; i < 4; ++i ) {
+				found = found || ( indicesA[i] == indicesB[j] && weightsA[i] > 0.0f );
+			}
+			if( ! found ) {
+				distance += weightsB[j];
+			}
+		}
+		return distance;
+	}
+	
+	//! Simplifies progressively, each level starting from the previous one.
+	class Simplifier {
+	public:
+		Simplifier( const glm::vec3* positions, size_t numVertices, const std::vector<uint32_t>& indices,
+				    const std::vector<glm::vec4>& boneIndices, const std::vector<glm::vec4>& boneWeights, float skinTolerance )
+		: mPositions( positions ), mIndices( indices ), mQuadrics( numVertices ), mLocked( numVertices, 0 ), mMaxCost( 0.0 )
+		{
+			mIndices.resize( mIndices.size() - mIndices.size() % 3 );
+			
+			// Seams: several vertices sharing one position.
+			std::unordered_map<glm::vec3, uint32_t, PositionHash> firstAtPosition;
+			for( uint32_t v = 0; v < numVertices; ++v ) {
+				auto inserted = firstAtPosition.emplace( positions[v], v );
+				if( ! inserted.second ) {
+					mLocked[v] = 1;
+					mLocked[inserted.first->second] = 1;
+				}
+			}
+			
+			// Open borders and non-manifold edges.
+			std::unordered_map<uint64_t, uint32_t> edgeCounts;
+			for( size_t i = 0; i < mIndices.size(); i += 3 ) {
+				for( int k = 0; k < 3; ++k ) {
+					++edgeCounts[edgeKey( mIndices[i + k], mIndices[i + ( k + 1 ) % 3] )];
+				}
+			}
+			for( const auto& edge : edgeCounts ) {
+				if( edge.second != 2 ) {
+					mLocked[uint32_t( edge.first >> 32 )] = 1;
+					mLocked[uint32_t( edge.first )] = 1;
+				}
+			}
+			
+			for( size_t i = 0; i < mIndices.size(); i += 3 ) {
+				const glm::vec3& p0 = positions[mIndices[i]];
+				glm::vec3 n = glm::cross( positions[mIndices[i + 1]] - p0, positions[mIndices[i + 2]] - p0 );
+				float length = glm::length( n );
+				if( length <= 0.0f ) {
+					continue;
+				}
+				n /= length;
+				float d = -glm::dot( n, p0 );
+				for( int k = 0; k < 3; ++k ) {
+					mQuadrics[mIndices[i + k]].addPlane( n, d );
+				}
+			}
+			
+			const bool skinned = ! boneIndices.empty() && boneIndices.size() >= numVertices && boneWeights.size() >= numVertices;
+			mCompatible = [=, &boneIndices, &boneWeights] ( uint32_t a, uint32_t b ) {
+				return ! skinned || skinDistance( boneIndices[a], boneWeights[a], boneIndices[b], boneWeights[b] ) <= skinTolerance;
+			};
+		}
+		
+		//! Collapses edges until at most \a targetTriangles remain or nothing collapses anymore.
+		void simplify( size_t targetTriangles )
+		{
+			while( getNumTriangles() > targetTriangles ) {
+				if( ! collapsePass( targetTriangles ) ) {
+					break;
+				}
+			}
+		}
+		
+		const std::vector<uint32_t>&	getIndices() const { return mIndices; }
+		size_t							getNumTriangles() const { return mIndices.size() / 3; }
+		float							getError() const { return float( std::sqrt( mMaxCost ) ); }
+	private:
+		bool collapsePass( size_t targetTriangles )
+		{
+			const size_t numVertices = mQuadrics.size();
+			const size_t numTriangles = getNumTriangles();
+			
+			// Triangles around each vertex.
+			std::vector<uint32_t> offsets( numVertices + 1, 0 );
+			for( uint32_t index : mIndices ) {
+				++offsets[index + 1];
+			}
+			for( size_t v = 0; v < numVertices; ++v ) {
+				offsets[v + 1] += offsets[v];
+			}
+			std::vector<uint32_t> triangles( mIndices.size() );
+			std::vector<uint32_t> fill( offsets.begin(), offsets.end() - 1 );
+			for( size_t i = 0; i < mIndices.size(); ++i ) {
+				triangles[fill[mIndices[i]]++] = uint32_t( i / 3 );
+			}
+			
+			std::vector<Collapse> collapses;
+			collapses.reserve( mIndices.size() );
+			for( size_t i = 0; i < mIndices.size(); i += 3 ) {
+				for( int k = 0; k < 3; ++k ) {
+					uint32_t a = mIndices[i + k], b = mIndices[i + ( k + 1 ) % 3];
+					if( a == b || ! mCompatible( a, b ) ) {
+						continue;
+					}
+					// Both directions of the (interior) edge show up, once in each adjacent triangle.
+					if( ! mLocked[a] ) {
+						collapses.push_back( Collapse{ a, b, mQuadrics[a].evaluate( mPositions[b] ) } );
+					}
+				}
+			}
+			std::sort( collapses.begin(), collapses.end() );
+			
+			std::vector<uint32_t> remap( numVertices );
+			for( uint32_t v = 0; v < numVertices; ++v ) {
+				remap[v] = v;
+			}
+			std::vector<uint8_t> touched( numVertices, 0 );
+			size_t removed = 0;
+			const size_t excess = numTriangles - targetTriangles;
+			for( const Collapse& collapse : collapses ) {
+				if( removed >= excess ) {
+					break;
+				}
+				const uint32_t from = collapse.mFrom, to = collapse.mTo;
+				if( touched[from] || touched[to] || flips( from, to, offsets, triangles ) ) {
+					continue;
+				}
+				
+				remap[from] = to;
+				mQuadrics[to].add( mQuadrics[from] );
+				mMaxCost = std::max( mMaxCost, collapse.mCost );
+				// Freeze the neighbourhood: later collapses of this pass were validated against the old geometry.
+				for( uint32_t t = offsets[from]; t < offsets[from + 1]; ++t ) {
+					const uint32_t* triangle = &mIndices[triangles[t] * 3];
+					removed += ( triangle[0] == to || triangle[1] == to || triangle[2] == to );
+					for( int k = 0; k < 3; ++k ) {
+						touched[triangle[k]] = 1;
+					}
+				}
+			}
+			if( removed == 0 ) {
+				return false;
+			}
+			
+			size_t write = 0;
+			for( size_t i = 0; i < mIndices.size(); i += 3 ) {
+				uint32_t a = remap[mIndices[i]], b = remap[mIndices[i + 1]], c = remap[mIndices[i + 2]];
+				if( a != b && b != c && a != c ) {
+					mIndices[write++] = a;
+					mIndices[write++] = b;
+					mIndices[write++] = c;
+				}
+			}
+			mIndices.resize( write );
+			return true;
+		}
+		
+		//! Whether moving \a from onto \a to turns any of its remaining triangles over.
+		bool flips( uint32_t from, uint32_t to, const std::vector<uint32_t>& offsets, const std::vector<uint32_t>& triangles ) const
+		{
+			for( uint32_t t = offsets[from]; t < offsets[from + 1]; ++t ) {
+				const uint32_t* triangle = &mIndices[triangles[t] * 3];
+				if( triangle[0] == to || triangle[1] == to || triangle[2] == to ) {
+					continue;	// collapses away
+				}
+				glm::vec3 p[3], q[3];
+				for( int k = 0; k < 3; ++k ) {
+					p[k] = mPositions[triangle[k]];
+					q[k] = ( triangle[k] == from ) ? mPositions[to] : p[k];
+				}
+				glm::vec3 before = glm::cross( p[1] - p[0], p[2] - p[0] );
+				glm::vec3 after = glm::cross( q[1] - q[0], q[2] - q[0] );
+				if( glm::dot( before, after ) < 0.25f * glm::length( before ) * glm::length( after ) ) {
+					return true;
+				}
+			}
+			return false;
+		}
+		
+		const glm::vec3*		mPositions;
+		std::vector<uint32_t>	mIndices;
+		std::vector<Quadric>	mQuadrics;
+		std::vector<uint8_t>	mLocked;
+		std::function<bool( uint32_t, uint32_t )>	mCompatible;
+		double					mMaxCost;
+	};
+	
+} // anonymous namespace
+
+std::vector<Lod> Lod::build( const glm::vec3* positions, size_t numVertices, const std::vector<uint32_t>& indices,
+							 const std::vector<glm::vec4>& boneIndices, const std::vector<glm::vec4>& boneWeights,
+							 size_t numLevels, float triangleRatio, float skinTolerance )
+{
+	std::vector<Lod> lods;
+	if( indices.size() < 3 || numLevels == 0 ) {
+		return lods;
+	}
+	
+	auto start = std::chrono::steady_clock::now();
+	Simplifier simplifier( positions, numVertices, indices, boneIndices, boneWeights, skinTolerance );
+	float target = float( simplifier.getNumTriangles() );
+	for( size_t level = 0; level < numLevels; ++level ) {
+		size_t numTriangles = simplifier.getNumTriangles();
+		target *= triangleRatio;
+		simplifier.simplify( size_t( target ) );
+		if( simplifier.getNumTriangles() == numTriangles ) {
+			break;	// stuck: further levels would be copies
+		}
+		
+		auto end = std::chrono::steady_clock::now();
+		Lod lod;
+		lod.mIndices = simplifier.getIndices();
+		lod.mError = simplifier.getError();
+		lod.mSeconds = std::chrono::duration<double>( end - start ).count();
+		lods.push_back( std::move( lod ) );
+		start = end;
+	}
+	return lods;
+}
+
+float Lod::getPixelsPerUnit( float distance, float fovY, float viewportHeight )
+{
+	return viewportHeight / ( 2.0f * std::max( distance, 1e-6f ) * std::tan( fovY * 0.5f ) );
+}
+
+size_t Lod::select( const std::vector<Lod>& lods, float pixelsPerUnit, float maxPixelError )
+{
+	size_t level = 0;
+	for( size_t i = 0; i < lods.size(); ++i ) {
+		if( lods[i].mError * pixelsPerUnit <= maxPixelError ) {
+			level = i + 1;
+		}
+	}
+	return level;
+}
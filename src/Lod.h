@@ -0,0 +1,39 @@
+#pragma once
+
+#include "cinder/Vector.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace model {
+
+//! A simplified index buffer of a section, over the section's own vertices.
+struct Lod {
+	Lod() : mError( 0.0f ), mSeconds( 0.0 ) { }
+	
+	std::vector<uint32_t>	mIndices;
+	//! Upper bound of the object-space distance between this level and the source surface.
+	float					mError;
+	//! Time spent simplifying from the previous level.
+	double					mSeconds;
+	
+	size_t	getNumTriangles() const { return mIndices.size() / 3; }
+	
+	/*!
+	 * Builds \a numLevels levels by quadric-error edge collapse, each with about \a triangleRatio times the triangles
+	 * of the previous one. A vertex only collapses onto a neighbour: the vertex buffer is shared by every level.
+	 * Vertices on UV/normal seams (several vertices at one position) and on open borders never move, and a vertex
+	 * only collapses onto a neighbour whose bone weights differ by at most \a skinTolerance (L1 distance).
+	 * Levels stop early once no edge can collapse anymore.
+	 */
+	static std::vector<Lod> build( const glm::vec3* positions, size_t numVertices, const std::vector<uint32_t>& indices,
+								   const std::vector<glm::vec4>& boneIndices, const std::vector<glm::vec4>& boneWeights,
+								   size_t numLevels, float triangleRatio = 0.5f, float skinTolerance = 0.2f );
+	
+	//! Pixels covered by one object-space unit at \a distance from a camera of vertical field of view \a fovY (radians) over \a viewportHeight pixels.
+	static float	getPixelsPerUnit( float distance, float fovY, float viewportHeight );
+	//! Coarsest level whose error covers at most \a maxPixelError pixels: 0 for the source indices, i for \a lods[i - 1].
+	static size_t	select( const std::vector<Lod>& lods, float pixelsPerUnit, float maxPixelError = 1.0f );
+};
+
+} //end namespace model
@@ -0,0 +1,180 @@
+#include "Meshlet.h"
+
+#include "cinder/Camera.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+using namespace model;
+using namespace ci;
+
+namespace {
+	
+	void finishMeshlet( const vec3* positions, const std::vector<uint32_t>& indices, const std::vector<uint32_t>& vertices, Meshlet* meshlet )
+	{
+		// Bounding sphere around the box of the vertices.
+		vec3 lower( std::numeric_limits<float>::max() ), upper( -std::numeric_limits<float>::max() );
+		for( uint32_t v : vertices ) {
+			lower = glm::min( lower, positions[v] );
+			upper = glm::max( upper, positions[v] );
+		}
+		meshlet->mCenter = ( lower + upper ) * 0.5f;
+		float radius2 = 0.0f;
+		for( uint32_t v : vertices ) {
+			vec3 offset = positions[v] - meshlet->mCenter;
+			radius2 = std::max( radius2, glm::dot( offset, offset ) );
+		}
+		meshlet->mRadius = std::sqrt( radius2 );
+		
+		// Normal cone around the average triangle normal, zero for degenerate triangles.
+		const size_t first = meshlet->mFirstIndex, last = first + meshlet->mNumIndices;
+		std::vector<vec3> normals;
+		normals.reserve( meshlet->mNumIndices / 3 );
+		vec3 axis( 0.0f );
+		for( size_t i = first; i < last; i += 3 ) {
+			const vec3& p0 = positions[indices[i]];
+			vec3 n = glm::cross( positions[indices[i + 1]] - p0, positions[indices[i + 2]] - p0 );
+			float length = glm::length( n );
+			normals.push_back( ( length > 0.0f ) ? n / length : vec3( 0.0f ) );
+			axis += normals.back();
+		}
+		
+		meshlet->mConeApex = meshlet->mCenter;
+		meshlet->mConeAxis = vec3( 0, 0, 1 );
+		meshlet->mConeCutoff = 1.0f;	// never back-facing
+		float axisLength = glm::length( axis );
+		if( axisLength <= 0.0f ) {
+			return;
+		}
+		axis /= axisLength;
+		float minDot = 1.0f;
+		for( const vec3& n : normals ) {
+			if( n != vec3( 0.0f ) ) {
+				minDot = std::min( minDot, glm::dot( n, axis ) );
+			}
+		}
+		if( minDot <= 0.1f ) {
+			// Normals spread over (almost) a hemisphere: some triangle always faces the camera.
+			return;
+		}
+		
+		// Apex behind every triangle plane, so that the cone test is conservative for the whole meshlet.
+		float maxT = 0.0f;
+		for( size_t t = 0; t < normals.size(); ++t ) {
+			if( normals[t] != vec3( 0.0f ) ) {
+				const vec3& p0 = positions[indices[first + 3 * t]];
+				maxT = std::max( maxT, glm::dot( meshlet->mCenter - p0, normals[t] ) / glm::dot( axis, normals[t] ) );
+			}
+		}
+		meshlet->mConeApex = meshlet->mCenter - axis * maxT;
+		meshlet->mConeAxis = axis;
+		meshlet->mConeCutoff = std::sqrt( 1.0f - minDot * minDot );
+	}
+	
+} // anonymous namespace
+
+std::vector<Meshlet> Meshlet::build( const vec3* positions, size_t numVertices, const std::vector<uint32_t>& indices, size_t maxVertices, size_t maxTriangles )
+{
+	std::vector<Meshlet> meshlets;
+	if( indices.size() < 3 || maxVertices < 3 || maxTriangles < 1 ) {
+		return meshlets;
+	}
+	
+	// Meshlet each vertex was last added to, to count unique vertices without clearing a set.
+	std::vector<uint32_t> owner( numVertices, std::numeric_limits<uint32_t>::max() );
+	std::vector<uint32_t> vertices;
+	vertices.reserve( maxVertices );
+	
+	Meshlet meshlet = Meshlet();
+	const size_t numTriangleIndices = indices.size() - indices.size() % 3;
+	for( size_t i = 0; i < numTriangleIndices; i += 3 ) {
+		uint32_t id = uint32_t( meshlets.size() );
+		const uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+		size_t newVertices = size_t( owner[a] != id ) + size_t( owner[b] != id && b != a ) + size_t( owner[c] != id && c != a && c != b );
+		if( vertices.size() + newVertices > maxVertices || meshlet.mNumIndices / 3 >= maxTriangles ) {
+			meshlet.mNumVertices = uint32_t( vertices.size() );
+			finishMeshlet( positions, indices, vertices, &meshlet );
+			meshlets.push_back( meshlet );
+			meshlet = Meshlet();
+			meshlet.mFirstIndex = uint32_t( i );
+			vertices.clear();
+			id = uint32_t( meshlets.size() );
+		}
+		for( size_t k = 0; k < 3; ++k ) {
+			if( owner[indices[i + k]] != id ) {
+				owner[indices[i + k]] = id;
+				vertices.push_back( indices[i + k] );
+			}
+		}
+		meshlet.mNumIndices += 3;
+	}
+	meshlet.mNumVertices = uint32_t( vertices.size() );
+	finishMeshlet( positions, indices, vertices, &meshlet );
+	meshlets.push_back( meshlet );
+	return meshlets;
+}
+
+MeshletCuller::MeshletCuller( const mat4& modelViewProjection, const vec3& eye )
+: mEye( eye )
+{
+	setPlanes( modelViewProjection );
+}
+
+MeshletCuller::MeshletCuller( const Camera& camera, const mat4& modelMatrix )
+{
+	mat4 modelView = camera.getViewMatrix() * modelMatrix;
+	mEye = vec3( glm::inverse( modelView ) * vec4( 0, 0, 0, 1 ) );
+	setPlanes( camera.getProjectionMatrix() * modelView );
+}
+
+void MeshletCuller::setPlanes( const mat4& m )
+{
+	// Gribb & Hartmann: the clip planes are sums and differences of the matrix rows.
+	const vec4 row0( m[0][0], m[1][0], m[2][0], m[3][0] );
+	const vec4 row1( m[0][1], m[1][1], m[2][1], m[3][1] );
+	const vec4 row2( m[0][2], m[1][2], m[2][2], m[3][2] );
+	const vec4 row3( m[0][3], m[1][3], m[2][3], m[3][3] );
+	mPlanes[0] = row3 + row0;
+	mPlanes[1] = row3 - row0;
+	mPlanes[2] = row3 + row1;
+	mPlanes[3] = row3 - row1;
+	mPlanes[4] = row3 + row2;
+	mPlanes[5] = row3 - row2;
+	for( auto& plane : mPlanes ) {
+		plane /= glm::length( vec3( plane ) );
+	}
+}
+
+bool MeshletCuller::isVisible( const Meshlet& meshlet ) const
+{
+	for( const auto& plane : mPlanes ) {
+		if( glm::dot( vec3( plane ), meshlet.mCenter ) + plane.w < -meshlet.mRadius ) {
+			return false;
+		}
+	}
+	return glm::dot( glm::normalize( meshlet.mConeApex - mEye ), meshlet.mConeAxis ) < meshlet.mConeCutoff;
+}
+
+void MeshletCuller::cull( const std::vector<Meshlet>& meshlets, std::vector<MeshletRange>* ranges )
+{
+	auto start = std::chrono::steady_clock::now();
+	
+	size_t numVisible = 0;
+	for( const Meshlet& meshlet : meshlets ) {
+		if( ! isVisible( meshlet ) ) {
+			continue;
+		}
+		++numVisible;
+		if( ! ranges->empty() && ranges->back().mFirstIndex + ranges->back().mNumIndices == meshlet.mFirstIndex ) {
+			ranges->back().mNumIndices += meshlet.mNumIndices;
+		} else {
+			ranges->push_back( MeshletRange{ meshlet.mFirstIndex, meshlet.mNumIndices } );
+		}
+	}
+	
+	mStats.mNumMeshlets += meshlets.size();
+	mStats.mNumVisible += numVisible;
+	mStats.mSeconds += std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+}
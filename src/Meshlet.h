@@ -0,0 +1,78 @@
+#pragma once
+
+#include "cinder/Vector.h"
+#include "cinder/Matrix.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace cinder {
+	class Camera;
+}
+
+namespace model {
+
+/*!
+ * A cluster of a few neighbouring triangles: a contiguous range of its section's indices with
+ * bounds tight enough to be culled as a whole, before submitting any of its triangles.
+ */
+struct Meshlet {
+	static const size_t MAX_VERTICES = 64;
+	static const size_t MAX_TRIANGLES = 124;
+	
+	uint32_t	mFirstIndex, mNumIndices;
+	uint32_t	mNumVertices;
+	//! Bounding sphere.
+	glm::vec3	mCenter;
+	float		mRadius;
+	//! Normal cone: the meshlet is back-facing when dot( normalize( mConeApex - eye ), mConeAxis ) >= mConeCutoff.
+	glm::vec3	mConeApex;
+	glm::vec3	mConeAxis;
+	float		mConeCutoff;
+	
+	/*!
+	 * Splits triangle list \a indices into meshlets of at most \a maxVertices unique vertices and \a maxTriangles triangles.
+	 * Triangles are taken in index order (which ImproveCacheLocality already makes local), so the meshlets
+	 * cover the index buffer in order and it needs no reordering.
+	 */
+	static std::vector<Meshlet> build( const glm::vec3* positions, size_t numVertices, const std::vector<uint32_t>& indices,
+									   size_t maxVertices = MAX_VERTICES, size_t maxTriangles = MAX_TRIANGLES );
+};
+
+//! A range of indices to draw, covering one or more consecutive visible meshlets.
+struct MeshletRange {
+	uint32_t	mFirstIndex, mNumIndices;
+};
+
+//! Frustum and back-face culling of meshlets, working in the meshlets' (model) space.
+class MeshletCuller {
+public:
+	struct Stats {
+		Stats() : mNumMeshlets( 0 ), mNumVisible( 0 ), mSeconds( 0.0 ) { }
+		
+		size_t	mNumMeshlets, mNumVisible;
+		double	mSeconds;
+		
+		void	merge( const Stats& stats ) { mNumMeshlets += stats.mNumMeshlets; mNumVisible += stats.mNumVisible; mSeconds += stats.mSeconds; }
+	};
+	
+	//! \a modelViewProjection maps model space to clip space, \a eye is the camera position in model space.
+	MeshletCuller( const glm::mat4& modelViewProjection, const glm::vec3& eye );
+	//! Culls for \a camera the meshlets of a mesh drawn with \a modelMatrix.
+	MeshletCuller( const ci::Camera& camera, const glm::mat4& modelMatrix );
+	
+	bool			isVisible( const Meshlet& meshlet ) const;
+	//! Appends to \a ranges the indices of the visible \a meshlets, merging adjacent ones into a single range.
+	void			cull( const std::vector<Meshlet>& meshlets, std::vector<MeshletRange>* ranges );
+	
+	//! Totals over every cull() call of this culler.
+	const Stats&	getStats() const { return mStats; }
+private:
+	void			setPlanes( const glm::mat4& modelViewProjection );
+	
+	glm::vec4		mPlanes[6];
+	glm::vec3		mEye;
+	Stats			mStats;
+};
+
+} //end namespace model
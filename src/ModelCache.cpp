@@ -0,0 +1,627 @@
+#include "ModelCache.h"
+#include "Node.h"
+#include "AnimTrack.h"
+#include "SampledClip.h"
+#include "SurfacePool.h"
+
+#include "cinder/Log.h"
+#include "cinder/Noncopyable.h"
+
+#include <cstring>
+#include <fstream>
+
+#if defined( CINDER_MSW )
+	#if ! defined( NOMINMAX )
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+#elif ! defined( CINDER_UWP )
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+using namespace model;
+
+namespace {
+	const char		MAGIC[4] = { 'C', 'I', 'M', 'C' };
+	const uint32_t	ENDIAN_TAG = 0x01020304;
+	//! Alignment of every array in the file, enough for SIMD loads of the attribute streams.
+	const size_t	ALIGNMENT = 16;
+	
+	struct Header {
+		char		mMagic[4];
+		uint32_t	mVersion;
+		uint32_t	mEndianTag;
+		uint32_t	mReserved;
+		uint64_t	mKey;
+	};
+	
+	//! Read-only view of a whole file, memory-mapped where the platform allows it.
+	class MappedFile : public ci::Noncopyable {
+	public:
+		explicit MappedFile( const ci::fs::path& path );
+		~MappedFile() { release(); }
+		
+		const uint8_t*	getData() const { return mData; }
+		size_t			getSize() const { return mSize; }
+	private:
+		void			release();
+		
+		const uint8_t*			mData;
+		size_t					mSize;
+#if defined( CINDER_MSW )
+		HANDLE					mFile, mMapping;
+#elif defined( CINDER_UWP )
+		std::vector<uint8_t>	mContents;
+#endif
+	};
+	
+#if defined( CINDER_MSW )
+	MappedFile::MappedFile( const ci::fs::path& path )
+	: mData( nullptr ), mSize( 0 ), mFile( INVALID_HANDLE_VALUE ), mMapping( nullptr )
+	{
+		mFile = ::CreateFileW( path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+		LARGE_INTEGER size;
+		if( mFile != INVALID_HANDLE_VALUE && ::GetFileSizeEx( mFile, &size ) && size.QuadPart > 0 ) {
+			mSize = size_t( size.QuadPart );
+			mMapping = ::CreateFileMappingW( mFile, nullptr, PAGE_READONLY, 0, 0, nullptr );
+			if( mMapping ) {
+				mData = static_cast<const uint8_t*>( ::MapViewOfFile( mMapping, FILE_MAP_READ, 0, 0, 0 ) );
+			}
+		}
+		if( ! mData ) {
+			release();
+			throw LoadErrorException( "Cannot map " + path.string() );
+		}
+	}
+	
+	void MappedFile::release()
+	{
+		if( mData )
+			::UnmapViewOfFile( mData );
+		if( mMapping )
+			::CloseHandle( mMapping );
+		if( mFile != INVALID_HANDLE_VALUE )
+			::CloseHandle( mFile );
+		mData = nullptr;
+		mMapping = nullptr;
+		mFile = INVALID_HANDLE_VALUE;
+	}
+#elif defined( CINDER_UWP )
+	// No file mapping for packaged apps: read the file instead.
+	MappedFile::MappedFile( const ci::fs::path& path )
+	: mData( nullptr ), mSize( 0 )
+	{
+		std::ifstream stream( path.wstring(), std::ios::binary );
+		mContents.assign( std::istreambuf_iterator<char>( stream ), std::istreambuf_iterator<char>() );
+		if( ! stream || mContents.empty() )
+			throw LoadErrorException( "Cannot read " + path.string() );
+		mData = mContents.data();
+		mSize = mContents.size();
+	}
+	
+	void MappedFile::release()
+	{
+	}
+#else
+	MappedFile::MappedFile( const ci::fs::path& path )
+	: mData( nullptr ), mSize( 0 )
+	{
+		int fd = ::open( path.string().c_str(), O_RDONLY );
+		struct stat info;
+		if( fd >= 0 && ::fstat( fd, &info ) == 0 && info.st_size > 0 ) {
+			void* data = ::mmap( nullptr, size_t( info.st_size ), PROT_READ, MAP_PRIVATE, fd, 0 );
+			if( data != MAP_FAILED ) {
+				mData = static_cast<const uint8_t*>( data );
+				mSize = size_t( info.st_size );
+			}
+		}
+		// The mapping stays valid once the descriptor is closed.
+		if( fd >= 0 )
+			::close( fd );
+		if( ! mData )
+			throw LoadErrorException( "Cannot map " + path.string() );
+	}
+	
+	void MappedFile::release()
+	{
+		if( mData )
+			::munmap( const_cast<uint8_t*>( mData ), mSize );
+		mData = nullptr;
+	}
+#endif
+	
+	size_t countNodes( const NodeRef& node )
+	{
+		size_t count = 1;
+		for( const auto& child : node->getChildren() ) {
+			count += countNodes( child );
+		}
+		return count;
+	}
+} // anonymous namespace
+
+class ModelCache::Writer {
+public:
+	template<typename T>
+	void write( const T& value ) { append( &value, sizeof( T ) ); }
+	void writeString( const std::string& str )
+	{
+		write<uint32_t>( uint32_t( str.size() ) );
+		append( str.data(), str.size() );
+	}
+	template<typename T>
+	void writeArray( const T* data, size_t count )
+	{
+		write<uint64_t>( count );
+		align();
+		append( data, count * sizeof( T ) );
+	}
+	template<typename T>
+	void writeArray( const std::vector<T>& values ) { writeArray( values.data(), values.size() ); }
+	template<typename T>
+	void writeArray( const AttribArray<T>& values ) { writeArray( values.data(), values.size() ); }
+	
+	const std::vector<uint8_t>& getData() const { return mData; }
+private:
+	void align() { mData.resize( ( mData.size() + ALIGNMENT - 1 ) / ALIGNMENT * ALIGNMENT, 0 ); }
+	void append( const void* data, size_t size )
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>( data );
+		mData.insert( mData.end(), bytes, bytes + size );
+	}
+	
+	std::vector<uint8_t> mData;
+};
+
+//! Bounds-checked reads; arrays are returned in place.
+class ModelCache::Reader {
+public:
+	Reader( const uint8_t* data, size_t size ) : mData( data ), mSize( size ), mPosition( 0 ) { }
+	
+	template<typename T>
+	T read()
+	{
+		T value;
+		std::memcpy( &value, take( sizeof( T ) ), sizeof( T ) );
+		return value;
+	}
+	std::string readString()
+	{
+		uint32_t size = read<uint32_t>();
+		return std::string( reinterpret_cast<const char*>( take( size ) ), size );
+	}
+	template<typename T>
+	const T* readArray( size_t* count )
+	{
+		uint64_t size = read<uint64_t>();
+		align();
+		if( size > ( mSize - mPosition ) / sizeof( T ) )
+			throw LoadErrorException( "Truncated model cache." );
+		*count = size_t( size );
+		return reinterpret_cast<const T*>( take( *count * sizeof( T ) ) );
+	}
+	template<typename T>
+	std::vector<T> readVector()
+	{
+		size_t count;
+		const T* data = readArray<T>( &count );
+		return std::vector<T>( data, data + count );
+	}
+	template<typename T>
+	void readAttrib( AttribArray<T>* attrib, const std::shared_ptr<const void>& storage )
+	{
+		size_t count;
+		const T* data = readArray<T>( &count );
+		if( count > 0 ) {
+			attrib->alias( data, count, storage );
+		}
+	}
+private:
+	const uint8_t* take( size_t size )
+	{
+		if( size > mSize - mPosition )
+			throw LoadErrorException( "Truncated model cache." );
+		const uint8_t* data = mData + mPosition;
+		mPosition += size;
+		return data;
+	}
+	void align()
+	{
+		mPosition = ( mPosition + ALIGNMENT - 1 ) / ALIGNMENT * ALIGNMENT;
+		if( mPosition > mSize )
+			throw LoadErrorException( "Truncated model cache." );
+	}
+	
+	const uint8_t*	mData;
+	size_t			mSize, mPosition;
+};
+
+uint64_t ModelCache::computeKey( const std::vector<ci::fs::path>& files, const std::string& options )
+{
+	// 64-bit FNV-1a
+	uint64_t hash = 14695981039346656037ULL;
+	auto mix = [&hash] ( const void* data, size_t size ) {
+		const uint8_t* bytes = static_cast<const uint8_t*>( data );
+		for( size_t i = 0; i < size; ++i ) {
+			hash ^= bytes[i];
+			hash *= 1099511628211ULL;
+		}
+	};
+	
+	const uint32_t version = VERSION;
+	mix( &version, sizeof( version ) );
+	mix( options.data(), options.size() );
+	
+	std::vector<char> chunk( 1 << 16 );
+	for( const auto& file : files ) {
+		std::ifstream stream( file.string(), std::ios::binary );
+		if( ! stream )
+			throw LoadErrorException( "Cannot read " + file.string() );
+		while( stream ) {
+			stream.read( chunk.data(), chunk.size() );
+			mix( chunk.data(), size_t( stream.gcount() ) );
+		}
+		// Keeps bytes moving from one file to the next from producing the same key.
+		const uint8_t separator = 0xFF;
+		mix( &separator, sizeof( separator ) );
+	}
+	return hash;
+}
+
+template<typename T>
+void ModelCache::writeCurve( Writer& out, const AnimCurve<T>& curve )
+{
+	out.write( curve.mStartTime );
+	out.write( curve.mEndTime );
+	out.write( curve.mVirtualDuration );
+	out.write( curve.mAverageFrameDuration );
+	out.writeArray( curve.mTimes );
+	out.writeArray( curve.mValues );
+	out.writeArray( curve.mPacked );
+	out.write( curve.mRangeMin );
+	out.write( curve.mRangeExtent );
+}
+
+template<typename T>
+void ModelCache::readCurve( Reader& in, AnimCurve<T>* curve )
+{
+	curve->mStartTime = in.read<float>();
+	curve->mEndTime = in.read<float>();
+	curve->mVirtualDuration = in.read<float>();
+	curve->mAverageFrameDuration = in.read<float>();
+	curve->mTimes = in.readVector<float>();
+	curve->mValues = in.readVector<T>();
+	curve->mPacked = in.readVector<uint16_t>();
+	for( int c = 0; c < 3; ++c ) {
+		curve->mRangeMin[c] = in.read<float>();
+	}
+	for( int c = 0; c < 3; ++c ) {
+		curve->mRangeExtent[c] = in.read<float>();
+	}
+	const size_t numValues = curve->mPacked.empty() ? curve->mValues.size() : curve->mPacked.size() / 3;
+	if( curve->mTimes.size() != numValues || curve->mPacked.size() % 3 != 0 )
+		throw LoadErrorException( "Corrupt model cache." );
+}
+
+void ModelCache::writeNode( Writer& out, const NodeRef& node, int32_t parentIndex, int32_t* nextIndex, const std::unordered_map<std::string, NodeRef>& bones )
+{
+	const int32_t index = (*nextIndex)++;
+	out.writeString( node->getName() );
+	out.write<int32_t>( parentIndex );
+	out.write<uint32_t>( uint32_t( node->getLevel() ) );
+	out.write( node->getInitialRelativePosition() );
+	out.write( node->getInitialRelativeRotation() );
+	out.write( node->getInitialRelativeScale() );
+	out.write<uint32_t>( uint32_t( node->getBoneIndex() ) );
+	auto bone = bones.find( node->getName() );
+	out.write<uint8_t>( bone != bones.end() && bone->second == node );
+	out.write<uint8_t>( node->getOffset() != nullptr );
+	if( node->getOffset() ) {
+		out.write( *node->getOffset() );
+	}
+	
+	out.write<uint32_t>( uint32_t( node->mAnimTracks.size() ) );
+	for( const auto& kv : node->mAnimTracks ) {
+		const AnimTrack& track = *kv.second;
+		out.write<int32_t>( kv.first );
+		out.write( track.getAnimDuration() );
+		out.write( track.getAnimTicksPerSecond() );
+		writeCurve( out, *track.mTranslationCurve );
+		writeCurve( out, *track.mRotationCurve );
+		writeCurve( out, *track.mScalingCurve );
+	}
+	
+	for( const auto& child : node->getChildren() ) {
+		writeNode( out, child, index, nextIndex, bones );
+	}
+}
+
+void ModelCache::writeMaterial( Writer& out, const MaterialSource& material )
+{
+	out.write<uint8_t>( material.mTwoSided );
+	out.write<uint32_t>( material.mWrapS );
+	out.write<uint32_t>( material.mWrapT );
+	out.write( material.mMaterial.getAmbient() );
+	out.write( material.mMaterial.getDiffuse() );
+	out.write( material.mMaterial.getSpecular() );
+	out.write( material.mMaterial.getEmission() );
+	out.write( material.mMaterial.getShininess() );
+	out.write<uint32_t>( material.mMaterial.getFace() );
+	
+	out.write<uint32_t>( uint32_t( material.mTexturePaths.size() ) );
+	for( const auto& kv : material.mTexturePaths ) {
+		out.write<uint32_t>( kv.first );
+		out.writeString( kv.second.string() );
+	}
+}
+
+MaterialSource ModelCache::readMaterial( Reader& in, const std::shared_ptr<SurfacePool>& surfaces, const DataSourceResolver& resolver )
+{
+	MaterialSource material;
+	material.mTwoSided = in.read<uint8_t>() != 0;
+	material.mWrapS = in.read<uint32_t>();
+	material.mWrapT = in.read<uint32_t>();
+	material.mMaterial.setAmbient( in.read<ci::ColorA>() );
+	material.mMaterial.setDiffuse( in.read<ci::ColorA>() );
+	material.mMaterial.setSpecular( in.read<ci::ColorA>() );
+	material.mMaterial.setEmission( in.read<ci::ColorA>() );
+	material.mMaterial.setShininess( in.read<float>() );
+	material.mMaterial.setFace( in.read<uint32_t>() );
+	
+	uint32_t numTextures = in.read<uint32_t>();
+	for( uint32_t t = 0; t < numTextures; ++t ) {
+		auto type = static_cast<MaterialSource::TextureType>( in.read<uint32_t>() );
+		ci::fs::path texturePath = in.readString();
+		
+		ci::DataSourceRef textureSource = resolver ? resolver( texturePath ) : nullptr;
+		if( resolver ? textureSource != nullptr : ci::fs::exists( texturePath ) ) {
+			material.mSurfaces[type] = surfaces->loadSurface( texturePath, textureSource );
+			material.mTexturePaths[type] = texturePath;
+		}
+	}
+	return material;
+}
+
+void ModelCache::write( const ci::fs::path& cachePath, uint64_t key, const Source& source )
+{
+	Writer out;
+	
+	Header header;
+	std::memcpy( header.mMagic, MAGIC, sizeof( MAGIC ) );
+	header.mVersion = VERSION;
+	header.mEndianTag = ENDIAN_TAG;
+	header.mReserved = 0;
+	header.mKey = key;
+	out.write( header );
+	
+	// Node hierarchy, written parents first
+	if( source.mRootNode ) {
+		out.write<uint32_t>( uint32_t( countNodes( source.mRootNode ) ) );
+		int32_t nextIndex = 0;
+		writeNode( out, source.mRootNode, -1, &nextIndex, source.mBones );
+	} else {
+		out.write<uint32_t>( 0 );
+	}
+	
+	out.write<uint32_t>( uint32_t( source.mAnimInfos.size() ) );
+	for( const auto& animInfo : source.mAnimInfos ) {
+		out.write( animInfo.getDuration() );
+		out.write( animInfo.getTicksPerSecond() );
+		out.writeString( animInfo.getName() );
+		out.write( animInfo.getCompressionStats() );
+	}
+	
+	out.write<uint32_t>( uint32_t( source.mSampledClips.size() ) );
+	for( const auto& clip : source.mSampledClips ) {
+		out.write( clip->mFrameRate );
+		out.write( clip->mPeriod );
+		out.write<uint32_t>( uint32_t( clip->mNumFrames ) );
+		out.write<uint32_t>( uint32_t( clip->mChannelNames.size() ) );
+		for( const auto& name : clip->mChannelNames ) {
+			out.writeString( name );
+		}
+		out.writeArray( clip->mSamples );
+	}
+	
+	out.write<uint32_t>( uint32_t( source.mSectionSources.size() ) );
+	for( const auto& section : source.mSectionSources ) {
+		out.writeString( section->mName );
+		out.write( section->mDefaultTransformation );
+		writeMaterial( out, section->mMaterialSource );
+		out.writeArray( section->mIndices );
+		out.writeArray( section->mPositions );
+		out.writeArray( section->mNormals );
+		out.writeArray( section->mTangents );
+		out.writeArray( section->mBitangents );
+		out.writeArray( section->mTexCoords );
+		out.writeArray( section->mColors );
+		out.writeArray( section->mBoneIndices );
+		out.writeArray( section->mBoneWeights );
+		std::vector<uint8_t> numWeights;
+		numWeights.reserve( section->mWeights.size() );
+		for( const auto& weights : section->mWeights ) {
+			numWeights.push_back( uint8_t( weights.getNumActiveWeights() ) );
+		}
+		out.writeArray( numWeights );
+		out.writeArray( section->mMeshlets );
+		out.write<uint32_t>( uint32_t( section->mLods.size() ) );
+		for( const auto& lod : section->mLods ) {
+			out.writeArray( lod.mIndices );
+			out.write( lod.mError );
+			out.write( lod.mSeconds );
+		}
+		out.write<uint32_t>( uint32_t( section->mMorphTargets.size() ) );
+		for( const auto& target : section->mMorphTargets ) {
+			out.writeArray( target.mRuns );
+			out.writeArray( target.mOffsets );
+		}
+	}
+	
+	// Write next to the destination then swap, so that readers never see a partial file.
+	ci::fs::path tempPath = cachePath;
+	tempPath += ".tmp";
+	{
+		std::ofstream stream( tempPath.string(), std::ios::binary | std::ios::trunc );
+		stream.write( reinterpret_cast<const char*>( out.getData().data() ), out.getData().size() );
+		if( ! stream )
+			throw ModelIoException( "Cannot write model cache " + tempPath.string() );
+	}
+	ci::fs::rename( tempPath, cachePath );
+}
+
+bool ModelCache::read( const ci::fs::path& cachePath, uint64_t key, Source* source, const std::shared_ptr<SurfacePool>& surfaces, const DataSourceResolver& resolver )
+{
+	if( ! ci::fs::exists( cachePath ) ) {
+		return false;
+	}
+	
+	try {
+		std::shared_ptr<MappedFile> file( new MappedFile( cachePath ) );
+		Reader in( file->getData(), file->getSize() );
+		
+		Header header = in.read<Header>();
+		if( std::memcmp( header.mMagic, MAGIC, sizeof( MAGIC ) ) != 0 || header.mVersion != VERSION
+		   || header.mEndianTag != ENDIAN_TAG || header.mKey != key ) {
+			CI_LOG_I( "Model cache " << cachePath << " is out of date." );
+			return false;
+		}
+		
+		std::vector<NodeRef> nodes( in.read<uint32_t>() );
+		std::unordered_map<std::string, NodeRef> bones;
+		std::vector<NodeRef> bonesByIndex;
+		for( size_t n = 0; n < nodes.size(); ++n ) {
+			std::string name = in.readString();
+			int32_t parentIndex = in.read<int32_t>();
+			uint32_t level = in.read<uint32_t>();
+			glm::vec3 position = in.read<glm::vec3>();
+			glm::quat rotation = in.read<glm::quat>();
+			glm::vec3 scale = in.read<glm::vec3>();
+			if( parentIndex >= int32_t( n ) || ( parentIndex < 0 && n > 0 ) )
+				throw LoadErrorException( "Corrupt model cache." );
+			
+			NodeRef parent = ( parentIndex >= 0 ) ? nodes[parentIndex] : nullptr;
+			NodeRef node = Node::create( position, rotation, scale, name, parent, level );
+			if( parent ) {
+				parent->addChild( node );
+			}
+			node->setBoneIndex( in.read<uint32_t>() );
+			if( in.read<uint8_t>() ) {
+				bones[name] = node;
+				if( bonesByIndex.size() <= node->getBoneIndex() )
+					bonesByIndex.resize( node->getBoneIndex() + 1 );
+				bonesByIndex[node->getBoneIndex()] = node;
+			}
+			if( in.read<uint8_t>() ) {
+				node->setOffsetMatrix( in.read<glm::mat4>() );
+			}
+			
+			uint32_t numTracks = in.read<uint32_t>();
+			for( uint32_t t = 0; t < numTracks; ++t ) {
+				int32_t trackId = in.read<int32_t>();
+				float duration = in.read<float>();
+				float ticksPerSecond = in.read<float>();
+				auto track = AnimTrack::create( duration, ticksPerSecond );
+				readCurve( in, track->mTranslationCurve.get() );
+				readCurve( in, track->mRotationCurve.get() );
+				readCurve( in, track->mScalingCurve.get() );
+				node->mAnimTracks[trackId] = track;
+			}
+			nodes[n] = node;
+		}
+		
+		std::vector<AnimInfo> animInfos( in.read<uint32_t>() );
+		for( auto& animInfo : animInfos ) {
+			float duration = in.read<float>();
+			float ticksPerSecond = in.read<float>();
+			animInfo = AnimInfo( duration, ticksPerSecond, in.readString() );
+			animInfo.setCompressionStats( in.read<AnimCompressionStats>() );
+		}
+		
+		std::vector<SampledClipRef> sampledClips( in.read<uint32_t>() );
+		for( auto& clip : sampledClips ) {
+			clip.reset( new SampledClip );
+			clip->mFrameRate = in.read<float>();
+			clip->mPeriod = in.read<float>();
+			clip->mNumFrames = in.read<uint32_t>();
+			clip->mChannelNames.resize( in.read<uint32_t>() );
+			for( auto& name : clip->mChannelNames ) {
+				name = in.readString();
+			}
+			clip->mSamples = in.readVector<SampledClip::Sample>();
+			if( clip->mNumFrames < 2 || clip->mSamples.size() != clip->mNumFrames * clip->mChannelNames.size() )
+				throw LoadErrorException( "Corrupt model cache." );
+		}
+		
+		// Sections alias the vertex streams in the mapping, which they keep alive.
+		std::shared_ptr<const void> storage = file;
+		std::vector<SectionSourceRef> sections( in.read<uint32_t>() );
+		for( auto& section : sections ) {
+			section = std::make_shared<SectionSource>();
+			section->mName = in.readString();
+			section->mDefaultTransformation = in.read<glm::mat4>();
+			section->mMaterialSource = readMaterial( in, surfaces, resolver );
+			section->mIndices = in.readVector<uint32_t>();
+			in.readAttrib( &section->mPositions, storage );
+			in.readAttrib( &section->mNormals, storage );
+			in.readAttrib( &section->mTangents, storage );
+			in.readAttrib( &section->mBitangents, storage );
+			in.readAttrib( &section->mTexCoords, storage );
+			section->mColors = in.readVector<ci::Colorf>();
+			section->mBoneIndices = in.readVector<glm::vec4>();
+			section->mBoneWeights = in.readVector<glm::vec4>();
+			
+			auto numWeights = in.readVector<uint8_t>();
+			if( numWeights.size() != section->mBoneIndices.size() || numWeights.size() != section->mBoneWeights.size() )
+				throw LoadErrorException( "Corrupt model cache." );
+			section->mWeights.resize( numWeights.size() );
+			for( size_t v = 0; v < numWeights.size(); ++v ) {
+				for( uint8_t b = 0; b < numWeights[v] && b < Weights::NB_WEIGHTS; ++b ) {
+					size_t boneIndex = size_t( section->mBoneIndices[v][b] );
+					if( boneIndex >= bonesByIndex.size() || ! bonesByIndex[boneIndex] )
+						throw LoadErrorException( "Corrupt model cache." );
+					section->mWeights[v].addWeight( bonesByIndex[boneIndex], section->mBoneWeights[v][b] );
+				}
+			}
+			
+			section->updateBounds();
+			section->mMeshlets = in.readVector<Meshlet>();
+			for( const auto& meshlet : section->mMeshlets ) {
+				if( size_t( meshlet.mFirstIndex ) + meshlet.mNumIndices > section->mIndices.size() )
+					throw LoadErrorException( "Corrupt model cache." );
+			}
+			section->mLods.resize( in.read<uint32_t>() );
+			for( auto& lod : section->mLods ) {
+				lod.mIndices = in.readVector<uint32_t>();
+				lod.mError = in.read<float>();
+				lod.mSeconds = in.read<double>();
+			}
+			section->mMorphTargets.resize( in.read<uint32_t>() );
+			for( auto& target : section->mMorphTargets ) {
+				target.mRuns = in.readVector<MorphTarget::Run>();
+				target.mOffsets = in.readVector<glm::vec3>();
+				size_t numOffsets = 0;
+				for( const auto& run : target.mRuns ) {
+					if( size_t( run.mFirstVertex ) + run.mNumVertices > section->mPositions.size() )
+						throw LoadErrorException( "Corrupt model cache." );
+					numOffsets += run.mNumVertices;
+				}
+				if( numOffsets != target.mOffsets.size() )
+					throw LoadErrorException( "Corrupt model cache." );
+			}
+		}
+		
+		source->mRootNode = nodes.empty() ? nullptr : nodes.front();
+		source->mBones = std::move( bones );
+		source->mAnimInfos = std::move( animInfos );
+		source->mSampledClips = std::move( sampledClips );
+		source->mSectionSources = std::move( sections );
+	}
+	catch( const std::exception& exc ) {
+		CI_LOG_W( "Ignoring model cache " << cachePath << ": " << exc.what() );
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "ModelIo.h"
+#include "DataSourceIOSystem.h"
+
+#include "cinder/Filesystem.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace model {
+
+class SurfacePool;
+template<typename T> class AnimCurve;
+
+/*!
+ * Binary snapshot of a model::Source: sections (attributes, indices, materials, morph targets),
+ * node hierarchy with its animation curves, and animation infos.
+ *
+ * The file is memory-mapped when read back. Vertex attribute streams are 16-byte aligned and
+ * used in place by the sections, which keep the mapping alive; everything else is small and copied.
+ * The format stores native-endian data and is only meant as a local cache, not as an exchange format.
+ */
+class ModelCache {
+public:
+	//! Bump whenever the layout of the file or of the cached data changes.
+	static const uint32_t VERSION = 6;
+	
+	//! Hashes the contents of \a files together with \a options (import flags...) and the format version.
+	static uint64_t	computeKey( const std::vector<ci::fs::path>& files, const std::string& options );
+	
+	/*!
+	 * Fills \a source from \a cachePath if it exists and was written with the same \a key.
+	 * Textures are decoded through \a surfaces, from the file system or \a resolver if set.
+	 * Returns false (leaving \a source untouched) if the cache is missing, stale or corrupt.
+	 */
+	static bool		read( const ci::fs::path& cachePath, uint64_t key, Source* source, const std::shared_ptr<SurfacePool>& surfaces, const DataSourceResolver& resolver = DataSourceResolver() );
+	//! Writes \a source to \a cachePath, atomically replacing any previous cache.
+	static void		write( const ci::fs::path& cachePath, uint64_t key, const Source& source );
+private:
+	class Writer;
+	class Reader;
+	
+	template<typename T>
+	static void				writeCurve( Writer& out, const AnimCurve<T>& curve );
+	template<typename T>
+	static void				readCurve( Reader& in, AnimCurve<T>* curve );
+	static void				writeNode( Writer& out, const std::shared_ptr<Node>& node, int32_t parentIndex, int32_t* nextIndex, const std::unordered_map<std::string, std::shared_ptr<Node>>& bones );
+	static void				writeMaterial( Writer& out, const MaterialSource& material );
+	static MaterialSource	readMaterial( Reader& in, const std::shared_ptr<SurfacePool>& surfaces, const DataSourceResolver& resolver );
+};
+
+} //end namespace model
@@ -2,6 +2,11 @@
 #include "ModelIo.h"
 #include "Node.h"
 
+#include "cinder/Log.h"
+
+#include <algorithm>
+#include <limits>
+
 
 namespace cinder {
 	
@@ -16,6 +21,12 @@ namespace cinder {
 	{
 	}
 	
+	bool Material::operator==( const Material& rhs ) const
+	{
+		return mAmbient == rhs.mAmbient && mDiffuse == rhs.mDiffuse && mSpecular == rhs.mSpecular
+			&& mShininess == rhs.mShininess && mEmission == rhs.mEmission && mFace == rhs.mFace;
+	}
+	
 } // namespace
 
 using namespace model;
@@ -74,16 +85,6 @@ bool SectionSource::hasAttrib( ci::geom::Attrib attr ) const
 		case ci::geom::Attrib::BITANGENT: return ! mBitangents.empty(); break;
 		case ci::geom::Attrib::BONE_INDEX: return  ! mBoneIndices.empty(); break;
 		case ci::geom::Attrib::BONE_WEIGHT: return ! mBoneWeights.empty(); break;
-		case ci::geom::Attrib::CUSTOM_0: return mMorphOffsets.size() > 0 && !mMorphOffsets.at( 0 ).empty(); break;
-		case ci::geom::Attrib::CUSTOM_1: return mMorphOffsets.size() > 1 && !mMorphOffsets.at( 1 ).empty(); break;
-		case ci::geom::Attrib::CUSTOM_2: return mMorphOffsets.size() > 2 && !mMorphOffsets.at( 2 ).empty(); break;
-		case ci::geom::Attrib::CUSTOM_3: return mMorphOffsets.size() > 3 && !mMorphOffsets.at( 3 ).empty(); break;
-		case ci::geom::Attrib::CUSTOM_4: return mMorphOffsets.size() > 4 && !mMorphOffsets.at( 4 ).empty(); break;
-		case ci::geom::Attrib::CUSTOM_5: return mMorphOffsets.size() > 5 && !mMorphOffsets.at( 5 ).empty(); break;
-		case ci::geom::Attrib::CUSTOM_6: return mMorphOffsets.size() > 6 && !mMorphOffsets.at( 6 ).empty(); break;
-		case ci::geom::Attrib::CUSTOM_7: return mMorphOffsets.size() > 7 && !mMorphOffsets.at( 7 ).empty(); break;
-		case ci::geom::Attrib::CUSTOM_8: return mMorphOffsets.size() > 8 && !mMorphOffsets.at( 8 ).empty(); break;
-		case ci::geom::Attrib::CUSTOM_9: return mMorphOffsets.size() > 9 && !mMorphOffsets.at( 9 ).empty(); break;
 		default:
 			return false;
 	}
@@ -103,16 +104,6 @@ uint8_t SectionSource::getAttribDims( ci::geom::Attrib attr ) const
 		case ci::geom::Attrib::BITANGENT: return 3;
 		case ci::geom::Attrib::BONE_INDEX: return 4;
 		case ci::geom::Attrib::BONE_WEIGHT: return 4;
-		case ci::geom::Attrib::CUSTOM_0: return 3;
-		case ci::geom::Attrib::CUSTOM_1: return 3;
-		case ci::geom::Attrib::CUSTOM_2: return 3;
-		case ci::geom::Attrib::CUSTOM_3: return 3;
-		case ci::geom::Attrib::CUSTOM_4: return 3;
-		case ci::geom::Attrib::CUSTOM_5: return 3;
-		case ci::geom::Attrib::CUSTOM_6: return 3;
-		case ci::geom::Attrib::CUSTOM_7: return 3;
-		case ci::geom::Attrib::CUSTOM_8: return 3;
-		case ci::geom::Attrib::CUSTOM_9: return 3;
 		default:
 			return 0;
 	}
@@ -140,12 +131,339 @@ void SectionSource::loadInto( ci::geom::Target *target, const ci::geom::AttribSe
 	// copy indices
 	if( getNumIndices() )
 		target->copyIndices( ci::geom::Primitive::TRIANGLES, mIndices.data(), getNumIndices(), 4 /* bytes per index */ );
+}
+
+void SectionSource::updateBounds()
+{
+	if( mPositions.empty() ) {
+		mBounds = ci::AxisAlignedBox();
+		mBoneBounds.clear();
+		return;
+	}
+	
+	glm::vec3 lower( std::numeric_limits<float>::max() ), upper( -std::numeric_limits<float>::max() );
+	for( const auto& position : mPositions ) {
+		lower = glm::min( lower, position );
+		upper = glm::max( upper, position );
+	}
+	mBounds = ci::AxisAlignedBox( lower, upper );
+	
+	// Bone slots are few: index them directly rather than through a map.
+	std::vector<BoneBounds> bounds;
+	const size_t numWeighted = std::min( mPositions.size(), std::min( mBoneIndices.size(), mBoneWeights.size() ) );
+	for( size_t v = 0; v < numWeighted; ++v ) {
+		for( int i = 0; i < 4; ++i ) {
+			if( mBoneWeights[v][i] <= 0.0f ) {
+				continue;
+			}
+			size_t bone = size_t( mBoneIndices[v][i] );
+			if( bone >= bounds.size() ) {
+				bounds.resize( bone + 1, BoneBounds{ 0, glm::vec3( std::numeric_limits<float>::max() ), glm::vec3( -std::numeric_limits<float>::max() ) } );
+			}
+			bounds[bone].mMin = glm::min( bounds[bone].mMin, mPositions[v] );
+			bounds[bone].mMax = glm::max( bounds[bone].mMax, mPositions[v] );
+		}
+	}
+	mBoneBounds.clear();
+	for( size_t bone = 0; bone < bounds.size(); ++bone ) {
+		if( bounds[bone].mMin.x <= bounds[bone].mMax.x ) {
+			bounds[bone].mBoneIndex = uint32_t( bone );
+			mBoneBounds.push_back( bounds[bone] );
+		}
+	}
+}
 
-	for( int i = 0; i < 10; ++i ) {
-		auto attrib = static_cast<ci::geom::Attrib>( size_t( ci::geom::Attrib::CUSTOM_0 ) + i );
-		if( getAttribDims( attrib ) )
-			target->copyAttrib( attrib, getAttribDims( attrib ), 0, (const float*)mMorphOffsets.at( i ).data(), std::min( mMorphOffsets.at( i ).size(), mPositions.size() ) );
+ci::AxisAlignedBox SectionSource::calcSkinnedBounds( const std::vector<BoneBounds>& boneBounds, const glm::mat4* skinningMatrices, size_t numMatrices )
+{
+	// Skinned vertices are convex combinations of their bones' transforms, hence inside the union of the transformed boxes.
+	glm::vec3 lower( std::numeric_limits<float>::max() ), upper( -std::numeric_limits<float>::max() );
+	for( const auto& bounds : boneBounds ) {
+		if( bounds.mBoneIndex >= numMatrices ) {
+			continue;
+		}
+		ci::AxisAlignedBox box = ci::AxisAlignedBox( bounds.mMin, bounds.mMax ).transformed( skinningMatrices[bounds.mBoneIndex] );
+		lower = glm::min( lower, box.getMin() );
+		upper = glm::max( upper, box.getMax() );
+	}
+	return ( lower.x <= upper.x ) ? ci::AxisAlignedBox( lower, upper ) : ci::AxisAlignedBox();
+}
+
+bool SectionSource::canMergeWith( const SectionSource& other ) const
+{
+	auto isPlain = [] ( const SectionSource& section ) {
+		return section.mBoneWeights.empty() && section.mMorphTargets.empty() && section.mMeshlets.empty() && section.mLods.empty();
+	};
+	const MaterialSource& lhs = mMaterialSource;
+	const MaterialSource& rhs = other.mMaterialSource;
+	return isPlain( *this ) && isPlain( other )
+		&& lhs.mMaterial == rhs.mMaterial && lhs.mSurfaces == rhs.mSurfaces && lhs.mWrapS == rhs.mWrapS && lhs.mWrapT == rhs.mWrapT && lhs.mTwoSided == rhs.mTwoSided
+		&& mNormals.empty() == other.mNormals.empty() && mTangents.empty() == other.mTangents.empty() && mBitangents.empty() == other.mBitangents.empty()
+		&& mTexCoords.empty() == other.mTexCoords.empty() && mColors.empty() == other.mColors.empty();
+}
+
+SectionSourceRef SectionSource::merge( const std::vector<SectionSourceRef>& sources )
+{
+	CI_ASSERT( ! sources.empty() );
+	const SectionSource& first = *sources.front();
+	SectionSourceRef merged( new SectionSource );
+	merged->mName = first.mName;
+	merged->mMaterialSource = first.mMaterialSource;
+	
+	std::vector<glm::vec3> positions, normals, tangents, bitangents;
+	std::vector<glm::vec2> texCoords;
+	for( const auto& source : sources ) {
+		CI_ASSERT( first.canMergeWith( *source ) );
+		const glm::mat4& transform = source->mDefaultTransformation;
+		const glm::mat3 normalTransform = glm::transpose( glm::inverse( glm::mat3( transform ) ) );
+		const uint32_t offset = uint32_t( positions.size() );
+		
+		for( const auto& position : source->mPositions ) {
+			positions.push_back( glm::vec3( transform * glm::vec4( position, 1.0f ) ) );
+		}
+		for( const auto& normal : source->mNormals ) {
+			normals.push_back( glm::normalize( normalTransform * normal ) );
+		}
+		for( const auto& tangent : source->mTangents ) {
+			tangents.push_back( glm::normalize( glm::mat3( transform ) * tangent ) );
+		}
+		for( const auto& bitangent : source->mBitangents ) {
+			bitangents.push_back( glm::normalize( glm::mat3( transform ) * bitangent ) );
+		}
+		texCoords.insert( texCoords.end(), source->mTexCoords.begin(), source->mTexCoords.end() );
+		merged->mColors.insert( merged->mColors.end(), source->mColors.begin(), source->mColors.end() );
+		
+		// A mirroring transformation flips the winding, which face culling would notice.
+		const bool mirrored = glm::determinant( glm::mat3( transform ) ) < 0.0f;
+		for( size_t i = 0; i + 2 < source->mIndices.size(); i += 3 ) {
+			merged->mIndices.push_back( offset + source->mIndices[i] );
+			merged->mIndices.push_back( offset + source->mIndices[mirrored ? i + 2 : i + 1] );
+			merged->mIndices.push_back( offset + source->mIndices[mirrored ? i + 1 : i + 2] );
+		}
+	}
+	merged->mPositions = std::move( positions );
+	merged->mNormals = std::move( normals );
+	merged->mTangents = std::move( tangents );
+	merged->mBitangents = std::move( bitangents );
+	merged->mTexCoords = std::move( texCoords );
+	merged->updateBounds();
+	return merged;
+}
+
+std::vector<SectionSourceRef> SectionSource::partitionBones( const SectionSourceRef& source, size_t maxBones, std::vector<std::vector<uint32_t>>* palettes )
+{
+	const SectionSource& whole = *source;
+	const size_t numVertices = whole.mPositions.size();
+	palettes->clear();
+	if( whole.mBoneIndices.size() != numVertices || whole.mBoneWeights.size() != numVertices ) {
+		palettes->emplace_back();
+		return { source };
+	}
+	CI_ASSERT( maxBones >= size_t( 3 * Weights::NB_WEIGHTS ) );
+	
+	const uint32_t NO_SLOT = std::numeric_limits<uint32_t>::max();
+	const size_t numTriangles = whole.mIndices.size() / 3;
+	std::vector<uint32_t> slots;
+	std::vector<uint32_t> palette;
+	// The bones of the triangle of vertices \a triangle[0..2], sorted.
+	auto getBones = [&] ( const uint32_t* triangle, uint32_t* bones ) -> size_t {
+		size_t numBones = 0;
+		for( size_t k = 0; k < 3; ++k ) {
+			const uint32_t v = triangle[k];
+			for( int i = 0; i < Weights::NB_WEIGHTS; ++i ) {
+				const uint32_t bone = uint32_t( whole.mBoneIndices[v][i] );
+				if( whole.mBoneWeights[v][i] > 0.0f && std::find( bones, bones + numBones, bone ) == bones + numBones ) {
+					bones[numBones++] = bone;
+				}
+			}
+		}
+		std::sort( bones, bones + numBones );
+		return numBones;
+	};
+	
+	std::vector<uint32_t> order( numTriangles );
+	std::vector<uint32_t> firstBones( numTriangles, NO_SLOT );
+	for( size_t t = 0; t < numTriangles; ++t ) {
+		uint32_t bones[3 * Weights::NB_WEIGHTS];
+		const size_t numBones = getBones( &whole.mIndices[3 * t], bones );
+		for( size_t b = 0; b < numBones; ++b ) {
+			if( bones[b] >= slots.size() ) {
+				slots.resize( bones[b] + 1, NO_SLOT );
+			}
+			if( slots[bones[b]] == NO_SLOT ) {
+				slots[bones[b]] = uint32_t( palette.size() );
+				palette.push_back( bones[b] );
+			}
+		}
+		firstBones[t] = numBones ? bones[0] : NO_SLOT;
+		order[t] = uint32_t( t );
+	}
+	
+	std::vector<size_t> partitionEnds;
+	if( palette.size() > maxBones ) {
+		// Triangles sorted by their first bone come in runs sharing bones; a run joins the current palette unless it would overflow.
+		std::stable_sort( order.begin(), order.end(), [&] ( uint32_t lhs, uint32_t rhs ) { return firstBones[lhs] < firstBones[rhs]; } );
+		std::fill( slots.begin(), slots.end(), NO_SLOT );
+		palette.clear();
+		for( size_t o = 0; o < numTriangles; ++o ) {
+			uint32_t bones[3 * Weights::NB_WEIGHTS];
+			const size_t numBones = getBones( &whole.mIndices[3 * order[o]], bones );
+			size_t numNew = 0;
+			for( size_t b = 0; b < numBones; ++b ) {
+				numNew += ( slots[bones[b]] == NO_SLOT ) ? 1 : 0;
+			}
+			if( palette.size() + numNew > maxBones ) {
+				partitionEnds.push_back( o );
+				for( uint32_t bone : palette ) {
+					slots[bone] = NO_SLOT;
+				}
+				palettes->push_back( std::move( palette ) );
+				palette.clear();
+			}
+			for( size_t b = 0; b < numBones; ++b ) {
+				if( slots[bones[b]] == NO_SLOT ) {
+					slots[bones[b]] = uint32_t( palette.size() );
+					palette.push_back( bones[b] );
+				}
+			}
+		}
+	}
+	partitionEnds.push_back( numTriangles );
+	palettes->push_back( std::move( palette ) );
+	
+	// Vertices no triangle uses may refer to bones outside the palette: they get slot 0.
+	auto remapBones = [NO_SLOT] ( const glm::vec4& bones, const glm::vec4& weights, const std::vector<uint32_t>& slots ) -> glm::vec4 {
+		glm::vec4 remapped( 0.0f );
+		for( int i = 0; i < Weights::NB_WEIGHTS; ++i ) {
+			const size_t bone = size_t( bones[i] );
+			const bool mapped = weights[i] > 0.0f && bone < slots.size() && slots[bone] != NO_SLOT;
+			remapped[i] = mapped ? float( slots[bone] ) : 0.0f;
+		}
+		return remapped;
+	};
+	
+	if( partitionEnds.size() == 1 ) {
+		// Same vertices and indices: only the bone indices change.
+		SectionSourceRef remapped( whole.clone() );
+		for( size_t v = 0; v < numVertices; ++v ) {
+			remapped->mBoneIndices[v] = remapBones( whole.mBoneIndices[v], whole.mBoneWeights[v], slots );
+		}
+		remapped->updateBounds();
+		return { remapped };
+	}
+	
+	// Each part takes the triangles of its palette and the vertices they use.
+	struct Part {
+		SectionSourceRef		mSource;
+		//! Slot of each bone in the part's palette, and index of each vertex of the whole in the part.
+		std::vector<uint32_t>	mSlots, mVertexMap;
+		std::vector<glm::vec3>	mPositions, mNormals, mTangents, mBitangents;
+		std::vector<glm::vec2>	mTexCoords;
+	};
+	std::vector<Part> parts( partitionEnds.size() );
+	auto addVertex = [&] ( Part* part, uint32_t v ) -> uint32_t {
+		if( part->mVertexMap[v] == NO_SLOT ) {
+			SectionSource& source = *part->mSource;
+			part->mVertexMap[v] = uint32_t( part->mPositions.size() );
+			part->mPositions.push_back( whole.mPositions[v] );
+			if( whole.mNormals.size() == numVertices ) part->mNormals.push_back( whole.mNormals[v] );
+			if( whole.mTangents.size() == numVertices ) part->mTangents.push_back( whole.mTangents[v] );
+			if( whole.mBitangents.size() == numVertices ) part->mBitangents.push_back( whole.mBitangents[v] );
+			if( whole.mTexCoords.size() == numVertices ) part->mTexCoords.push_back( whole.mTexCoords[v] );
+			if( whole.mColors.size() == numVertices ) source.mColors.push_back( whole.mColors[v] );
+			if( whole.mWeights.size() == numVertices ) source.mWeights.push_back( whole.mWeights[v] );
+			source.mBoneWeights.push_back( whole.mBoneWeights[v] );
+			source.mBoneIndices.push_back( remapBones( whole.mBoneIndices[v], whole.mBoneWeights[v], part->mSlots ) );
+		}
+		return part->mVertexMap[v];
+	};
+	
+	size_t begin = 0;
+	for( size_t p = 0; p < partitionEnds.size(); ++p ) {
+		Part& part = parts[p];
+		part.mSlots.assign( slots.size(), NO_SLOT );
+		for( size_t slot = 0; slot < (*palettes)[p].size(); ++slot ) {
+			part.mSlots[(*palettes)[p][slot]] = uint32_t( slot );
+		}
+		part.mVertexMap.assign( numVertices, NO_SLOT );
+		part.mSource.reset( new SectionSource );
+		part.mSource->mName = whole.mName;
+		part.mSource->mMaterialSource = whole.mMaterialSource;
+		part.mSource->mDefaultTransformation = whole.mDefaultTransformation;
+		for( size_t i = 3 * begin; i < 3 * partitionEnds[p]; ++i ) {
+			part.mSource->mIndices.push_back( addVertex( &part, whole.mIndices[3 * order[i / 3] + i % 3] ) );
+		}
+		begin = partitionEnds[p];
+	}
+	
+	// Levels of detail index the whole's vertices: each of their triangles goes to a part whose palette has all its bones,
+	// preferably one which has its vertices already. Collapses keep bone weights close, so few triangles fit no palette:
+	// those go to the part with most of their vertices, their missing bones falling back to slot 0.
+	size_t numMisfits = 0;
+	for( size_t l = 0; l < whole.mLods.size(); ++l ) {
+		for( size_t p = 0; p < parts.size(); ++p ) {
+			Lod lod;
+			lod.mError = whole.mLods[l].mError;
+			// Simplified once, for all parts.
+			lod.mSeconds = ( p == 0 ) ? whole.mLods[l].mSeconds : 0.0;
+			parts[p].mSource->mLods.push_back( lod );
+		}
+		const std::vector<uint32_t>& indices = whole.mLods[l].mIndices;
+		for( size_t t = 0; t + 2 < indices.size(); t += 3 ) {
+			uint32_t bones[3 * Weights::NB_WEIGHTS];
+			const size_t numBones = getBones( &indices[t], bones );
+			Part* target = nullptr;
+			bool targetFits = false;
+			int targetShared = -1;
+			for( auto& part : parts ) {
+				bool fits = true;
+				for( size_t b = 0; b < numBones && fits; ++b ) {
+					fits = bones[b] < part.mSlots.size() && part.mSlots[bones[b]] != NO_SLOT;
+				}
+				int shared = 0;
+				for( size_t k = 0; k < 3; ++k ) {
+					shared += ( part.mVertexMap[indices[t + k]] != NO_SLOT ) ? 1 : 0;
+				}
+				if( ( fits && ! targetFits ) || ( fits == targetFits && shared > targetShared ) ) {
+					target = &part;
+					targetFits = fits;
+					targetShared = shared;
+				}
+			}
+			numMisfits += targetFits ? 0 : 1;
+			for( size_t k = 0; k < 3; ++k ) {
+				target->mSource->mLods[l].mIndices.push_back( addVertex( target, indices[t + k] ) );
+			}
+		}
+	}
+	if( numMisfits > 0 ) {
+		CI_LOG_W( "Section '" << whole.mName << "': " << numMisfits << " level of detail triangle(s) refer to bones of several palettes." );
+	}
+	
+	// Meshlets cover the index buffer in order, which the parts reorder: rebuild them, within the limits the whole's were built with.
+	size_t maxMeshletVertices = 0, maxMeshletTriangles = 0;
+	for( const auto& meshlet : whole.mMeshlets ) {
+		maxMeshletVertices = std::max<size_t>( maxMeshletVertices, meshlet.mNumVertices );
+		maxMeshletTriangles = std::max<size_t>( maxMeshletTriangles, meshlet.mNumIndices / 3 );
+	}
+	
+	std::vector<SectionSourceRef> sources;
+	for( auto& part : parts ) {
+		SectionSource& source = *part.mSource;
+		for( const auto& target : whole.mMorphTargets ) {
+			source.mMorphTargets.push_back( target.remapped( part.mVertexMap, part.mPositions.size() ) );
+		}
+		if( ! whole.mMeshlets.empty() ) {
+			source.mMeshlets = Meshlet::build( part.mPositions.data(), part.mPositions.size(), source.mIndices, maxMeshletVertices, maxMeshletTriangles );
+		}
+		source.mPositions = std::move( part.mPositions );
+		source.mNormals = std::move( part.mNormals );
+		source.mTangents = std::move( part.mTangents );
+		source.mBitangents = std::move( part.mBitangents );
+		source.mTexCoords = std::move( part.mTexCoords );
+		source.updateBounds();
+		sources.push_back( part.mSource );
 	}
+	return sources;
 }
 
 ci::geom::AttribSet SectionSource::getAvailableAttribs() const
@@ -5,9 +5,18 @@
 #include "cinder/GeomIo.h"
 #include "cinder/Exception.h"
 #include "cinder/CinderAssert.h"
+#include "cinder/Filesystem.h"
+#include "cinder/AxisAlignedBox.h"
+
+#include "AnimTrack.h"
+#include "Meshlet.h"
+#include "Lod.h"
+#include "MorphTarget.h"
 
 #include <array>
 #include <map>
+#include <memory>
+#include <stdexcept>
 #include <string>
 #include <unordered_map>
 
@@ -36,6 +45,9 @@ namespace cinder {
 		ColorA	getEmission() const { return mEmission; }
 		GLenum	getFace() const { return mFace; }
 		
+		bool	operator==( const Material& rhs ) const;
+		bool	operator!=( const Material& rhs ) const { return ! ( *this == rhs ); }
+		
 	protected:
 		ColorA			mAmbient;
 		ColorA			mDiffuse;
@@ -50,6 +62,8 @@ namespace model {
 	
 class Skeleton;
 typedef std::shared_ptr<Skeleton> SkeletonRef;
+class SampledClip;
+typedef std::shared_ptr<SampledClip> SampledClipRef;
 
 class Node;
 class ModelTarget;
@@ -136,9 +150,12 @@ struct MaterialSource
 	MaterialSource()
 //	: mTransparentColor( ci::Color::white() )
 //	, mUseAlpha( false )
-	: mTwoSided( false )
+	: mWrapS( GL_REPEAT ), mWrapT( GL_REPEAT )
+	, mTwoSided( false )
 	{ }
 	std::map<TextureType, std::shared_ptr<ci::Surface>> mSurfaces;
+	//! Where each surface was loaded from, so that the material can be restored from a ModelCache.
+	std::map<TextureType, ci::fs::path>	mTexturePaths;
 	
 	GLenum			mWrapS, mWrapT;
 	ci::Material	mMaterial;
@@ -174,25 +191,113 @@ public:
 	float getDuration() const { return mDuration; }
 	float getTicksPerSecond() const { return mTicksPerSecond; }
 	const std::string& getName() const { return mName; }
+	//! Set when the clip was compressed at load time (see AssimpLoader::Settings::compressAnimations()).
+	const AnimCompressionStats& getCompressionStats() const { return mCompressionStats; }
+	void setCompressionStats( const AnimCompressionStats& stats ) { mCompressionStats = stats; }
 private:
 	float		mDuration;
 	float		mTicksPerSecond;
 	std::string	mName;
+	AnimCompressionStats	mCompressionStats;
 };
 	
+/*!
+ * A vertex attribute array which either owns its elements or aliases memory
+ * owned by someone else (i.e. an orphaned aiScene). In the latter case, the
+ * storage handle keeps that memory alive for as long as the array refers to it.
+ */
+template<typename T>
+class AttribArray {
+public:
+	AttribArray() : mData( nullptr ), mSize( 0 ) { }
+	AttribArray( const AttribArray& rhs ) : mValues( rhs.mValues ), mStorage( rhs.mStorage ) { bind( rhs ); }
+	AttribArray& operator=( const AttribArray& rhs )
+	{
+		mValues = rhs.mValues;
+		mStorage = rhs.mStorage;
+		bind( rhs );
+		return *this;
+	}
+	//! Moves leave \a rhs empty: the elements, owned or aliased, change hands without being copied.
+	AttribArray( AttribArray&& rhs ) noexcept : mValues( std::move( rhs.mValues ) ), mStorage( std::move( rhs.mStorage ) ), mData( rhs.mData ), mSize( rhs.mSize ) { rhs.reset(); }
+	AttribArray& operator=( AttribArray&& rhs ) noexcept
+	{
+		mValues = std::move( rhs.mValues );
+		mStorage = std::move( rhs.mStorage );
+		mData = rhs.mData;
+		mSize = rhs.mSize;
+		rhs.reset();
+		return *this;
+	}
+	AttribArray& operator=( std::vector<T>&& values )
+	{
+		mValues = std::move( values );
+		mStorage.reset();
+		mData = mValues.data();
+		mSize = mValues.size();
+		return *this;
+	}
+	
+	//! Refers to \a size tightly packed elements without copying them.
+	void alias( const T* data, size_t size, const std::shared_ptr<const void>& storage )
+	{
+		std::vector<T>().swap( mValues );
+		mStorage = storage;
+		mData = data;
+		mSize = size;
+	}
+	
+	bool		empty() const { return mSize == 0; }
+	size_t		size() const { return mSize; }
+	const T*	data() const { return mData; }
+	bool		isAliased() const { return mStorage != nullptr; }
+	
+	const T*	begin() const { return mData; }
+	const T*	end() const { return mData + mSize; }
+	const T&	operator[]( size_t i ) const { return mData[i]; }
+	const T&	at( size_t i ) const
+	{
+		if( i >= mSize )
+			throw std::out_of_range( "AttribArray::at" );
+		return mData[i];
+	}
+private:
+	void reset()
+	{
+		std::vector<T>().swap( mValues );
+		mStorage.reset();
+		mData = nullptr;
+		mSize = 0;
+	}
+	void bind( const AttribArray& rhs )
+	{
+		mData = rhs.isAliased() ? rhs.mData : mValues.data();
+		mSize = rhs.mSize;
+	}
+	
+	std::vector<T>					mValues;
+	std::shared_ptr<const void>		mStorage;
+	const T*						mData;
+	size_t							mSize;
+};
+
 typedef std::shared_ptr<class Source> SourceRef;
 typedef std::shared_ptr<class SectionSource> SectionSourceRef;
 
 class Source {
 public:
+	friend class ModelCache;
 	virtual std::vector<SectionSourceRef>	getSectionSources() const { return mSectionSources; }
 	virtual std::shared_ptr<Node>			getSkeletonRoot() const { return mRootNode; }
 	virtual std::unordered_map<std::string, std::shared_ptr<Node>>	getSkeletonBones() const { return mBones; }
 	const std::vector<AnimInfo>&			getAnimInfos() const { return mAnimInfos; }
+	//! Fixed-rate resampling of each animation, indexed like getAnimInfos(); empty unless requested at load time.
+	const std::vector<SampledClipRef>&		getSampledClips() const { return mSampledClips; }
 protected:
 	//! Information extracted (upon class instantiation) from assimp about each model section
 	std::vector<SectionSourceRef>	mSectionSources;
 	std::vector<AnimInfo> mAnimInfos;
+	std::vector<SampledClipRef> mSampledClips;
 	std::shared_ptr<Node> mRootNode;
 	std::unordered_map<std::string, std::shared_ptr<Node>> mBones;
 };
@@ -200,6 +305,8 @@ protected:
 class SectionSource : public ci::geom::Source {
 public:
 	friend class AssimpLoader;
+	friend class ModelCache;
+	friend class PackedVertices;
 	virtual size_t				getNumIndices() const override;
 	virtual size_t				getNumVertices() const override;
 	virtual ci::geom::Primitive	getPrimitive() const override;
@@ -209,18 +316,55 @@ public:
 	ci::geom::AttribSet			getAvailableAttribs() const override;
 
 	const std::string&				getName() const { return mName; }
+	const AttribArray<glm::vec3>&	getPositions() const { return mPositions; }
+	const AttribArray<glm::vec3>&	getNormals() const { return mNormals; }
+	const std::vector<uint32_t>&	getIndices() const { return mIndices; }
 	const MaterialSource&			getMaterialSource() const { return mMaterialSource; }
 	const ci::mat4&			getDefaultTransformation() const { return mDefaultTransformation; }
 	const std::vector<glm::vec4>&	getBoneIndices() const { return mBoneIndices; }
 	const std::vector<glm::vec4>&	getBoneWeights() const { return mBoneWeights; }
 	const std::vector<Weights>&		getWeights() const { return mWeights; }
-	size_t							getNumMorphTargets() const { return mMorphOffsets.size(); }
+	//! Every section of a model has the same number of targets, in the order they were loaded; some may displace none of its vertices.
+	size_t							getNumMorphTargets() const { return mMorphTargets.size(); }
+	const std::vector<MorphTarget>&	getMorphTargets() const { return mMorphTargets; }
+	//! Clusters covering the indices in order, built at load time when requested (see AssimpLoader::Settings::meshlets()).
+	const std::vector<Meshlet>&		getMeshlets() const { return mMeshlets; }
+	//! Simplified levels, coarser and coarser, built at load time when requested (see AssimpLoader::Settings::lods()).
+	const std::vector<Lod>&			getLods() const { return mLods; }
+	
+	//! Bounds of the vertices influenced by one bone, in bind pose.
+	struct BoneBounds {
+		uint32_t	mBoneIndex;
+		glm::vec3	mMin, mMax;
+	};
+	//! Bounds of the positions, in the section's space (before its default transformation).
+	const ci::AxisAlignedBox&		getBounds() const { return mBounds; }
+	const std::vector<BoneBounds>&	getBoneBounds() const { return mBoneBounds; }
+	//! Whether \a other can be merged with this section (see merge()): same material, same attributes, and no bones, morph targets, meshlets or levels of detail.
+	bool							canMergeWith( const SectionSource& other ) const;
+	//! One section with the vertices of \a sources (see canMergeWith()), their default transformations baked in, drawn in one call.
+	static SectionSourceRef			merge( const std::vector<SectionSourceRef>& sources );
+	
+	/*!
+	 * Sections skinned with palettes of at most \a maxBones bones (at least 12, the most a triangle can refer to), covering \a source.
+	 * Their bone indices refer to slots of their palette, and \a palettes receives, for each section, the bone index of each slot.
+	 * A source which fits is copied as a whole; otherwise its triangles are grouped by bones, each part keeping its own vertices.
+	 * Parts rebuild their meshlets, and take the triangles of each level of detail whose bones their palette has, along with
+	 * their vertices. A source without bones is returned as is, with an empty palette.
+	 */
+	static std::vector<SectionSourceRef>	partitionBones( const SectionSourceRef& source, size_t maxBones, std::vector<std::vector<uint32_t>>* palettes );
+	
+	//! Conservative bounds of a section with \a boneBounds skinned by \a skinningMatrices, indexed by bone index (see Skeleton::computeSkinningMatrices()).
+	static ci::AxisAlignedBox		calcSkinnedBounds( const std::vector<BoneBounds>& boneBounds, const glm::mat4* skinningMatrices, size_t numMatrices );
+	ci::AxisAlignedBox				calcSkinnedBounds( const std::vector<glm::mat4>& skinningMatrices ) const { return calcSkinnedBounds( mBoneBounds, skinningMatrices.data(), skinningMatrices.size() ); }
 private:
 	bool				hasAttrib( ci::geom::Attrib attr ) const;
+	//! Computes mBounds and mBoneBounds from the positions and bone weights.
+	void				updateBounds();
 	
 	std::string							mName;
-	std::vector<glm::vec3>				mPositions, mNormals, mTangents, mBitangents;
-	std::vector<glm::vec2>				mTexCoords;
+	AttribArray<glm::vec3>				mPositions, mNormals, mTangents, mBitangents;
+	AttribArray<glm::vec2>				mTexCoords;
 	std::vector<uint32_t>				mIndices;
 	std::vector<ci::Colorf>				mColors;
 	std::vector<glm::vec4>				mBoneWeights, mBoneIndices;
@@ -228,7 +372,11 @@ private:
 	MaterialSource						mMaterialSource;
 	ci::mat4							mDefaultTransformation;
 
-	std::vector<std::vector<glm::vec3>> mMorphOffsets;
+	std::vector<MorphTarget>			mMorphTargets;
+	std::vector<Meshlet>				mMeshlets;
+	std::vector<Lod>					mLods;
+	ci::AxisAlignedBox					mBounds;
+	std::vector<BoneBounds>				mBoneBounds;
 };
 	
 class ModelIoException : public ci::Exception
@@ -249,6 +397,11 @@ public:
 	LoadErrorException( const std::string &message ) throw() : ModelIoException( "Load error: " + message ) { };
 };
 
+class LoadCancelledException : public LoadErrorException {
+public:
+	LoadCancelledException() : LoadErrorException( "cancelled." ) { }
+};
+
 class ModelTargetException : public ModelIoException {
 public:
 	ModelTargetException() : ModelIoException() {}
@@ -0,0 +1,63 @@
+#include "MorphEvaluator.h"
+
+#include "cinder/CinderAssert.h"
+
+#include <algorithm>
+
+using namespace model;
+
+MorphEvaluatorRef MorphEvaluator::create( const SectionSource& source )
+{
+	return MorphEvaluatorRef( new MorphEvaluator( source ) );
+}
+
+MorphEvaluator::MorphEvaluator( const SectionSource& source )
+: mPositions( source.getPositions().begin(), source.getPositions().end() )
+, mTargets( source.getMorphTargets() )
+{
+	mTargetRanges.reserve( mTargets.size() );
+	for( const MorphTarget& target : mTargets ) {
+		if( target.empty() ) {
+			mTargetRanges.emplace_back( 0, 0 );
+			continue;
+		}
+		const MorphTarget::Run& last = target.mRuns.back();
+		mTargetRanges.emplace_back( target.mRuns.front().mFirstVertex, last.mFirstVertex + last.mNumVertices );
+		CI_ASSERT( mTargetRanges.back().second <= mPositions.size() );
+	}
+}
+
+void MorphEvaluator::restore( const MorphTarget& target, glm::vec3* positions ) const
+{
+	for( const MorphTarget::Run& run : target.mRuns ) {
+		std::copy( mPositions.begin() + run.mFirstVertex, mPositions.begin() + run.mFirstVertex + run.mNumVertices, positions + run.mFirstVertex );
+	}
+}
+
+std::pair<size_t, size_t> MorphEvaluator::evaluate( const std::vector<float>& weights, glm::vec3* positions )
+{
+	size_t first = mPositions.size(), last = 0;
+	auto extend = [&] ( uint32_t t ) {
+		if( mTargetRanges[t].first < mTargetRanges[t].second ) {
+			first = std::min( first, mTargetRanges[t].first );
+			last = std::max( last, mTargetRanges[t].second );
+		}
+	};
+
+	for( uint32_t t : mActiveTargets ) {
+		restore( mTargets[t], positions );
+		extend( t );
+	}
+	mActiveTargets.clear();
+
+	const size_t numTargets = std::min( weights.size(), mTargets.size() );
+	for( size_t t = 0; t < numTargets; ++t ) {
+		if( weights[t] == 0.0f || mTargets[t].empty() ) {
+			continue;
+		}
+		mTargets[t].apply( weights[t], positions );
+		mActiveTargets.push_back( uint32_t( t ) );
+		extend( uint32_t( t ) );
+	}
+	return ( first < last ) ? std::make_pair( first, last ) : std::make_pair( size_t( 0 ), size_t( 0 ) );
+}
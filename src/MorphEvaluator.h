@@ -0,0 +1,47 @@
+#pragma once
+
+#include "ModelIo.h"
+
+#include <utility>
+#include <vector>
+
+namespace model {
+
+typedef std::shared_ptr<class MorphEvaluator> MorphEvaluatorRef;
+
+/*!
+ * Morph targets blended on the CPU for one section.
+ * evaluate() only visits the targets whose weight is not zero, and only the vertices they displace:
+ * instead of starting from a copy of the base positions, it restores the vertices moved by the previous
+ * call's targets. The cost follows the active targets, whatever the number of targets loaded.
+ */
+class MorphEvaluator {
+public:
+	static MorphEvaluatorRef create( const SectionSource& source );
+
+	size_t	getNumVertices() const { return mPositions.size(); }
+	size_t	getNumTargets() const { return mTargets.size(); }
+	const std::vector<glm::vec3>&	getBasePositions() const { return mPositions; }
+
+	/*!
+	 * Blends targets weighted by \a weights (missing ones weighing 0) into \a positions, of getNumVertices() elements.
+	 * \a positions must hold the result of the previous evaluate() or the base positions, i.e. be the evaluator's own buffer.
+	 * Returns the range of vertices [first, second) which may have changed since the previous call, empty if none.
+	 */
+	std::pair<size_t, size_t>	evaluate( const std::vector<float>& weights, glm::vec3* positions );
+	//! Targets blended by the last evaluate().
+	const std::vector<uint32_t>&	getActiveTargets() const { return mActiveTargets; }
+protected:
+	MorphEvaluator( const SectionSource& source );
+
+	//! Restores the base position of the vertices displaced by \a target.
+	void	restore( const MorphTarget& target, glm::vec3* positions ) const;
+
+	std::vector<glm::vec3>		mPositions;
+	std::vector<MorphTarget>	mTargets;
+	//! Vertex range displaced by each target, empty for targets that displace nothing.
+	std::vector<std::pair<size_t, size_t>>	mTargetRanges;
+	std::vector<uint32_t>		mActiveTargets;
+};
+
+} //end namespace model
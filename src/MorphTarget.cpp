@@ -0,0 +1,90 @@
+#include "MorphTarget.h"
+
+#include "cinder/CinderAssert.h"
+
+#include <algorithm>
+#include <limits>
+
+using namespace model;
+
+namespace {
+
+	//! Appends vertex \a v displaced by \a offset, extending the last run when \a v follows it.
+	inline void append( MorphTarget* target, uint32_t v, const glm::vec3& offset )
+	{
+		auto& runs = target->mRuns;
+		if( runs.empty() || runs.back().mFirstVertex + runs.back().mNumVertices != v ) {
+			runs.push_back( MorphTarget::Run{ v, 0 } );
+		}
+		++runs.back().mNumVertices;
+		target->mOffsets.push_back( offset );
+	}
+
+} // anonymous namespace
+
+void MorphTarget::apply( float weight, glm::vec3* positions ) const
+{
+	const glm::vec3* offset = mOffsets.data();
+	for( const Run& run : mRuns ) {
+		glm::vec3* position = positions + run.mFirstVertex;
+		for( uint32_t i = 0; i < run.mNumVertices; ++i ) {
+			position[i] += weight * offset[i];
+		}
+		offset += run.mNumVertices;
+	}
+}
+
+void MorphTarget::toDense( glm::vec3* offsets, size_t numVertices ) const
+{
+	std::fill( offsets, offsets + numVertices, glm::vec3( 0 ) );
+	const glm::vec3* offset = mOffsets.data();
+	for( const Run& run : mRuns ) {
+		CI_ASSERT( size_t( run.mFirstVertex ) + run.mNumVertices <= numVertices );
+		std::copy( offset, offset + run.mNumVertices, offsets + run.mFirstVertex );
+		offset += run.mNumVertices;
+	}
+}
+
+MorphTarget MorphTarget::create( const glm::vec3* base, const glm::vec3* target, size_t numVertices, float tolerance )
+{
+	const float toleranceSquared = tolerance * tolerance;
+	MorphTarget result;
+	for( size_t v = 0; v < numVertices; ++v ) {
+		const glm::vec3 offset = target[v] - base[v];
+		const float lengthSquared = glm::dot( offset, offset );
+		if( lengthSquared > toleranceSquared ) {
+			append( &result, uint32_t( v ), offset );
+		}
+	}
+	result.mRuns.shrink_to_fit();
+	result.mOffsets.shrink_to_fit();
+	return result;
+}
+
+MorphTarget MorphTarget::remapped( const std::vector<uint32_t>& vertexMap, size_t numVertices ) const
+{
+	const uint32_t NO_VERTEX = std::numeric_limits<uint32_t>::max();
+	std::vector<std::pair<uint32_t, glm::vec3>> moved;
+	moved.reserve( mOffsets.size() );
+	const glm::vec3* offset = mOffsets.data();
+	for( const Run& run : mRuns ) {
+		for( uint32_t i = 0; i < run.mNumVertices; ++i ) {
+			const uint32_t v = vertexMap[run.mFirstVertex + i];
+			if( v != NO_VERTEX ) {
+				CI_ASSERT( v < numVertices );
+				moved.emplace_back( v, offset[i] );
+			}
+		}
+		offset += run.mNumVertices;
+	}
+	// New vertices come in the order of first use, not of the source vertices.
+	std::sort( moved.begin(), moved.end(), [] ( const std::pair<uint32_t, glm::vec3>& lhs, const std::pair<uint32_t, glm::vec3>& rhs ) {
+		return lhs.first < rhs.first;
+	} );
+
+	MorphTarget result;
+	for( const auto& vertex : moved ) {
+		append( &result, vertex.first, vertex.second );
+	}
+	return result;
+}
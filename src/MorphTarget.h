@@ -0,0 +1,47 @@
+#pragma once
+
+#include "cinder/Vector.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace model {
+
+/*!
+ * Offsets of a morph target from the positions of its section, kept only for the vertices it displaces.
+ * These are stored as runs of consecutive vertices, their offsets packed one run after the other: a face
+ * target touching a tenth of a body costs a tenth of the dense offsets, plus 8 bytes per run.
+ */
+struct MorphTarget {
+	struct Run {
+		uint32_t	mFirstVertex, mNumVertices;
+	};
+
+	std::vector<Run>		mRuns;
+	//! Offsets of the vertices of every run, in order.
+	std::vector<glm::vec3>	mOffsets;
+
+	//! Whether the target displaces no vertex at all.
+	bool	empty() const { return mOffsets.empty(); }
+	//! Vertices displaced by the target.
+	size_t	getNumVertices() const { return mOffsets.size(); }
+	size_t	getMemorySize() const { return mRuns.size() * sizeof( Run ) + mOffsets.size() * sizeof( glm::vec3 ); }
+
+	//! Adds \a weight times the offsets to \a positions, indexed by vertex.
+	void	apply( float weight, glm::vec3* positions ) const;
+	//! Writes the offset of every vertex into \a offsets, of \a numVertices elements (zero where the target doesn't move the vertex).
+	void	toDense( glm::vec3* offsets, size_t numVertices ) const;
+
+	/*!
+	 * The target moving \a numVertices \a base positions to \a target, keeping the vertices whose offset is longer than \a tolerance.
+	 * \a tolerance 0 keeps every vertex that moves at all.
+	 */
+	static MorphTarget	create( const glm::vec3* base, const glm::vec3* target, size_t numVertices, float tolerance = 0.0f );
+	/*!
+	 * The offsets of this target over a subset of its section's vertices, vertex \a v becoming \a vertexMap[v]
+	 * of \a numVertices; vertices mapped to UINT32_MAX are dropped (see SectionSource::partitionBones()).
+	 */
+	MorphTarget			remapped( const std::vector<uint32_t>& vertexMap, size_t numVertices ) const;
+};
+
+} //end namespace model
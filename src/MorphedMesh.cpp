@@ -4,17 +4,88 @@
 #include "Skeleton.h"
 #include "Renderer.h"
 
-#include "cinder/Utilities.h"
+#include <algorithm>
 
 using namespace ci;
 using namespace model;
 
-MorphedMesh::Section::Section( const SectionSourceRef& source, size_t numMorphTargets, ci::gl::GlslProgRef shader, gl::Batch::AttributeMapping mapping )
-: ABatchSection( source, shader, mapping )
-, mNumMorphTargets( numMorphTargets )
+namespace {
+
+#if ! defined( CINDER_GL_ES )
+	//! A section with, as CUSTOM_0, the first and number of the offsets of each vertex in the mesh's deltas texture.
+	class MorphRangeSource : public geom::Source {
+	public:
+		MorphRangeSource( const SectionSource& section, const std::vector<vec2>& ranges )
+		: mSection( section ), mRanges( ranges )
+		{ }
+
+		size_t			getNumVertices() const override { return mSection.getNumVertices(); }
+		size_t			getNumIndices() const override { return mSection.getNumIndices(); }
+		geom::Primitive	getPrimitive() const override { return mSection.getPrimitive(); }
+		uint8_t			getAttribDims( geom::Attrib attr ) const override { return ( attr == geom::Attrib::CUSTOM_0 ) ? 2 : mSection.getAttribDims( attr ); }
+		geom::AttribSet	getAvailableAttribs() const override
+		{
+			geom::AttribSet attribs = mSection.getAvailableAttribs();
+			attribs.insert( geom::Attrib::CUSTOM_0 );
+			return attribs;
+		}
+		void			loadInto( geom::Target* target, const geom::AttribSet& requestedAttribs ) const override
+		{
+			mSection.loadInto( target, requestedAttribs );
+			target->copyAttrib( geom::Attrib::CUSTOM_0, 2, 0, (const float*)mRanges.data(), mRanges.size() );
+		}
+		MorphRangeSource*	clone() const override { return new MorphRangeSource( *this ); }
+	private:
+		const SectionSource&		mSection;
+		const std::vector<vec2>&	mRanges;
+	};
+#endif
+
+} // anonymous namespace
+
+#if ! defined( CINDER_GL_ES )
+
+MorphedMesh::Section::Section( const SectionSourceRef& source, const gl::VboMeshRef& vboMesh, ci::gl::GlslProgRef shader, gl::Batch::AttributeMapping mapping )
+: ABatchSection( source, vboMesh, shader, mapping )
+, mNumMorphTargets( source->getNumMorphTargets() )
+{
+}
+
+#else
+
+MorphedMesh::Section::Section( const SectionSourceRef& source, ci::gl::GlslProgRef shader )
+: ABatchSection( source, shader )
+, mEvaluator( MorphEvaluator::create( *source ) )
+, mPositions( mEvaluator->getBasePositions() )
+, mNumMorphTargets( source->getNumMorphTargets() )
 {
 }
 
+void MorphedMesh::Section::update( const std::vector<float>& weights )
+{
+	const auto range = mEvaluator->evaluate( weights, mPositions.data() );
+	if( range.first == range.second ) {
+		return;
+	}
+	for( const auto& layoutVbo : mBatch->getVboMesh()->getVertexArrayLayoutVbos() ) {
+		for( const auto& attrib : layoutVbo.first.getAttribs() ) {
+			if( attrib.getAttrib() != geom::Attrib::POSITION ) {
+				continue;
+			}
+			if( attrib.getStride() == 0 || attrib.getStride() == sizeof( vec3 ) ) {
+				// Planar positions: only the range which moved.
+				layoutVbo.second->bufferSubData( attrib.getOffset() + range.first * sizeof( vec3 ), ( range.second - range.first ) * sizeof( vec3 ), mPositions.data() + range.first );
+			}
+			else {
+				mBatch->getVboMesh()->bufferAttrib( geom::Attrib::POSITION, mPositions );
+			}
+			return;
+		}
+	}
+}
+
+#endif
+
 MorphedMeshRef MorphedMesh::create( const model::Source& source, ci::gl::GlslProgRef shader )
 {
 	if( ! shader )
@@ -29,22 +100,92 @@ void MorphedMesh::setMorphTargetWeight( size_t index, float weightContribution )
 }
 
 MorphedMesh::MorphedMesh( const model::Source& source, ci::gl::GlslProgRef shader )
-: mMorphTargetWeights{}
-{
-	size_t index = 0;
-	for( auto& sectionSource : source.getSectionSources() ) {
-		
-		size_t numMorphTargets = sectionSource->getNumMorphTargets();
-		
-		gl::Batch::AttributeMapping mapping;
-		for( size_t i = 0; i < sectionSource->getNumMorphTargets(); ++i ) {
-			mapping[static_cast<geom::Attrib>( size_t( geom::Attrib::CUSTOM_0 ) + i )] = "vPositionDiff" + toString( i );
+{
+	size_t numMorphTargets = 0;
+	for( const auto& sectionSource : source.getSectionSources() ) {
+		numMorphTargets = std::max( numMorphTargets, sectionSource->getNumMorphTargets() );
+	}
+	mMorphTargetWeights.assign( numMorphTargets, 0.0f );
+
+#if ! defined( CINDER_GL_ES )
+	// Offsets grouped by vertex, every section after the previous one.
+	std::vector<vec4> deltas;
+	std::vector<vec2> ranges;
+	std::vector<uint32_t> next;
+	gl::Batch::AttributeMapping mapping;
+	mapping[geom::Attrib::CUSTOM_0] = "vMorphRange";
+	for( const auto& sectionSource : source.getSectionSources() ) {
+		const auto& targets = sectionSource->getMorphTargets();
+		const size_t numVertices = sectionSource->getNumVertices();
+		next.assign( numVertices, 0 );
+		for( const MorphTarget& target : targets ) {
+			for( const MorphTarget::Run& run : target.mRuns ) {
+				for( uint32_t i = 0; i < run.mNumVertices; ++i ) {
+					++next[run.mFirstVertex + i];
+				}
+			}
+		}
+		// Float ranges are exact up to 2^24 offsets, beyond what buffer textures are guaranteed to hold.
+		ranges.resize( numVertices );
+		size_t first = deltas.size();
+		for( size_t v = 0; v < numVertices; ++v ) {
+			ranges[v] = vec2( float( first ), float( next[v] ) );
+			const size_t count = next[v];
+			next[v] = uint32_t( first );
+			first += count;
+		}
+		deltas.resize( first );
+		for( size_t t = 0; t < targets.size(); ++t ) {
+			const vec3* offset = targets[t].mOffsets.data();
+			for( const MorphTarget::Run& run : targets[t].mRuns ) {
+				for( uint32_t i = 0; i < run.mNumVertices; ++i ) {
+					deltas[next[run.mFirstVertex + i]++] = vec4( offset[i], float( t ) );
+				}
+				offset += run.mNumVertices;
+			}
 		}
-		
-		SectionRef section{ new Section{ sectionSource, numMorphTargets, shader, mapping } };
-		mMeshSections.emplace_back( section );
-		
-		mMorphTargetWeights.at( index ) = (index == 0) ? 1.0f : 0.0f;
-		++index;
+
+		auto vboMesh = gl::VboMesh::create( MorphRangeSource( *sectionSource, ranges ) );
+		mMeshSections.emplace_back( new Section( sectionSource, vboMesh, shader, mapping ) );
+	}
+
+	// Buffer textures can't be empty.
+	if( deltas.empty() ) {
+		deltas.emplace_back( 0 );
+	}
+	std::vector<float> weights( std::max<size_t>( numMorphTargets, 1 ), 0.0f );
+	mDeltasTexture = gl::BufferTexture::create( deltas.data(), deltas.size() * sizeof( vec4 ), GL_RGBA32F, GL_STATIC_DRAW );
+	mWeightsTexture = gl::BufferTexture::create( weights.data(), weights.size() * sizeof( float ), GL_R32F, GL_DYNAMIC_DRAW );
+#else
+	mUpdatedWeights = mMorphTargetWeights;
+	for( const auto& sectionSource : source.getSectionSources() ) {
+		mMeshSections.emplace_back( new Section( sectionSource, shader ) );
 	}
+#endif
 }
+
+#if ! defined( CINDER_GL_ES )
+
+void MorphedMesh::bindMorphTextures( const std::vector<float>& weights ) const
+{
+	if( ! weights.empty() ) {
+		mWeightsTexture->getBufferObj()->bufferSubData( 0, std::min( weights.size(), mMorphTargetWeights.size() ) * sizeof( float ), weights.data() );
+	}
+	mDeltasTexture->bindTexture( DELTAS_TEXTURE_UNIT );
+	mWeightsTexture->bindTexture( WEIGHTS_TEXTURE_UNIT );
+}
+
+#else
+
+void MorphedMesh::updatePositions()
+{
+	if( mUpdatedWeights == mMorphTargetWeights ) {
+		return;
+	}
+	for( const auto& section : mMeshSections ) {
+		section->update( mMorphTargetWeights );
+	}
+	mUpdatedWeights = mMorphTargetWeights;
+}
+
+#endif
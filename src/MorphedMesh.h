@@ -1,6 +1,11 @@
 #pragma once
 
 #include "AMeshSection.h"
+#include "MorphEvaluator.h"
+
+#if ! defined( CINDER_GL_ES )
+	#include "cinder/gl/BufferTexture.h"
+#endif
 
 #include <vector>
 
@@ -8,31 +13,66 @@ namespace model {
 
 	typedef std::shared_ptr<class MorphedMesh> MorphedMeshRef;
 
+	/*!
+	 * Mesh blending any number of morph targets, one weight per target shared by every section.
+	 * The sparse offsets of every section are uploaded once into a buffer texture, grouped by vertex and tagged with
+	 * their target; each vertex loops over its own offsets only, reading the weights from a second buffer texture.
+	 * OpenGL ES has no buffer textures: sections are then blended on the CPU (see MorphEvaluator) and their positions uploaded.
+	 */
 	class MorphedMesh {
 	public:
-		const static int MAXMORPHTARGETS = 10;
-		
 		class Section : public ABatchSection
 		{
 			friend class MorphedMesh;
 		public:
-			Section( const SectionSourceRef& source, size_t numMorphTargets, ci::gl::GlslProgRef shader, ci::gl::Batch::AttributeMapping mapping );
+			size_t	getNumMorphTargets() const { return mNumMorphTargets; }
 		private:
+#if ! defined( CINDER_GL_ES )
+			Section( const SectionSourceRef& source, const ci::gl::VboMeshRef& vboMesh, ci::gl::GlslProgRef shader, ci::gl::Batch::AttributeMapping mapping );
+#else
+			Section( const SectionSourceRef& source, ci::gl::GlslProgRef shader );
+
+			//! Blends the targets with \a weights and uploads the positions which changed.
+			void	update( const std::vector<float>& weights );
+
+			MorphEvaluatorRef		mEvaluator;
+			std::vector<glm::vec3>	mPositions;
+#endif
 			size_t				mNumMorphTargets;
 		};
 		typedef std::shared_ptr<Section> SectionRef;
 
 		static MorphedMeshRef create( const model::Source& source, ci::gl::GlslProgRef shader = nullptr );
-		
+
+		size_t	getNumMorphTargets() const { return mMorphTargetWeights.size(); }
 		void	setMorphTargetWeight( size_t index, float weightContribution );
-		float	getMorphTargetWeight( size_t index ) { return mMorphTargetWeights.at( index ); }
-		const std::array<float, 10> getMorphTargetWeights() const { return mMorphTargetWeights; }
-		
+		float	getMorphTargetWeight( size_t index ) const { return mMorphTargetWeights.at( index ); }
+		//! Starting at 0, i.e. at the positions of the model.
+		const std::vector<float>&	getMorphTargetWeights() const { return mMorphTargetWeights; }
+
 		const std::vector<SectionRef>&	getSections() const { return mMeshSections; }
+
+#if ! defined( CINDER_GL_ES )
+		static const uint8_t DELTAS_TEXTURE_UNIT = 1;
+		static const uint8_t WEIGHTS_TEXTURE_UNIT = 2;
+		//! Uploads \a weights (one per target) and binds the offsets and weights textures to DELTAS_TEXTURE_UNIT and WEIGHTS_TEXTURE_UNIT.
+		void	bindMorphTextures( const std::vector<float>& weights ) const;
+		//! RGBA32F texels: the offset of one vertex in xyz, the index of its target in w.
+		const ci::gl::BufferTextureRef&	getDeltasTexture() const { return mDeltasTexture; }
+#else
+		//! Blends the sections with the current weights, if they changed since the last call. Called by Renderer::draw().
+		void	updatePositions();
+#endif
 	protected:
 		MorphedMesh( const model::Source& source, ci::gl::GlslProgRef shader );
-		
+
 		std::vector<SectionRef>	mMeshSections;
-		std::array<float, MAXMORPHTARGETS>	mMorphTargetWeights;
+		std::vector<float>		mMorphTargetWeights;
+#if ! defined( CINDER_GL_ES )
+		ci::gl::BufferTextureRef	mDeltasTexture, mWeightsTexture;
+#else
+		//! Weights the sections were last blended with.
+		std::vector<float>		mUpdatedWeights;
+#endif
 	};
-}
\ No newline at end of file
+}
@@ -29,6 +29,7 @@ Node::Node( const vec3& position, const quat& rotation, vec3 scale,
 , mParent( parent )
 , mLevel( level )
 , mBoneIndex( 0 )
+, mPoseIndex( 0 )
 , mTime( 0.0f )
 , mIsAnimated( false )
 , mNeedsUpdate( true )
@@ -38,9 +39,9 @@ Node::Node( const vec3& position, const quat& rotation, vec3 scale,
 
 NodeRef Node::clone() const
 {
-	NodeRef clone = NodeRef( new Node(mRelativePosition,
-									  mRelativeRotation,
-									  mRelativeScale,
+	NodeRef clone = NodeRef( new Node(getRelativePosition(),
+									  getRelativeRotation(),
+									  getRelativeScale(),
 									  mName,
 									  nullptr,
 									  mLevel ) );
@@ -48,10 +49,14 @@ NodeRef Node::clone() const
 		clone->setOffsetMatrix( *mOffset );
 	clone->setBoneIndex( getBoneIndex() );
 	clone->mBoneIndex = mBoneIndex;
+	clone->mInitialRelativePosition = mInitialRelativePosition;
+	clone->mInitialRelativeRotation = mInitialRelativeRotation;
+	clone->mInitialRelativeScale = mInitialRelativeScale;
 	
-	//TODO: Copy animation data.
-	//	clone->mIsAnimated = mIsAnimated;
-	clone->animate( mTime );
+	// Tracks are not modified once loaded: clones share them.
+	clone->mAnimTracks = mAnimTracks;
+	clone->mIsAnimated = isAnimated();
+	clone->mTime = mPose ? mPose->getTime() : mTime;
 	return clone;
 }
 
@@ -69,12 +74,15 @@ void Node::setParent( NodeRef parent )
 mat4 Node::getRelativeTransformation() const
 {
 	mat4 transformation;
-	computeTransformation( mRelativePosition, mRelativeRotation, mRelativeScale, &transformation );
+	computeTransformation( getRelativePosition(), getRelativeRotation(), getRelativeScale(), &transformation );
 	return transformation;
 }
 
 mat4 Node::getAbsoluteTransformation() const
 {
+	if( mPose ) {
+		return mPose->getWorldTransform( mPoseIndex );
+	}
 	if( mNeedsUpdate ) {
 		update();
 	}
@@ -85,6 +93,9 @@ mat4 Node::getAbsoluteTransformation() const
 
 const vec3& Node::getAbsolutePosition() const
 {
+	if( mPose ) {
+		return mPose->getWorldPosition( mPoseIndex );
+	}
 	if( mNeedsUpdate ) {
 		update();
 	}
@@ -93,6 +104,9 @@ const vec3& Node::getAbsolutePosition() const
 
 const quat& Node::getAbsoluteRotation() const
 {
+	if( mPose ) {
+		return mPose->getWorldRotation( mPoseIndex );
+	}
 	if( mNeedsUpdate ) {
 		update();
 	}
@@ -101,6 +115,9 @@ const quat& Node::getAbsoluteRotation() const
 
 const vec3& Node::getAbsoluteScale() const
 {
+	if( mPose ) {
+		return mPose->getWorldScale( mPoseIndex );
+	}
 	if( mNeedsUpdate ) {
 		update();
 	}
@@ -109,49 +126,69 @@ const vec3& Node::getAbsoluteScale() const
 
 void Node::setAbsolutePosition( const vec3& pos )
 {
-	mAbsolutePosition = pos;
 	std::shared_ptr<Node> parent( mParent.lock() );
 	if ( parent ) {
-		setRelativePosition( mAbsolutePosition - parent->getAbsolutePosition() );
+		setRelativePosition( pos - parent->getAbsolutePosition() );
 	} else {
-		setRelativePosition( mAbsolutePosition );
+		setRelativePosition( pos );
 	}
 }
 
 void Node::setRelativePosition( const vec3& pos )
 {
-	mRelativePosition = pos;
-	requestSubtreeUpdate();
+	if( mPose ) {
+		mPose->setLocalPosition( mPoseIndex, pos );
+	} else {
+		mRelativePosition = pos;
+		requestSubtreeUpdate();
+	}
 }
 
 void Node::setAbsoluteRotation( const quat& rotation )
 {
-	mAbsoluteRotation = rotation;
 	std::shared_ptr<Node> parent( mParent.lock() );
 	if ( parent ) {
-		setRelativeRotation( glm::inverse( parent->getAbsoluteRotation() ) * mAbsoluteRotation );
+		setRelativeRotation( glm::inverse( parent->getAbsoluteRotation() ) * rotation );
 	} else {
-		setRelativeRotation( mAbsoluteRotation );
+		setRelativeRotation( rotation );
 	}
 }
 
 void Node::setRelativeRotation( const quat& rotation )
 {
-	mRelativeRotation = rotation;
-	requestSubtreeUpdate();
+	if( mPose ) {
+		mPose->setLocalRotation( mPoseIndex, rotation );
+	} else {
+		mRelativeRotation = rotation;
+		requestSubtreeUpdate();
+	}
 }
 
 void Node::setRelativeScale( const vec3& scale )
 {
-	mRelativeScale = scale;
-	requestSubtreeUpdate();
+	if( mPose ) {
+		mPose->setLocalScale( mPoseIndex, scale );
+	} else {
+		mRelativeScale = scale;
+		requestSubtreeUpdate();
+	}
 }
 
 void Node::resetToInitial()
 {
-	mRelativePosition = mInitialRelativePosition;
-	mRelativeRotation = mInitialRelativeRotation;
-	mRelativeScale = mInitialRelativeScale;
+	setRelativePosition( mInitialRelativePosition );
+	setRelativeRotation( mInitialRelativeRotation );
+	setRelativeScale( mInitialRelativeScale );
+}
+
+void Node::bindPose( const PoseRef& pose, size_t index )
+{
+	pose->setLocalPosition( index, getRelativePosition() );
+	pose->setLocalRotation( index, getRelativeRotation() );
+	pose->setLocalScale( index, getRelativeScale() );
+	pose->setAnimated( index, isAnimated() );
+	mPose = pose;
+	mPoseIndex = index;
 }
 
 void Node::addChild( NodeRef node )
@@ -214,14 +251,20 @@ void Node::animate( float time, int trackId )
 	mTime = time;
 	mIsAnimated = false;
 	if( hasAnimations( trackId ) ) {
-		mAnimTracks[trackId]->getValues( mTime,
-										&mRelativePosition,
-										&mRelativeRotation,
-										&mRelativeScale);
+		vec3 position, scale;
+		quat rotation;
+		mAnimTracks[trackId]->getValues( mTime, &position, &rotation, &scale );
+		setRelativePosition( position );
+		setRelativeRotation( rotation );
+		setRelativeScale( scale );
 		mIsAnimated = true;
 	}
-	requestSubtreeUpdate();
-	update();
+	if( mPose ) {
+		mPose->setAnimated( mPoseIndex, mIsAnimated );
+	} else {
+		requestSubtreeUpdate();
+		update();
+	}
 }
 
 void Node::blendAnimate( float time, const std::unordered_map<int, float>& weights )
@@ -231,30 +274,43 @@ void Node::blendAnimate( float time, const std::unordered_map<int, float>& weigh
 	// We accumulate transformations from each animation track with a weighted sum
 	// and use the result if at least on node was animated.
 	vec3 weightedPosition;
-	quat weightedRotation;
+	// Rotations are summed in one hemisphere and normalized (nlerp), independently of the order of the weights.
+	quat weightedRotation( 0, 0, 0, 0 );
 	vec3 weightedScale;
 	
-	float w;
+	vec3 translation, scale;
+	quat rotation;
 	for( auto& kv : weights ) {
-		if( hasAnimations( kv.first ) ) {
+		auto track = mAnimTracks.find( kv.first );
+		if( track != mAnimTracks.end() ) {
 			mIsAnimated = true;
-			w = kv.second;
-			weightedPosition += w * mAnimTracks.at( kv.first )->getTranslation( time );
-			weightedRotation = glm::slerp( weightedRotation, mAnimTracks.at( kv.first )->getRotation( time ), w );
-			weightedScale	 += w * mAnimTracks.at( kv.first )->getScaling( time );
+			const float w = kv.second;
+			track->second->getValues( time, &translation, &rotation, &scale );
+			weightedPosition += w * translation;
+			weightedRotation += ( glm::dot( weightedRotation, rotation ) < 0.0f ? -w : w ) * rotation;
+			weightedScale	 += w * scale;
 		}
 	}
 	if( mIsAnimated ) {
-		mRelativePosition = weightedPosition;
-		mRelativeRotation = weightedRotation;
-		mRelativeScale = weightedScale;
+		setRelativePosition( weightedPosition );
+		setRelativeRotation( glm::normalize( weightedRotation ) );
+		setRelativeScale( weightedScale );
+	}
+	if( mPose ) {
+		mPose->setAnimated( mPoseIndex, mIsAnimated );
+	} else {
+		requestSubtreeUpdate();
+		update();
 	}
-	requestSubtreeUpdate();
-	update();
 }
 
 void Node::requestSubtreeUpdate()
 {
+	if( mPose ) {
+		// World transformations live in the pose, which recomputes them all at once.
+		mPose->invalidate();
+		return;
+	}
 	mNeedsUpdate = true;
 	
 	for( auto childNode : mChildren ) {
@@ -9,6 +9,7 @@
 #pragma once
 
 #include "AnimTrack.h"
+#include "Pose.h"
 
 #include "cinder/Matrix44.h"
 
@@ -22,6 +23,9 @@ typedef std::shared_ptr<class Node> NodeRef;
 
 class Node {
 public:
+	friend class ModelCache;
+	friend class Skeleton;
+
 	static NodeRef create( const glm::vec3& position, const glm::quat& rotation, glm::vec3 scale = glm::vec3( 1 ),
 		const std::string& name = "", NodeRef parent = nullptr, size_t level = 0 );
 
@@ -43,9 +47,9 @@ public:
 	const std::string&	getName() const { return mName; }
 	void				setName( const std::string& name ) { mName = name; }
 	
-	const glm::vec3&		getRelativePosition() const { return mRelativePosition; }
-	const glm::quat&		getRelativeRotation() const { return mRelativeRotation; }
-	const glm::vec3&		getRelativeScale() const { return mRelativeScale; }
+	const glm::vec3&		getRelativePosition() const { return mPose ? mPose->getLocalPosition( mPoseIndex ) : mRelativePosition; }
+	const glm::quat&		getRelativeRotation() const { return mPose ? mPose->getLocalRotation( mPoseIndex ) : mRelativeRotation; }
+	const glm::vec3&		getRelativeScale() const { return mPose ? mPose->getLocalScale( mPoseIndex ) : mRelativeScale; }
 	const glm::vec3&		getInitialRelativePosition() const { return mInitialRelativePosition; }
 	const glm::quat&		getInitialRelativeRotation() const { return mInitialRelativeRotation; }
 	const glm::vec3&		getInitialRelativeScale() const { return mInitialRelativeScale; }
@@ -78,8 +82,14 @@ public:
 	void	addRotationKeyframe( int trackId, float time, const glm::quat& rotation  );
 	void	addScalingKeyframe( int trackId, float time, const glm::vec3& scaling );
 	
-	bool	isAnimated() const { return mIsAnimated; }
-	float	getTime() { return mTime; }
+	const std::unordered_map<int, std::shared_ptr<AnimTrack>>&	getAnimTracks() const { return mAnimTracks; }
+	
+	bool	isAnimated() const { return mPose ? mPose->isAnimated( mPoseIndex ) : mIsAnimated; }
+	float	getTime() { return mPose ? mPose->getTime() : mTime; }
+	
+	//! The pose this node is a view over (once part of a Skeleton), null otherwise.
+	const PoseRef&	getPose() const { return mPose; }
+	size_t			getPoseIndex() const { return mPoseIndex; }
 	
 	/*! 
 	 *  Update the relative and absolute transformations using animation curves (if animated).
@@ -110,6 +120,8 @@ protected:
 	static void computeTransformation( const glm::vec3& t, const glm::quat& r, const glm::vec3& s,  glm::mat4* transformation );
 
 	void	update() const;
+	//! Moves the relative transformation into slot \a index of \a pose, which then owns it.
+	void	bindPose( const PoseRef& pose, size_t index );
 	void	requestSubtreeUpdate();
 	bool	hasAnimations( int trackId = 0 ) const;
 	
@@ -137,6 +149,9 @@ protected:
 	size_t		mLevel;
 	size_t		mBoneIndex;
 	
+	PoseRef		mPose;
+	size_t		mPoseIndex;
+	
 	/*!
 	 * An unordered_map storing the different animation tracks with
 	 * their specific int trackId key.
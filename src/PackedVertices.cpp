@@ -0,0 +1,189 @@
+#include "PackedVertices.h"
+
+#include "cinder/CinderAssert.h"
+#include "cinder/Log.h"
+#include "cinder/gl/Vbo.h"
+
+#include "glm/gtc/packing.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <limits>
+
+using namespace model;
+using namespace ci;
+
+namespace {
+	
+	float signNotZero( float v )
+	{
+		return ( v >= 0.0f ) ? 1.0f : -1.0f;
+	}
+	
+	//! Maps a unit vector onto the [-1,1] square of the octahedral parameterization.
+	vec2 encodeOctahedral( const vec3& v )
+	{
+		float l1 = std::abs( v.x ) + std::abs( v.y ) + std::abs( v.z );
+		if( l1 <= 0.0f ) {
+			return vec2( 0.0f );
+		}
+		vec2 e( v.x / l1, v.y / l1 );
+		if( v.z < 0.0f ) {
+			e = vec2( ( 1.0f - std::abs( e.y ) ) * signNotZero( e.x ), ( 1.0f - std::abs( e.x ) ) * signNotZero( e.y ) );
+		}
+		return e;
+	}
+	
+	uint32_t packUnorm15( float v )
+	{
+		return uint32_t( std::round( glm::clamp( v * 0.5f + 0.5f, 0.0f, 1.0f ) * 32767.0f ) );
+	}
+	
+	//! Quantizes weights summing to 1 so that they still sum to \a one.
+	template<typename T>
+	void quantizeWeights( const vec4& weights, float one, T* out )
+	{
+		int total = 0, largest = 0;
+		for( int i = 0; i < 4; ++i ) {
+			out[i] = T( std::round( glm::clamp( weights[i], 0.0f, 1.0f ) * one ) );
+			total += int( out[i] );
+			if( weights[i] > weights[largest] ) {
+				largest = i;
+			}
+		}
+		if( total > 0 ) {
+			out[largest] = T( glm::clamp( int( out[largest] ) + int( one ) - total, 0, int( one ) ) );
+		}
+	}
+	
+	template<typename T>
+	void store( uint8_t* vertex, size_t offset, const T& value )
+	{
+		std::memcpy( vertex + offset, &value, sizeof( T ) );
+	}
+	
+} // anonymous namespace
+
+PackedVerticesRef PackedVertices::create( const SectionSource& source, const Format& format )
+{
+	auto start = std::chrono::steady_clock::now();
+	
+	PackedVerticesRef packed( new PackedVertices );
+	const size_t numVertices = source.mPositions.size();
+	packed->mNumVertices = numVertices;
+	
+	const size_t numNormals = std::min( source.mNormals.size(), numVertices );
+	const size_t numTangents = std::min( numNormals, std::min( source.mTangents.size(), numVertices ) );
+	const size_t numTexCoords = std::min( source.mTexCoords.size(), numVertices );
+	const size_t numColors = std::min( source.mColors.size(), numVertices );
+	const size_t numBoneIndices = std::min( source.mBoneIndices.size(), numVertices );
+	const size_t numBoneWeights = std::min( source.mBoneWeights.size(), numVertices );
+	
+	// What loadInto() would emit, for comparison.
+	packed->mUnpackedBytes = numVertices * sizeof( vec3 ) + numNormals * sizeof( vec3 ) + source.mTangents.size() * sizeof( vec3 )
+							+ source.mBitangents.size() * sizeof( vec3 ) + numTexCoords * sizeof( vec2 ) + numColors * sizeof( Colorf )
+							+ numBoneIndices * sizeof( vec4 ) + numBoneWeights * sizeof( vec4 ) + source.mIndices.size() * sizeof( uint32_t );
+	
+	// Interleaved layout: the position, then one int per packed attribute (two for 16-bit weights).
+	size_t stride = sizeof( vec3 );
+	const size_t normalOffset = stride;			stride += numNormals ? 4 : 0;
+	const size_t tangentOffset = stride;		stride += numTangents ? 4 : 0;
+	const size_t texCoordOffset = stride;		stride += numTexCoords ? 4 : 0;
+	const size_t colorOffset = stride;			stride += numColors ? 4 : 0;
+	const size_t boneIndexOffset = stride;		stride += numBoneIndices ? 4 : 0;
+	const size_t boneWeightOffset = stride;		stride += numBoneWeights ? ( format.mWeights16 ? 8 : 4 ) : 0;
+	packed->mStride = stride;
+	
+	auto& layout = packed->mLayout;
+	layout.append( geom::Attrib::POSITION, geom::DataType::FLOAT, 3, stride, 0 );
+	if( numNormals )
+		layout.append( geom::Attrib::NORMAL, geom::DataType::INTEGER, 1, stride, normalOffset );
+	if( numTangents )
+		layout.append( geom::Attrib::TANGENT, geom::DataType::INTEGER, 1, stride, tangentOffset );
+	if( numTexCoords )
+		layout.append( geom::Attrib::TEX_COORD_0, geom::DataType::INTEGER, 1, stride, texCoordOffset );
+	if( numColors )
+		layout.append( geom::Attrib::COLOR, geom::DataType::INTEGER, 1, stride, colorOffset );
+	if( numBoneIndices )
+		layout.append( geom::Attrib::BONE_INDEX, geom::DataType::INTEGER, 1, stride, boneIndexOffset );
+	if( numBoneWeights )
+		layout.append( geom::Attrib::BONE_WEIGHT, geom::DataType::INTEGER, format.mWeights16 ? 2 : 1, stride, boneWeightOffset );
+	
+	// Vertices without some attribute (shorter source arrays) keep zeros.
+	packed->mVertexData.assign( numVertices * stride, 0 );
+	for( size_t v = 0; v < numVertices; ++v ) {
+		uint8_t* vertex = &packed->mVertexData[v * stride];
+		store( vertex, 0, source.mPositions[v] );
+		
+		if( v < numNormals ) {
+			const vec3& normal = source.mNormals[v];
+			store( vertex, normalOffset, glm::packSnorm2x16( encodeOctahedral( normal ) ) );
+			if( v < numTangents ) {
+				const vec3& tangent = source.mTangents[v];
+				bool flipped = ( v < source.mBitangents.size() ) && glm::dot( glm::cross( normal, tangent ), source.mBitangents[v] ) < 0.0f;
+				vec2 e = encodeOctahedral( tangent );
+				store( vertex, tangentOffset, packUnorm15( e.x ) | ( packUnorm15( e.y ) << 15 ) | ( flipped ? 0x80000000u : 0u ) );
+			}
+		}
+		if( v < numTexCoords ) {
+			store( vertex, texCoordOffset, glm::packHalf2x16( source.mTexCoords[v] ) );
+		}
+		if( v < numColors ) {
+			const Colorf& color = source.mColors[v];
+			store( vertex, colorOffset, glm::packUnorm4x8( vec4( color.r, color.g, color.b, 1.0f ) ) );
+		}
+		if( v < numBoneIndices ) {
+			const vec4& indices = source.mBoneIndices[v];
+			uint32_t packedIndices = 0;
+			for( int i = 0; i < 4; ++i ) {
+				CI_ASSERT_MSG( indices[i] >= 0.0f && indices[i] < 256.0f, "Packed vertices support up to 256 bones." );
+				packedIndices |= uint32_t( glm::clamp( indices[i], 0.0f, 255.0f ) ) << ( 8 * i );
+			}
+			store( vertex, boneIndexOffset, packedIndices );
+		}
+		if( v < numBoneWeights ) {
+			if( format.mWeights16 ) {
+				uint16_t weights[4];
+				quantizeWeights( source.mBoneWeights[v], 65535.0f, weights );
+				store( vertex, boneWeightOffset, weights );
+			}
+			else {
+				uint8_t weights[4];
+				quantizeWeights( source.mBoneWeights[v], 255.0f, weights );
+				store( vertex, boneWeightOffset, weights );
+			}
+		}
+	}
+	
+	if( numVertices <= std::numeric_limits<uint16_t>::max() ) {
+		packed->mIndices16.assign( source.mIndices.begin(), source.mIndices.end() );
+	}
+	else {
+		packed->mIndices32 = source.mIndices;
+	}
+	
+	packed->mPackingSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+	CI_LOG_V( "Packed section '" << source.getName() << "': " << packed->getUnpackedBytes() << " to " << packed->getPackedBytes()
+			 << " bytes in " << packed->mPackingSeconds * 1000.0 << " ms" );
+	return packed;
+}
+
+size_t PackedVertices::getPackedBytes() const
+{
+	return mVertexData.size() + mIndices16.size() * sizeof( uint16_t ) + mIndices32.size() * sizeof( uint32_t );
+}
+
+gl::VboMeshRef PackedVertices::createVboMesh() const
+{
+	auto vertexVbo = gl::Vbo::create( GL_ARRAY_BUFFER, mVertexData.size(), mVertexData.data(), GL_STATIC_DRAW );
+	gl::VboRef indexVbo;
+	if( ! mIndices16.empty() ) {
+		indexVbo = gl::Vbo::create( GL_ELEMENT_ARRAY_BUFFER, mIndices16.size() * sizeof( uint16_t ), mIndices16.data(), GL_STATIC_DRAW );
+	}
+	else if( ! mIndices32.empty() ) {
+		indexVbo = gl::Vbo::create( GL_ELEMENT_ARRAY_BUFFER, mIndices32.size() * sizeof( uint32_t ), mIndices32.data(), GL_STATIC_DRAW );
+	}
+	return gl::VboMesh::create( uint32_t( mNumVertices ), GL_TRIANGLES, { { mLayout, vertexVbo } }, uint32_t( getNumIndices() ),
+							   has16BitIndices() ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, indexVbo );
+}
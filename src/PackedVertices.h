@@ -0,0 +1,69 @@
+#pragma once
+
+#include "ModelIo.h"
+
+#include "cinder/GeomIo.h"
+#include "cinder/gl/VboMesh.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace model {
+
+typedef std::shared_ptr<class PackedVertices> PackedVerticesRef;
+
+/*!
+ * Compact, interleaved copy of a SectionSource ready for upload, about a third of the size of the
+ * separate float streams emitted by SectionSource::loadInto(). Per vertex:
+ * - POSITION: 3 floats
+ * - NORMAL: octahedral, 2 x snorm16 in one int
+ * - TANGENT: octahedral, 2 x unorm15 and the bitangent sign (bit 31) in one int, replacing BITANGENT
+ * - TEX_COORD_0: 2 half floats in one int
+ * - COLOR: 4 x unorm8 in one int
+ * - BONE_INDEX: 4 x uint8 in one int
+ * - BONE_WEIGHT: 4 x unorm8 in one int, or 4 x unorm16 in two with Format::weights16()
+ * Packed attributes are integers and need the packed_*.glsl shaders, which decode them. packed_skinning_vert.glsl reads
+ * unorm16 weights when compiled with WEIGHTS16 defined, as Renderer's PACKED_SKELETAL_WEIGHTS16 shader is.
+ * Indices are 16-bit when the section has fewer than 65536 vertices.
+ */
+class PackedVertices {
+public:
+	struct Format {
+		Format() : mWeights16( false ) { }
+		//! Stores bone weights as unorm16 instead of unorm8.
+		Format& weights16( bool weights16 ) { mWeights16 = weights16; return *this; }
+		
+		bool mWeights16;
+	};
+	
+	static PackedVerticesRef create( const SectionSource& source, const Format& format = Format() );
+	
+	size_t							getNumVertices() const { return mNumVertices; }
+	size_t							getStride() const { return mStride; }
+	const std::vector<uint8_t>&		getVertexData() const { return mVertexData; }
+	const ci::geom::BufferLayout&	getLayout() const { return mLayout; }
+	
+	size_t							getNumIndices() const { return mIndices32.empty() ? mIndices16.size() : mIndices32.size(); }
+	bool							has16BitIndices() const { return mIndices32.empty(); }
+	
+	//! Bytes of the packed vertices and indices.
+	size_t							getPackedBytes() const;
+	//! Bytes SectionSource::loadInto() emits for the same section.
+	size_t							getUnpackedBytes() const { return mUnpackedBytes; }
+	//! CPU time spent packing.
+	double							getPackingSeconds() const { return mPackingSeconds; }
+	
+	ci::gl::VboMeshRef				createVboMesh() const;
+protected:
+	PackedVertices() : mNumVertices( 0 ), mStride( 0 ), mUnpackedBytes( 0 ), mPackingSeconds( 0.0 ) { }
+	
+	size_t					mNumVertices, mStride;
+	std::vector<uint8_t>	mVertexData;
+	ci::geom::BufferLayout	mLayout;
+	std::vector<uint16_t>	mIndices16;
+	std::vector<uint32_t>	mIndices32;
+	size_t					mUnpackedBytes;
+	double					mPackingSeconds;
+};
+
+} //end namespace model
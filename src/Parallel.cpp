@@ -0,0 +1,169 @@
+#include "Parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace model {
+
+namespace {
+	//! A parallelFor in flight: the caller and any helping worker keep grabbing the next index until none is left.
+	class Job {
+	public:
+		Job( size_t count, const std::function<void( size_t )>& fn )
+		: mCount( count ), mFn( &fn ), mNext( 0 ), mFailed( false ), mNumHelpers( 0 )
+		{ }
+		
+		//! Runs on the calling thread, then waits for the helpers still busy with an index.
+		void runAndWait()
+		{
+			run();
+			std::unique_lock<std::mutex> lock( mMutex );
+			mHelpersDone.wait( lock, [this] { return mNumHelpers == 0; } );
+			if( mError ) {
+				std::rethrow_exception( mError );
+			}
+		}
+		
+		//! Runs on a worker. Workers reaching a job after its caller returned find no index left and never touch mFn.
+		void help()
+		{
+			{
+				std::lock_guard<std::mutex> lock( mMutex );
+				++mNumHelpers;
+			}
+			run();
+			{
+				std::lock_guard<std::mutex> lock( mMutex );
+				--mNumHelpers;
+			}
+			mHelpersDone.notify_all();
+		}
+	private:
+		void run()
+		{
+			size_t i;
+			while( ! mFailed && ( i = mNext++ ) < mCount ) {
+				try {
+					(*mFn)( i );
+				}
+				catch( ... ) {
+					std::lock_guard<std::mutex> lock( mMutex );
+					if( ! mError ) {
+						mError = std::current_exception();
+					}
+					mFailed = true;
+				}
+			}
+		}
+		
+		const size_t							mCount;
+		const std::function<void( size_t )>*	mFn;
+		std::atomic<size_t>						mNext;
+		std::atomic<bool>						mFailed;
+		
+		std::mutex								mMutex;
+		std::condition_variable					mHelpersDone;
+		size_t									mNumHelpers;
+		std::exception_ptr						mError;
+	};
+	
+	//! Worker threads shared by every parallelFor, started on first use rather than per call.
+	class WorkerPool {
+	public:
+		static WorkerPool& instance()
+		{
+			static WorkerPool pool;
+			return pool;
+		}
+		
+		size_t getNumWorkers() const { return mWorkers.size(); }
+		
+		void submit( const std::shared_ptr<Job>& job, size_t numHelpers )
+		{
+			{
+				std::lock_guard<std::mutex> lock( mMutex );
+				mQueue.insert( mQueue.end(), numHelpers, job );
+			}
+			mWorkAvailable.notify_all();
+		}
+	private:
+		WorkerPool()
+		: mStopping( false )
+		{
+			const size_t numWorkers = getDefaultNumThreads() - 1;
+			for( size_t t = 0; t < numWorkers; ++t ) {
+				mWorkers.emplace_back( [this] { work(); } );
+			}
+		}
+		
+		~WorkerPool()
+		{
+			{
+				std::lock_guard<std::mutex> lock( mMutex );
+				mStopping = true;
+			}
+			mWorkAvailable.notify_all();
+			for( auto& worker : mWorkers ) {
+				worker.join();
+			}
+		}
+		
+		void work()
+		{
+			for(;;) {
+				std::shared_ptr<Job> job;
+				{
+					std::unique_lock<std::mutex> lock( mMutex );
+					mWorkAvailable.wait( lock, [this] { return mStopping || ! mQueue.empty(); } );
+					if( mQueue.empty() ) {
+						return;
+					}
+					job = mQueue.front();
+					mQueue.pop_front();
+				}
+				job->help();
+			}
+		}
+		
+		std::vector<std::thread>			mWorkers;
+		std::deque<std::shared_ptr<Job>>	mQueue;
+		std::mutex							mMutex;
+		std::condition_variable				mWorkAvailable;
+		bool								mStopping;
+	};
+} // anonymous namespace
+
+size_t getDefaultNumThreads()
+{
+	return std::max<size_t>( 1, std::thread::hardware_concurrency() );
+}
+
+void parallelFor( size_t count, size_t numThreads, const std::function<void( size_t )>& fn )
+{
+	if( numThreads == 0 ) {
+		numThreads = getDefaultNumThreads();
+	}
+	numThreads = std::min( numThreads, count );
+	
+	if( numThreads <= 1 ) {
+		for( size_t i = 0; i < count; ++i ) {
+			fn( i );
+		}
+		return;
+	}
+	
+	// The calling thread takes part, so nested or concurrent loops still progress when every worker is busy.
+	WorkerPool& pool = WorkerPool::instance();
+	auto job = std::make_shared<Job>( count, fn );
+	pool.submit( job, std::min( numThreads - 1, pool.getNumWorkers() ) );
+	job->runAndWait();
+}
+	
+} //end namespace model
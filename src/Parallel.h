@@ -0,0 +1,20 @@
+#pragma once
+
+#include <functional>
+#include <cstddef>
+
+namespace model {
+
+	//! Number of worker threads used when a caller asks for 0 (i.e. "as many as the hardware allows").
+	size_t	getDefaultNumThreads();
+	
+	/*!
+	 * Calls \a fn for every index in [0, count) using up to \a numThreads threads, the calling one included.
+	 * Threads grab the next pending index from a shared atomic counter as soon as they are done with the
+	 * previous one, so uneven workloads stay balanced. This is dynamic scheduling rather than work-stealing:
+	 * with one index per fetch there are no per-thread queues to steal from. The first exception thrown by \a fn stops the loop and is rethrown here.
+	 * Helper threads come from a pool shared by every call, which makes per-frame loops affordable.
+	 */
+	void	parallelFor( size_t count, size_t numThreads, const std::function<void( size_t )>& fn );
+	
+} //end namespace model
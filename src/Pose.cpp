@@ -0,0 +1,77 @@
+#include "Pose.h"
+
+#include "cinder/CinderAssert.h"
+
+using namespace model;
+using namespace ci;
+
+PoseRef Pose::create( const std::vector<int32_t>& parents )
+{
+	return PoseRef( new Pose( std::make_shared<std::vector<int32_t>>( parents ) ) );
+}
+
+PoseRef Pose::create( const std::shared_ptr<const std::vector<int32_t>>& parents )
+{
+	return PoseRef( new Pose( parents ) );
+}
+
+Pose::Pose( const std::shared_ptr<const std::vector<int32_t>>& parents )
+: mParents( parents )
+, mLocalPositions( parents->size() )
+, mLocalScales( parents->size(), vec3( 1 ) )
+, mLocalRotations( parents->size() )
+, mAnimated( parents->size(), 0 )
+, mTime( 0.0f )
+, mNeedsUpdate( true )
+, mWorldPositions( parents->size() )
+, mWorldScales( parents->size() )
+, mWorldRotations( parents->size() )
+{
+	for( size_t i = 0; i < mParents->size(); ++i ) {
+		CI_ASSERT_MSG( (*mParents)[i] < int32_t( i ), "Parents must precede their children." );
+	}
+}
+
+mat4 Pose::getWorldTransform( size_t index ) const
+{
+	update();
+	// translate( p ) * toMat4( r ) * scale( s ), without the two matrix products
+	mat4 transform = glm::toMat4( mWorldRotations[index] );
+	transform[0] *= mWorldScales[index].x;
+	transform[1] *= mWorldScales[index].y;
+	transform[2] *= mWorldScales[index].z;
+	transform[3] = vec4( mWorldPositions[index], 1.0f );
+	return transform;
+}
+
+void Pose::update() const
+{
+	if( ! mNeedsUpdate ) {
+		return;
+	}
+	
+	// Parents come first: their world transformation is always final by the time we reach a child.
+	const std::vector<int32_t>& parents = *mParents;
+	const size_t numNodes = parents.size();
+	for( size_t i = 0; i < numNodes; ++i ) {
+		const int32_t parent = parents[i];
+		if( parent >= 0 ) {
+			const quat& parentRotation = mWorldRotations[parent];
+			const vec3& parentScale = mWorldScales[parent];
+			mWorldRotations[i] = parentRotation * mLocalRotations[i];
+			mWorldScales[i] = mLocalScales[i] * parentScale;
+			mWorldPositions[i] = parentRotation * ( parentScale * mLocalPositions[i] ) + mWorldPositions[parent];
+		} else {
+			mWorldPositions[i] = mLocalPositions[i];
+			mWorldRotations[i] = mLocalRotations[i];
+			mWorldScales[i] = mLocalScales[i];
+		}
+	}
+	mNeedsUpdate = false;
+}
+
+size_t Pose::getMemorySize() const
+{
+	const size_t numNodes = mParents->size();
+	return sizeof( Pose ) + numNodes * ( 4 * sizeof( vec3 ) + 2 * sizeof( quat ) + sizeof( uint8_t ) );
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "cinder/Matrix.h"
+#include "cinder/Quaternion.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace model {
+
+typedef std::shared_ptr<class Pose> PoseRef;
+
+/*!
+ * Flat storage for the transformations of a node hierarchy.
+ * Nodes are stored parent-first (a node's parent always has a smaller index) and their
+ * transformations as separate position, rotation and scale arrays, so that every world
+ * transformation is computed in a single linear pass over the arrays.
+ * Nodes bound to a pose (see Skeleton) are views over their slot in it.
+ * World transformations are cached decomposed, like the local ones; matrices are built on request.
+ */
+class Pose {
+public:
+	//! \a parents holds the parent index of each node, -1 for roots. Parents must come before their children.
+	static PoseRef create( const std::vector<int32_t>& parents );
+	//! A pose referring to \a parents rather than copying them, e.g. shared by the instances of a skeleton.
+	static PoseRef create( const std::shared_ptr<const std::vector<int32_t>>& parents );
+	
+	size_t							getNumNodes() const { return mParents->size(); }
+	const std::vector<int32_t>&		getParents() const { return *mParents; }
+	
+	const glm::vec3&	getLocalPosition( size_t index ) const { return mLocalPositions[index]; }
+	const glm::quat&	getLocalRotation( size_t index ) const { return mLocalRotations[index]; }
+	const glm::vec3&	getLocalScale( size_t index ) const { return mLocalScales[index]; }
+	void				setLocalPosition( size_t index, const glm::vec3& position ) { mLocalPositions[index] = position; mNeedsUpdate = true; }
+	void				setLocalRotation( size_t index, const glm::quat& rotation ) { mLocalRotations[index] = rotation; mNeedsUpdate = true; }
+	void				setLocalScale( size_t index, const glm::vec3& scale ) { mLocalScales[index] = scale; mNeedsUpdate = true; }
+	
+	//! Direct access to the local transformations, for bulk writes. Call invalidate() afterwards.
+	glm::vec3*			getLocalPositions() { return mLocalPositions.data(); }
+	glm::quat*			getLocalRotations() { return mLocalRotations.data(); }
+	glm::vec3*			getLocalScales() { return mLocalScales.data(); }
+	void				invalidate() { mNeedsUpdate = true; }
+	
+	//! World transformations, updated on demand.
+	const glm::vec3&	getWorldPosition( size_t index ) const { update(); return mWorldPositions[index]; }
+	const glm::quat&	getWorldRotation( size_t index ) const { update(); return mWorldRotations[index]; }
+	const glm::vec3&	getWorldScale( size_t index ) const { update(); return mWorldScales[index]; }
+	glm::mat4			getWorldTransform( size_t index ) const;
+	
+	//! Whether the last animation pass found a track for the node.
+	bool				isAnimated( size_t index ) const { return mAnimated[index] != 0; }
+	void				setAnimated( size_t index, bool animated ) { mAnimated[index] = animated; }
+	float				getTime() const { return mTime; }
+	void				setTime( float time ) { mTime = time; }
+	
+	//! Recomputes every world transformation if a local one changed since the last update.
+	void				update() const;
+	//! Bytes owned by the pose, i.e. without the parents it refers to.
+	size_t				getMemorySize() const;
+protected:
+	explicit Pose( const std::shared_ptr<const std::vector<int32_t>>& parents );
+	
+	std::shared_ptr<const std::vector<int32_t>>	mParents;
+	std::vector<glm::vec3>			mLocalPositions, mLocalScales;
+	std::vector<glm::quat>			mLocalRotations;
+	std::vector<uint8_t>			mAnimated;
+	float							mTime;
+	
+	mutable bool					mNeedsUpdate;
+	mutable std::vector<glm::vec3>	mWorldPositions, mWorldScales;
+	mutable std::vector<glm::quat>	mWorldRotations;
+};
+
+} //end namespace model
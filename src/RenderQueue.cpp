@@ -0,0 +1,169 @@
+#include "RenderQueue.h"
+#include "Renderer.h"
+
+#include "cinder/gl/gl.h"
+
+#include <algorithm>
+
+using namespace ci;
+using namespace model;
+
+namespace {
+
+	const size_t NUM_LIGHT_UNIFORMS = 4;
+	const size_t NUM_MATERIAL_UNIFORMS = 5;
+
+} // anonymous namespace
+
+void GlCommandRecorder::begin()
+{
+	gl::pushModelMatrix();
+}
+
+void GlCommandRecorder::end()
+{
+	if( mTexture ) {
+		mTexture->unbind();
+		mTexture.reset();
+	}
+	gl::disable( GL_CULL_FACE );
+	gl::popModelMatrix();
+}
+
+void GlCommandRecorder::bindShader( const gl::GlslProgRef& shader )
+{
+	CommandRecorder::bindShader( shader );
+	shader->bind();
+}
+
+void GlCommandRecorder::bindTexture( const gl::Texture2dRef& texture )
+{
+	CommandRecorder::bindTexture( texture );
+	if( texture ) {
+		texture->bind();
+	}
+	else if( mTexture ) {
+		mTexture->unbind();
+	}
+	mTexture = texture;
+}
+
+void GlCommandRecorder::setUniforms( const gl::GlslProgRef& shader, size_t numUniforms, const std::function<void( const gl::GlslProgRef& )>& setUniforms )
+{
+	CommandRecorder::setUniforms( shader, numUniforms, setUniforms );
+	setUniforms( shader );
+}
+
+void GlCommandRecorder::setCullFace( bool enabled )
+{
+	CommandRecorder::setCullFace( enabled );
+	gl::enable( GL_CULL_FACE, enabled );
+}
+
+void GlCommandRecorder::setModelMatrix( const mat4& modelMatrix )
+{
+	CommandRecorder::setModelMatrix( modelMatrix );
+	gl::setModelMatrix( modelMatrix );
+}
+
+void GlCommandRecorder::draw( const gl::BatchRef& batch, GLint first, GLsizei count )
+{
+	CommandRecorder::draw( batch, first, count );
+	batch->draw( first, count );
+}
+
+void RenderQueue::push( const ABatchSection& section, const gl::BatchRef& batch, const MeshUniforms& meshUniforms, GLint first, GLsizei count )
+{
+	// The light moves along with the model-view, as when drawing right away.
+	const vec4 lightPosition = gl::getModelView() * vec4( Renderer::getLight()->position, 1 );
+	mat4 modelMatrix = gl::getModelMatrix();
+	if( section.hasDefaultTransformation() ) {
+		modelMatrix *= section.getDefaultTranformation();
+	}
+	mItems.push_back( Item{ batch, first, count, section.getTexture(), findMaterial( section.getMaterial() ), modelMatrix, lightPosition, meshUniforms } );
+}
+
+size_t RenderQueue::findMaterial( const Material& material )
+{
+	// A handful of materials per frame: a scan beats hashing.
+	auto found = std::find( mMaterials.begin(), mMaterials.end(), material );
+	if( found != mMaterials.end() ) {
+		return size_t( found - mMaterials.begin() );
+	}
+	mMaterials.push_back( material );
+	return mMaterials.size() - 1;
+}
+
+void RenderQueue::flush( CommandRecorder* recorder )
+{
+	if( mItems.empty() ) {
+		return;
+	}
+	
+	mOrder.resize( mItems.size() );
+	for( size_t i = 0; i < mOrder.size(); ++i ) {
+		mOrder[i] = i;
+	}
+	// Stable, so that draws in the same state keep their order.
+	std::stable_sort( mOrder.begin(), mOrder.end(), [this] ( size_t lhs, size_t rhs ) {
+		const Item& a = mItems[lhs];
+		const Item& b = mItems[rhs];
+		if( a.mBatch->getGlslProg() != b.mBatch->getGlslProg() )
+			return a.mBatch->getGlslProg() < b.mBatch->getGlslProg();
+		if( a.mMeshUniforms.mKey != b.mMeshUniforms.mKey )
+			return std::less<const void*>()( a.mMeshUniforms.mKey, b.mMeshUniforms.mKey );
+		if( a.mTexture != b.mTexture )
+			return a.mTexture < b.mTexture;
+		return a.mMaterial < b.mMaterial;
+	} );
+
+	recorder->begin();
+	recorder->setCullFace( true );
+	gl::GlslProgRef shader;
+	gl::Texture2dRef texture;
+	const Item* previous = nullptr;
+	for( size_t index : mOrder ) {
+		const Item& item = mItems[index];
+		// Uniforms belong to a program: a new one starts from scratch.
+		const bool newShader = ( item.mBatch->getGlslProg() != shader );
+		if( newShader ) {
+			shader = item.mBatch->getGlslProg();
+			recorder->bindShader( shader );
+		}
+		if( newShader || item.mLightPosition != previous->mLightPosition ) {
+			const vec4 lightPosition = item.mLightPosition;
+			recorder->setUniforms( shader, NUM_LIGHT_UNIFORMS, [lightPosition] ( const gl::GlslProgRef& shader ) {
+				shader->uniform( "uDiffuseMap", 0 );
+				shader->uniform( "uLight.position", lightPosition );
+				shader->uniform( "uLight.diffuse", Renderer::getLight()->diffuse );
+				shader->uniform( "uLight.specular", Renderer::getLight()->specular );
+			} );
+		}
+		if( ( newShader || item.mMeshUniforms.mKey != previous->mMeshUniforms.mKey ) && item.mMeshUniforms.mSetUniforms ) {
+			recorder->setUniforms( shader, item.mMeshUniforms.mNumUniforms, item.mMeshUniforms.mSetUniforms );
+		}
+		if( item.mTexture != texture ) {
+			texture = item.mTexture;
+			recorder->bindTexture( texture );
+		}
+		if( newShader || item.mMaterial != previous->mMaterial ) {
+			const Material& material = mMaterials[item.mMaterial];
+			recorder->setUniforms( shader, NUM_MATERIAL_UNIFORMS, [material] ( const gl::GlslProgRef& shader ) {
+				shader->uniform( "uMaterial.ambient", material.getAmbient() );
+				shader->uniform( "uMaterial.diffuse", material.getDiffuse() );
+				shader->uniform( "uMaterial.specular", material.getSpecular() );
+				shader->uniform( "uMaterial.emission", material.getEmission() );
+				shader->uniform( "uMaterial.shininess", material.getShininess() );
+			} );
+		}
+		if( previous == nullptr || item.mModelMatrix != previous->mModelMatrix ) {
+			recorder->setModelMatrix( item.mModelMatrix );
+		}
+		recorder->draw( item.mBatch, item.mFirst, item.mCount );
+		previous = &item;
+	}
+	recorder->end();
+
+	mItems.clear();
+	mMaterials.clear();
+}
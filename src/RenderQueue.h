@@ -0,0 +1,125 @@
+#pragma once
+
+#include "AMeshSection.h"
+
+#include "cinder/gl/Batch.h"
+#include "cinder/gl/GlslProg.h"
+#include "cinder/gl/Texture.h"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace model {
+
+	typedef std::shared_ptr<class CommandRecorder> CommandRecorderRef;
+
+	/*!
+	 * Receives what a RenderQueue submits. The base class only counts the calls, which needs no GL context
+	 * (i.e. to measure submissions headlessly); GlCommandRecorder also issues them.
+	 */
+	class CommandRecorder {
+	public:
+		struct Stats {
+			Stats() : mNumDraws( 0 ), mNumShaderBinds( 0 ), mNumTextureBinds( 0 ), mNumUniforms( 0 ), mNumMatrixChanges( 0 ), mNumStateChanges( 0 ) { }
+			//! Everything but the draws.
+			size_t	getNumChanges() const { return mNumShaderBinds + mNumTextureBinds + mNumUniforms + mNumMatrixChanges + mNumStateChanges; }
+
+			size_t	mNumDraws, mNumShaderBinds, mNumTextureBinds, mNumUniforms, mNumMatrixChanges, mNumStateChanges;
+		};
+
+		static CommandRecorderRef create() { return CommandRecorderRef( new CommandRecorder ); }
+		virtual ~CommandRecorder() { }
+
+		//! Bracket every flush of a RenderQueue.
+		virtual void	begin() { }
+		virtual void	end() { }
+
+		virtual void	bindShader( const ci::gl::GlslProgRef& /*shader*/ ) { ++mStats.mNumShaderBinds; }
+		//! A null \a texture unbinds the previous one.
+		virtual void	bindTexture( const ci::gl::Texture2dRef& /*texture*/ ) { ++mStats.mNumTextureBinds; }
+		//! \a setUniforms sets \a numUniforms uniforms of \a shader; recorders which don't issue GL calls don't call it.
+		virtual void	setUniforms( const ci::gl::GlslProgRef& /*shader*/, size_t numUniforms, const std::function<void( const ci::gl::GlslProgRef& )>& /*setUniforms*/ ) { mStats.mNumUniforms += numUniforms; }
+		virtual void	setCullFace( bool /*enabled*/ ) { ++mStats.mNumStateChanges; }
+		virtual void	setModelMatrix( const glm::mat4& /*modelMatrix*/ ) { ++mStats.mNumMatrixChanges; }
+		//! Draws \a count indices from \a first, or the whole batch if \a count is negative.
+		virtual void	draw( const ci::gl::BatchRef& /*batch*/, GLint /*first*/, GLsizei /*count*/ ) { ++mStats.mNumDraws; }
+
+		const Stats&	getStats() const { return mStats; }
+		void			resetStats() { mStats = Stats(); }
+	protected:
+		CommandRecorder() { }
+
+		Stats	mStats;
+	};
+
+	//! Issues the commands to the current GL context, counting them too.
+	class GlCommandRecorder : public CommandRecorder {
+	public:
+		static CommandRecorderRef create() { return CommandRecorderRef( new GlCommandRecorder ); }
+
+		void	begin() override;
+		void	end() override;
+
+		void	bindShader( const ci::gl::GlslProgRef& shader ) override;
+		void	bindTexture( const ci::gl::Texture2dRef& texture ) override;
+		void	setUniforms( const ci::gl::GlslProgRef& shader, size_t numUniforms, const std::function<void( const ci::gl::GlslProgRef& )>& setUniforms ) override;
+		void	setCullFace( bool enabled ) override;
+		void	setModelMatrix( const glm::mat4& modelMatrix ) override;
+		void	draw( const ci::gl::BatchRef& batch, GLint first, GLsizei count ) override;
+	protected:
+		GlCommandRecorder() { }
+
+		ci::gl::Texture2dRef	mTexture;
+	};
+
+	/*!
+	 * Collects the draws of mesh sections, then submits them sorted by shader, mesh uniforms, texture and material,
+	 * skipping every shader, texture, uniform, matrix and state change which would set what is already set.
+	 */
+	class RenderQueue {
+	public:
+		//! Uniforms shared by the sections of a mesh (i.e. bone matrices), set once per run of its sections.
+		struct MeshUniforms {
+			MeshUniforms() : mKey( nullptr ), mNumUniforms( 0 ) { }
+			//! Identifies the values (i.e. a copy of the bone matrices taken by the draw); sections with the same key share them.
+			const void*		mKey;
+			size_t			mNumUniforms;
+			std::function<void( const ci::gl::GlslProgRef& )>	mSetUniforms;
+		};
+
+		RenderQueue() { }
+
+		/*!
+		 * Queues \a section drawn with \a batch (i.e. one of its levels of detail), \a count indices from \a first or all of them if negative.
+		 * The current model matrix and light position are captured here.
+		 */
+		void	push( const ABatchSection& section, const ci::gl::BatchRef& batch, const MeshUniforms& meshUniforms = MeshUniforms(), GLint first = 0, GLsizei count = -1 );
+		//! Sorts and submits the queued draws to \a recorder, then empties the queue.
+		void	flush( CommandRecorder* recorder );
+
+		bool	empty() const { return mItems.empty(); }
+		size_t	size() const { return mItems.size(); }
+	private:
+		struct Item {
+			ci::gl::BatchRef		mBatch;
+			GLint					mFirst;
+			GLsizei					mCount;
+			ci::gl::Texture2dRef	mTexture;
+			//! Index in mMaterials.
+			size_t					mMaterial;
+			glm::mat4				mModelMatrix;
+			//! In eye space.
+			glm::vec4				mLightPosition;
+			MeshUniforms			mMeshUniforms;
+		};
+
+		//! Index of \a material in mMaterials, which holds each distinct material once.
+		size_t	findMaterial( const ci::Material& material );
+
+		std::vector<Item>			mItems;
+		std::vector<ci::Material>	mMaterials;
+		std::vector<size_t>			mOrder;
+	};
+
+} //end namespace model
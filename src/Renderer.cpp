@@ -19,6 +19,9 @@
 #include "Node.h"
 #include "SkeletalMesh.h"
 
+#include <algorithm>
+#include <string>
+
 using namespace ci;
 using namespace model;
 
@@ -44,11 +47,21 @@ Renderer& Renderer::instance()
 }
 
 Renderer::Renderer()
+: mLodPixelError( 1.0f )
+, mRecorder( GlCommandRecorder::create() )
+, mQueueing( false )
+, mNumUploadedBoneMatrices( 0 )
 {
 	try {
 		mShaders[ MeshType::STATIC ]	= gl::GlslProg::create( app::loadAsset( "static_vert.glsl" ), app::loadAsset( "model_frag.glsl" ) );
 		mShaders[ MeshType::SKELETAL ]	= gl::GlslProg::create( app::loadAsset( "skinning_vert.glsl" ), app::loadAsset( "model_frag.glsl" ) );
 		mShaders[ MeshType::MORPHED ]	= gl::GlslProg::create( app::loadAsset( "morph_vert.glsl" ), app::loadAsset( "model_frag.glsl" ) );
+#if ! defined( CINDER_GL_ES )
+		mShaders[ MeshType::PACKED_STATIC ]		= gl::GlslProg::create( app::loadAsset( "packed_static_vert.glsl" ), app::loadAsset( "model_frag.glsl" ) );
+		mShaders[ MeshType::PACKED_SKELETAL ]	= gl::GlslProg::create( app::loadAsset( "packed_skinning_vert.glsl" ), app::loadAsset( "model_frag.glsl" ) );
+		mShaders[ MeshType::PACKED_SKELETAL_WEIGHTS16 ]	= gl::GlslProg::create( gl::GlslProg::Format().vertex( app::loadAsset( "packed_skinning_vert.glsl" ) )
+																.fragment( app::loadAsset( "model_frag.glsl" ) ).define( "WEIGHTS16" ) );
+#endif
 	}
 	catch( gl::GlslProgCompileExc &exc ) {
 		app::console() << "Shader compile error: " << std::endl;
@@ -56,38 +69,62 @@ Renderer::Renderer()
 	}
 }
 
-void Renderer::bindGlobalUniforms( const ci::gl::GlslProgRef& shader )
+void Renderer::flushQueue()
 {
-	shader->uniform( "uDiffuseMap", 0 );
-	shader->uniform( "uLight.position", gl::getModelView() *  vec4( mLight->position, 1 ) );
-	shader->uniform( "uLight.diffuse", mLight->diffuse );
-	shader->uniform( "uLight.specular", mLight->specular );
+	instance().mQueueing = false;
+	instance().mQueue.flush( instance().mRecorder.get() );
 }
 
-void Renderer::bindSectionUniforms( const std::shared_ptr<ABatchSection>& section, const ci::gl::GlslProgRef& shader )
+void Renderer::submit()
 {
-	shader->uniform( "uMaterial.ambient", section->getMaterial().getAmbient() );
-	shader->uniform( "uMaterial.diffuse", section->getMaterial().getDiffuse() );
-	shader->uniform( "uMaterial.specular", section->getMaterial().getSpecular() );
-	shader->uniform( "uMaterial.emission", section->getMaterial().getEmission() );
-	shader->uniform( "uMaterial.shininess", section->getMaterial().getShininess() );
+	if( ! instance().mQueueing ) {
+		instance().mQueue.flush( instance().mRecorder.get() );
+	}
 }
 
 void Renderer::draw( const StaticMeshRef& mesh, int sectionId )
 {
-	auto& shader = instance().mShaders.at( MeshType::STATIC );
-	gl::ScopedGlslProg prog( shader );
-	bindGlobalUniforms( shader );
-	
-	drawSections( mesh->getSections(), shader, sectionId );
+	drawSections( mesh->getSections(), sectionId );
+}
+
+void Renderer::draw( const StaticMeshRef& mesh, const ci::Camera& camera, int sectionId )
+{
+	auto& queue = instance().mQueue;
+	std::vector<MeshletRange> ranges;
+	int index = -1;
+	for( const auto& section : mesh->getSections() ) {
+		if( sectionId >= 0 && (sectionId != ++index) )
+			continue;
+		
+		mat4 modelMatrix = gl::getModelMatrix();
+		if( section->hasDefaultTransformation() ) {
+			modelMatrix *= section->getDefaultTranformation();
+		}
+		size_t lod = section->selectLod( camera, modelMatrix, instance().mLodPixelError );
+		if( lod > 0 || section->getMeshlets().empty() ) {
+			queue.push( *section, section->getLodBatch( lod ) );
+			continue;
+		}
+		MeshletCuller culler( camera, modelMatrix );
+		ranges.clear();
+		culler.cull( section->getMeshlets(), &ranges );
+		instance().mMeshletStats.merge( culler.getStats() );
+		for( const auto& range : ranges ) {
+			queue.push( *section, section->getBatch(), RenderQueue::MeshUniforms(), GLint( range.mFirstIndex ), GLsizei( range.mNumIndices ) );
+		}
+	}
+	submit();
 }
 
 void Renderer::draw( const SkeletalTriMeshRef& mesh, int sectionId )
 {
+	int index = -1;
 	for( const SkeletalTriMesh::SectionRef& section : mesh->getSections() ) {
-		auto drawMesh = [section] {
-			gl::Batch::create( *section->getTriMesh(),
-							   gl::getStockShader( gl::ShaderDef().color().texture() ) )->draw();
+		if( sectionId >= 0 && (sectionId != ++index) )
+			continue;
+		
+		auto drawMesh = [&section] {
+			section->prepareBatch()->draw();
 		};
 		drawSection( *section.get(), drawMesh);
 	}
@@ -95,37 +132,98 @@ void Renderer::draw( const SkeletalTriMeshRef& mesh, int sectionId )
 
 void Renderer::draw( const SkeletalMeshRef& mesh, int sectionId )
 {
-	auto& shader = instance().mShaders.at( MeshType::SKELETAL );
-	gl::ScopedGlslProg prog( shader );
-	bindGlobalUniforms( shader );
-	shader->uniform( "boneMats", mesh->getBoneMatrices().data(), SkeletalMesh::MAXBONES );
-	shader->uniform( "invTransposeMats", mesh->getInvTransposeMatrices().data(), SkeletalMesh::MAXBONES );
-	 
-	drawSections( mesh->getSections(), shader, sectionId );
+	int index = -1;
+	for( const auto& section : mesh->getSections() ) {
+		if( sectionId >= 0 && (sectionId != ++index) )
+			continue;
+		
+		// The palette is copied: a queued mesh may be updated and drawn again before the flush.
+		auto palette = std::make_shared<BonePalette>();
+		const size_t paletteSize = section->getBonePalette().size();
+		const mat4* matrices = mesh->getPaletteMatrices( *section );
+		const mat4* invTransposeMatrices = mesh->getPaletteInvTransposeMatrices( *section );
+		palette->mBoneMatrices.assign( matrices, matrices + paletteSize );
+		palette->mInvTransposeMatrices.assign( invTransposeMatrices, invTransposeMatrices + paletteSize );
+		
+		RenderQueue::MeshUniforms meshUniforms;
+		meshUniforms.mKey = palette.get();
+		meshUniforms.mNumUniforms = 2;
+		meshUniforms.mSetUniforms = [palette] ( const gl::GlslProgRef& shader ) {
+			uploadBonePalette( shader, *palette );
+		};
+		instance().mQueue.push( *section, section->getBatch(), meshUniforms );
+	}
+	submit();
+}
+
+void Renderer::uploadBonePalette( const gl::GlslProgRef& shader, const BonePalette& palette )
+{
+	auto& uploaded = instance().mUploadedPalettes[shader.get()];
+	if( uploaded.mShader.lock() != shader ) {
+		// Another program at the same address: nothing is known of its uniforms.
+		uploaded = UploadedPalette();
+		uploaded.mShader = shader;
+	}
+	uploadMatrices( shader, "boneMats", palette.mBoneMatrices, &uploaded.mPalette.mBoneMatrices );
+	uploadMatrices( shader, "invTransposeMats", palette.mInvTransposeMatrices, &uploaded.mPalette.mInvTransposeMatrices );
+}
+
+void Renderer::uploadMatrices( const gl::GlslProgRef& shader, const std::string& name, const std::vector<mat4>& matrices, std::vector<mat4>* uploaded )
+{
+	// One upload covering every changed slot.
+	const size_t count = std::min<size_t>( matrices.size(), SkeletalMesh::MAXBONES );
+	size_t first = count, last = 0;
+	for( size_t i = 0; i < count; ++i ) {
+		if( i >= uploaded->size() || matrices[i] != (*uploaded)[i] ) {
+			first = std::min( first, i );
+			last = i + 1;
+		}
+	}
+	if( first >= last ) {
+		return;
+	}
+	shader->uniform( shader->getUniformLocation( name + "[" + std::to_string( first ) + "]" ), &matrices[first], int( last - first ) );
+	if( uploaded->size() < last ) {
+		uploaded->resize( last );
+	}
+	std::copy( matrices.begin() + first, matrices.begin() + last, uploaded->begin() + first );
+	instance().mNumUploadedBoneMatrices += last - first;
 }
 
 void Renderer::draw( const MorphedMeshRef& mesh, int sectionId )
 {
-	
-	auto& shader = instance().mShaders.at( MeshType::MORPHED );
-	gl::ScopedGlslProg prog( shader );
-	bindGlobalUniforms( shader );
-	shader->uniform( "uWeights", mesh->getMorphTargetWeights().data(), MorphedMesh::MAXMORPHTARGETS );
-	
-	drawSections( mesh->getSections(), shader, sectionId );
+	RenderQueue::MeshUniforms meshUniforms;
+#if ! defined( CINDER_GL_ES )
+	auto weights = std::make_shared<std::vector<float>>( mesh->getMorphTargetWeights() );
+	meshUniforms.mKey = weights.get();
+	meshUniforms.mNumUniforms = 2;
+	// The weights are uploaded when the queue gets to the mesh, so that every draw keeps its own.
+	meshUniforms.mSetUniforms = [mesh, weights] ( const gl::GlslProgRef& shader ) {
+		mesh->bindMorphTextures( *weights );
+		shader->uniform( "uMorphDeltas", int( MorphedMesh::DELTAS_TEXTURE_UNIT ) );
+		shader->uniform( "uMorphWeights", int( MorphedMesh::WEIGHTS_TEXTURE_UNIT ) );
+	};
+#else
+	mesh->updatePositions();
+#endif
+	drawSections( mesh->getSections(), sectionId, meshUniforms );
 }
 
 void Renderer::draw( const SkeletonRef& skeleton, const std::string& rootNodeName )
 {
-	const NodeRef& root = ( !rootNodeName.empty() && skeleton->hasBone( rootNodeName ) ) ? skeleton->getBones().at(rootNodeName) : skeleton->getRootNode();
+	// Read through the pose, which is the skeleton's own even for an instance (see Skeleton::createInstance()).
+	const int32_t rootIndex = ( !rootNodeName.empty() && skeleton->hasBone( rootNodeName ) ) ? skeleton->getNodeIndex( rootNodeName ) : 0;
+	if( skeleton->getNodes().empty() || rootIndex < 0 ) {
+		return;
+	}
 	
 	gl::ScopedGlslProg bind( gl::getStockShader( gl::ShaderDef().color() ) );
 #if ! defined( CINDER_GL_ES )
 	bool wireframe = gl::isWireframeEnabled();
 	gl::enableWireframe();
 #endif
-	instance().drawAbsolute( skeleton, root );
-	instance().drawRelative( skeleton, root );
+	instance().drawAbsolute( skeleton, size_t( rootIndex ) );
+	instance().drawRelative( skeleton, size_t( rootIndex ) );
 #if ! defined( CINDER_GL_ES )
 	gl::setWireframeEnabled( wireframe );
 #endif
@@ -139,13 +237,14 @@ void Renderer::drawLabels( std::shared_ptr<Skeleton> skeleton, const CameraPersp
 	
 	const auto& modelMat = gl::getModelMatrix();
 	gl::setMatricesWindow( app::getWindowSize() );
-	skeleton->traverseNodes( [&] ( NodeRef n ) {
-		if( skeleton->isNodeVisible( n ) ) {
-			vec2 pos = camera.worldToScreen( vec3( modelMat *  vec4( n->getAbsolutePosition(), 1 ) ), app::getWindowWidth()
+	const auto& nodes = skeleton->getNodes();
+	for( size_t i = 0; i < nodes.size(); ++i ) {
+		if( skeleton->isNodeVisible( nodes[i] ) ) {
+			vec2 pos = camera.worldToScreen( vec3( modelMat *  vec4( skeleton->getPose()->getWorldPosition( i ), 1 ) ), app::getWindowWidth()
 											, app::getWindowHeight() );
-			gl::drawStringCentered( n->getName(), pos );
+			gl::drawStringCentered( nodes[i]->getName(), pos );
 		}
-	} );
+	}
 }
 
 void Renderer::drawSection( const AMeshSection& section, std::function<void()> drawMesh )
@@ -173,12 +272,29 @@ void Renderer::drawSection( const AMeshSection& section, std::function<void()> d
 	gl::disable( GL_CULL_FACE );
 }
 
-void Renderer::drawRelative( SkeletonRef skeleton, const NodeRef& node )
+size_t Renderer::findSubtreeEnd( const SkeletonRef& skeleton, size_t root )
 {
-	gl::ScopedMatrices push{};
-	gl::multModelMatrix( node->getRelativeTransformation() );
-	if( skeleton->isNodeVisible( node ) ) {
-		float scale = 0.2f * length( node->getRelativePosition() );
+	// Parent-first order: the subtree ends at the first node whose parent precedes the root.
+	const auto& parents = skeleton->getPose()->getParents();
+	size_t end = root + 1;
+	while( end < parents.size() && parents[end] >= int32_t( root ) ) {
+		++end;
+	}
+	return end;
+}
+
+void Renderer::drawRelative( const SkeletonRef& skeleton, size_t root )
+{
+	const PoseRef& pose = skeleton->getPose();
+	const auto& nodes = skeleton->getNodes();
+	const size_t end = findSubtreeEnd( skeleton, root );
+	for( size_t i = root; i < end; ++i ) {
+		if( ! skeleton->isNodeVisible( nodes[i] ) ) {
+			continue;
+		}
+		gl::ScopedModelMatrix push;
+		gl::multModelMatrix( pose->getWorldTransform( i ) );
+		float scale = 0.2f * length( pose->getLocalPosition( i ) );
 		gl::VertBatch vb(GL_LINES);
 		vb.color(1,0,0);
 		vb.vertex( vec3( 0 ) );
@@ -194,23 +310,20 @@ void Renderer::drawRelative( SkeletonRef skeleton, const NodeRef& node )
 		vb.vertex( vec3( 0, 0, scale ) );
 		vb.draw();
 	}
-	for( NodeRef child : node->getChildren() ) {
-		drawRelative( skeleton, child );
-	}
 }
 
-void Renderer::drawAbsolute( SkeletonRef skeleton, const NodeRef& node )
+void Renderer::drawAbsolute( const SkeletonRef& skeleton, size_t root )
 {
-	skeleton->traverseNodes( [skeleton] ( NodeRef n ) {
-		if( skeleton->isNodeVisible( n ) ) {
-			std::shared_ptr<Node> parent( n->getParent().lock() );
-			if( parent ) {
-				vec3 currentPos = n->getAbsolutePosition();
-				gl::color( n->isAnimated() ? Color(1.0f, 0.0f, 0.0f) : Color(0.0f, 1.0f, 0.0f) );
-				drawBone( currentPos, parent->getAbsolutePosition() );
-			}
+	const PoseRef& pose = skeleton->getPose();
+	const auto& parents = pose->getParents();
+	const auto& nodes = skeleton->getNodes();
+	const size_t end = findSubtreeEnd( skeleton, root );
+	for( size_t i = root; i < end; ++i ) {
+		if( skeleton->isNodeVisible( nodes[i] ) && parents[i] >= 0 ) {
+			gl::color( pose->isAnimated( i ) ? Color(1.0f, 0.0f, 0.0f) : Color(0.0f, 1.0f, 0.0f) );
+			drawBone( pose->getWorldPosition( i ), pose->getWorldPosition( parents[i] ) );
 		}
-	} );
+	}
 }
 
 void Renderer::drawBone( const vec3& start, const vec3& end )
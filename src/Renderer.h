@@ -4,6 +4,8 @@
 #include <memory>
 #include <mutex>
 #include <map>
+#include <string>
+#include <vector>
 
 #include "cinder/Camera.h"
 #include "cinder/gl/GlslProg.h"
@@ -15,6 +17,7 @@
 #include "MorphedMesh.h"
 #include "Skeleton.h"
 #include "Node.h"
+#include "RenderQueue.h"
 
 namespace model {
 	
@@ -31,7 +34,12 @@ namespace model {
 	enum MeshType {
 		STATIC,
 		SKELETAL,
-		MORPHED
+		MORPHED,
+		//! Decode the PackedVertices layout. Desktop OpenGL only.
+		PACKED_STATIC,
+		PACKED_SKELETAL,
+		//! PACKED_SKELETAL for bone weights packed with PackedVertices::Format::weights16().
+		PACKED_SKELETAL_WEIGHTS16
 	};
 	
 	class Renderer {
@@ -45,6 +53,14 @@ namespace model {
 		static void setShader( MeshType mtype, ci::gl::GlslProgRef shader ) { instance().mShaders[ mtype ] = shader; }
 		
 		static void		draw( const StaticMeshRef& mesh, int sectionId = -1 );
+		/*!
+		 * Draws each section at the level of detail selected for \a camera (see ABatchSection::selectLod()) and, at full detail,
+		 * only the meshlets \a camera may see.
+		 */
+		static void		draw( const StaticMeshRef& mesh, const ci::Camera& camera, int sectionId = -1 );
+		//! Screen-space error (in pixels) allowed when selecting levels of detail. 1 by default.
+		static void		setLodPixelError( float maxPixelError ) { instance().mLodPixelError = maxPixelError; }
+		static float	getLodPixelError() { return instance().mLodPixelError; }
 		static void		draw( const SkeletalTriMeshRef& mesh, int sectionId = -1 );
 		static void		draw( const SkeletalMeshRef& mesh, int sectionId = -1 );
 		static void		draw( const MorphedMeshRef& mesh, int sectionId = -1 );
@@ -55,36 +71,67 @@ namespace model {
 		
 		//! Render the node names.
 		static void		drawLabels( SkeletonRef skeleton, const ci::CameraPersp& camera );
+		
+		/*!
+		 * Mesh draws between beginQueue() and flushQueue() are queued, then submitted together sorted by shader, texture and material.
+		 * Otherwise each draw submits its own sections right away (still sorted).
+		 */
+		static void		beginQueue() { instance().mQueueing = true; }
+		static void		flushQueue();
+		//! Receives the submitted commands; a GlCommandRecorder by default. A plain CommandRecorder only counts them, without a GL context.
+		static void							setCommandRecorder( const CommandRecorderRef& recorder ) { instance().mRecorder = recorder; }
+		static const CommandRecorderRef&	getCommandRecorder() { return instance().mRecorder; }
+		//! Draws and state changes submitted since the last reset (i.e. once per frame).
+		static const CommandRecorder::Stats&	getCommandStats() { return instance().mRecorder->getStats(); }
+		static void								resetCommandStats() { instance().mRecorder->resetStats(); }
+		
+		//! Bone matrices (and normal matrices) actually uploaded by SkeletalMesh draws since the last reset; unchanged ones are skipped.
+		static size_t	getNumUploadedBoneMatrices() { return instance().mNumUploadedBoneMatrices; }
+		static void		resetNumUploadedBoneMatrices() { instance().mNumUploadedBoneMatrices = 0; }
+		
+		//! Meshlets tested and kept, and the time spent culling them, by the camera draws since the last reset (i.e. once per frame).
+		static const MeshletCuller::Stats&	getMeshletStats() { return instance().mMeshletStats; }
+		static void							resetMeshletStats() { instance().mMeshletStats = MeshletCuller::Stats(); }
 	protected:
 		Renderer();
 		Renderer( const Renderer& renderer );
 		Renderer& operator=( const Renderer& );
 								
-		static void bindGlobalUniforms( const ci::gl::GlslProgRef& shader );
-		static void bindSectionUniforms( const std::shared_ptr<ABatchSection>& section, const ci::gl::GlslProgRef& shader );
-		
 		template <class T>
-		static void drawSections( std::vector<T> sections, const ci::gl::GlslProgRef& shader, int sectionId ) {
+		static void drawSections( const std::vector<T>& sections, int sectionId, const RenderQueue::MeshUniforms& meshUniforms = RenderQueue::MeshUniforms() ) {
 			int index = -1;
-			for( auto& section : sections ) {
+			for( const auto& section : sections ) {
 				if( sectionId >= 0 && (sectionId != ++index) )
 					continue;
 				
-				auto drawMesh = [&] {
-					bindSectionUniforms( section, shader );
-					section->getBatch()->draw();
-				};
-				drawSection( *section.get(), drawMesh );
+				instance().mQueue.push( *section, section->getBatch(), meshUniforms );
 			}
+			submit();
 		}
+		//! Flushes the queue unless between beginQueue() and flushQueue().
+		static void submit();
+		
+		struct BonePalette {
+			std::vector<glm::mat4>	mBoneMatrices, mInvTransposeMatrices;
+		};
+		//! What a program's palette uniforms hold, assuming only the Renderer sets them.
+		struct UploadedPalette {
+			std::weak_ptr<ci::gl::GlslProg>	mShader;
+			BonePalette						mPalette;
+		};
+		//! Uploads the slots of \a palette which differ from what \a shader holds.
+		static void uploadBonePalette( const ci::gl::GlslProgRef& shader, const BonePalette& palette );
+		static void uploadMatrices( const ci::gl::GlslProgRef& shader, const std::string& name, const std::vector<glm::mat4>& matrices, std::vector<glm::mat4>* uploaded );
 		
 		static void drawSection( const AMeshSection& section, std::function<void()> drawMesh );
 		//! Determines whether the node should be rendered as part of the skeleton.
 		static bool	isVisibleNode( SkeletonRef skeleton, const NodeRef& node );
-		//! Draw the visible nodes/bones of the skeleton by traversing recursively its node transformation hierarchy.
-		static void	drawRelative( SkeletonRef skeleton, const NodeRef& node );
+		//! End of the pose slots of the subtree of node \a root, which are contiguous from \a root.
+		static size_t	findSubtreeEnd( const SkeletonRef& skeleton, size_t root );
+		//! Draw the axes of the visible nodes of the skeleton, in the world transformations of its pose.
+		static void	drawRelative( const SkeletonRef& skeleton, size_t root );
 		//! Draw the visible nodes/bones of the skeleton by using its absolute bone positions.
-		static void	drawAbsolute( SkeletonRef skeleton, const NodeRef& node );
+		static void	drawAbsolute( const SkeletonRef& skeleton, size_t root );
 		
 		static void drawBone( const ci::vec3& start, const ci::vec3& end );
 		
@@ -92,6 +139,13 @@ namespace model {
 		static std::once_flag mOnceFlag;
 		
 		std::map< MeshType, ci::gl::GlslProgRef> mShaders;
+		MeshletCuller::Stats	mMeshletStats;
+		float					mLodPixelError;
+		RenderQueue				mQueue;
+		CommandRecorderRef		mRecorder;
+		bool					mQueueing;
+		std::map<const ci::gl::GlslProg*, UploadedPalette>	mUploadedPalettes;
+		size_t					mNumUploadedBoneMatrices;
 
 		static LightRef mLight;
 	};
@@ -0,0 +1,64 @@
+#include "SampledClip.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace model;
+using namespace ci;
+
+SampledClipRef SampledClip::create( const std::vector<NodeRef>& nodes, int trackId, float periodSeconds, float framesPerSecond )
+{
+	SampledClipRef clip( new SampledClip );
+	clip->mFrameRate = framesPerSecond;
+	clip->mPeriod = std::max( 0.0f, periodSeconds );
+	clip->mNumFrames = std::max<size_t>( 1, size_t( std::ceil( clip->mPeriod * framesPerSecond ) ) ) + 1;
+	
+	std::vector<const AnimTrack*> tracks;
+	for( const auto& node : nodes ) {
+		auto track = node->getAnimTracks().find( trackId );
+		if( track != node->getAnimTracks().end() ) {
+			clip->mChannelNames.push_back( node->getName() );
+			tracks.push_back( track->second.get() );
+		}
+	}
+	
+	const size_t numChannels = tracks.size();
+	clip->mSamples.resize( clip->mNumFrames * numChannels );
+	std::vector<AnimTrack::Cursor> cursors( numChannels );
+	for( size_t f = 0; f < clip->mNumFrames; ++f ) {
+		const float time = float( f ) / framesPerSecond;
+		Sample* frame = &clip->mSamples[f * numChannels];
+		for( size_t c = 0; c < numChannels; ++c ) {
+			tracks[c]->getValues( time, &frame[c].mTranslation, &frame[c].mRotation, &frame[c].mScale, &cursors[c] );
+		}
+	}
+	return clip;
+}
+
+void SampledClip::sample( float time, const int32_t* channelSlots, vec3* positions, quat* rotations, vec3* scales ) const
+{
+	const size_t numChannels = getNumChannels();
+	float cyclicTime = ( mPeriod > 0.0f ) ? time - mPeriod * std::floor( time / mPeriod ) : 0.0f;
+	float position = cyclicTime * mFrameRate;
+	size_t frame = std::min( size_t( position ), mNumFrames - 2 );
+	float alpha = std::min( position - float( frame ), 1.0f );
+	
+	const Sample* from = &mSamples[frame * numChannels];
+	const Sample* to = from + numChannels;
+	for( size_t c = 0; c < numChannels; ++c ) {
+		const int32_t slot = channelSlots[c];
+		if( slot < 0 ) {
+			continue;
+		}
+		positions[slot] = glm::mix( from[c].mTranslation, to[c].mTranslation, alpha );
+		scales[slot] = glm::mix( from[c].mScale, to[c].mScale, alpha );
+		// Adjacent frames are close: a normalized lerp along the shortest arc is as good as a slerp.
+		const quat& a = from[c].mRotation;
+		quat b = to[c].mRotation;
+		if( glm::dot( a, b ) < 0.0f ) {
+			b = -b;
+		}
+		rotations[slot] = glm::normalize( quat( a.w + ( b.w - a.w ) * alpha, a.x + ( b.x - a.x ) * alpha,
+											   a.y + ( b.y - a.y ) * alpha, a.z + ( b.z - a.z ) * alpha ) );
+	}
+}
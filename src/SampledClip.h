@@ -0,0 +1,53 @@
+#pragma once
+
+#include "ModelIo.h"
+#include "Node.h"
+
+#include <string>
+#include <vector>
+
+namespace model {
+
+/*!
+ * An animation clip resampled at a fixed rate: for every frame, the local transformation of every
+ * animated node (channel), stored frame after frame. Sampling is index arithmetic and one blend
+ * between two adjacent frames, trading memory for the keyframe searches of AnimCurve.
+ */
+class SampledClip {
+public:
+	struct Sample {
+		glm::vec3	mTranslation;
+		glm::quat	mRotation;
+		glm::vec3	mScale;
+	};
+	
+	//! Resamples track \a trackId of the \a nodes holding one over \a periodSeconds (the clip loops) at \a framesPerSecond.
+	static SampledClipRef create( const std::vector<NodeRef>& nodes, int trackId, float periodSeconds, float framesPerSecond );
+	
+	size_t			getNumChannels() const { return mChannelNames.size(); }
+	//! Node names of the channels, in the order of the samples of a frame.
+	const std::vector<std::string>&	getChannelNames() const { return mChannelNames; }
+	//! Stored frames, including a last one at the end of the period so that every interval has both its frames.
+	size_t			getNumFrames() const { return mNumFrames; }
+	float			getFrameRate() const { return mFrameRate; }
+	float			getPeriod() const { return mPeriod; }
+	const Sample*	getFrame( size_t frame ) const { return &mSamples[frame * getNumChannels()]; }
+	size_t			getMemorySize() const { return mSamples.size() * sizeof( Sample ); }
+	
+	/*!
+	 * Blends the frames around \a time (in seconds, looping) into local transformation arrays.
+	 * \a channelSlots maps each channel to its index in the arrays, negative to skip it.
+	 */
+	void			sample( float time, const int32_t* channelSlots, glm::vec3* positions, glm::quat* rotations, glm::vec3* scales ) const;
+protected:
+	SampledClip() : mNumFrames( 0 ), mFrameRate( 0.0f ), mPeriod( 0.0f ) { }
+	
+	std::vector<std::string>	mChannelNames;
+	std::vector<Sample>			mSamples;
+	size_t						mNumFrames;
+	float						mFrameRate, mPeriod;
+	
+	friend class ModelCache;
+};
+
+} //end namespace model
@@ -8,48 +8,159 @@
 
 #include "glm/gtc/matrix_inverse.hpp"
 
+#include <algorithm>
+#include <cmath>
+
 using namespace ci;
 using namespace model;
 
-SkeletalMesh::Section::Section( const SectionSourceRef& source,  gl::GlslProgRef shader )
-: ABatchSection( source, shader )
+namespace {
+	
+	//! Whether the upper 3x3 of \a m is not a rotation times a uniform scale, in which case normals need its inverse transpose.
+	bool hasNonUniformScale( const mat4& m )
+	{
+		const vec3 x( m[0] ), y( m[1] ), z( m[2] );
+		const float xx = dot( x, x ), yy = dot( y, y ), zz = dot( z, z );
+		const float tolerance = 1e-4f * std::max( xx, std::max( yy, zz ) );
+		return std::abs( xx - yy ) > tolerance || std::abs( xx - zz ) > tolerance
+			|| std::abs( dot( x, y ) ) > tolerance || std::abs( dot( x, z ) ) > tolerance || std::abs( dot( y, z ) ) > tolerance;
+	}
+	
+} // anonymous namespace
+
+SkeletalMesh::Section::Section( const SectionSourceRef& source,  gl::GlslProgRef shader, bool packVertices, const PackedVertices::Format& packedFormat, const std::vector<uint32_t>& bonePalette, size_t paletteOffset )
+: ABatchSection( source, shader, packVertices, packedFormat )
+, mBoneBounds( source->getBoneBounds() )
+, mStaticBounds( source->getBounds().transformed( source->getDefaultTransformation() ) )
+, mBonePalette( bonePalette )
+, mPaletteOffset( paletteOffset )
+{
+}
+
+ci::AxisAlignedBox SkeletalMesh::Section::calcBounds( const glm::mat4* paletteMatrices ) const
 {
+	if( mBoneBounds.empty() ) {
+		return mStaticBounds;
+	}
+	// The bone bounds refer to palette slots too.
+	return SectionSource::calcSkinnedBounds( mBoneBounds, paletteMatrices, mBonePalette.size() );
 }
 
-SkeletalMeshRef SkeletalMesh::create( const model::Source& modelSource, SkeletonRef skeleton, gl::GlslProgRef skinningShader )
+SkeletalMeshRef SkeletalMesh::create( const model::Source& modelSource, SkeletonRef skeleton, gl::GlslProgRef skinningShader, bool packVertices, const PackedVertices::Format& packedFormat )
 {
-	if( ! skinningShader )
-		skinningShader = model::Renderer::instance().getShader( MeshType::SKELETAL );
+#if defined( CINDER_GL_ES )
+	// No integer attributes in GLSL ES 1.0, hence no packed shaders.
+	packVertices = false;
+#endif
+	if( ! skinningShader ) {
+		MeshType type = MeshType::SKELETAL;
+		if( packVertices ) {
+			type = packedFormat.mWeights16 ? MeshType::PACKED_SKELETAL_WEIGHTS16 : MeshType::PACKED_SKELETAL;
+		}
+		skinningShader = model::Renderer::instance().getShader( type );
+	}
+
+	return SkeletalMeshRef( new SkeletalMesh( modelSource, skeleton, skinningShader, packVertices, packedFormat ) );
+}
 
-	return SkeletalMeshRef( new SkeletalMesh( modelSource, skeleton, skinningShader ) );
+SkeletalMeshRef SkeletalMesh::createInstance( SkeletonRef skeleton ) const
+{
+	return SkeletalMeshRef( new SkeletalMesh( *this, skeleton ) );
 }
 
-SkeletalMesh::SkeletalMesh( const model::Source& modelSource, SkeletonRef skeleton, gl::GlslProgRef skinningShader )
+SkeletalMesh::SkeletalMesh( const model::Source& modelSource, SkeletonRef skeleton, gl::GlslProgRef skinningShader, bool packVertices, const PackedVertices::Format& packedFormat )
 : Actor( modelSource, skeleton )
+, mNumNonUniformBones( 0 )
+, mPacked( packVertices )
 {
+	std::vector<std::vector<uint32_t>> palettes;
+	size_t paletteOffset = 0;
 	for( auto& sectionSource : modelSource.getSectionSources() ) {
-		auto section = SectionRef( new Section{ sectionSource, skinningShader } );
-		section->mSkeleton				= mSkeleton;
-		section->mInvTransposeMatrices	= &mInvTransposeMatrices;
-		section->mBoneMatrices			= &mBoneMatrices;
-		
-		mMeshSections.push_back( section );
+		auto parts = SectionSource::partitionBones( sectionSource, MAXBONES, &palettes );
+		for( size_t p = 0; p < parts.size(); ++p ) {
+			mMeshSections.push_back( SectionRef( new Section{ parts[p], skinningShader, packVertices, packedFormat, palettes[p], paletteOffset } ) );
+			paletteOffset += palettes[p].size();
+		}
 	}
+	mPaletteMatrices.resize( paletteOffset );
+}
+
+SkeletalMesh::SkeletalMesh( const SkeletalMesh& prototype, SkeletonRef skeleton )
+: Actor( prototype, skeleton )
+, mPaletteMatrices( prototype.mPaletteMatrices )
+, mPaletteInvTransposeMatrices( prototype.mPaletteInvTransposeMatrices )
+, mNumNonUniformBones( prototype.mNumNonUniformBones )
+, mMeshSections( prototype.mMeshSections )
+, mPacked( prototype.mPacked )
+{
 }
 
 void SkeletalMesh::update()
 {
-	int i = 0;
-	for( const auto& entry : mSkeleton->getBones() ) {
-		if( i >= MAXBONES ) {
-			CI_ASSERT_MSG( false, "Skeleton exceeds maximum supported number of bones." );
-			break;
+	// Straight into the palettes: a bone used by several sections is computed once per section.
+	for( const auto& section : mMeshSections ) {
+		mSkeleton->computeSkinningMatrices( section->mBonePalette.data(), section->mBonePalette.size(), mPaletteMatrices.data() + section->mPaletteOffset );
+	}
+	
+	// The inverse transpose of a rotation times a uniform scale s is the matrix itself over s^2: only non-uniform bones need an inverse.
+	// The shaders blend the normal matrices of a vertex's bones by weight before normalizing, so the matrices themselves only
+	// do as normal matrices if every bone has the same scale.
+	mNumNonUniformBones = 0;
+	bool sameScale = true;
+	float firstScale2 = -1.0f;
+	for( const auto& m : mPaletteMatrices ) {
+		if( hasNonUniformScale( m ) ) {
+			++mNumNonUniformBones;
+			continue;
+		}
+		const float scale2 = glm::dot( vec3( m[0] ), vec3( m[0] ) );
+		if( firstScale2 < 0.0f ) {
+			firstScale2 = scale2;
+		}
+		sameScale = sameScale && std::abs( scale2 - firstScale2 ) <= 1e-4f * std::max( scale2, firstScale2 );
+	}
+	if( mNumNonUniformBones == 0 && sameScale ) {
+		mPaletteInvTransposeMatrices.clear();
+		return;
+	}
+	
+	mPaletteInvTransposeMatrices.resize( mPaletteMatrices.size() );
+	for( size_t i = 0; i < mPaletteMatrices.size(); ++i ) {
+		const mat4& m = mPaletteMatrices[i];
+		if( hasNonUniformScale( m ) ) {
+			mPaletteInvTransposeMatrices[i] = glm::inverseTranspose( m );
+			continue;
 		}
-		const NodeRef& bone = entry.second;
-		size_t idx = bone->getBoneIndex();
-		( mBoneMatrices ).at( idx ) = bone->getAbsoluteTransformation() * *bone->getOffset();
-		( mInvTransposeMatrices ).at( idx ) = glm::inverseTranspose( mBoneMatrices.at( idx ) );
-		++i;
+		const float scale2 = glm::dot( vec3( m[0] ), vec3( m[0] ) );
+		const float invScale2 = ( scale2 > 0.0f ) ? 1.0f / scale2 : 1.0f;
+		mPaletteInvTransposeMatrices[i] = mat4( m[0] * invScale2, m[1] * invScale2, m[2] * invScale2, m[3] );
 	}
 }
 
+const glm::mat4* SkeletalMesh::getPaletteInvTransposeMatrices( const Section& section ) const
+{
+	const auto& matrices = mPaletteInvTransposeMatrices.empty() ? mPaletteMatrices : mPaletteInvTransposeMatrices;
+	return matrices.data() + section.mPaletteOffset;
+}
+
+size_t SkeletalMesh::getMemorySize() const
+{
+	return sizeof( SkeletalMesh ) + mSkeleton->getMemorySize() + mMeshSections.capacity() * sizeof( SectionRef )
+		+ ( mPaletteMatrices.capacity() + mPaletteInvTransposeMatrices.capacity() ) * sizeof( glm::mat4 );
+}
+
+ci::AxisAlignedBox SkeletalMesh::calcBoundingBox() const
+{
+	ci::AxisAlignedBox bounds;
+	bool empty = true;
+	for( const auto& section : mMeshSections ) {
+		ci::AxisAlignedBox sectionBounds = section->calcBounds( getPaletteMatrices( *section ) );
+		if( empty ) {
+			bounds = sectionBounds;
+			empty = false;
+		} else {
+			bounds.include( sectionBounds );
+		}
+	}
+	return bounds;
+}
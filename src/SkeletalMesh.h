@@ -20,40 +20,76 @@ typedef std::shared_ptr<class SkeletalMesh> SkeletalMeshRef;
 class SkeletalMesh : public Actor
 {
 public:
+	//! Bones a section is skinned with at most, i.e. the size of the shaders' palettes; sections referring to more are split.
 	static const int MAXBONES = 92;
 	
 	class Section : public ABatchSection
 	{
 		friend class SkeletalMesh;
 	public:
-		const SkeletonRef&						getSkeleton() const { return mSkeleton; }
-		const std::array<glm::mat4, MAXBONES>*	getBoneMatrices() const { return mBoneMatrices; }
-		const std::array<glm::mat4, MAXBONES>*	getInvTransposeMatrices() const { return mInvTransposeMatrices; }
+		//! Bone index (see Node::getBoneIndex()) of each slot of the section's palette, which its vertices refer to.
+		const std::vector<uint32_t>&	getBonePalette() const { return mBonePalette; }
+		//! Conservative bounds of the section posed by \a paletteMatrices (see SkeletalMesh::getPaletteMatrices()), from the bounds of its bones.
+		ci::AxisAlignedBox				calcBounds( const glm::mat4* paletteMatrices ) const;
 	private:
-		Section( const SectionSourceRef& source, ci::gl::GlslProgRef shader );
+		Section( const SectionSourceRef& source, ci::gl::GlslProgRef shader, bool packVertices, const PackedVertices::Format& packedFormat, const std::vector<uint32_t>& bonePalette, size_t paletteOffset );
 		
-		std::array<glm::mat4, MAXBONES>*		mBoneMatrices;
-		std::array<glm::mat4, MAXBONES>*		mInvTransposeMatrices;
-		SkeletonRef								mSkeleton;
+		std::vector<SectionSource::BoneBounds>	mBoneBounds;
+		//! Bounds of sections without bones, which don't move.
+		ci::AxisAlignedBox						mStaticBounds;
+		std::vector<uint32_t>					mBonePalette;
+		//! Where the palette starts in the matrices of the mesh.
+		size_t									mPaletteOffset;
 	};
 	
 	typedef std::shared_ptr<Section> SectionRef;
 	
-	static SkeletalMeshRef create( const model::Source& modelSource, SkeletonRef skeleton = nullptr, ci::gl::GlslProgRef skinningShader = nullptr );
+	/*!
+	 * With \a packVertices, sections are uploaded in the compact PackedVertices layout of \a packedFormat, and skinned by default
+	 * with the packed shader decoding it (PACKED_SKELETAL, or PACKED_SKELETAL_WEIGHTS16 for 16-bit weights).
+	 * OpenGL ES has no packed shaders: \a packVertices is ignored there.
+	 * Sections of \a modelSource referring to more than MAXBONES bones become several consecutive sections (see SectionSource::partitionBones()).
+	 */
+	static SkeletalMeshRef create( const model::Source& modelSource, SkeletonRef skeleton = nullptr, ci::gl::GlslProgRef skinningShader = nullptr, bool packVertices = false, const PackedVertices::Format& packedFormat = PackedVertices::Format() );
+	/*!
+	 * Another mesh sharing this one's sections (i.e. their GPU buffers) and clips, posed by \a skeleton,
+	 * by default an instance of getSkeleton() (see Skeleton::createInstance()).
+	 */
+	SkeletalMeshRef createInstance( SkeletonRef skeleton = nullptr ) const;
 	
-	//! Updates the bones matrices (used by skinning shaders) based on the current skeleton pose.
+	//! Updates the palettes (used by skinning shaders) from the current skeleton pose.
 	void update() override;
 	
 	const std::vector<SectionRef>&			getSections() const { return mMeshSections; }
+	bool									isPacked() const { return mPacked; }
+	//! Union of the bounds of the sections in the current pose, as of the last update().
+	ci::AxisAlignedBox						calcBoundingBox() const;
 	
-	const std::array<glm::mat4, MAXBONES>&	getBoneMatrices() const { return mBoneMatrices; }
-	const std::array<glm::mat4, MAXBONES>&	getInvTransposeMatrices() const { return mInvTransposeMatrices; }
+	//! Palette slots whose inverse transpose had to be computed by the last update(), i.e. whose bone scales non-uniformly.
+	size_t									getNumNonUniformBones() const { return mNumNonUniformBones; }
+	
+	//! Skinning matrices of the palette of \a section, one per slot of Section::getBonePalette(), as of the last update().
+	const glm::mat4*						getPaletteMatrices( const Section& section ) const { return mPaletteMatrices.data() + section.mPaletteOffset; }
+	/*!
+	 * Matrices skinning the normals of \a section, all of the same magnitude: the inverse transposes of the palette matrices,
+	 * or the palette matrices themselves when every bone scales uniformly by the same factor.
+	 */
+	const glm::mat4*						getPaletteInvTransposeMatrices( const Section& section ) const;
+	//! Slots of the palettes of every section.
+	size_t									getNumPaletteMatrices() const { return mPaletteMatrices.size(); }
+	//! Bytes owned by this mesh alone: itself, its palettes and its skeleton (see Skeleton::getMemorySize()), not the sections its instances share.
+	size_t									getMemorySize() const;
 protected:
-	SkeletalMesh( const model::Source& modelSource, SkeletonRef skeleton, ci::gl::GlslProgRef skinningShader );
+	SkeletalMesh( const model::Source& modelSource, SkeletonRef skeleton, ci::gl::GlslProgRef skinningShader, bool packVertices, const PackedVertices::Format& packedFormat );
+	SkeletalMesh( const SkeletalMesh& prototype, SkeletonRef skeleton );
 
-	std::array<glm::mat4, MAXBONES>		mBoneMatrices;
-	std::array<glm::mat4, MAXBONES>		mInvTransposeMatrices;
+	//! The palettes of the sections, one after the other: the sections themselves are shared by the instances of the mesh.
+	std::vector<glm::mat4>				mPaletteMatrices;
+	//! Empty while every bone scales uniformly by the same factor, the normals then being skinned by mPaletteMatrices.
+	std::vector<glm::mat4>				mPaletteInvTransposeMatrices;
+	size_t								mNumNonUniformBones;
 	std::vector<SectionRef>				mMeshSections;
+	bool								mPacked;
 };
 	
 } //end namespace model
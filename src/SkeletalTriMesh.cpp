@@ -10,57 +10,124 @@
 #include "Node.h"
 #include "Skeleton.h"
 
+#include "cinder/CinderAssert.h"
+#include "cinder/gl/gl.h"
+
+#include <algorithm>
+
 using namespace ci;
 using namespace model;
+
+SkeletalTriMesh::BufferStats SkeletalTriMesh::sBufferStats;
 	
-SkeletalTriMesh::Section::Section( const SectionSourceRef& source, const std::vector<Weights>& weights )
+SkeletalTriMesh::Section::Section( const SectionSourceRef& source )
 : AMeshSection( source )
 , mTriMesh( TriMesh::create( *source ) )
-, mWeights( weights )
+, mSkinning( SkinningEngine::create( *source ) )
+, mCurrentBuffer( 0 )
+, mDirty( false )
 {
-	auto verts =  mTriMesh->getPositions<3>();
-	for( size_t i=0; i<mTriMesh->getNumVertices(); ++i ) {
-		mInitialPositions.emplace_back( *verts );
-		verts++;
-	}
-	
-	mInitialNormals = mTriMesh->getNormals();
+	CI_ASSERT( mSkinning->getNumVertices() == mTriMesh->getNumVertices() );
 }
 
 void SkeletalTriMesh::Section::reset()
 {
-	*mTriMesh->getPositions<3>() = *mInitialPositions.data();
+	const auto& positions = mSkinning->getBindPositions();
+	std::copy( positions.begin(), positions.end(), mTriMesh->getPositions<3>() );
 	if( mTriMesh->hasNormals() )
-		mTriMesh->getNormals() = mInitialNormals;
+		mTriMesh->getNormals() = mSkinning->getBindNormals();
+	mDirty = true;
 }
 
-void SkeletalTriMesh::Section::update()
+void SkeletalTriMesh::Section::update( const std::vector<glm::mat4>& palette )
 {
-	CI_ASSERT( mWeights.size() == mTriMesh->getNumVertices() );
+	vec3* normals = mTriMesh->hasNormals() ? mTriMesh->getNormals().data() : nullptr;
+	mSkinning->skin( palette, mTriMesh->getPositions<3>(), normals );
+	mDirty = true;
+}
+
+const gl::BatchRef& SkeletalTriMesh::Section::prepareBatch()
+{
+	if( mBatches.empty() ) {
+		createBuffers();
+		mDirty = false;
+		return mBatches[mCurrentBuffer];
+	}
 	
-	int vertexIdx = 0;
-	for( const auto& weights : mWeights ) {
-		
-		vec3 weightedPosition;
-		vec3 weightedNormal;
-		for(  unsigned int i=0; i < weights.getNumActiveWeights(); ++i ) {
-			
-			const vec3& srcPos		= mInitialPositions.at( vertexIdx );
-			auto bone				= weights.getBone( i );
-			auto skinningMatrix		= bone->getAbsoluteTransformation() * *bone->getOffset();
-			float weight			= weights.getWeight( i );
-			
-			weightedPosition += weight * vec3( skinningMatrix * vec4( srcPos, 1 ) );
-			if( mTriMesh->hasNormals() )
-				weightedNormal += weight * vec3( skinningMatrix * vec4( mInitialNormals[ vertexIdx ], 1 ) );
+	const size_t begin = mSkinning->getSkinnedBegin(), end = mSkinning->getSkinnedEnd();
+	if( mDirty && begin < end ) {
+		mCurrentBuffer = ( mCurrentBuffer + 1 ) % NUM_BUFFERS;
+		const gl::VboRef& vbo = mVertexVbos[mCurrentBuffer];
+		const size_t rangeBytes = ( end - begin ) * sizeof( vec3 );
+		vbo->bufferSubData( begin * sizeof( vec3 ), rangeBytes, mTriMesh->getPositions<3>() + begin );
+		sBufferStats.mNumUploadedBytes += rangeBytes;
+		++sBufferStats.mNumUploads;
+		if( mTriMesh->hasNormals() ) {
+			// Normals follow the positions.
+			const size_t normalsOffset = mTriMesh->getNumVertices() * sizeof( vec3 );
+			vbo->bufferSubData( normalsOffset + begin * sizeof( vec3 ), rangeBytes, mTriMesh->getNormals().data() + begin );
+			sBufferStats.mNumUploadedBytes += rangeBytes;
+			++sBufferStats.mNumUploads;
 		}
+	}
+	mDirty = false;
+	return mBatches[mCurrentBuffer];
+}
+
+void SkeletalTriMesh::Section::createBuffers()
+{
+	const size_t numVertices = mTriMesh->getNumVertices();
+	const size_t positionsBytes = numVertices * sizeof( vec3 );
+	const size_t normalsBytes = mTriMesh->hasNormals() ? positionsBytes : 0;
+	
+	geom::BufferLayout vertexLayout;
+	vertexLayout.append( geom::Attrib::POSITION, 3, 0, 0 );
+	if( normalsBytes ) {
+		vertexLayout.append( geom::Attrib::NORMAL, 3, 0, positionsBytes );
+	}
+	
+	// Texture coordinates and colors don't move: one buffer for every batch.
+	geom::BufferLayout staticLayout;
+	std::vector<float> staticData;
+	const uint8_t texCoordDims = mTriMesh->getAttribDims( geom::Attrib::TEX_COORD_0 );
+	if( texCoordDims ) {
+		staticLayout.append( geom::Attrib::TEX_COORD_0, texCoordDims, 0, 0 );
+		staticData.insert( staticData.end(), mTriMesh->getBufferTexCoords0().begin(), mTriMesh->getBufferTexCoords0().end() );
+	}
+	const uint8_t colorDims = mTriMesh->getAttribDims( geom::Attrib::COLOR );
+	if( colorDims ) {
+		staticLayout.append( geom::Attrib::COLOR, colorDims, 0, staticData.size() * sizeof( float ) );
+		staticData.insert( staticData.end(), mTriMesh->getBufferColors().begin(), mTriMesh->getBufferColors().end() );
+	}
+	gl::VboRef staticVbo;
+	if( ! staticData.empty() ) {
+		staticVbo = gl::Vbo::create( GL_ARRAY_BUFFER, staticData.size() * sizeof( float ), staticData.data(), GL_STATIC_DRAW );
+		++sBufferStats.mNumBufferCreations;
+	}
+	
+	const auto& indices = mTriMesh->getIndices();
+	auto indexVbo = gl::Vbo::create( GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof( uint32_t ), indices.data(), GL_STATIC_DRAW );
+	++sBufferStats.mNumBufferCreations;
+	
+	auto shader = gl::getStockShader( gl::ShaderDef().color().texture() );
+	for( size_t b = 0; b < NUM_BUFFERS; ++b ) {
+		auto vertexVbo = gl::Vbo::create( GL_ARRAY_BUFFER, positionsBytes + normalsBytes, nullptr, GL_DYNAMIC_DRAW );
+		vertexVbo->bufferSubData( 0, positionsBytes, mTriMesh->getPositions<3>() );
+		if( normalsBytes ) {
+			vertexVbo->bufferSubData( positionsBytes, normalsBytes, mTriMesh->getNormals().data() );
+		}
+		++sBufferStats.mNumBufferCreations;
+		mVertexVbos.push_back( vertexVbo );
 		
-		mTriMesh->getPositions<3>()[vertexIdx] = weightedPosition;
-		if( mTriMesh->hasNormals() )
-			mTriMesh->getNormals().at( vertexIdx ) = weightedNormal;
-		
-		++vertexIdx;
+		std::vector<std::pair<geom::BufferLayout, gl::VboRef>> layouts = { { vertexLayout, vertexVbo } };
+		if( staticVbo ) {
+			layouts.push_back( { staticLayout, staticVbo } );
+		}
+		auto vboMesh = gl::VboMesh::create( uint32_t( numVertices ), GL_TRIANGLES, layouts, uint32_t( indices.size() ), GL_UNSIGNED_INT, indexVbo );
+		mBatches.push_back( gl::Batch::create( vboMesh, shader ) );
+		++sBufferStats.mNumBatchCreations;
 	}
+	mCurrentBuffer = 0;
 }
 
 SkeletalTriMeshRef SkeletalTriMesh::create( const model::Source& modelSource, SkeletonRef skeleton )
@@ -72,15 +139,16 @@ SkeletalTriMesh::SkeletalTriMesh( const model::Source& modelSource, SkeletonRef
 : Actor( modelSource, skeleton )
 {
 	for( auto& sectionSource : modelSource.getSectionSources() ) {
-		SectionRef section{ new Section{ sectionSource, sectionSource->getWeights() } };
+		SectionRef section{ new Section{ sectionSource } };
 		mSections.push_back( section );
 	}
 }
 
 void SkeletalTriMesh::update()
 {
+	mSkeleton->computeSkinningMatrices( &mPalette );
 	for( auto& section : mSections ) {
-		section->update();
+		section->update( mPalette );
 	}
 }
 
@@ -1,12 +1,15 @@
 #pragma once
 
 #include "cinder/TriMesh.h"
+#include "cinder/gl/Batch.h"
+#include "cinder/gl/Vbo.h"
 
 #include <vector>
 #include <string>
 
 #include "AMeshSection.h"
 #include "Actor.h"
+#include "SkinningEngine.h"
 
 namespace model {
 
@@ -20,31 +23,60 @@ public:
 		friend class SkeletalTriMesh;
 	public:
 		void reset();
-		void update();
+		//! Skins the TriMesh with \a palette, skinning matrices indexed by bone index.
+		void update( const std::vector<glm::mat4>& palette );
 		
 		ci::TriMeshRef		getTriMesh() const { return mTriMesh; }
-		const std::vector<glm::vec3>& getInitialPositions() const { return mInitialPositions; }
-		const std::vector<glm::vec3>& getInitialNormals() const { return mInitialNormals; }
+		const std::vector<glm::vec3>& getInitialPositions() const { return mSkinning->getBindPositions(); }
+		const std::vector<glm::vec3>& getInitialNormals() const { return mSkinning->getBindNormals(); }
+		const SkinningEngineRef&	getSkinningEngine() const { return mSkinning; }
+		
+		/*!
+		 * Batch drawing the TriMesh as of the last update() or reset(). The buffers are created by the first call; later calls upload
+		 * the skinned range of the positions and normals (see SkinningEngine::getSkinnedBegin()) into the next of NUM_BUFFERS buffers,
+		 * so that the GPU can still read the previous frames' vertices.
+		 */
+		const ci::gl::BatchRef&	prepareBatch();
+		
+		static const size_t NUM_BUFFERS = 3;
 	private:
-		Section( const SectionSourceRef& source, const std::vector<Weights>& weights );
+		Section( const SectionSourceRef& source );
+		
+		void	createBuffers();
 		
 		ci::TriMeshRef			mTriMesh;
-		std::vector<Weights>	mWeights;
-		std::vector<glm::vec3>	mInitialPositions;
-		std::vector<glm::vec3>	mInitialNormals;
+		SkinningEngineRef		mSkinning;
+		//! Each batch reads its own positions and normals, and shares the other attributes and the indices.
+		std::vector<ci::gl::BatchRef>	mBatches;
+		std::vector<ci::gl::VboRef>		mVertexVbos;
+		size_t					mCurrentBuffer;
+		//! Whether the TriMesh moved since the last upload.
+		bool					mDirty;
 	};
 	typedef std::shared_ptr<Section> SectionRef;
 	
 	static SkeletalTriMeshRef create( const model::Source& modelSource, SkeletonRef skeleton = nullptr );
 	
+	//! GPU work done by Section::prepareBatch() since the last reset. Once every section was drawn, no buffer should be created anymore.
+	struct BufferStats {
+		BufferStats() : mNumBufferCreations( 0 ), mNumBatchCreations( 0 ), mNumUploads( 0 ), mNumUploadedBytes( 0 ) { }
+		size_t	mNumBufferCreations, mNumBatchCreations, mNumUploads, mNumUploadedBytes;
+	};
+	static const BufferStats&	getBufferStats() { return sBufferStats; }
+	static void					resetBufferStats() { sBufferStats = BufferStats(); }
+	
 	//! Updates the mesh vertices (and normals if needed) based on the current skeleton pose.
-	void update();
+	void update() override;
 
 	const std::vector<SectionRef>&	getSections() const { return mSections; }
 protected:
 	SkeletalTriMesh( const model::Source& modelSource, SkeletonRef skeleton = nullptr );
 
 	std::vector<SectionRef>	mSections;
+	//! Skinning matrices, computed once per update and shared by every section.
+	std::vector<glm::mat4>	mPalette;
+	
+	static BufferStats		sBufferStats;
 };
 
 } //end namespace model
\ No newline at end of file
@@ -7,9 +7,12 @@
 //
 
 #include "Skeleton.h"
+#include "AnimBatch.h"
 
 #include "cinder/CinderAssert.h"
 
+#include <algorithm>
+
 using namespace model;
 
 Skeleton::RenderMode Skeleton::sRenderMode = Skeleton::RenderMode::FULL;
@@ -25,40 +28,122 @@ SkeletonRef Skeleton::create( const NodeRef& rootNode, std::unordered_map<std::s
 }
 
 Skeleton::Skeleton( const NodeRef& rootNode )
-: mRootNode( rootNode )
+: mDefinition( std::make_shared<Definition>() )
 {
+	mDefinition->mRootNode = rootNode;
+	initPose();
 	traverseNodes( [this] ( const NodeRef& node ) {
 		CI_ASSERT( ! node->getName().empty() );
-		mBones.emplace( node->getName(), node );
+		mDefinition->mBones.emplace( node->getName(), node );
 	} );
+	initBones();
 }
 
 Skeleton::Skeleton( const NodeRef& rootNode, std::unordered_map<std::string, NodeRef> bones )
-: mRootNode( rootNode )
-, mBones( bones )
+: mDefinition( std::make_shared<Definition>() )
 {
-	
+	mDefinition->mRootNode = rootNode;
+	mDefinition->mBones = std::move( bones );
+	initPose();
+	initBones();
+}
+
+Skeleton::Skeleton( const DefinitionRef& definition )
+: mDefinition( definition )
+, mPose( Pose::create( getSharedParents() ) )
+, mCursors( definition->mNodes.size() )
+{
+	resetToInitial();
 }
 
-void cloneTraversal( const NodeRef& origin, NodeRef& copy )
+static void flattenNodes( const NodeRef& node, int32_t parent, std::vector<NodeRef>* nodes, std::vector<int32_t>* parents )
 {
-	for( const auto& originChild : origin->getChildren() ) {
-		NodeRef copyChild = originChild->clone();
-		copyChild->setParent( copy );
-		copy->addChild( copyChild );
-		cloneTraversal( originChild, copyChild );
+	const int32_t index = int32_t( nodes->size() );
+	nodes->push_back( node );
+	parents->push_back( parent );
+	for( const NodeRef& child : node->getChildren() ) {
+		flattenNodes( child, index, nodes, parents );
+	}
+}
+
+void Skeleton::initPose()
+{
+	Definition& def = *mDefinition;
+	if( def.mRootNode ) {
+		flattenNodes( def.mRootNode, -1, &def.mNodes, &def.mParents );
+	}
+	const size_t numNodes = def.mNodes.size();
+	
+	// Skeletons created over the same nodes share their pose, as they share the nodes themselves.
+	PoseRef rootPose = def.mRootNode ? def.mRootNode->getPose() : nullptr;
+	bool sharedPose = rootPose && rootPose->getParents() == def.mParents;
+	for( size_t i = 0; sharedPose && i < numNodes; ++i ) {
+		sharedPose = def.mNodes[i]->getPose() == rootPose && def.mNodes[i]->getPoseIndex() == i;
+	}
+	if( sharedPose ) {
+		mPose = rootPose;
+	} else {
+		mPose = Pose::create( getSharedParents() );
+		for( size_t i = 0; i < numNodes; ++i ) {
+			def.mNodes[i]->bindPose( mPose, i );
+		}
+	}
+	
+	def.mInitialPositions.resize( numNodes );
+	def.mInitialRotations.resize( numNodes );
+	def.mInitialScales.resize( numNodes );
+	mCursors.assign( numNodes, AnimTrack::Cursor() );
+	for( size_t i = 0; i < numNodes; ++i ) {
+		const NodeRef& node = def.mNodes[i];
+		def.mNodeSlots.emplace( node->getName(), int32_t( i ) );
+		def.mInitialPositions[i] = node->getInitialRelativePosition();
+		def.mInitialRotations[i] = node->getInitialRelativeRotation();
+		def.mInitialScales[i] = node->getInitialRelativeScale();
+		
+		for( const auto& kv : node->mAnimTracks ) {
+			auto& channel = def.mChannels[kv.first];
+			channel.resize( numNodes, nullptr );
+			channel[i] = kv.second.get();
+		}
 	}
 }
 
 Skeleton::Skeleton( const Skeleton &rhs )
+: mDefinition( std::make_shared<Definition>() )
 {
-	mRootNode = rhs.getRootNode()->clone();
-	cloneTraversal( rhs.getRootNode(), mRootNode );
+	// Parents precede their children: each copy is attached as it is made.
+	const auto& nodes = rhs.getNodes();
+	const auto& parents = rhs.mDefinition->mParents;
+	std::vector<NodeRef> copies( nodes.size() );
+	std::unordered_map<const Node*, NodeRef> copiesByOrigin;
+	for( size_t i = 0; i < nodes.size(); ++i ) {
+		copies[i] = nodes[i]->clone();
+		if( parents[i] >= 0 ) {
+			const NodeRef& parent = copies[parents[i]];
+			copies[i]->setParent( parent );
+			parent->addChild( copies[i] );
+		}
+		copiesByOrigin.emplace( nodes[i].get(), copies[i] );
+	}
 	
-	for( auto& entry : rhs.getBones() ) {
-		std::string name = entry.first;
-		mBones[name] = getNode( name );
+	mDefinition->mRootNode = copies.empty() ? nullptr : copies.front();
+	for( const auto& entry : rhs.getBones() ) {
+		auto copy = copiesByOrigin.find( entry.second.get() );
+		mDefinition->mBones[entry.first] = ( copy != copiesByOrigin.end() ) ? copy->second : nullptr;
 	}
+	initPose();
+	initBones();
+}
+
+SkeletonRef Skeleton::createInstance() const
+{
+	return SkeletonRef( new Skeleton( mDefinition ) );
+}
+
+size_t Skeleton::getMemorySize() const
+{
+	return sizeof( Skeleton ) + mPose->getMemorySize() + mCursors.capacity() * sizeof( AnimTrack::Cursor )
+		+ mClipSlots.capacity() * sizeof( mClipSlots.front() );
 }
 
 SkeletonRef Skeleton::clone() const
@@ -68,39 +153,41 @@ SkeletonRef Skeleton::clone() const
 
 bool Skeleton::hasBone( const std::string& name ) const
 {
-	return mBones.count( name ) > 0;
+	return mDefinition->mBones.count( name ) > 0;
 }
 
 NodeRef Skeleton::getBone( const std::string& name ) const
 {
-	if( mBones.count(name) > 0 ) {
-		return mBones.at( name );
+	auto bone = mDefinition->mBones.find( name );
+	if( bone != mDefinition->mBones.end() ) {
+		return bone->second;
 	}
 	return nullptr;
 }
 
 NodeRef Skeleton::getNode(const std::string& name) const
 {
-	return findNode( name, mRootNode );
+	const int32_t index = getNodeIndex( name );
+	return ( index >= 0 ) ? mDefinition->mNodes[index] : nullptr;
 }
 
-NodeRef Skeleton::findNode( const std::string& name, const NodeRef& node ) const
+glm::mat4 Skeleton::getWorldTransform( const std::string& name ) const
 {
-	if( node->getName() == name ) {
-		return node;
-	}
-	for( const NodeRef& child : node->getChildren() ) {
-		NodeRef foundNode = findNode( name, child );
-		if (foundNode != nullptr) {
-			return foundNode;
-		}
-	}
-	return nullptr;
+	const int32_t index = getNodeIndex( name );
+	return ( index >= 0 ) ? mPose->getWorldTransform( size_t( index ) ) : glm::mat4();
+}
+
+int32_t Skeleton::getNodeIndex( const std::string& name ) const
+{
+	auto slot = mDefinition->mNodeSlots.find( name );
+	return ( slot != mDefinition->mNodeSlots.end() ) ? slot->second : -1;
 }
 
 void Skeleton::traverseNodes( std::function<void(const NodeRef&)> visit ) const
 {
-	traverseNodes( mRootNode, visit );
+	for( const NodeRef& node : mDefinition->mNodes ) {
+		visit( node );
+	}
 }
 
 void Skeleton::traverseNodes( const NodeRef& node, std::function<void(const NodeRef&)> visit )
@@ -125,33 +212,191 @@ bool Skeleton::isNodeVisible( const NodeRef& node ) const
 		default: return false;
 	}
 }
+
+void Skeleton::initBones()
+{
+	Definition& def = *mDefinition;
+	def.mBoneBindings.clear();
+	def.mNumBoneSlots = 0;
+	for( const auto& kv : def.mBones ) {
+		const NodeRef& bone = kv.second;
+		if( bone && bone->getOffset() && bone->getPose() == mPose ) {
+			def.mBoneBindings.push_back( { bone->getBoneIndex(), bone->getPoseIndex(), *bone->getOffset() } );
+			def.mNumBoneSlots = std::max( def.mNumBoneSlots, bone->getBoneIndex() + 1 );
+		}
+	}
+	def.mBoneBindingIndices.assign( def.mNumBoneSlots, -1 );
+	for( size_t b = 0; b < def.mBoneBindings.size(); ++b ) {
+		def.mBoneBindingIndices[def.mBoneBindings[b].mBoneIndex] = int32_t( b );
+	}
+}
+
+void Skeleton::computeSkinningMatrices( std::vector<glm::mat4>* matrices ) const
+{
+	matrices->resize( mDefinition->mNumBoneSlots );
+	for( const auto& bone : mDefinition->mBoneBindings ) {
+		(*matrices)[bone.mBoneIndex] = mPose->getWorldTransform( bone.mPoseIndex ) * bone.mOffset;
+	}
+}
+
+void Skeleton::computeSkinningMatrices( const uint32_t* boneIndices, size_t numBones, glm::mat4* matrices ) const
+{
+	const auto& bindingIndices = mDefinition->mBoneBindingIndices;
+	for( size_t i = 0; i < numBones; ++i ) {
+		const int32_t binding = ( boneIndices[i] < bindingIndices.size() ) ? bindingIndices[boneIndices[i]] : -1;
+		if( binding >= 0 ) {
+			const BoneBinding& bone = mDefinition->mBoneBindings[binding];
+			matrices[i] = mPose->getWorldTransform( bone.mPoseIndex ) * bone.mOffset;
+		} else {
+			// The vertices of a bone the skeleton lacks stay in bind pose.
+			matrices[i] = glm::mat4();
+		}
+	}
+}
+
+void Skeleton::animate( float time, int trackId )
+{
+	AnimBatch batch( mPose->getLocalPositions(), mPose->getLocalRotations(), mPose->getLocalScales() );
+	
+	const auto& channels = mDefinition->mChannels;
+	auto channel = channels.find( trackId );
+	const size_t numNodes = mCursors.size();
+	for( size_t i = 0; i < numNodes; ++i ) {
+		AnimTrack* track = ( channel != channels.end() ) ? channel->second[i] : nullptr;
+		if( track ) {
+			batch.add( *track, time, &mCursors[i], i );
+		}
+		mPose->setAnimated( i, track != nullptr );
+	}
+	batch.flush();
+	mPose->setTime( time );
+	mPose->invalidate();
+}
+
+void Skeleton::blendAnimate( float time, const std::unordered_map<int, float>& weights )
+{
+	// Resolve the tracks once rather than per node, keeping the iteration order of the weights.
+	std::vector<std::pair<const std::vector<AnimTrack*>*, float>> channels;
+	for( const auto& kv : weights ) {
+		auto channel = mDefinition->mChannels.find( kv.first );
+		if( channel != mDefinition->mChannels.end() ) {
+			channels.emplace_back( &channel->second, kv.second );
+		}
+	}
+	
+	glm::vec3* positions = mPose->getLocalPositions();
+	glm::quat* rotations = mPose->getLocalRotations();
+	glm::vec3* scales = mPose->getLocalScales();
+	
+	const size_t numNodes = mCursors.size();
+	for( size_t i = 0; i < numNodes; ++i ) {
+		bool animated = false;
+		glm::vec3 weightedPosition( 0 );
+		// Summed in one hemisphere and normalized (nlerp): unlike chained slerps, independent of the order of the weights.
+		glm::quat weightedRotation( 0, 0, 0, 0 );
+		glm::vec3 weightedScale( 0 );
+		for( const auto& channel : channels ) {
+			AnimTrack* track = (*channel.first)[i];
+			if( track ) {
+				animated = true;
+				const float w = channel.second;
+				const glm::quat rotation = track->getRotation( time );
+				weightedPosition += w * track->getTranslation( time );
+				weightedRotation += ( glm::dot( weightedRotation, rotation ) < 0.0f ? -w : w ) * rotation;
+				weightedScale += w * track->getScaling( time );
+			}
+		}
+		if( animated ) {
+			positions[i] = weightedPosition;
+			rotations[i] = glm::normalize( weightedRotation );
+			scales[i] = weightedScale;
+		}
+		mPose->setAnimated( i, animated );
+	}
+	mPose->setTime( time );
+	mPose->invalidate();
+}
+
+const std::vector<int32_t>& Skeleton::findClipSlots( const SampledClipRef& clip )
+{
+	for( const auto& slots : mClipSlots ) {
+		if( slots.first == clip.get() ) {
+			return *slots.second;
+		}
+	}
+	
+	// Instances may be animated on several threads (see Crowd).
+	Definition& def = *mDefinition;
+	std::lock_guard<std::mutex> lock( def.mClipSlotsMutex );
+	auto slots = def.mClipSlots.find( clip.get() );
+	if( slots == def.mClipSlots.end() ) {
+		std::vector<int32_t> channelSlots;
+		channelSlots.reserve( clip->getNumChannels() );
+		for( const auto& name : clip->getChannelNames() ) {
+			auto slot = def.mNodeSlots.find( name );
+			channelSlots.push_back( ( slot != def.mNodeSlots.end() ) ? slot->second : -1 );
+		}
+		// The definition keeps the clip alive, hence its address unique.
+		slots = def.mClipSlots.emplace( clip.get(), std::make_pair( clip, std::move( channelSlots ) ) ).first;
+	}
+	// Elements of an unordered_map stay put as it grows.
+	mClipSlots.emplace_back( clip.get(), &slots->second.second );
+	return slots->second.second;
+}
+
+void Skeleton::animate( const SampledClipRef& clip, float time )
+{
+	const std::vector<int32_t>& channelSlots = findClipSlots( clip );
+	
+	clip->sample( time, channelSlots.data(), mPose->getLocalPositions(), mPose->getLocalRotations(), mPose->getLocalScales() );
+	for( size_t i = 0; i < mCursors.size(); ++i ) {
+		mPose->setAnimated( i, false );
+	}
+	for( int32_t slot : channelSlots ) {
+		if( slot >= 0 ) {
+			mPose->setAnimated( size_t( slot ), true );
+		}
+	}
+	mPose->setTime( time );
+	mPose->invalidate();
+}
+
+void Skeleton::resetToInitial()
+{
+	const Definition& def = *mDefinition;
+	std::copy( def.mInitialPositions.begin(), def.mInitialPositions.end(), mPose->getLocalPositions() );
+	std::copy( def.mInitialRotations.begin(), def.mInitialRotations.end(), mPose->getLocalRotations() );
+	std::copy( def.mInitialScales.begin(), def.mInitialScales.end(), mPose->getLocalScales() );
+	mPose->invalidate();
+}
 	
 ci::AxisAlignedBox Skeleton::calcBoundingBox() const
 {
 	ci::AxisAlignedBox bb;
-	traverseNodes( [&bb, this] ( const NodeRef& node ) {
-						if( isNodeVisible( node ) ) {
-							bb.include( node->getAbsolutePosition() );
-						}
-					} );
-	
+	const auto& nodes = getNodes();
+	for( size_t i = 0; i < nodes.size(); ++i ) {
+		if( isNodeVisible( nodes[i] ) ) {
+			bb.include( mPose->getWorldPosition( i ) );
+		}
+	}
 	return bb;
 }
 
 
 std::ostream& operator<<( std::ostream& o, const Skeleton& skeleton )
 {	
-	skeleton.traverseNodes( [& o] (const NodeRef& node)
-						   {
-							   o << "Node:" << node->getName() << " level:" << node->getLevel();
-							   
-							   auto parent = node->getParent().lock();
-							   if( parent ) {
-								   o << " parent:" << parent->getName();
-							   }
-							   o << std::endl;
-							   o << "Position:" << node->getAbsolutePosition() << std::endl;
-						   });
+	const auto& nodes = skeleton.getNodes();
+	for( size_t i = 0; i < nodes.size(); ++i ) {
+		const NodeRef& node = nodes[i];
+		o << "Node:" << node->getName() << " level:" << node->getLevel();
+		
+		auto parent = node->getParent().lock();
+		if( parent ) {
+			o << " parent:" << parent->getName();
+		}
+		o << std::endl;
+		o << "Position:" << skeleton.getPose()->getWorldPosition( i ) << std::endl;
+	}
 	return o;
 }
 
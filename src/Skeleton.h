@@ -9,7 +9,9 @@
 #pragma once
 
 #include "Node.h"
+#include "Pose.h"
 #include "ModelIo.h"
+#include "SampledClip.h"
 
 #include "cinder/AxisAlignedBox.h"
 
@@ -17,12 +19,20 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <functional>
+#include <mutex>
 
 namespace model {
 
 /** 
  * The skeleton is composed of a hierachy of nodes, some of which are its bones.
  * Its bones are internally identified by a map from std::string names to NodeRef(s).
+ * The nodes are also flattened parent-first into a Pose, which stores their transformations
+ * and which they become views over: animating the skeleton samples every node into the pose,
+ * whose world transformations are then computed in one linear pass.
+ * 
+ * What doesn't change once loaded (nodes, bones, initial transformations, animation channels) is
+ * held in a definition shared by every instance of the skeleton (see createInstance()); an instance
+ * only owns its pose (referring to the definition's parents) and playback cursors.
  **/
 class Skeleton {
 public:
@@ -42,37 +52,119 @@ public:
 	static SkeletonRef create( const NodeRef& rootNode );
 	static SkeletonRef create( const NodeRef& rootNode, std::unordered_map<std::string, NodeRef> bones );
 	
-	//! Deep copy of the node hierarchy and names map. Heavy, non-recommended operation. Prefer extracting different informations out of the same skeleton.
+	/*!
+	 * Another skeleton sharing this one's definition, with a pose of its own starting at the initial transformations.
+	 * Takes a few allocations and O(nodes) copies, about 93 bytes per node (see getMemorySize()): the way to animate several
+	 * characters independently. The nodes are shared too and remain views over the pose of the skeleton they were created with
+	 * (see isInstance()); read an instance's transformations from its getPose(), or with getWorldTransform().
+	 */
+	SkeletonRef		createInstance() const;
+	//! Whether the nodes are views over another skeleton's pose, i.e. this skeleton was made by createInstance().
+	bool			isInstance() const { return mDefinition->mNodes.empty() || mDefinition->mNodes.front()->getPose() != mPose; }
+	//! Bytes owned by this skeleton alone: itself, its pose and its playback cursors, not the definition its instances share.
+	size_t			getMemorySize() const;
+	//! Deep copy of the node hierarchy and bones (animation tracks are shared), i.e. to edit it separately. Prefer createInstance() to pose it separately.
 	virtual SkeletonRef clone() const;
 	
-	const NodeRef&	getRootNode() const { return mRootNode; }
+	//! Shared by every instance: on an instance (see isInstance()), its transformations are not this skeleton's.
+	const NodeRef&	getRootNode() const { return mDefinition->mRootNode; }
+	/*!
+	 * First node named \a name, in the order of getNodes(). Nodes are shared by every instance and view the pose of the skeleton
+	 * they were created with: on an instance (see isInstance()), use getWorldTransform( name ) rather than the node's transformations.
+	 */
 	NodeRef			getNode( const std::string& name) const;
+	//! World transformation of the first node named \a name in this skeleton's pose, instances included; identity if there is none.
+	glm::mat4		getWorldTransform( const std::string& name ) const;
+	//! Pose slot of the first node named \a name, -1 if there is none.
+	int32_t			getNodeIndex( const std::string& name ) const;
 	bool			isNodeVisible( const NodeRef& node ) const;
+	//! Visits the nodes parent-first, in the order of getNodes().
 	void			traverseNodes( std::function<void(const NodeRef&)> visit ) const;
 	static void		traverseNodes( const NodeRef& node, std::function<void(const NodeRef&)> visit );
 	
 	bool			hasBone( const std::string& name ) const;
 	NodeRef			getBone( const std::string& name ) const;
-	size_t			getNumBones() { return mBones.size(); }
-	const std::unordered_map<std::string, NodeRef>&	getBones() const { return mBones; }
+	size_t			getNumBones() { return mDefinition->mBones.size(); }
+	const std::unordered_map<std::string, NodeRef>&	getBones() const { return mDefinition->mBones; }
 	
-	//! Resulting box depends on the current Skeleton::RenderMode.
+	//! Resulting box, in the pose of this skeleton, depends on the current Skeleton::RenderMode.
 	ci::AxisAlignedBox calcBoundingBox() const;
+	
+	//! Nodes in parent-first order; node \a i is stored in slot \a i of getPose(). Shared by every instance, as getNode()'s.
+	const std::vector<NodeRef>&	getNodes() const { return mDefinition->mNodes; }
+	const PoseRef&				getPose() const { return mPose; }
+	
+	//! Samples track \a trackId at \a time for every node, interpolating all of them at once (see AnimBatch). Nodes without that track keep their transformation.
+	void			animate( float time, int trackId = 0 );
+	//! Weighted blend of several tracks, as Node::blendAnimate() but for every node at once. See BlendGraph for masks and additive layers.
+	void			blendAnimate( float time, const std::unordered_map<int, float>& weights );
+	//! Samples a pre-sampled clip at \a time. Nodes without a channel in the clip keep their transformation.
+	void			animate( const SampledClipRef& clip, float time );
+	void			resetToInitial();
+	
+	//! Skinning matrices (world transformation * offset) of the current pose, indexed by bone index.
+	void			computeSkinningMatrices( std::vector<glm::mat4>* matrices ) const;
+	//! Skinning matrices of the \a numBones bones \a boneIndices only, e.g. a palette (see SkeletalMesh::Section::getBonePalette()); identity for bones the skeleton lacks.
+	void			computeSkinningMatrices( const uint32_t* boneIndices, size_t numBones, glm::mat4* matrices ) const;
+	//! Size of the computeSkinningMatrices() palette: one more than the largest bone index.
+	size_t			getNumBoneSlots() const { return mDefinition->mNumBoneSlots; }
 protected:
+	struct BoneBinding {
+		size_t		mBoneIndex, mPoseIndex;
+		glm::mat4	mOffset;
+	};
+	
+	//! Shared by the instances of a skeleton, and left untouched once built but for the clip slots, which are guarded.
+	struct Definition {
+		NodeRef										mRootNode;
+		std::unordered_map<std::string, NodeRef>	mBones;
+		//! Nodes in parent-first order, and the slot of the parent of each.
+		std::vector<NodeRef>						mNodes;
+		std::vector<int32_t>						mParents;
+		//! Slot of the first node of each name.
+		std::unordered_map<std::string, int32_t>	mNodeSlots;
+		std::vector<glm::vec3>						mInitialPositions, mInitialScales;
+		std::vector<glm::quat>						mInitialRotations;
+		//! Per track id, the track of every node (in pose order), null where a node is not animated.
+		std::unordered_map<int, std::vector<AnimTrack*>>	mChannels;
+		std::vector<BoneBinding>					mBoneBindings;
+		//! Per bone index, the index of its binding, -1 if the skeleton lacks the bone.
+		std::vector<int32_t>						mBoneBindingIndices;
+		size_t										mNumBoneSlots;
+		
+		//! Per sampled clip played by any instance, the pose slot of each of its channels (-1 if absent).
+		std::unordered_map<const SampledClip*, std::pair<SampledClipRef, std::vector<int32_t>>>	mClipSlots;
+		std::mutex									mClipSlotsMutex;
+	};
+	typedef std::shared_ptr<Definition> DefinitionRef;
+	
 	Skeleton( const NodeRef& rootNode );
 	Skeleton( const NodeRef& rootNode, std::unordered_map<std::string, NodeRef> bones );
+	//! A new instance of \a definition.
+	Skeleton( const DefinitionRef& definition );
 	
-	//! Find the node by traversing the hierarchy
-	NodeRef findNode( const std::string& name, const NodeRef& node ) const;
+	//! Flattens the hierarchy and binds the nodes to the pose.
+	void	initPose();
+	//! The definition's parents, shared with (and kept alive by) the poses of its instances.
+	std::shared_ptr<const std::vector<int32_t>>	getSharedParents() const { return std::shared_ptr<const std::vector<int32_t>>( mDefinition, &mDefinition->mParents ); }
+	//! Collects the pose slot and offset of each bone, once the bones are set.
+	void	initBones();
+	//! Slots of the channels of \a clip, computed by the first instance to play it.
+	const std::vector<int32_t>&	findClipSlots( const SampledClipRef& clip );
 	
 	friend std::ostream& operator<<( std::ostream& o, const Skeleton& skeleton );
+	friend class BlendGraph;
 
 private:
 	Skeleton( const Skeleton &rhs ); // private to prevent copying; use clone() method instead
 	Skeleton& operator=( const Skeleton &rhs ); // not defined to prevent copying
 	
-	NodeRef mRootNode;
-	std::unordered_map<std::string, NodeRef> mBones;
+	DefinitionRef			mDefinition;
+	PoseRef					mPose;
+	//! Playback position of each node in its curves, making sequential animate() calls search-free.
+	std::vector<AnimTrack::Cursor>	mCursors;
+	//! The definition's slots of the clips this instance played, searched without locking.
+	std::vector<std::pair<const SampledClip*, const std::vector<int32_t>*>>	mClipSlots;
 };
 
 extern std::ostream& operator<<( std::ostream& lhs, const Skeleton& rhs );
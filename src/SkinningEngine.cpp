@@ -0,0 +1,140 @@
+#include "SkinningEngine.h"
+#include "Parallel.h"
+
+#include "cinder/CinderAssert.h"
+
+#include "glm/gtc/type_ptr.hpp"
+
+#include <algorithm>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+	#define MODEL_SKINNING_USE_SSE2
+	#include <emmintrin.h>
+#endif
+
+using namespace model;
+using namespace glm;
+
+namespace {
+	//! Vertices per job: large enough to amortize scheduling, small enough to balance threads.
+	const size_t BATCH_SIZE = 4096;
+	
+	inline vec3 normalizeOrZero( const vec3& v )
+	{
+		float lengthSquared = dot( v, v );
+		return lengthSquared > 0.0f ? v * inversesqrt( lengthSquared ) : v;
+	}
+}
+
+SkinningEngineRef SkinningEngine::create( const SectionSource& source, size_t numThreads )
+{
+	return SkinningEngineRef( new SkinningEngine( source, numThreads ) );
+}
+
+SkinningEngine::SkinningEngine( const SectionSource& source, size_t numThreads )
+: mNumThreads( numThreads )
+, mPositions( source.getPositions().begin(), source.getPositions().end() )
+, mNumBones( 0 )
+, mSkinnedBegin( 0 )
+, mSkinnedEnd( 0 )
+{
+	if( source.getNormals().size() == mPositions.size() ) {
+		mNormals.assign( source.getNormals().begin(), source.getNormals().end() );
+	}
+	
+	const size_t numVertices = mPositions.size();
+	mBoneIndices.resize( numVertices );
+	mBoneWeights.resize( numVertices );
+	mNumInfluences.resize( numVertices, 0 );
+	
+	const auto& weights = source.getWeights();
+	if( weights.size() != numVertices ) {
+		return;
+	}
+	for( size_t v = 0; v < numVertices; ++v ) {
+		const size_t numInfluences = weights[v].getNumActiveWeights();
+		mNumInfluences[v] = uint8_t( numInfluences );
+		if( numInfluences > 0 ) {
+			mSkinnedBegin = ( mSkinnedEnd == 0 ) ? v : mSkinnedBegin;
+			mSkinnedEnd = v + 1;
+		}
+		for( size_t i = 0; i < numInfluences; ++i ) {
+			mBoneIndices[v][i] = uint16_t( source.getBoneIndices()[v][i] );
+			mBoneWeights[v][i] = source.getBoneWeights()[v][i];
+			mNumBones = std::max<size_t>( mNumBones, mBoneIndices[v][i] + 1 );
+		}
+	}
+}
+
+void SkinningEngine::skin( const std::vector<glm::mat4>& palette, glm::vec3* positions, glm::vec3* normals ) const
+{
+	CI_ASSERT_MSG( palette.size() >= mNumBones, "Palette is missing bones." );
+	if( ! hasNormals() ) {
+		normals = nullptr;
+	}
+	
+	const size_t numVertices = getNumVertices();
+	const size_t numBatches = ( numVertices + BATCH_SIZE - 1 ) / BATCH_SIZE;
+	parallelFor( numBatches, mNumThreads, [&] ( size_t b ) {
+		skinRange( b * BATCH_SIZE, std::min( numVertices, ( b + 1 ) * BATCH_SIZE ), palette.data(), positions, normals );
+	} );
+}
+
+void SkinningEngine::skinRange( size_t begin, size_t end, const glm::mat4* palette, glm::vec3* positions, glm::vec3* normals ) const
+{
+	for( size_t v = begin; v < end; ++v ) {
+		const size_t numInfluences = mNumInfluences[v];
+		if( numInfluences == 0 ) {
+			positions[v] = mPositions[v];
+			if( normals ) {
+				normals[v] = mNormals[v];
+			}
+			continue;
+		}
+		
+		const auto& bones = mBoneIndices[v];
+		const vec4& weights = mBoneWeights[v];
+#if defined( MODEL_SKINNING_USE_SSE2 )
+		// Weighted sum of the bone matrices, one column per register.
+		const float* m = value_ptr( palette[bones[0]] );
+		__m128 w = _mm_set1_ps( weights[0] );
+		__m128 c0 = _mm_mul_ps( _mm_loadu_ps( m ), w );
+		__m128 c1 = _mm_mul_ps( _mm_loadu_ps( m + 4 ), w );
+		__m128 c2 = _mm_mul_ps( _mm_loadu_ps( m + 8 ), w );
+		__m128 c3 = _mm_mul_ps( _mm_loadu_ps( m + 12 ), w );
+		for( size_t i = 1; i < numInfluences; ++i ) {
+			m = value_ptr( palette[bones[i]] );
+			w = _mm_set1_ps( weights[i] );
+			c0 = _mm_add_ps( c0, _mm_mul_ps( _mm_loadu_ps( m ), w ) );
+			c1 = _mm_add_ps( c1, _mm_mul_ps( _mm_loadu_ps( m + 4 ), w ) );
+			c2 = _mm_add_ps( c2, _mm_mul_ps( _mm_loadu_ps( m + 8 ), w ) );
+			c3 = _mm_add_ps( c3, _mm_mul_ps( _mm_loadu_ps( m + 12 ), w ) );
+		}
+		
+		alignas( 16 ) float out[4];
+		const vec3& p = mPositions[v];
+		__m128 r = _mm_add_ps( _mm_add_ps( _mm_mul_ps( c0, _mm_set1_ps( p.x ) ), _mm_mul_ps( c1, _mm_set1_ps( p.y ) ) ),
+							   _mm_add_ps( _mm_mul_ps( c2, _mm_set1_ps( p.z ) ), c3 ) );
+		_mm_store_ps( out, r );
+		positions[v] = vec3( out[0], out[1], out[2] );
+		
+		if( normals ) {
+			// Directions: no translation column.
+			const vec3& n = mNormals[v];
+			r = _mm_add_ps( _mm_add_ps( _mm_mul_ps( c0, _mm_set1_ps( n.x ) ), _mm_mul_ps( c1, _mm_set1_ps( n.y ) ) ),
+						    _mm_mul_ps( c2, _mm_set1_ps( n.z ) ) );
+			_mm_store_ps( out, r );
+			normals[v] = normalizeOrZero( vec3( out[0], out[1], out[2] ) );
+		}
+#else
+		mat4 skinning = palette[bones[0]] * weights[0];
+		for( size_t i = 1; i < numInfluences; ++i ) {
+			skinning += palette[bones[i]] * weights[i];
+		}
+		positions[v] = vec3( skinning * vec4( mPositions[v], 1.0f ) );
+		if( normals ) {
+			normals[v] = normalizeOrZero( vec3( skinning * vec4( mNormals[v], 0.0f ) ) );
+		}
+#endif
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "ModelIo.h"
+
+#include <array>
+#include <vector>
+
+namespace model {
+
+typedef std::shared_ptr<class SkinningEngine> SkinningEngineRef;
+
+/*!
+ * Linear blend skinning on the CPU for one section.
+ * The bind pose and bone influences are extracted once; skin() then blends, for every vertex,
+ * the palette matrices of its bones (4 SIMD columns where available) and transforms the bind
+ * position and normal with the result. Vertices are processed in batches spread over threads.
+ */
+class SkinningEngine {
+public:
+	//! \a numThreads caps the threads used by skin(), 0 using every hardware thread.
+	static SkinningEngineRef create( const SectionSource& source, size_t numThreads = 0 );
+	
+	size_t	getNumVertices() const { return mPositions.size(); }
+	bool	hasNormals() const { return ! mNormals.empty(); }
+	const std::vector<glm::vec3>&	getBindPositions() const { return mPositions; }
+	const std::vector<glm::vec3>&	getBindNormals() const { return mNormals; }
+	//! Vertices outside [getSkinnedBegin(), getSkinnedEnd()) have no bone influences, hence never leave the bind pose.
+	size_t	getSkinnedBegin() const { return mSkinnedBegin; }
+	size_t	getSkinnedEnd() const { return mSkinnedEnd; }
+	
+	/*!
+	 * Skins the section with \a palette (skinning matrices indexed by bone index, see Skeleton::computeSkinningMatrices())
+	 * into caller-supplied buffers of getNumVertices() elements. \a normals may be null, and is ignored if the section has none.
+	 * Vertices without bone influences keep their bind pose.
+	 */
+	void	skin( const std::vector<glm::mat4>& palette, glm::vec3* positions, glm::vec3* normals ) const;
+protected:
+	SkinningEngine( const SectionSource& source, size_t numThreads );
+	
+	void	skinRange( size_t begin, size_t end, const glm::mat4* palette, glm::vec3* positions, glm::vec3* normals ) const;
+	
+	size_t										mNumThreads;
+	std::vector<glm::vec3>						mPositions, mNormals;
+	std::vector<std::array<uint16_t, Weights::NB_WEIGHTS>>	mBoneIndices;
+	std::vector<glm::vec4>						mBoneWeights;
+	std::vector<uint8_t>						mNumInfluences;
+	size_t										mNumBones;
+	size_t										mSkinnedBegin, mSkinnedEnd;
+};
+
+} //end namespace model
@@ -2,27 +2,54 @@
 #include "ModelIo.h"
 #include "Renderer.h"
 
+#include <algorithm>
+
 using namespace ci;
 using namespace model;
 
-StaticMesh::Section::Section( const SectionSourceRef& source, ci::gl::GlslProgRef shader )
-: ABatchSection( source, shader )
+StaticMesh::Section::Section( const SectionSourceRef& source, ci::gl::GlslProgRef shader, bool packVertices )
+: ABatchSection( source, shader, packVertices )
+, mMeshlets( source->getMeshlets() )
 {
 	
 }
 
-StaticMeshRef StaticMesh::create( const model::Source& source, ci::gl::GlslProgRef shader )
+StaticMeshRef StaticMesh::create( const model::Source& source, ci::gl::GlslProgRef shader, bool packVertices, bool mergeSections )
 {
+#if defined( CINDER_GL_ES )
+	// No integer attributes in GLSL ES 1.0, hence no packed shaders.
+	packVertices = false;
+#endif
 	if( ! shader )
-		shader = model::Renderer::instance().getShader( MeshType::STATIC );
+		shader = model::Renderer::instance().getShader( packVertices ? MeshType::PACKED_STATIC : MeshType::STATIC );
 
-	return StaticMeshRef( new StaticMesh( source, shader ) );
+	return StaticMeshRef( new StaticMesh( source, shader, packVertices, mergeSections ) );
 }
 
-StaticMesh::StaticMesh( const model::Source& source, ci::gl::GlslProgRef shader )
+StaticMesh::StaticMesh( const model::Source& source, ci::gl::GlslProgRef shader, bool packVertices, bool mergeSections )
+: mPacked( packVertices )
 {
-	for( auto& sectionSource : source.getSectionSources() ) {
-		SectionRef section{ new Section{ sectionSource, shader } };
+	std::vector<SectionSourceRef> sectionSources = source.getSectionSources();
+	if( mergeSections ) {
+		// Groups keep the order of their first section.
+		std::vector<std::vector<SectionSourceRef>> groups;
+		for( const auto& sectionSource : sectionSources ) {
+			auto group = std::find_if( groups.begin(), groups.end(), [&] ( const std::vector<SectionSourceRef>& g ) { return g.front()->canMergeWith( *sectionSource ); } );
+			if( group != groups.end() ) {
+				group->push_back( sectionSource );
+			}
+			else {
+				groups.push_back( { sectionSource } );
+			}
+		}
+		sectionSources.clear();
+		for( const auto& group : groups ) {
+			sectionSources.push_back( group.size() > 1 ? SectionSource::merge( group ) : group.front() );
+		}
+	}
+	
+	for( auto& sectionSource : sectionSources ) {
+		SectionRef section{ new Section{ sectionSource, shader, packVertices } };
 		mMeshSections.emplace_back( section );
 	}
 }
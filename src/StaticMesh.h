@@ -14,18 +14,29 @@ namespace model {
 		{
 			friend class StaticMesh;
 		public:
-			Section( const SectionSourceRef& source, ci::gl::GlslProgRef shader );
+			Section( const SectionSourceRef& source, ci::gl::GlslProgRef shader, bool packVertices );
+			
+			const std::vector<Meshlet>&	getMeshlets() const { return mMeshlets; }
+		private:
+			std::vector<Meshlet>		mMeshlets;
 		};
 		typedef std::shared_ptr<Section> SectionRef;
 
-		static StaticMeshRef create( const model::Source& source, ci::gl::GlslProgRef shader = nullptr );
+		/*!
+		 * With \a packVertices, sections are uploaded in the compact PackedVertices layout (and drawn with the packed shader by default).
+		 * OpenGL ES has no packed shaders: \a packVertices is ignored there.
+		 * With \a mergeSections, sections which can be (see SectionSource::canMergeWith()) are merged into one, drawn in one call.
+		 */
+		static StaticMeshRef create( const model::Source& source, ci::gl::GlslProgRef shader = nullptr, bool packVertices = false, bool mergeSections = false );
 		
 		virtual ~StaticMesh() { };
 		
 		const std::vector<SectionRef>&	getSections() const { return mMeshSections; }
+		bool							isPacked() const { return mPacked; }
 	protected:
-		StaticMesh( const model::Source& source, ci::gl::GlslProgRef shader );
+		StaticMesh( const model::Source& source, ci::gl::GlslProgRef shader, bool packVertices, bool mergeSections );
 		
 		std::vector<StaticMesh::SectionRef>	mMeshSections;
+		bool								mPacked;
 	};
 }
\ No newline at end of file
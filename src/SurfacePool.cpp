@@ -5,13 +5,163 @@
 using namespace ci;
 using namespace model;
 
-const std::shared_ptr<ci::Surface>& SurfacePool::loadSurface( const ci::fs::path& filepath )
+SurfacePool::SurfacePool( size_t byteBudget )
+: mByteBudget( byteBudget )
+, mBytes( 0 )
+, mHits( 0 )
+, mMisses( 0 )
+, mEvictions( 0 )
+, mClock( 0 )
+, mGenerations( 0 )
 {
-	if(  mSurfaces.count( filepath ) ) {
-		return mSurfaces.at( filepath );
-	} else {
-		std::shared_ptr<ci::Surface> texture( new ci::Surface( ci::loadImage( filepath ) ) );
-		mSurfaces.emplace( filepath, texture );
-		return mSurfaces.at( filepath );
+}
+
+ci::fs::path SurfacePool::canonicalize( const ci::fs::path& filepath )
+{
+	// Resolves "./a.png" vs "a.png" and symlinks, so that both share the same entry.
+	try {
+		return ci::fs::canonical( filepath );
+	}
+	catch( const ci::fs::filesystem_error& ) {
+		// Missing files: loadImage() will report the error.
+		return filepath;
+	}
+}
+
+SurfacePool::Shard& SurfacePool::getShard( const ci::fs::path& key )
+{
+	return mShards[ std::hash<ci::fs::path>()( key ) % NUM_SHARDS ];
+}
+
+std::shared_ptr<ci::Surface> SurfacePool::loadSurface( const ci::fs::path& filepath, const ci::DataSourceRef& source )
+{
+	const ci::fs::path key = source ? filepath : canonicalize( filepath );
+	Shard& shard = getShard( key );
+	
+	std::promise<std::shared_ptr<ci::Surface>> promise;
+	const uint64_t generation = ++mGenerations;
+	{
+		std::unique_lock<std::mutex> lock( shard.mMutex );
+		auto it = shard.mEntries.find( key );
+		if( it != shard.mEntries.end() ) {
+			++mHits;
+			it->second.mLastUse = ++mClock;
+			auto surface = it->second.mSurface;
+			lock.unlock();
+			// Waits if another thread is still decoding this image.
+			return surface.get();
+		}
+		++mMisses;
+		shard.mEntries.emplace( key, Entry( promise.get_future().share(), generation ) );
+	}
+	
+	// Decode outside of the lock so that different images load in parallel.
+	std::shared_ptr<ci::Surface> surface;
+	try {
+		if( source ) {
+			// Sources from a resolver may carry no file path: the format comes from the key's extension instead.
+			std::string extension = filepath.extension().string();
+			if( ! extension.empty() && extension[0] == '.' ) {
+				extension.erase( 0, 1 );
+			}
+			surface.reset( new ci::Surface( ci::loadImage( source, ci::ImageSource::Options(), extension ) ) );
+		}
+		else {
+			surface.reset( new ci::Surface( ci::loadImage( key ) ) );
+		}
+	}
+	catch( ... ) {
+		// Let waiting threads fail too, and allow a later retry.
+		promise.set_exception( std::current_exception() );
+		std::lock_guard<std::mutex> lock( shard.mMutex );
+		auto it = shard.mEntries.find( key );
+		if( it != shard.mEntries.end() && it->second.mGeneration == generation ) {
+			shard.mEntries.erase( it );
+		}
+		throw;
+	}
+	promise.set_value( surface );
+	
+	const size_t bytes = size_t( surface->getRowBytes() ) * size_t( surface->getHeight() );
+	{
+		std::lock_guard<std::mutex> lock( shard.mMutex );
+		auto it = shard.mEntries.find( key );
+		// The entry is gone, or another thread's, if clear() was called in the meantime: the image is then not cached.
+		if( it != shard.mEntries.end() && it->second.mGeneration == generation ) {
+			it->second.mBytes = bytes;
+			it->second.mLastUse = ++mClock;
+			mBytes += bytes;
+		}
+	}
+	
+	if( mBytes > mByteBudget ) {
+		evict();
+	}
+	return surface;
+}
+
+void SurfacePool::evict()
+{
+	// A single evicting thread at a time, which keeps concurrent misses from overshooting.
+	std::lock_guard<std::mutex> evictionLock( mEvictionMutex );
+	
+	while( mBytes > mByteBudget ) {
+		// Find the globally least recently used decoded image. Evictions are rare
+		// and the number of textures small, so a scan is cheaper than maintaining a shared list.
+		Shard* victimShard = nullptr;
+		ci::fs::path victim;
+		uint64_t oldest = std::numeric_limits<uint64_t>::max();
+		for( auto& shard : mShards ) {
+			std::lock_guard<std::mutex> lock( shard.mMutex );
+			for( const auto& entry : shard.mEntries ) {
+				if( entry.second.mBytes > 0 && entry.second.mLastUse < oldest ) {
+					oldest = entry.second.mLastUse;
+					victim = entry.first;
+					victimShard = &shard;
+				}
+			}
+		}
+		if( ! victimShard ) {
+			break;
+		}
+		
+		std::lock_guard<std::mutex> lock( victimShard->mMutex );
+		auto it = victimShard->mEntries.find( victim );
+		// Skip it if it was used again while we were looking elsewhere.
+		if( it != victimShard->mEntries.end() && it->second.mLastUse == oldest ) {
+			mBytes -= it->second.mBytes;
+			victimShard->mEntries.erase( it );
+			++mEvictions;
+		}
+	}
+}
+
+void SurfacePool::setByteBudget( size_t byteBudget )
+{
+	mByteBudget = byteBudget;
+	if( mBytes > mByteBudget ) {
+		evict();
+	}
+}
+
+SurfacePool::Stats SurfacePool::getStats() const
+{
+	Stats stats;
+	stats.mHits = mHits;
+	stats.mMisses = mMisses;
+	stats.mEvictions = mEvictions;
+	stats.mBytes = mBytes;
+	return stats;
+}
+
+void SurfacePool::clear()
+{
+	std::lock_guard<std::mutex> evictionLock( mEvictionMutex );
+	for( auto& shard : mShards ) {
+		std::lock_guard<std::mutex> lock( shard.mMutex );
+		for( const auto& entry : shard.mEntries ) {
+			mBytes -= entry.second.mBytes;
+		}
+		shard.mEntries.clear();
 	}
-}
\ No newline at end of file
+}
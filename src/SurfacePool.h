@@ -1,7 +1,13 @@
 #pragma once
 
 #include "cinder/Surface.h"
+#include "cinder/DataSource.h"
 
+#include <array>
+#include <atomic>
+#include <future>
+#include <limits>
+#include <mutex>
 #include <unordered_map>
 #include "cinder/Noncopyable.h"
 
@@ -23,11 +29,62 @@ namespace model {
 	
 	typedef std::shared_ptr<class SurfacePool> SurfacePoolRef;
 	
+	/*!
+	 * Caches decoded images by canonical path. Safe to use from several loading threads at once:
+	 * lookups are spread over independently locked shards, and concurrent requests for an image
+	 * which is still being decoded wait for that decode instead of starting their own.
+	 * Once the decoded images exceed the byte budget, the least recently used ones are dropped
+	 * from the cache (surfaces still referenced elsewhere stay alive).
+	 */
 	class SurfacePool : public ci::Noncopyable {
 	public:
-		const std::shared_ptr<ci::Surface>& loadSurface( const ci::fs::path& filepath );
+		struct Stats {
+			size_t mHits, mMisses, mEvictions;
+			//! Bytes currently held by the cache.
+			size_t mBytes;
+		};
+		
+		explicit SurfacePool( size_t byteBudget = std::numeric_limits<size_t>::max() );
+		
+		/*!
+		 * Decodes \a filepath, or \a source if given, in which case \a filepath is only used as cache key
+		 * (useful for images living in archives or memory).
+		 */
+		std::shared_ptr<ci::Surface>	loadSurface( const ci::fs::path& filepath, const ci::DataSourceRef& source = nullptr );
+		
+		void	setByteBudget( size_t byteBudget );
+		size_t	getByteBudget() const { return mByteBudget; }
+		Stats	getStats() const;
+		//! Drops every decoded image. Decodes in flight complete but are not cached.
+		void	clear();
 	private:
-		std::unordered_map<ci::fs::path, std::shared_ptr<ci::Surface>> mSurfaces;
+		static const size_t NUM_SHARDS = 16;
+		
+		struct Entry {
+			Entry( const std::shared_future<std::shared_ptr<ci::Surface>>& surface, uint64_t generation ) : mSurface( surface ), mBytes( 0 ), mLastUse( 0 ), mGeneration( generation ) { }
+			std::shared_future<std::shared_ptr<ci::Surface>>	mSurface;
+			//! Zero while the image is being decoded; such entries are never evicted.
+			size_t												mBytes;
+			uint64_t											mLastUse;
+			//! Unique per entry: a decode only updates or erases the entry it created, not one inserted after a clear().
+			uint64_t											mGeneration;
+		};
+		
+		struct Shard {
+			std::mutex										mMutex;
+			std::unordered_map<ci::fs::path, Entry>			mEntries;
+		};
+		
+		static ci::fs::path	canonicalize( const ci::fs::path& filepath );
+		Shard&				getShard( const ci::fs::path& key );
+		//! Drops least recently used images until the cache fits its budget.
+		void				evict();
+		
+		std::array<Shard, NUM_SHARDS>	mShards;
+		std::mutex						mEvictionMutex;
+		std::atomic<size_t>				mByteBudget, mBytes;
+		std::atomic<size_t>				mHits, mMisses, mEvictions;
+		std::atomic<uint64_t>			mClock, mGenerations;
 	};
 	
 } //end namespace model